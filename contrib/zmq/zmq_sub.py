@@ -46,6 +46,8 @@ class ZMQHandler():
         self.zmqSubSocket.setsockopt_string(zmq.SUBSCRIBE, "hashtx")
         self.zmqSubSocket.setsockopt_string(zmq.SUBSCRIBE, "rawblock")
         self.zmqSubSocket.setsockopt_string(zmq.SUBSCRIBE, "rawtx")
+        self.zmqSubSocket.setsockopt_string(zmq.SUBSCRIBE, "mempoolremoval")
+        self.zmqSubSocket.setsockopt_string(zmq.SUBSCRIBE, "addressdelta")
         self.zmqSubSocket.connect("tcp://127.0.0.1:%i" % port)
 
     async def handle(self) :
@@ -68,6 +70,13 @@ class ZMQHandler():
         elif topic == b"rawtx":
             print('- RAW TX ('+sequence+') -')
             print(binascii.hexlify(body))
+        elif topic == b"mempoolremoval":
+            print('- MEMPOOL REMOVAL ('+sequence+') reason '+str(body[32])+' -')
+            print(binascii.hexlify(body[:32]))
+        elif topic == b"addressdelta":
+            height, connected = struct.unpack('<IB', body[32:37])
+            print('- ADDRESS DELTA ('+sequence+') height '+str(height)+(' connected' if connected else ' disconnected')+' -')
+            print(binascii.hexlify(body[:32]))
         # schedule ourselves to receive the next message
         asyncio.ensure_future(self.handle())
 
@@ -4,6 +4,7 @@
 
 #include <base58.h>
 
+#include <crypto/sha256.h>
 #include <hash.h>
 #include <uint256.h>
 
@@ -31,6 +32,11 @@ static const int8_t mapBase58[256] = {
     -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
 };
 
+/** Base58 digits are handled five at a time, which keeps a limb below 2^30 */
+static const int BASE58_LIMB_DIGITS = 5;
+static const uint32_t BASE58_LIMB = 58 * 58 * 58 * 58 * 58;
+static const uint32_t BASE58_POW[BASE58_LIMB_DIGITS + 1] = {1, 58, 58 * 58, 58 * 58 * 58, 58 * 58 * 58 * 58, BASE58_LIMB};
+
 bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
 {
     // Skip leading spaces.
@@ -38,45 +44,57 @@ bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
         psz++;
     // Skip and count leading '1's.
     int zeroes = 0;
-    int length = 0;
     while (*psz == '1') {
         zeroes++;
         psz++;
     }
-    // Allocate enough space in big-endian base256 representation.
-    int size = strlen(psz) * 733 /1000 + 1; // log(58) / log(256), rounded up.
-    std::vector<unsigned char> b256(size);
-    // Process the characters.
+    const char* pend = psz;
+    while (*pend && !isspace(*pend))
+        pend++;
+    // Skip trailing spaces.
+    const char* ptail = pend;
+    while (isspace(*ptail))
+        ptail++;
+    if (*ptail != 0)
+        return false;
+    // Allocate enough 32-bit limbs, least significant first.
+    const size_t digits = pend - psz;
+    std::vector<uint32_t> limbs(digits * 733 / 1000 / 4 + 1); // log(58) / log(256), rounded up.
+    size_t length = 0;
     static_assert(sizeof(mapBase58)/sizeof(mapBase58[0]) == 256, "mapBase58.size() should be 256"); // guarantee not out of range
-    while (*psz && !isspace(*psz)) {
-        // Decode base58 character
-        int carry = mapBase58[(uint8_t)*psz];
-        if (carry == -1)  // Invalid b58 character
-            return false;
-        int i = 0;
-        for (std::vector<unsigned char>::reverse_iterator it = b256.rbegin(); (carry != 0 || i < length) && (it != b256.rend()); ++it, ++i) {
-            carry += 58 * (*it);
-            *it = carry % 256;
-            carry /= 256;
+    // Process the characters in groups, the first one short if needed: "limbs = limbs * 58^n + group".
+    size_t n = digits % BASE58_LIMB_DIGITS;
+    if (n == 0) n = BASE58_LIMB_DIGITS;
+    while (psz != pend) {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; i++) {
+            const int digit = mapBase58[(uint8_t)*psz++];
+            if (digit == -1)  // Invalid b58 character
+                return false;
+            carry = carry * 58 + digit;
+        }
+        size_t i = 0;
+        for (; (carry != 0 || i < length) && i < limbs.size(); i++) {
+            carry += (uint64_t)limbs[i] * BASE58_POW[n];
+            limbs[i] = (uint32_t)carry;
+            carry >>= 32;
         }
         assert(carry == 0);
         length = i;
-        psz++;
+        n = BASE58_LIMB_DIGITS;
     }
-    // Skip trailing spaces.
-    while (isspace(*psz))
-        psz++;
-    if (*psz != 0)
-        return false;
-    // Skip leading zeroes in b256.
-    std::vector<unsigned char>::iterator it = b256.begin() + (size - length);
-    while (it != b256.end() && *it == 0)
-        it++;
-    // Copy result into output vector.
-    vch.reserve(zeroes + (b256.end() - it));
+    // Copy the bytes into the output vector without leading zeroes.
     vch.assign(zeroes, 0x00);
-    while (it != b256.end())
-        vch.push_back(*(it++));
+    vch.reserve(zeroes + length * 4);
+    bool leading = true;
+    for (size_t i = length; i-- > 0;) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            const unsigned char byte = limbs[i] >> shift;
+            if (leading && byte == 0) continue;
+            leading = false;
+            vch.push_back(byte);
+        }
+    }
     return true;
 }
 
@@ -84,39 +102,47 @@ std::string EncodeBase58(const unsigned char* pbegin, const unsigned char* pend)
 {
     // Skip & count leading zeroes.
     int zeroes = 0;
-    int length = 0;
     while (pbegin != pend && *pbegin == 0) {
         pbegin++;
         zeroes++;
     }
-    // Allocate enough space in big-endian base58 representation.
-    int size = (pend - pbegin) * 138 / 100 + 1; // log(256) / log(58), rounded up.
-    std::vector<unsigned char> b58(size);
-    // Process the bytes.
+    // Allocate enough limbs of five base58 digits, least significant first.
+    std::vector<uint32_t> limbs((pend - pbegin) * 138 / 100 / BASE58_LIMB_DIGITS + 1); // log(256) / log(58), rounded up.
+    size_t length = 0;
+    // Process the bytes four at a time, the first word short if needed: "limbs = limbs * 256^n + word".
+    size_t n = (pend - pbegin) % 4;
+    if (n == 0) n = 4;
     while (pbegin != pend) {
-        int carry = *pbegin;
-        int i = 0;
-        // Apply "b58 = b58 * 256 + ch".
-        for (std::vector<unsigned char>::reverse_iterator it = b58.rbegin(); (carry != 0 || i < length) && (it != b58.rend()); it++, i++) {
-            carry += 256 * (*it);
-            *it = carry % 58;
-            carry /= 58;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; i++) {
+            carry = (carry << 8) | *pbegin++;
+        }
+        size_t i = 0;
+        for (; (carry != 0 || i < length) && i < limbs.size(); i++) {
+            carry += (uint64_t)limbs[i] << (8 * n);
+            limbs[i] = carry % BASE58_LIMB;
+            carry /= BASE58_LIMB;
         }
-
         assert(carry == 0);
         length = i;
-        pbegin++;
+        n = 4;
     }
-    // Skip leading zeroes in base58 result.
-    std::vector<unsigned char>::iterator it = b58.begin() + (size - length);
-    while (it != b58.end() && *it == 0)
-        it++;
-    // Translate the result into a string.
+    // Translate the result into a string, skipping leading zeroes.
     std::string str;
-    str.reserve(zeroes + (b58.end() - it));
+    str.reserve(zeroes + length * BASE58_LIMB_DIGITS);
     str.assign(zeroes, '1');
-    while (it != b58.end())
-        str += pszBase58[*(it++)];
+    const size_t start = str.size();
+    for (size_t i = length; i-- > 0;) {
+        char group[BASE58_LIMB_DIGITS];
+        uint32_t limb = limbs[i];
+        for (int j = BASE58_LIMB_DIGITS - 1; j >= 0; j--) {
+            group[j] = pszBase58[limb % 58];
+            limb /= 58;
+        }
+        str.append(group, BASE58_LIMB_DIGITS);
+    }
+    const size_t first = str.find_first_not_of('1', start);
+    str.erase(start, (first == std::string::npos ? str.size() : first) - start);
     return str;
 }
 
@@ -139,6 +165,29 @@ std::string EncodeBase58Check(const std::vector<unsigned char>& vchIn)
     return EncodeBase58(vch);
 }
 
+std::vector<std::string> EncodeBase58CheckMulti(const std::vector<std::vector<unsigned char>>& vchIn)
+{
+    std::vector<const unsigned char*> inputs(vchIn.size());
+    std::vector<size_t> lengths(vchIn.size());
+    for (size_t i = 0; i < vchIn.size(); i++) {
+        inputs[i] = vchIn[i].data();
+        lengths[i] = vchIn[i].size();
+    }
+    std::vector<unsigned char> hashes(vchIn.size() * CSHA256::OUTPUT_SIZE);
+    SHA256DMulti(hashes.data(), inputs.data(), lengths.data(), vchIn.size());
+
+    std::vector<std::string> ret;
+    ret.reserve(vchIn.size());
+    std::vector<unsigned char> vch;
+    for (size_t i = 0; i < vchIn.size(); i++) {
+        // add 4-byte hash check to the end
+        vch.assign(vchIn[i].begin(), vchIn[i].end());
+        vch.insert(vch.end(), &hashes[i * CSHA256::OUTPUT_SIZE], &hashes[i * CSHA256::OUTPUT_SIZE] + 4);
+        ret.push_back(EncodeBase58(vch));
+    }
+    return ret;
+}
+
 bool DecodeBase58Check(const char* psz, std::vector<unsigned char>& vchRet)
 {
     if (!DecodeBase58(psz, vchRet) ||
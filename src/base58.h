@@ -46,6 +46,12 @@ bool DecodeBase58(const std::string& str, std::vector<unsigned char>& vchRet);
  */
 std::string EncodeBase58Check(const std::vector<unsigned char>& vchIn);
 
+/**
+ * Encode several byte vectors into base58-encoded strings, including
+ * checksums. The checksums are hashed side by side, see SHA256DMulti.
+ */
+std::vector<std::string> EncodeBase58CheckMulti(const std::vector<std::vector<unsigned char>>& vchIn);
+
 /**
  * Decode a base58-encoded string (psz) that includes a checksum into a byte
  * vector (vchRet), return true if decoding is successful
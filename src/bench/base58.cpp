@@ -54,6 +54,68 @@ static void Base58Decode(benchmark::State& state)
 }
 
 
+/** A version byte and a key hash, as in a pay-to-pubkey-hash address */
+static std::vector<unsigned char> AddressPayload(unsigned char n)
+{
+    std::vector<unsigned char> vch(21);
+    vch[0] = 30;
+    for (size_t i = 1; i < vch.size(); i++) {
+        vch[i] = n * 37 + i * 101;
+    }
+    return vch;
+}
+
+
+static void Base58EncodeAddress(benchmark::State& state)
+{
+    std::vector<unsigned char> vch = AddressPayload(0);
+    vch.insert(vch.end(), {1, 2, 3, 4});
+    while (state.KeepRunning()) {
+        EncodeBase58(vch);
+    }
+}
+
+
+static void Base58DecodeAddress(benchmark::State& state)
+{
+    const char* addr = "DH5yaieqoZN36fDVciNyRueRGvGLR3mr7L";
+    std::vector<unsigned char> vch;
+    while (state.KeepRunning()) {
+        DecodeBase58(addr, vch);
+    }
+}
+
+
+static void Base58CheckEncodeAddresses_1024(benchmark::State& state)
+{
+    std::vector<std::vector<unsigned char>> payloads;
+    for (int i = 0; i < 1024; i++) {
+        payloads.push_back(AddressPayload(i));
+    }
+    while (state.KeepRunning()) {
+        for (const auto& vch : payloads) {
+            EncodeBase58Check(vch);
+        }
+    }
+}
+
+
+static void Base58CheckEncodeMulti_1024(benchmark::State& state)
+{
+    std::vector<std::vector<unsigned char>> payloads;
+    for (int i = 0; i < 1024; i++) {
+        payloads.push_back(AddressPayload(i));
+    }
+    while (state.KeepRunning()) {
+        EncodeBase58CheckMulti(payloads);
+    }
+}
+
+
 BENCHMARK(Base58Encode, 470 * 1000);
 BENCHMARK(Base58CheckEncode, 320 * 1000);
 BENCHMARK(Base58Decode, 800 * 1000);
+BENCHMARK(Base58EncodeAddress, 2400 * 1000);
+BENCHMARK(Base58DecodeAddress, 2000 * 1000);
+BENCHMARK(Base58CheckEncodeAddresses_1024, 1000);
+BENCHMARK(Base58CheckEncodeMulti_1024, 1000);
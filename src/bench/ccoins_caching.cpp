@@ -4,9 +4,12 @@
 
 #include <bench/bench.h>
 #include <coins.h>
+#include <crypto/common.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <wallet/crypter.h>
 
+#include <stdio.h>
 #include <vector>
 
 // FIXME: Dedup with SetupDummyInputs in test/transaction_tests.cpp.
@@ -85,3 +88,55 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+static COutPoint BenchOutpoint(uint32_t n)
+{
+    uint256 hash;
+    WriteLE32(hash.begin(), n / 4);
+    return COutPoint(hash, n % 4);
+}
+
+static Coin BenchCoin(uint32_t n)
+{
+    // P2PKH sized script, stored inline in the CScript prevector
+    CScript script = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, n & 0xff) << OP_EQUALVERIFY << OP_CHECKSIG;
+    return Coin(CTxOut(n, script), n, false);
+}
+
+// Insert coins until the cache holds 16 MiB, the way blocks fill pcoinsTip
+// during IBD.
+static void CCoinsCacheFill(benchmark::State& state)
+{
+    static const size_t CACHE_BYTES = 16 << 20;
+    CCoinsView coinsDummy;
+    while (state.KeepRunning()) {
+        CCoinsViewCache coins(&coinsDummy);
+        uint32_t n = 0;
+        while (coins.DynamicMemoryUsage() < CACHE_BYTES) {
+            coins.AddCoin(BenchOutpoint(n), BenchCoin(n), false);
+            n++;
+        }
+    }
+}
+
+// Random lookups of cached coins, as ConnectBlock does for block inputs
+static void CCoinsCacheLookup(benchmark::State& state)
+{
+    static const uint32_t NUM_COINS = 200000;
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+    for (uint32_t n = 0; n < NUM_COINS; n++) {
+        coins.AddCoin(BenchOutpoint(n), BenchCoin(n), false);
+    }
+    FastRandomContext rng(true);
+    CAmount total = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000; i++) {
+            total += coins.AccessCoin(BenchOutpoint(rng.randrange(NUM_COINS))).out.nValue;
+        }
+    }
+    assert(total >= 0);
+}
+
+BENCHMARK(CCoinsCacheFill, 2);
+BENCHMARK(CCoinsCacheLookup, 10 * 1000);
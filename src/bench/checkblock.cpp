@@ -4,10 +4,15 @@
 
 #include <bench/bench.h>
 
+#include <blockfilecache.h>
 #include <chainparams.h>
+#include <clientversion.h>
 #include <validation.h>
 #include <streams.h>
 #include <consensus/validation.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <script/standard.h>
 
 namespace block_bench {
 #include <bench/data/block413567.raw.h>
@@ -32,6 +37,89 @@ static void DeserializeBlockTest(benchmark::State& state)
     }
 }
 
+static void DeserializeBlockSpanTest(benchmark::State& state)
+{
+    const Span<const unsigned char> data(block_bench::block413567, sizeof(block_bench::block413567));
+
+    while (state.KeepRunning()) {
+        CBlock block;
+        SpanReader stream(SER_NETWORK, PROTOCOL_VERSION, data);
+        stream >> block;
+        assert(stream.empty());
+    }
+}
+
+//! Copies of the test block in the file read by the on-disk benchmarks
+static const int DISK_BENCH_BLOCKS = 64;
+
+/** File holding copies of the test block, removed when done */
+class BenchBlockFile
+{
+public:
+    const fs::path m_path;
+
+    BenchBlockFile() : m_path(fs::temp_directory_path() / strprintf("bench_blk_%016x.dat", GetRand(std::numeric_limits<uint64_t>::max())))
+    {
+        FILE* file = fsbridge::fopen(m_path, "wb");
+        assert(file);
+        for (int i = 0; i < DISK_BENCH_BLOCKS; i++) {
+            size_t written = fwrite(block_bench::block413567, 1, sizeof(block_bench::block413567), file);
+            assert(written == sizeof(block_bench::block413567));
+        }
+        fclose(file);
+    }
+    ~BenchBlockFile() { fs::remove(m_path); }
+};
+
+static void DeserializeBlockFileTest(benchmark::State& state)
+{
+    BenchBlockFile blocks;
+
+    while (state.KeepRunning()) {
+        CAutoFile file(fsbridge::fopen(blocks.m_path, "rb"), SER_DISK, CLIENT_VERSION);
+        for (int i = 0; i < DISK_BENCH_BLOCKS; i++) {
+            CBlock block;
+            file >> block;
+        }
+    }
+}
+
+// The path ReadBlockFromDisk takes for files that are not mapped
+static void DeserializeBlockReadTest(benchmark::State& state)
+{
+    BenchBlockFile blocks;
+    CBlockFileCache cache(1);
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+
+    while (state.KeepRunning()) {
+        for (int i = 0; i < DISK_BENCH_BLOCKS; i++) {
+            stream.resize(sizeof(block_bench::block413567));
+            bool fRead = cache.Read(blocks.m_path, i * sizeof(block_bench::block413567), (unsigned char*)stream.data(), stream.size());
+            assert(fRead);
+            CBlock block;
+            stream >> block;
+        }
+    }
+}
+
+static void DeserializeBlockMappedTest(benchmark::State& state)
+{
+    BenchBlockFile blocks;
+    CBlockFileCache cache(1);
+    Span<const unsigned char> data;
+    std::shared_ptr<const void> keepalive;
+    if (!cache.Map(blocks.m_path, data, keepalive)) return;
+
+    while (state.KeepRunning()) {
+        SpanReader stream(SER_DISK, CLIENT_VERSION, data);
+        for (int i = 0; i < DISK_BENCH_BLOCKS; i++) {
+            CBlock block;
+            stream >> block;
+        }
+        assert(stream.empty());
+    }
+}
+
 static void DeserializeAndCheckBlockTest(benchmark::State& state)
 {
     CDataStream stream((const char*)block_bench::block413567,
@@ -52,5 +140,79 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
     }
 }
 
+/**
+ * Script checks for the P2PKH inputs of the test block. The outputs they
+ * spend are not part of the block, but follow from the key in the scriptSig.
+ */
+class BenchBlockScriptChecks
+{
+public:
+    CBlock block;
+    std::vector<PrecomputedTransactionData> txdata;
+    std::vector<CScriptCheck> checks;
+
+    BenchBlockScriptChecks()
+    {
+        CDataStream stream((const char*)block_bench::block413567,
+                (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+                SER_NETWORK, PROTOCOL_VERSION);
+        stream >> block;
+        InitSignatureCache();
+
+        txdata.reserve(block.vtx.size());
+        for (const auto& tx : block.vtx) {
+            txdata.emplace_back(*tx);
+            if (tx->IsCoinBase()) continue;
+            for (unsigned int i = 0; i < tx->vin.size(); i++) {
+                std::vector<std::vector<unsigned char>> vPushes;
+                CScript::const_iterator pc = tx->vin[i].scriptSig.begin();
+                opcodetype opcode;
+                std::vector<unsigned char> vch;
+                while (tx->vin[i].scriptSig.GetOp(pc, opcode, vch)) vPushes.push_back(vch);
+                if (vPushes.size() != 2) continue;
+                const CPubKey pubkey(vPushes[1]);
+                if (!pubkey.IsFullyValid()) continue;
+                CScriptCheck check(CTxOut(0, GetScriptForDestination(pubkey.GetID())), *tx, i, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG, false, &txdata.back());
+                if (check()) checks.push_back(check);
+            }
+        }
+        assert(!checks.empty());
+    }
+};
+
+static void VerifyBlockScriptsTest(benchmark::State& state)
+{
+    ECCVerifyHandle verify_handle;
+    BenchBlockScriptChecks block;
+
+    while (state.KeepRunning()) {
+        for (CScriptCheck& check : block.checks) {
+            bool success = check();
+            assert(success);
+        }
+    }
+}
+
+static void VerifyBlockScriptsBatchTest(benchmark::State& state)
+{
+    ECCVerifyHandle verify_handle;
+    BenchBlockScriptChecks block;
+
+    while (state.KeepRunning()) {
+        // In groups the size of the ones the script check queue hands out
+        for (size_t i = 0; i < block.checks.size(); i += 128) {
+            std::vector<CScriptCheck> vChecks(block.checks.begin() + i, block.checks.begin() + std::min(i + 128, block.checks.size()));
+            bool success = RunChecks(vChecks);
+            assert(success);
+        }
+    }
+}
+
 BENCHMARK(DeserializeBlockTest, 130);
+BENCHMARK(DeserializeBlockSpanTest, 130);
+BENCHMARK(DeserializeBlockFileTest, 2);
+BENCHMARK(DeserializeBlockReadTest, 2);
+BENCHMARK(DeserializeBlockMappedTest, 2);
 BENCHMARK(DeserializeAndCheckBlockTest, 160);
+BENCHMARK(VerifyBlockScriptsTest, 1);
+BENCHMARK(VerifyBlockScriptsBatchTest, 1);
@@ -60,6 +60,46 @@ static void SHA256D64_1024(benchmark::State& state)
     }
 }
 
+/* 1024 messages of 150 to 660 bytes, about the size of typical transactions */
+static void TxSizedMessages(std::vector<uint8_t>& data, std::vector<const unsigned char*>& inputs, std::vector<size_t>& lengths)
+{
+    size_t total = 0;
+    for (int i = 0; i < 1024; ++i) {
+        lengths.push_back(150 + (i * 97) % 511);
+        total += lengths.back();
+    }
+    data.assign(total, 0);
+    for (size_t i = 0, offset = 0; i < lengths.size(); offset += lengths[i++]) {
+        inputs.push_back(data.data() + offset);
+    }
+}
+
+static void SHA256D_Txs_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> data;
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    TxSizedMessages(data, inputs, lengths);
+    std::vector<uint8_t> out(32 * inputs.size());
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            CHash256().Write(inputs[i], lengths[i]).Finalize(&out[32 * i]);
+        }
+    }
+}
+
+static void SHA256DMulti_Txs_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> data;
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    TxSizedMessages(data, inputs, lengths);
+    std::vector<uint8_t> out(32 * inputs.size());
+    while (state.KeepRunning()) {
+        SHA256DMulti(out.data(), inputs.data(), lengths.data(), inputs.size());
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -103,5 +143,7 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA256D_Txs_1024, 2000);
+BENCHMARK(SHA256DMulti_Txs_1024, 2000);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
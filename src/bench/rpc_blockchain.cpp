@@ -0,0 +1,93 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <cbor.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <rpc/blockchain.h>
+#include <streams.h>
+#include <validation.h>
+
+#include <univalue.h>
+
+namespace block_bench {
+#include <bench/data/block413567.raw.h>
+} // namespace block_bench
+
+// Encoding cost of a large verbose block reply (getblock verbosity 2 and
+// /rest/block/) as JSON through a UniValue tree versus direct CBOR, and the
+// cost of a full JSON write/read round trip.
+
+static CBlock LoadBenchBlock()
+{
+    CDataStream stream((const char*)block_bench::block413567,
+            (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+            SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+    return block;
+}
+
+static void BlockToJsonVerbose(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const CBlock block = LoadBenchBlock();
+    CBlockIndex blockindex(block);
+    const uint256 blockHash = block.GetHash();
+    blockindex.phashBlock = &blockHash;
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        std::string strJSON = blockToJSON(block, &blockindex, true).write();
+        assert(!strJSON.empty());
+    }
+}
+
+static void BlockToJsonVerboseRoundTrip(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const CBlock block = LoadBenchBlock();
+    CBlockIndex blockindex(block);
+    const uint256 blockHash = block.GetHash();
+    blockindex.phashBlock = &blockHash;
+
+    LOCK(cs_main);
+    // Build, write and re-parse, as an RPC client of getblock would
+    while (state.KeepRunning()) {
+        std::string strJSON = blockToJSON(block, &blockindex, true).write();
+        UniValue parsed;
+        bool ok = parsed.read(strJSON);
+        assert(ok && parsed.isObject());
+    }
+}
+
+static void BlockToCBORVerbose(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const CBlock block = LoadBenchBlock();
+    CBlockIndex blockindex(block);
+    const uint256 blockHash = block.GetHash();
+    blockindex.phashBlock = &blockHash;
+
+    LOCK(cs_main);
+    // The binary reply must be smaller than the JSON one it replaces
+    std::string strCBOR;
+    {
+        CBORWriter writer(strCBOR);
+        blockToCBOR(block, &blockindex, true, writer);
+    }
+    assert(strCBOR.size() < blockToJSON(block, &blockindex, true).write().size());
+
+    while (state.KeepRunning()) {
+        strCBOR.clear();
+        CBORWriter writer(strCBOR);
+        blockToCBOR(block, &blockindex, true, writer);
+    }
+}
+
+BENCHMARK(BlockToJsonVerbose, 10);
+BENCHMARK(BlockToJsonVerboseRoundTrip, 10);
+BENCHMARK(BlockToCBORVerbose, 50);
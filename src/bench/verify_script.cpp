@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <arith_uint256.h>
 #include <bench/bench.h>
 #include <key.h>
 #if defined(HAVE_CONSENSUS_LIB)
@@ -13,6 +14,7 @@
 #include <streams.h>
 
 #include <array>
+#include <memory>
 
 // FIXME: Dedup with BuildCreditingTransaction in test/script_tests.cpp.
 static CMutableTransaction BuildCreditingTransaction(const CScript& scriptPubKey)
@@ -107,3 +109,112 @@ static void VerifyScriptBench(benchmark::State& state)
 }
 
 BENCHMARK(VerifyScriptBench, 6300);
+
+// A transaction with many legacy inputs, where hashing the transaction once
+// per input makes signature hashing quadratic in the number of inputs.
+static CMutableTransaction BuildManyInputTransaction(CScript& scriptCode)
+{
+    static const int nInputs = 500;
+    uint160 pubkeyHash;
+    scriptCode = CScript() << OP_DUP << OP_HASH160 << ToByteVector(pubkeyHash) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    CMutableTransaction tx;
+    tx.nVersion = 1;
+    tx.vin.resize(nInputs);
+    for (int i = 0; i < nInputs; i++) {
+        tx.vin[i].prevout.hash = ArithToUint256(arith_uint256(i + 1));
+        tx.vin[i].prevout.n = i;
+        // A typical P2PKH scriptSig: signature and compressed pubkey
+        tx.vin[i].scriptSig = CScript() << std::vector<unsigned char>(72, 1) << std::vector<unsigned char>(33, 2);
+    }
+    tx.vout.resize(2);
+    for (CTxOut& txout : tx.vout) {
+        txout.nValue = 1;
+        txout.scriptPubKey = scriptCode;
+    }
+    return tx;
+}
+
+static void LegacySigHashManyInputs(benchmark::State& state, bool fPrecompute)
+{
+    CScript scriptCode;
+    const CTransaction tx(BuildManyInputTransaction(scriptCode));
+
+    while (state.KeepRunning()) {
+        std::unique_ptr<PrecomputedTransactionData> txdata;
+        if (fPrecompute) txdata.reset(new PrecomputedTransactionData(tx));
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            SignatureHash(scriptCode, tx, i, SIGHASH_ALL, 0, SigVersion::BASE, txdata.get());
+        }
+    }
+}
+
+static void LegacySigHashManyInputsBench(benchmark::State& state)
+{
+    LegacySigHashManyInputs(state, false);
+}
+
+static void LegacySigHashManyInputsPrecomputedBench(benchmark::State& state)
+{
+    LegacySigHashManyInputs(state, true);
+}
+
+BENCHMARK(LegacySigHashManyInputsBench, 10);
+BENCHMARK(LegacySigHashManyInputsPrecomputedBench, 10);
+
+//! Signatures verified per iteration by the signature verification benchmarks
+static const int VERIFY_BENCH_SIGNATURES = 128;
+
+/** Signatures by a few keys, as when several inputs spend coins of the same address */
+static void BuildSignatures(std::vector<CPubKey>& vPubKeys, std::vector<std::vector<unsigned char>>& vSigs, std::vector<uint256>& vHashes)
+{
+    CKey keys[4];
+    for (int i = 0; i < 4; i++) {
+        const std::array<unsigned char, 32> vchKey = {{(unsigned char)(i + 1)}};
+        keys[i].Set(vchKey.begin(), vchKey.end(), true);
+    }
+    for (int i = 0; i < VERIFY_BENCH_SIGNATURES; i++) {
+        const CKey& key = keys[i % 4];
+        vHashes.push_back(ArithToUint256(arith_uint256(i + 1)));
+        vSigs.emplace_back();
+        key.Sign(vHashes.back(), vSigs.back());
+        vPubKeys.push_back(key.GetPubKey());
+    }
+}
+
+static void VerifySignaturesBench(benchmark::State& state)
+{
+    ECCVerifyHandle verify_handle;
+    std::vector<CPubKey> vPubKeys;
+    std::vector<std::vector<unsigned char>> vSigs;
+    std::vector<uint256> vHashes;
+    BuildSignatures(vPubKeys, vSigs, vHashes);
+
+    while (state.KeepRunning()) {
+        for (int i = 0; i < VERIFY_BENCH_SIGNATURES; i++) {
+            bool success = vPubKeys[i].Verify(vHashes[i], vSigs[i]);
+            assert(success);
+        }
+    }
+}
+
+static void VerifySignaturesBatchBench(benchmark::State& state)
+{
+    ECCVerifyHandle verify_handle;
+    std::vector<CPubKey> vPubKeys;
+    std::vector<std::vector<unsigned char>> vSigs;
+    std::vector<uint256> vHashes;
+    BuildSignatures(vPubKeys, vSigs, vHashes);
+
+    while (state.KeepRunning()) {
+        CSignatureBatch batch;
+        for (int i = 0; i < VERIFY_BENCH_SIGNATURES; i++) {
+            batch.Add(vPubKeys[i], vSigs[i], vHashes[i]);
+        }
+        bool success = batch.Verify();
+        assert(success);
+    }
+}
+
+BENCHMARK(VerifySignaturesBench, 40);
+BENCHMARK(VerifySignaturesBatchBench, 40);
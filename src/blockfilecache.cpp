@@ -0,0 +1,204 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilecache.h>
+
+#include <compat.h>
+#include <metrics.h>
+#include <util.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char BLOCK_FILE_LOOKUP_METRIC[] = "block_file_cache_lookups_total";
+static const char BLOCK_FILE_LOOKUP_METRIC_HELP[] = "Block and undo file reads by whether the file was already open";
+static CMetricCounter g_metric_block_file_hit(BLOCK_FILE_LOOKUP_METRIC, BLOCK_FILE_LOOKUP_METRIC_HELP, "result=\"hit\"");
+static CMetricCounter g_metric_block_file_miss(BLOCK_FILE_LOOKUP_METRIC, BLOCK_FILE_LOOKUP_METRIC_HELP, "result=\"miss\"");
+static CMetricGauge g_metric_block_files_open("block_files_open", "Block and undo files kept open for reading");
+static CMetricGauge g_metric_block_files_mapped("block_files_mapped_bytes", "Size of the block files mapped into memory");
+static std::atomic<int64_t> g_mapped_bytes{0};
+
+/** An open file, closed when the last read using it is done */
+class CBlockFileCache::File
+{
+private:
+    FILE* const m_file;
+    //! Mapping of the whole file, set once under the cache lock
+    std::atomic<const unsigned char*> m_map{nullptr};
+    size_t m_map_size{0};
+
+public:
+    explicit File(FILE* file) : m_file(file) {}
+    ~File()
+    {
+#ifndef WIN32
+        if (m_map) {
+            munmap((void*)m_map.load(), m_map_size);
+            g_metric_block_files_mapped.Set(g_mapped_bytes -= m_map_size);
+        }
+#endif
+        fclose(m_file);
+    }
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    bool Read(uint64_t nPos, unsigned char* buf, size_t len) const
+    {
+#ifdef WIN32
+        // An explicit offset makes ReadFile positional like pread
+        HANDLE handle = (HANDLE)_get_osfhandle(_fileno(m_file));
+        while (len > 0) {
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = (DWORD)nPos;
+            overlapped.OffsetHigh = (DWORD)(nPos >> 32);
+            DWORD nRead = 0;
+            if (!ReadFile(handle, buf, (DWORD)std::min<size_t>(len, 1 << 30), &nRead, &overlapped) || nRead == 0) {
+                return false;
+            }
+            buf += nRead;
+            nPos += nRead;
+            len -= nRead;
+        }
+#else
+        const int fd = fileno(m_file);
+        while (len > 0) {
+            ssize_t nRead = pread(fd, buf, len, nPos);
+            if (nRead < 0 && errno == EINTR) continue;
+            if (nRead <= 0) return false;
+            buf += nRead;
+            nPos += nRead;
+            len -= nRead;
+        }
+#endif
+        return true;
+    }
+
+    bool IsMapped() const { return m_map != nullptr; }
+    Span<const unsigned char> GetMapped() const
+    {
+        const unsigned char* map = m_map.load();
+        return Span<const unsigned char>(map, map ? m_map_size : 0);
+    }
+
+    bool Map()
+    {
+#ifdef WIN32
+        return false;
+#else
+        // Whole block files would exhaust a 32-bit address space
+        if (sizeof(void*) < 8) return false;
+        struct stat st;
+        if (fstat(fileno(m_file), &st) != 0 || st.st_size <= 0) return false;
+        void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fileno(m_file), 0);
+        if (map == MAP_FAILED) return false;
+        // The size is published by the release of m_map
+        m_map_size = st.st_size;
+        m_map = (const unsigned char*)map;
+        g_metric_block_files_mapped.Set(g_mapped_bytes += m_map_size);
+        return true;
+#endif
+    }
+};
+
+CBlockFileCache::CBlockFileCache(size_t max_open) : m_max_open(std::max<size_t>(max_open, 1)) {}
+
+CBlockFileCache::~CBlockFileCache()
+{
+    Clear();
+}
+
+std::shared_ptr<CBlockFileCache::File> CBlockFileCache::Get(const fs::path& path, bool fMap)
+{
+    const std::string key = path.string();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_hits++;
+        g_metric_block_file_hit.Inc();
+        m_files.splice(m_files.begin(), m_files, it->second);
+        const std::shared_ptr<File>& file = it->second->second;
+        if (fMap && !file->IsMapped()) file->Map();
+        return file;
+    }
+
+    m_misses++;
+    g_metric_block_file_miss.Inc();
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        LogPrintf("Unable to open file %s\n", key);
+        return nullptr;
+    }
+    m_files.emplace_front(key, std::make_shared<File>(file));
+    m_index.emplace(key, m_files.begin());
+    if (fMap) m_files.front().second->Map();
+    if (m_files.size() > m_max_open) {
+        m_index.erase(m_files.back().first);
+        m_files.pop_back();
+    }
+    g_metric_block_files_open.Set(m_files.size());
+    return m_files.front().second;
+}
+
+bool CBlockFileCache::Read(const fs::path& path, uint64_t nPos, unsigned char* buf, size_t len)
+{
+    std::shared_ptr<File> file = Get(path, false);
+    if (!file) return false;
+    const Span<const unsigned char> data = file->GetMapped();
+    if (data.size() > 0 && nPos <= (uint64_t)data.size() && len <= data.size() - nPos) {
+        memcpy(buf, data.data() + nPos, len);
+        return true;
+    }
+    return file->Read(nPos, buf, len);
+}
+
+bool CBlockFileCache::Map(const fs::path& path, Span<const unsigned char>& data, std::shared_ptr<const void>& keepalive)
+{
+    std::shared_ptr<File> file = Get(path, true);
+    if (!file || !file->IsMapped()) return false;
+    data = file->GetMapped();
+    keepalive = file;
+    return true;
+}
+
+void CBlockFileCache::Close(const fs::path& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(path.string());
+    if (it == m_index.end()) return;
+    m_files.erase(it->second);
+    m_index.erase(it);
+    g_metric_block_files_open.Set(m_files.size());
+}
+
+void CBlockFileCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_files.clear();
+    m_index.clear();
+    g_metric_block_files_open.Set(0);
+}
+
+size_t CBlockFileCache::GetOpenFiles() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_files.size();
+}
+
+std::pair<uint64_t, uint64_t> CBlockFileCache::GetHitsAndMisses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::make_pair(m_hits, m_misses);
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILECACHE_H
+#define BITCOIN_BLOCKFILECACHE_H
+
+#include <fs.h>
+#include <span.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+//! Read-only blk/rev files kept open at most
+static const int MAX_OPEN_BLOCK_FILES = 32;
+
+/**
+ * Read-only block and undo files kept open for positional reads.
+ *
+ * Files are opened on first use and read with pread, which leaves the file
+ * offset alone, so any number of threads can read the same descriptor at the
+ * same time without seeking. When more than the maximum are open, the least
+ * recently used file is closed once the reads still using it are done.
+ *
+ * Files that are no longer written to can also be mapped into memory and
+ * deserialized from in place. A mapping covers the file as it was when it was
+ * made, so it must not be used for files that are still appended to or that
+ * may be truncated.
+ */
+class CBlockFileCache
+{
+private:
+    class File;
+    typedef std::list<std::pair<std::string, std::shared_ptr<File>>> FileList;
+
+    const size_t m_max_open;
+    mutable std::mutex m_mutex;
+    //! Open files, the most recently used first
+    FileList m_files;
+    std::unordered_map<std::string, FileList::iterator> m_index;
+    uint64_t m_hits{0};
+    uint64_t m_misses{0};
+
+    std::shared_ptr<File> Get(const fs::path& path, bool fMap);
+
+public:
+    explicit CBlockFileCache(size_t max_open);
+    ~CBlockFileCache();
+
+    /** Read len bytes at offset nPos of a file, false if it cannot be opened or is too short */
+    bool Read(const fs::path& path, uint64_t nPos, unsigned char* buf, size_t len);
+    /**
+     * Map a whole file into memory. The data stays valid for as long as
+     * keepalive is held. False if the file cannot be mapped, in which case
+     * Read still works.
+     */
+    bool Map(const fs::path& path, Span<const unsigned char>& data, std::shared_ptr<const void>& keepalive);
+    /** Close a file if it is open, before it is deleted */
+    void Close(const fs::path& path);
+    void Clear();
+
+    size_t GetOpenFiles() const;
+    //! Reads that found their file open, and that had to open it
+    std::pair<uint64_t, uint64_t> GetHitsAndMisses() const;
+};
+
+#endif // BITCOIN_BLOCKFILECACHE_H
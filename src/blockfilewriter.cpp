@@ -0,0 +1,109 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilewriter.h>
+
+#include <util.h>
+
+/** Open a file for writing, creating it if it does not exist */
+static FILE* OpenWriteFile(const fs::path& path)
+{
+    fs::create_directories(path.parent_path());
+    FILE* file = fsbridge::fopen(path, "rb+");
+    if (!file)
+        file = fsbridge::fopen(path, "wb+");
+    if (!file)
+        LogPrintf("Unable to open file %s\n", path.string());
+    return file;
+}
+
+FILE* CBlockFileWriter::Open(int nFileIn)
+{
+    if (m_file && m_file_num == nFileIn)
+        return m_file;
+    Close();
+    m_file = OpenWriteFile(m_path(nFileIn));
+    if (!m_file)
+        return nullptr;
+    // Every write is a whole serialized block, so stdio buffering would only add a copy
+    setvbuf(m_file, nullptr, _IONBF, 0);
+    m_file_num = nFileIn;
+    m_pos = 0;
+    m_dirty = true;
+    return m_file;
+}
+
+bool CBlockFileWriter::Write(const CDiskBlockPos& pos, const std::vector<unsigned char>& data)
+{
+    if (!Open(pos.nFile))
+        return false;
+    if (m_pos != pos.nPos) {
+        if (fseek(m_file, pos.nPos, SEEK_SET)) {
+            Close();
+            return false;
+        }
+        m_pos = pos.nPos;
+    }
+    m_dirty = true;
+    if (fwrite(data.data(), 1, data.size(), m_file) != data.size()) {
+        Close();
+        return false;
+    }
+    m_pos += data.size();
+    return true;
+}
+
+void CBlockFileWriter::Allocate(const CDiskBlockPos& pos, unsigned int length)
+{
+    if (!Open(pos.nFile))
+        return;
+    AllocateFileRange(m_file, pos.nPos, length);
+    // The fallback implementation writes zeros through the file position
+    m_pos = -1;
+}
+
+bool CBlockFileWriter::Commit(int nFileIn, bool fFinalize, unsigned int nSize)
+{
+    if (m_file && m_file_num == nFileIn) {
+        // Nothing was written since the last sync
+        if (!m_dirty && !fFinalize)
+            return true;
+        bool status = true;
+        if (fFinalize)
+            status &= TruncateFile(m_file, nSize);
+        status &= FileCommit(m_file);
+        m_syncs++;
+        if (status)
+            m_dirty = false;
+        return status;
+    }
+
+    // The file was last written before the writer moved on to another one
+    FILE* fileOld = OpenWriteFile(m_path(nFileIn));
+    if (!fileOld)
+        return true;
+    bool status = true;
+    if (fFinalize)
+        status &= TruncateFile(fileOld, nSize);
+    status &= FileCommit(fileOld);
+    m_syncs++;
+    fclose(fileOld);
+    return status;
+}
+
+void CBlockFileWriter::Close(int nFileIn)
+{
+    if (m_file_num == nFileIn)
+        Close();
+}
+
+void CBlockFileWriter::Close()
+{
+    if (m_file)
+        fclose(m_file);
+    m_file = nullptr;
+    m_file_num = -1;
+    m_pos = -1;
+    m_dirty = false;
+}
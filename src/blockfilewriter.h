@@ -0,0 +1,65 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEWRITER_H
+#define BITCOIN_BLOCKFILEWRITER_H
+
+#include <chain.h>
+#include <fs.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * Keeps the blk or rev file being appended to open between writes, so that
+ * storing a block is a single write instead of an open, seek and close.
+ * Writes bypass stdio buffering so that readers see them at once; syncing to
+ * disk is left to Commit.
+ *
+ * Not thread safe, validation protects its writers with cs_LastBlockFile.
+ */
+class CBlockFileWriter
+{
+public:
+    typedef std::function<fs::path(int nFile)> PathFunction;
+
+private:
+    const PathFunction m_path;
+    FILE* m_file = nullptr;
+    int m_file_num = -1;
+    //! Offset of the file position, or -1 if it is unknown
+    int64_t m_pos = -1;
+    //! Whether the open file may have data that was not committed
+    bool m_dirty = false;
+    uint64_t m_syncs = 0;
+
+    FILE* Open(int nFileIn);
+
+public:
+    //! path returns the name of a file from its number
+    explicit CBlockFileWriter(PathFunction path) : m_path(std::move(path)) {}
+    ~CBlockFileWriter() { Close(); }
+
+    CBlockFileWriter(const CBlockFileWriter&) = delete;
+    CBlockFileWriter& operator=(const CBlockFileWriter&) = delete;
+
+    //! Write data at pos, keeping the file open for the next write
+    bool Write(const CDiskBlockPos& pos, const std::vector<unsigned char>& data);
+    //! Preallocate length bytes from pos
+    void Allocate(const CDiskBlockPos& pos, unsigned int length);
+    //! Sync a file to disk, truncating it to nSize first if fFinalize is set
+    bool Commit(int nFileIn, bool fFinalize, unsigned int nSize);
+    //! Close the file if it is open, before it is deleted
+    void Close(int nFileIn);
+    void Close();
+
+    bool IsOpen(int nFileIn) const { return m_file && m_file_num == nFileIn; }
+    //! Number of times a file was synced to disk
+    uint64_t GetSyncs() const { return m_syncs; }
+};
+
+#endif // BITCOIN_BLOCKFILEWRITER_H
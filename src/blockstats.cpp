@@ -0,0 +1,110 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockstats.h>
+
+#include <coins.h>
+#include <consensus/validation.h>
+#include <primitives/block.h>
+#include <undo.h>
+#include <version.h>
+
+bool ComputeBlockStats(const CBlock& block, const CBlockUndo& blockundo, CBlockStats& stats)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) return false;
+    stats.SetNull();
+    stats.hashBlock = block.GetHash();
+    stats.nTxs = block.vtx.size();
+    stats.nMinFee = stats.nMinFeeRate = MAX_MONEY;
+    stats.nMinTxSize = std::numeric_limits<int64_t>::max();
+
+    std::vector<CAmount> fee_array;
+    std::vector<std::pair<CAmount, int64_t>> feerate_array;
+    std::vector<int64_t> txsize_array;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        stats.nOuts += tx.vout.size();
+
+        CAmount tx_total_out = 0;
+        for (const CTxOut& out : tx.vout) {
+            tx_total_out += out.nValue;
+            stats.nUtxoSizeInc += GetSerializeSize(out, SER_NETWORK, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
+        }
+        if (tx.IsCoinBase()) continue;
+
+        const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+        if (txundo.vprevout.size() != tx.vin.size()) return false;
+        stats.nIns += tx.vin.size();
+        stats.nTotalOut += tx_total_out;
+
+        const int64_t tx_size = tx.GetTotalSize();
+        txsize_array.push_back(tx_size);
+        stats.nMaxTxSize = std::max(stats.nMaxTxSize, tx_size);
+        stats.nMinTxSize = std::min(stats.nMinTxSize, tx_size);
+        stats.nTotalSize += tx_size;
+
+        const int64_t weight = GetTransactionWeight(tx);
+        stats.nTotalWeight += weight;
+        if (tx.HasWitness()) {
+            stats.nSwTxs++;
+            stats.nSwTotalSize += tx_size;
+            stats.nSwTotalWeight += weight;
+        }
+
+        CAmount tx_total_in = 0;
+        for (const Coin& coin : txundo.vprevout) {
+            tx_total_in += coin.out.nValue;
+            stats.nUtxoSizeInc -= GetSerializeSize(coin.out, SER_NETWORK, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
+        }
+        const CAmount txfee = tx_total_in - tx_total_out;
+        if (!MoneyRange(txfee)) return false;
+        fee_array.push_back(txfee);
+        stats.nMaxFee = std::max(stats.nMaxFee, txfee);
+        stats.nMinFee = std::min(stats.nMinFee, txfee);
+        stats.nTotalFee += txfee;
+
+        // New feerate uses satoshis per virtual byte instead of per serialized byte
+        const CAmount feerate = weight ? (txfee * WITNESS_SCALE_FACTOR) / weight : 0;
+        feerate_array.emplace_back(feerate, weight);
+        stats.nMaxFeeRate = std::max(stats.nMaxFeeRate, feerate);
+        stats.nMinFeeRate = std::min(stats.nMinFeeRate, feerate);
+    }
+    if (block.vtx.size() <= 1) {
+        stats.nMinFee = stats.nMinFeeRate = stats.nMinTxSize = 0;
+    }
+
+    stats.nMedianFee = CalculateTruncatedMedian(fee_array);
+    stats.nMedianTxSize = CalculateTruncatedMedian(txsize_array);
+    CalculatePercentilesByWeight(stats.vFeeRatePercentiles, feerate_array, stats.nTotalWeight);
+    return true;
+}
+
+void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight)
+{
+    if (scores.empty()) {
+        return;
+    }
+
+    std::sort(scores.begin(), scores.end());
+
+    // 10th, 25th, 50th, 75th, and 90th percentile weight units.
+    const double weights[NUM_GETBLOCKSTATS_PERCENTILES] = {
+        total_weight / 10.0, total_weight / 4.0, total_weight / 2.0, (total_weight * 3.0) / 4.0, (total_weight * 9.0) / 10.0
+    };
+
+    int64_t next_percentile_index = 0;
+    int64_t cumulative_weight = 0;
+    for (const auto& element : scores) {
+        cumulative_weight += element.second;
+        while (next_percentile_index < NUM_GETBLOCKSTATS_PERCENTILES && cumulative_weight >= weights[next_percentile_index]) {
+            result[next_percentile_index] = element.first;
+            ++next_percentile_index;
+        }
+    }
+
+    // Fill any remaining percentiles with the last value.
+    for (int64_t i = next_percentile_index; i < NUM_GETBLOCKSTATS_PERCENTILES; i++) {
+        result[i] = scores.back().first;
+    }
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKSTATS_H
+#define BITCOIN_BLOCKSTATS_H
+
+#include <amount.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class CBlock;
+class CBlockUndo;
+
+//! -blockstatsindex default
+static const bool DEFAULT_BLOCKSTATSINDEX = false;
+
+static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
+
+// outpoint (needed for the utxo index) + nHeight + fCoinBase
+static constexpr size_t PER_UTXO_OVERHEAD = sizeof(COutPoint) + sizeof(uint32_t) + sizeof(bool);
+
+/**
+ * The values of getblockstats that depend on the transactions of a block,
+ * as kept by the block stats index. Header fields are taken from the block
+ * index when the stats are reported. Amounts are in satoshis, feerates in
+ * satoshis per virtual byte.
+ */
+class CBlockStats
+{
+public:
+    //! Block the stats are for, null for a disconnected block
+    uint256 hashBlock;
+    int64_t nTxs;
+    int64_t nIns;
+    int64_t nOuts;
+    CAmount nTotalOut;
+    CAmount nTotalFee;
+    CAmount nMinFee;
+    CAmount nMaxFee;
+    CAmount nMedianFee;
+    CAmount nMinFeeRate;
+    CAmount nMaxFeeRate;
+    CAmount vFeeRatePercentiles[NUM_GETBLOCKSTATS_PERCENTILES];
+    int64_t nTotalSize;
+    int64_t nMinTxSize;
+    int64_t nMaxTxSize;
+    int64_t nMedianTxSize;
+    int64_t nTotalWeight;
+    int64_t nSwTxs;
+    int64_t nSwTotalSize;
+    int64_t nSwTotalWeight;
+    //! Can be negative, so stored as is
+    int64_t nUtxoSizeInc;
+
+    CBlockStats() { SetNull(); }
+
+    void SetNull()
+    {
+        hashBlock.SetNull();
+        nTxs = nIns = nOuts = 0;
+        nTotalOut = nTotalFee = nMinFee = nMaxFee = nMedianFee = 0;
+        nMinFeeRate = nMaxFeeRate = 0;
+        std::fill(vFeeRatePercentiles, vFeeRatePercentiles + NUM_GETBLOCKSTATS_PERCENTILES, 0);
+        nTotalSize = nMinTxSize = nMaxTxSize = nMedianTxSize = nTotalWeight = 0;
+        nSwTxs = nSwTotalSize = nSwTotalWeight = nUtxoSizeInc = 0;
+    }
+
+    bool IsNull() const { return hashBlock.IsNull(); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashBlock);
+        READWRITE(VARINT(nTxs, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nIns, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nOuts, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nTotalOut, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nTotalFee, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nMinFee, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nMaxFee, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nMedianFee, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nMinFeeRate, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nMaxFeeRate, VarIntMode::NONNEGATIVE_SIGNED));
+        for (int i = 0; i < NUM_GETBLOCKSTATS_PERCENTILES; i++)
+            READWRITE(VARINT(vFeeRatePercentiles[i], VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nTotalSize, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nMinTxSize, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nMaxTxSize, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nMedianTxSize, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nTotalWeight, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nSwTxs, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nSwTotalSize, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nSwTotalWeight, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(nUtxoSizeInc);
+    }
+};
+
+/** Compute the stats of a block, with the spent coins taken from its undo data */
+bool ComputeBlockStats(const CBlock& block, const CBlockUndo& blockundo, CBlockStats& stats);
+
+template<typename T>
+T CalculateTruncatedMedian(std::vector<T>& scores)
+{
+    size_t size = scores.size();
+    if (size == 0) {
+        return 0;
+    }
+
+    std::sort(scores.begin(), scores.end());
+    if (size % 2 == 0) {
+        return (scores[size / 2 - 1] + scores[size / 2]) / 2;
+    } else {
+        return scores[size / 2];
+    }
+}
+
+/** Used by getblockstats to get feerates at different percentiles by weight  */
+void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight);
+
+#endif // BITCOIN_BLOCKSTATS_H
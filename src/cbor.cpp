@@ -0,0 +1,197 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cbor.h>
+
+#include <uint256.h>
+#include <utilstrencodings.h>
+
+#include <univalue.h>
+
+#include <string.h>
+
+namespace {
+
+enum CBORMajorType : uint8_t {
+    CBOR_UINT = 0,
+    CBOR_NEGINT = 1,
+    CBOR_BYTES = 2,
+    CBOR_TEXT = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_SIMPLE = 7,
+};
+
+static const uint8_t CBOR_FALSE = 0xf4;
+static const uint8_t CBOR_TRUE = 0xf5;
+static const uint8_t CBOR_NULL = 0xf6;
+static const uint8_t CBOR_FLOAT64 = 0xfb;
+static const uint8_t CBOR_BREAK = 0xff;
+static const uint8_t CBOR_INDEFINITE = 31;
+
+} // namespace
+
+bool IsCBORMediaType(const std::string& header)
+{
+    return header.find(CBOR_CONTENT_TYPE) != std::string::npos;
+}
+
+void CBORWriter::WriteHead(uint8_t major, uint64_t value)
+{
+    const uint8_t type = major << 5;
+    if (value < 24) {
+        m_out.push_back(type | value);
+        return;
+    }
+    int len;
+    if (value <= 0xff) {
+        m_out.push_back(type | 24);
+        len = 1;
+    } else if (value <= 0xffff) {
+        m_out.push_back(type | 25);
+        len = 2;
+    } else if (value <= 0xffffffff) {
+        m_out.push_back(type | 26);
+        len = 4;
+    } else {
+        m_out.push_back(type | 27);
+        len = 8;
+    }
+    // CBOR integers are big-endian
+    for (int i = len - 1; i >= 0; i--) {
+        m_out.push_back((value >> (8 * i)) & 0xff);
+    }
+}
+
+void CBORWriter::WriteUInt(uint64_t value)
+{
+    WriteHead(CBOR_UINT, value);
+}
+
+void CBORWriter::WriteInt(int64_t value)
+{
+    if (value >= 0) {
+        WriteHead(CBOR_UINT, value);
+    } else {
+        // Negative integers encode -1 - value; ~value avoids overflow on INT64_MIN
+        WriteHead(CBOR_NEGINT, ~(uint64_t)value);
+    }
+}
+
+void CBORWriter::WriteBool(bool value)
+{
+    m_out.push_back(value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void CBORWriter::WriteNull()
+{
+    m_out.push_back(CBOR_NULL);
+}
+
+void CBORWriter::WriteDouble(double value)
+{
+    uint64_t bits;
+    static_assert(sizeof(bits) == sizeof(value), "double must be 64 bits");
+    memcpy(&bits, &value, sizeof(bits));
+    m_out.push_back(CBOR_FLOAT64);
+    for (int i = 7; i >= 0; i--) {
+        m_out.push_back((bits >> (8 * i)) & 0xff);
+    }
+}
+
+void CBORWriter::WriteText(const std::string& str)
+{
+    WriteHead(CBOR_TEXT, str.size());
+    m_out.append(str);
+}
+
+void CBORWriter::WriteText(const char* str)
+{
+    const size_t len = strlen(str);
+    WriteHead(CBOR_TEXT, len);
+    m_out.append(str, len);
+}
+
+void CBORWriter::WriteBytes(const unsigned char* data, size_t len)
+{
+    WriteHead(CBOR_BYTES, len);
+    if (len) m_out.append((const char*)data, len);
+}
+
+void CBORWriter::WriteHash(const uint256& hash)
+{
+    WriteHead(CBOR_BYTES, hash.size());
+    for (const unsigned char* it = hash.end(); it != hash.begin();) {
+        m_out.push_back(*--it);
+    }
+}
+
+void CBORWriter::BeginArray(size_t count)
+{
+    WriteHead(CBOR_ARRAY, count);
+}
+
+void CBORWriter::BeginMap(size_t count)
+{
+    WriteHead(CBOR_MAP, count);
+}
+
+void CBORWriter::BeginArray()
+{
+    m_out.push_back((CBOR_ARRAY << 5) | CBOR_INDEFINITE);
+}
+
+void CBORWriter::BeginMap()
+{
+    m_out.push_back((CBOR_MAP << 5) | CBOR_INDEFINITE);
+}
+
+void CBORWriter::End()
+{
+    m_out.push_back(CBOR_BREAK);
+}
+
+void UniValueToCBOR(CBORWriter& writer, const UniValue& value)
+{
+    switch (value.getType()) {
+    case UniValue::VNULL:
+        writer.WriteNull();
+        break;
+    case UniValue::VBOOL:
+        writer.WriteBool(value.isTrue());
+        break;
+    case UniValue::VSTR:
+        writer.WriteText(value.getValStr());
+        break;
+    case UniValue::VNUM: {
+        // UniValue keeps numbers in their JSON text form; integers stay integers
+        int64_t n;
+        double d;
+        if (ParseInt64(value.getValStr(), &n)) {
+            writer.WriteInt(n);
+        } else if (ParseDouble(value.getValStr(), &d)) {
+            writer.WriteDouble(d);
+        } else {
+            writer.WriteText(value.getValStr());
+        }
+        break;
+    }
+    case UniValue::VARR:
+        writer.BeginArray(value.size());
+        for (const UniValue& v : value.getValues()) {
+            UniValueToCBOR(writer, v);
+        }
+        break;
+    case UniValue::VOBJ: {
+        const std::vector<std::string>& keys = value.getKeys();
+        const std::vector<UniValue>& values = value.getValues();
+        writer.BeginMap(keys.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            writer.WriteText(keys[i]);
+            UniValueToCBOR(writer, values[i]);
+        }
+        break;
+    }
+    }
+}
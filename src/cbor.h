@@ -0,0 +1,81 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// CBOR (RFC 7049) is a binary encoding with the same data model as JSON.
+// It is offered as an alternative to JSON for RPC and REST replies: hashes
+// and scripts are emitted as raw byte strings and amounts as integers, so
+// large replies (verbose blocks, the verbose mempool) need neither hex
+// encoding nor an intermediate UniValue tree.
+
+#ifndef BITCOIN_CBOR_H
+#define BITCOIN_CBOR_H
+
+#include <stdint.h>
+#include <string>
+
+class uint256;
+class UniValue;
+
+/** MIME type used to negotiate CBOR encoded replies */
+static const char* const CBOR_CONTENT_TYPE = "application/cbor";
+
+/** Return true if an HTTP Accept or Content-Type header value asks for CBOR */
+bool IsCBORMediaType(const std::string& header);
+
+/**
+ * Streaming CBOR encoder appending to a caller-owned buffer.
+ *
+ * Maps and arrays are written either with a known element count
+ * (BeginMap(n)/BeginArray(n)) or as indefinite-length containers
+ * (BeginMap()/BeginArray() ... End()), which lets callers emit optional
+ * keys without counting them first.
+ */
+class CBORWriter
+{
+private:
+    std::string& m_out;
+
+    void WriteHead(uint8_t major, uint64_t value);
+
+public:
+    explicit CBORWriter(std::string& out) : m_out(out) {}
+
+    void WriteUInt(uint64_t value);
+    void WriteInt(int64_t value);
+    void WriteBool(bool value);
+    void WriteNull();
+    void WriteDouble(double value);
+    void WriteText(const std::string& str);
+    void WriteText(const char* str);
+    void WriteBytes(const unsigned char* data, size_t len);
+
+    /** Write any contiguous byte container (std::vector, CScript, ...) as a byte string */
+    template <typename T>
+    void WriteBytes(const T& container)
+    {
+        WriteBytes(container.empty() ? nullptr : (const unsigned char*)&container[0], container.size());
+    }
+
+    /** Write a hash as a 32-byte string, in the same (reversed) byte order as GetHex() */
+    void WriteHash(const uint256& hash);
+
+    void BeginArray(size_t count);
+    void BeginMap(size_t count);
+    void BeginArray();
+    void BeginMap();
+    /** Terminate the innermost indefinite-length array or map */
+    void End();
+
+    /** Map key helper: keys are always text strings */
+    CBORWriter& Key(const char* key)
+    {
+        WriteText(key);
+        return *this;
+    }
+};
+
+/** Encode an existing UniValue tree. Used for replies that are only available as UniValue. */
+void UniValueToCBOR(CBORWriter& writer, const UniValue& value);
+
+#endif // BITCOIN_CBOR_H
@@ -8,14 +8,19 @@
 #include <chain.h>
 #include <validation.h>
 #include <chainparams.h> 
+#include <memusage.h>
 #include <txdb.h>
+#include <util.h>
+
+#include <atomic>
+#include <stdexcept>
 
 CBlockHeader CBlockIndex::GetBlockHeader() const {
     CBlockHeader header;
     header.nVersion       = nVersion;
     if (pprev)
         header.hashPrevBlock = pprev->GetBlockHash();
-    header.hashMerkleRoot = hashMerkleRoot;
+    header.hashMerkleRoot = GetMerkleRoot();
     header.nTime          = nTime;
     header.nBits          = nBits;
     header.nNonce         = nNonce;
@@ -38,12 +43,55 @@ CBlockHeader CBlockIndex::GetBlockHeader() const {
 
 void CBlockIndex::SetBlockHeader (const CBlockHeader& header) {
     nVersion       = header.nVersion;
-    hashMerkleRoot = header.hashMerkleRoot;
     nTime          = header.nTime;
     nBits          = header.nBits;
     nNonce         = header.nNonce;
+    const uint256 hash = header.GetHash();
+    if (pblocktree)
+        pblocktree->WriteMerkleRoot (hash, header.hashMerkleRoot);
     if (header.IsAuxpow())
-        pblocktree->WriteAuxPow (header.GetHash(), *(header.auxpow));
+        pblocktree->WriteAuxPow (hash, *(header.auxpow));
+}
+
+uint256 CBlockIndex::GetMerkleRoot() const {
+    uint256 hashMerkleRoot;
+    if (!ReadMerkleRoot(hashMerkleRoot)) {
+        // Every entry is stored with its root, so the database is corrupt
+        static std::atomic<bool> fAborted{false};
+        if (!fAborted.exchange(true))
+            AbortNode(strprintf("No merkle root for %s in the block index database", GetBlockHash().ToString()), _("Error reading from database, shutting down."));
+        throw std::runtime_error(strprintf("%s: no merkle root for %s", __func__, GetBlockHash().ToString()));
+    }
+    return hashMerkleRoot;
+}
+
+bool CBlockIndex::ReadMerkleRoot(uint256& hashMerkleRoot) const {
+    // Entries that are not backed by a block tree database have no stored root
+    if (!pblocktree) {
+        hashMerkleRoot.SetNull();
+        return true;
+    }
+    return pblocktree->ReadMerkleRoot(*phashBlock, hashMerkleRoot);
+}
+
+CBlockIndex* CBlockIndexArena::Allocate()
+{
+    if (m_size == m_chunks.size() * CHUNK_ENTRIES) {
+        m_chunks.emplace_back(new CBlockIndex[CHUNK_ENTRIES]);
+    }
+    return &m_chunks.back()[m_size++ % CHUNK_ENTRIES];
+}
+
+void CBlockIndexArena::Clear()
+{
+    // Release the chunk list as well, clear() would keep its capacity
+    std::vector<std::unique_ptr<CBlockIndex[]>>().swap(m_chunks);
+    m_size = 0;
+}
+
+size_t CBlockIndexArena::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(m_chunks) + m_chunks.size() * memusage::MallocUsage(CHUNK_ENTRIES * sizeof(CBlockIndex));
 }
 
 /**
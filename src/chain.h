@@ -15,6 +15,7 @@
 #include <uint256.h>
 #include <chainparams.h>
 
+#include <memory>
 #include <vector>
 
 /**
@@ -219,9 +220,8 @@ public:
     //! Verification status of this block. See enum BlockStatus
     uint32_t nStatus;
 
-    //! block header
+    //! block header, without the merkle root (see GetMerkleRoot)
     int32_t nVersion;
-    uint256 hashMerkleRoot;
     uint32_t nTime;
     uint32_t nBits;
     uint32_t nNonce;
@@ -241,7 +241,6 @@ public:
         nStatus = 0;
 
         nVersion       = 0;
-        hashMerkleRoot = uint256();
         nTime          = 0;
         nBits          = 0;
         nNonce         = 0;
@@ -277,8 +276,18 @@ public:
         return ret;
     }
 
+    //! Block header, throws like GetMerkleRoot
     CBlockHeader GetBlockHeader() const;
 
+    //! Merkle root of the block. It is rarely needed and is read from the block
+    //! tree database instead of being kept in memory for every block. A root
+    //! missing from the database means that it is corrupt: the node is shut
+    //! down and std::runtime_error thrown, so that no header with a null root
+    //! is served to peers.
+    uint256 GetMerkleRoot() const;
+    //! Merkle root of the block, if it can be read
+    bool ReadMerkleRoot(uint256& hashMerkleRoot) const;
+
     uint256 GetBlockHash() const
     {
         return *phashBlock;
@@ -307,9 +316,10 @@ public:
 
     std::string ToString() const
     {
+        uint256 hashMerkleRoot;
         return strprintf("CBlockIndex(pprev=%p, nHeight=%d, merkle=%s, hashBlock=%s)",
             pprev, nHeight,
-            hashMerkleRoot.ToString(),
+            ReadMerkleRoot(hashMerkleRoot) ? hashMerkleRoot.ToString() : "unknown",
             GetBlockHash().ToString());
     }
 
@@ -368,12 +378,13 @@ class CDiskBlockIndex : public CBlockIndex
 {
 public:
     uint256 hashPrev;
+    uint256 hashMerkleRoot;
 
     CDiskBlockIndex() {
         hashPrev = uint256();
     }
 
-    explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
+    CDiskBlockIndex(const CBlockIndex* pindex, const uint256& hashMerkleRootIn) : CBlockIndex(*pindex), hashMerkleRoot(hashMerkleRootIn) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
     }
 
@@ -428,6 +439,29 @@ public:
     }
 };
 
+/**
+ * Storage of block index entries, allocated in chunks instead of one by one
+ * to save the allocator overhead of millions of small objects. Entries keep
+ * their address until the arena is cleared.
+ */
+class CBlockIndexArena
+{
+public:
+    static const size_t CHUNK_ENTRIES = 4096;
+
+private:
+    std::vector<std::unique_ptr<CBlockIndex[]>> m_chunks;
+    size_t m_size = 0;
+
+public:
+    //! A new entry in its default state
+    CBlockIndex* Allocate();
+    void Clear();
+
+    size_t size() const { return m_size; }
+    size_t DynamicMemoryUsage() const;
+};
+
 /** An in-memory indexed chain of blocks. */
 class CChain {
 private:
@@ -16,6 +16,20 @@
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * Run the checks a worker took from the queue, returning whether all of them
+ * succeeded. Check types that can share work between checks overload this.
+ */
+template <typename T>
+bool RunChecks(std::vector<T>& vChecks)
+{
+    for (T& check : vChecks) {
+        if (!check())
+            return false;
+    }
+    return true;
+}
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -116,9 +130,8 @@ private:
                 fOk = fAllOk;
             }
             // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
+            if (fOk)
+                fOk = RunChecks(vChecks);
             vChecks.clear();
         } while (true);
     }
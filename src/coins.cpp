@@ -6,29 +6,17 @@
 #include <coins.h>
 
 #include <consensus/consensus.h>
+#include <metrics.h>
 #include <random.h>
 
 #include <script/standard.h>
 #include <key_io.h>
 #include <core_io.h>
 
-CAddressKey::CAddressKey(const CScript& pscript, const COutPoint& pout) {
-    script = pscript;
-    out = pout;
-    if (script.size() == 67 && script[0] == 65 && script.back() == OP_CHECKSIG) {
-        CTxDestination ar;
-        if (ExtractDestination(script, ar)) script = GetScriptForDestination(ar);
-    }
-    if (script.size() == 35 && script[0] == 33 && script.back() == OP_CHECKSIG) {
-        CTxDestination ar;
-        if (ExtractDestination(script, ar)) script = GetScriptForDestination(ar);
-    }
-}
-
 std::string CAddressKey::GetAddr () const {
     CTxDestination ar;
-    if (ExtractDestination (script, ar)) return EncodeDestination(ar);
-    return ScriptToAsmStr (script);
+    if (script.GetDestination(ar)) return EncodeDestination(ar);
+    return ScriptToAsmStr (script.script);
 }
 
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
@@ -55,16 +43,26 @@ size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn),
+    cacheCoins(0, SaltedOutpointHasher(), std::equal_to<COutPoint>(), &m_cache_coins_memory_resource), cachedCoinsUsage(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
 }
 
+// Summed over all cache layers; a miss in a child view is usually a hit in pcoinsTip
+static const char COINS_LOOKUP_METRIC[] = "coins_cache_lookups_total";
+static const char COINS_LOOKUP_METRIC_HELP[] = "Coin lookups in CCoinsViewCache by result, summed over cache layers";
+static CMetricCounter g_metric_coins_hit(COINS_LOOKUP_METRIC, COINS_LOOKUP_METRIC_HELP, "result=\"hit\"");
+static CMetricCounter g_metric_coins_miss(COINS_LOOKUP_METRIC, COINS_LOOKUP_METRIC_HELP, "result=\"miss\"");
+
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        g_metric_coins_hit.Inc();
         return it;
+    }
+    g_metric_coins_miss.Inc();
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
@@ -226,11 +224,55 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
 
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
-    cacheCoins.clear();
+    ReallocateCache();
     cachedCoinsUsage = 0;
     return fOk;
 }
 
+void CCoinsViewCache::ReallocateCache() {
+    // The map must be destroyed before the resource it allocates from
+    cacheCoins.~CCoinsMap();
+    m_cache_coins_memory_resource.~CCoinsMapMemoryResource();
+    ::new (&m_cache_coins_memory_resource) CCoinsMapMemoryResource{};
+    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(), std::equal_to<COutPoint>(), &m_cache_coins_memory_resource);
+}
+
+bool CCoinsViewCache::Sync() {
+    CCoinsMap mapDirty;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            ++it;
+            continue;
+        }
+        if (it->second.coin.IsSpent()) {
+            // The base will not have the coin anymore, there is nothing left to cache
+            cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+            if (!(it->second.flags & CCoinsCacheEntry::FRESH)) {
+                mapDirty.emplace(it->first, std::move(it->second));
+            }
+            it = cacheCoins.erase(it);
+        } else {
+            CCoinsCacheEntry& entry = mapDirty[it->first];
+            entry.coin = it->second.coin;
+            entry.flags = it->second.flags;
+            it->second.flags = 0;
+            ++it;
+        }
+    }
+    return base->BatchWrite(mapDirty, hashBlock);
+}
+
+void CCoinsViewCache::Trim(size_t max_usage) {
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end() && DynamicMemoryUsage() > max_usage;) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+            it = cacheCoins.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
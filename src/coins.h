@@ -12,7 +12,9 @@
 #include <core_memusage.h>
 #include <hash.h>
 #include <memusage.h>
+#include <script/standard.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 
 #include <assert.h>
@@ -96,7 +98,7 @@ public:
      * unordered_map will behave unpredictably if the custom hasher returns a
      * uint64_t, resulting in failures when syncing the chain (#4634).
      */
-    size_t operator()(const COutPoint& id) const {
+    size_t operator()(const COutPoint& id) const noexcept {
         return SipHashUint256Extra(k0, k1, id.hash, id.n);
     }
 };
@@ -120,7 +122,18 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * Nodes of CCoinsMap are allocated from a PoolResource. The exact node size is
+ * implementation defined; one or two pointers for the bucket list and possibly
+ * a cached hash are added to the value, so reserving four pointers keeps every
+ * node in the pool. SaltedOutpointHasher is noexcept, which lets libstdc++
+ * skip caching the hash in each node.
+ */
+typedef PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                      sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4,
+                      alignof(void*)> CCoinsMapAllocator;
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
+typedef CCoinsMapAllocator::ResourceType CCoinsMapMemoryResource;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -207,6 +220,8 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
+    //! Must outlive cacheCoins, which allocates its nodes from it
+    mutable CCoinsMapMemoryResource m_cache_coins_memory_resource{};
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
@@ -269,12 +284,25 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push the modifications applied to this cache to its base like Flush(),
+     * but keep the unmodified entries and the written unspent ones cached.
+     * Spent entries are dropped; afterwards no entry is dirty.
+     */
+    bool Sync();
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Evict entries that are not dirty until the cache uses at most max_usage bytes,
+     * or only dirty entries are left.
+     */
+    void Trim(size_t max_usage);
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
@@ -296,6 +324,12 @@ public:
 
 private:
     CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
+
+    /**
+     * Replace cacheCoins and its memory resource by empty ones, returning
+     * the memory the pool kept to the system.
+     */
+    void ReallocateCache();
 };
 
 //! Utility function to add all of a transaction's outputs to a cache.
@@ -314,12 +348,12 @@ const Coin& AccessByTxid(const CCoinsViewCache& cache, const uint256& txid);
 
 class CAddressKey {
 public:
-    CScript script;
+    CCompactScript script;
     COutPoint out;
 
     CAddressKey() : script(), out() { }
 
-    CAddressKey(const CScript& ascript, const COutPoint& aout);
+    CAddressKey(const CScript& ascript, const COutPoint& aout) : script(ascript), out(aout) { }
 
     CAddressKey(const CAddressKey &pp) {
         script = pp.script;
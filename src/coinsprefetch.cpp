@@ -0,0 +1,205 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coinsprefetch.h>
+
+#include <memusage.h>
+#include <metrics.h>
+#include <util.h>
+
+#include <algorithm>
+#include <iterator>
+
+//! Outpoints read by one thread at a time; small enough to balance a block over the threads
+static const size_t PREFETCH_JOB_SIZE = 32;
+
+static CMetricCounter g_metric_prefetch_reads("coins_prefetched_total", "Coins read ahead of their use by the prefetch threads");
+static CMetricCounter g_metric_prefetch_hits("coins_prefetch_hits_total", "Coin cache misses answered by prefetched coins");
+
+CCoinsViewPrefetch::CCoinsViewPrefetch(CCoinsView* viewIn, int nThreads) : CCoinsViewBacked(viewIn)
+{
+    for (int i = 0; i < nThreads; i++) {
+        m_threads.emplace_back(&CCoinsViewPrefetch::ThreadPrefetch, this);
+    }
+}
+
+CCoinsViewPrefetch::~CCoinsViewPrefetch()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_cv.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void CCoinsViewPrefetch::ThreadPrefetch()
+{
+    RenameThread("dogecoin-prefetch");
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop) return;
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+            // Skip the outpoints a waiting call took over and already read
+            job.outpoints.erase(std::remove_if(job.outpoints.begin(), job.outpoints.end(), [this](const COutPoint& outpoint) {
+                if (!m_queued.erase(outpoint)) return true;
+                m_reading.insert(outpoint);
+                return false;
+            }), job.outpoints.end());
+        }
+
+        std::vector<std::pair<COutPoint, Coin>> coins;
+        coins.reserve(job.outpoints.size());
+        for (const COutPoint& outpoint : job.outpoints) {
+            Coin coin;
+            if (base->GetCoin(outpoint, coin) && !coin.IsSpent()) {
+                coins.emplace_back(outpoint, std::move(coin));
+            }
+        }
+        g_metric_prefetch_reads.Inc(job.outpoints.size());
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const COutPoint& outpoint : job.outpoints) {
+                m_reading.erase(outpoint);
+            }
+            if (job.generation == m_generation) {
+                std::vector<COutPoint>& added = m_by_height[job.nHeight];
+                for (auto& entry : coins) {
+                    if (m_prefetched.size() >= MAX_PREFETCHED_COINS) break;
+                    const size_t usage = entry.second.DynamicMemoryUsage();
+                    if (m_prefetched.emplace(entry.first, PrefetchedCoin{std::move(entry.second), job.nHeight}).second) {
+                        m_prefetched_usage += usage;
+                        added.push_back(entry.first);
+                    }
+                }
+            }
+            if (job.pending) --*job.pending;
+        }
+        m_done_cv.notify_all();
+    }
+}
+
+bool CCoinsViewPrefetch::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_prefetched.find(outpoint);
+        if (it != m_prefetched.end()) {
+            // The caller caches the coin, it is not asked for again
+            m_prefetched_usage -= it->second.coin.DynamicMemoryUsage();
+            coin = std::move(it->second.coin);
+            m_prefetched.erase(it);
+            g_metric_prefetch_hits.Inc();
+            return true;
+        }
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewPrefetch::HaveCoin(const COutPoint &outpoint) const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_prefetched.count(outpoint)) return true;
+    }
+    return base->HaveCoin(outpoint);
+}
+
+bool CCoinsViewPrefetch::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    bool fOk = base->BatchWrite(mapCoins, hashBlock);
+    // Reads that started before the write may have seen the old coins
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+    m_prefetched.clear();
+    m_by_height.clear();
+    m_prefetched_usage = 0;
+    return fOk;
+}
+
+void CCoinsViewPrefetch::Prefetch(std::vector<COutPoint> outpoints, int nHeight, bool fWait)
+{
+    if (m_threads.empty() || outpoints.empty()) return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::vector<COutPoint> reading;
+    outpoints.erase(std::remove_if(outpoints.begin(), outpoints.end(), [this, nHeight, fWait, &reading](const COutPoint& outpoint) {
+        auto it = m_prefetched.find(outpoint);
+        if (it != m_prefetched.end()) {
+            // Already read, keep it for this block too
+            if (it->second.nHeight < nHeight) {
+                it->second.nHeight = nHeight;
+                m_by_height[nHeight].push_back(outpoint);
+            }
+            return true;
+        }
+        if (m_reading.count(outpoint)) {
+            if (fWait) reading.push_back(outpoint);
+            return true;
+        }
+        // A queued outpoint is taken over by a waiting call, which is read first
+        return !fWait && m_queued.count(outpoint);
+    }), outpoints.end());
+    size_t pending = 0;
+    std::vector<Job> jobs;
+    for (size_t start = 0; start < outpoints.size(); start += PREFETCH_JOB_SIZE) {
+        const size_t end = std::min(outpoints.size(), start + PREFETCH_JOB_SIZE);
+        jobs.push_back(Job{std::vector<COutPoint>(outpoints.begin() + start, outpoints.begin() + end), nHeight, m_generation, fWait ? &pending : nullptr});
+        pending++;
+    }
+    m_queued.insert(outpoints.begin(), outpoints.end());
+    m_queue.insert(fWait ? m_queue.begin() : m_queue.end(), std::make_move_iterator(jobs.begin()), std::make_move_iterator(jobs.end()));
+    if (pending > 0) m_work_cv.notify_all();
+    if (fWait) {
+        // Also wait for the reads of these outpoints that were already running
+        m_done_cv.wait(lock, [this, &pending, &reading] {
+            return pending == 0 && std::none_of(reading.begin(), reading.end(), [this](const COutPoint& outpoint) { return m_reading.count(outpoint) > 0; });
+        });
+    }
+}
+
+void CCoinsViewPrefetch::Evict(int nHeight)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_by_height.empty() && m_by_height.begin()->first <= nHeight) {
+        for (const COutPoint& outpoint : m_by_height.begin()->second) {
+            auto it = m_prefetched.find(outpoint);
+            // Coins used since, or kept for a higher block, stay where they are
+            if (it == m_prefetched.end() || it->second.nHeight > nHeight) continue;
+            m_prefetched_usage -= it->second.coin.DynamicMemoryUsage();
+            m_prefetched.erase(it);
+        }
+        m_by_height.erase(m_by_height.begin());
+    }
+}
+
+size_t CCoinsViewPrefetch::GetPrefetchedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_prefetched.size();
+}
+
+size_t CCoinsViewPrefetch::GetQueuedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queued.size() + m_reading.size();
+}
+
+size_t CCoinsViewPrefetch::DynamicMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t usage = memusage::DynamicUsage(m_prefetched) + m_prefetched_usage + memusage::DynamicUsage(m_by_height);
+    usage += memusage::DynamicUsage(m_queued) + memusage::DynamicUsage(m_reading);
+    for (const auto& entry : m_by_height) {
+        usage += memusage::DynamicUsage(entry.second);
+    }
+    return usage;
+}
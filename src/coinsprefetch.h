@@ -0,0 +1,112 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_COINSPREFETCH_H
+#define BITCOIN_COINSPREFETCH_H
+
+#include <coins.h>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//! -prefetchthreads default, 0 disables prefetching
+static const int DEFAULT_PREFETCH_THREADS = 4;
+//! Maximum number of -prefetchthreads
+static const int MAX_PREFETCH_THREADS = 16;
+//! Received blocks at most this far above the tip have their inputs prefetched
+static const int PREFETCH_LOOKAHEAD = 16;
+//! Prefetched coins kept at most, further reads are dropped until some are used
+static const size_t MAX_PREFETCHED_COINS = 500000;
+
+/**
+ * CCoinsView between pcoinsTip and the coin database that reads coins ahead
+ * of their use on a pool of threads.
+ *
+ * Prefetch() queues outpoints; the threads read them from the base view in
+ * parallel and keep the unspent coins found. A later GetCoin of such an
+ * outpoint, i.e. a cache miss in pcoinsTip, takes the coin from here instead
+ * of reading the database on the validation thread.
+ *
+ * The coins are read from the database, so they are only valid as long as the
+ * database does not change. Every BatchWrite drops them, together with the
+ * results of reads that were in flight. Coins are also dropped by Evict() once
+ * the tip reaches the height of the block they were read for, so that those
+ * of blocks that failed or were never connected do not stay. Until then they
+ * are part of the coins cache memory, see DynamicMemoryUsage().
+ */
+class CCoinsViewPrefetch final : public CCoinsViewBacked
+{
+private:
+    struct Job {
+        std::vector<COutPoint> outpoints;
+        int nHeight;
+        uint64_t generation;
+        //! Jobs left of a waiting Prefetch() call, guarded by m_mutex
+        size_t* pending;
+    };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    mutable std::condition_variable m_done_cv;
+    //! Jobs of waiting Prefetch() calls are queued in front of the others
+    std::deque<Job> m_queue;
+    //! Outpoints in m_queue that no thread has taken yet
+    std::unordered_set<COutPoint, SaltedOutpointHasher> m_queued;
+    //! Outpoints being read by a thread
+    std::unordered_set<COutPoint, SaltedOutpointHasher> m_reading;
+    struct PrefetchedCoin {
+        Coin coin;
+        //! Height of the highest block the coin was read for
+        int nHeight;
+    };
+
+    mutable std::unordered_map<COutPoint, PrefetchedCoin, SaltedOutpointHasher> m_prefetched;
+    //! Outpoints read for the blocks at each height, some may be gone from m_prefetched
+    std::map<int, std::vector<COutPoint>> m_by_height;
+    //! Dynamic memory of the coins in m_prefetched, not counting the map itself
+    mutable size_t m_prefetched_usage{0};
+    //! Incremented when the base changes, results of older reads are dropped
+    uint64_t m_generation{0};
+    bool m_stop{false};
+    std::vector<std::thread> m_threads;
+
+    void ThreadPrefetch();
+
+public:
+    CCoinsViewPrefetch(CCoinsView* viewIn, int nThreads);
+    ~CCoinsViewPrefetch();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+
+    /**
+     * Queue reads of the given outpoints, the inputs of a block at nHeight.
+     * Outpoints already read, queued or being read are skipped. With fWait,
+     * the reads go ahead of those queued before, outpoints they share are
+     * taken over, and the call returns once they are read, which spreads
+     * the reads of a block over all threads.
+     */
+    void Prefetch(std::vector<COutPoint> outpoints, int nHeight, bool fWait);
+
+    //! Drop the coins read for blocks at nHeight or below, once the tip is there
+    void Evict(int nHeight);
+
+    //! Number of prefetched coins not used yet
+    size_t GetPrefetchedCount() const;
+
+    //! Number of outpoints queued or being read
+    size_t GetQueuedCount() const;
+
+    //! Memory held by the prefetched coins, to be counted against -dbcache
+    size_t DynamicMemoryUsage() const;
+};
+
+#endif // BITCOIN_COINSPREFETCH_H
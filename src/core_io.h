@@ -11,6 +11,7 @@
 #include <vector>
 
 class CBlock;
+class CBORWriter;
 class CScript;
 class CTransaction;
 struct CMutableTransaction;
@@ -36,5 +37,8 @@ std::string SighashToStr(unsigned char sighash_type);
 void ScriptPubKeyToUniv(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 void ScriptToUniv(const CScript& script, UniValue& out, bool include_address);
 void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry, bool include_hex = true, int serialize_flags = 0);
+/** Binary counterparts of the above: same keys, but hashes and scripts as byte strings and amounts in satoshis */
+void ScriptPubKeyToCBOR(const CScript& scriptPubKey, CBORWriter& out);
+void TxToCBOR(const CTransaction& tx, const uint256& hashBlock, CBORWriter& out, bool include_hex = true, int serialize_flags = 0);
 
 #endif // BITCOIN_CORE_IO_H
@@ -4,6 +4,7 @@
 
 #include <core_io.h>
 
+#include <cbor.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
 #include <key_io.h>
@@ -171,10 +172,10 @@ void ScriptPubKeyToUniv(const CScript& scriptPubKey,
     out.pushKV("type", GetTxnOutputType(type));
 
     UniValue a(UniValue::VARR);
-    for (const CTxDestination& addr : addresses) {
-        a.push_back(EncodeDestination(addr));
+    for (std::string& addr : EncodeDestinations(addresses)) {
+        a.push_back(std::move(addr));
     }
-    out.pushKV("addresses", a);
+    out.pushKV("addresses", std::move(a));
 }
 
 void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry, bool include_hex, int serialize_flags)
@@ -187,47 +188,52 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry,
     entry.pushKV("weight", GetTransactionWeight(tx));
     entry.pushKV("locktime", (int64_t)tx.nLockTime);
 
+    // vin/vout entries are built here with fixed, unique keys, so they are
+    // appended without duplicate checks and moved rather than copied.
     UniValue vin(UniValue::VARR);
+    vin.reserve(tx.vin.size());
     for (unsigned int i = 0; i < tx.vin.size(); i++) {
         const CTxIn& txin = tx.vin[i];
         UniValue in(UniValue::VOBJ);
         if (tx.IsCoinBase())
-            in.pushKV("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            in.pushKVEnd("coinbase", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
         else {
-            in.pushKV("txid", txin.prevout.hash.GetHex());
-            in.pushKV("vout", (int64_t)txin.prevout.n);
+            in.pushKVEnd("txid", txin.prevout.hash.GetHex());
+            in.pushKVEnd("vout", (int64_t)txin.prevout.n);
             UniValue o(UniValue::VOBJ);
-            o.pushKV("asm", ScriptToAsmStr(txin.scriptSig, true));
-            o.pushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
-            in.pushKV("scriptSig", o);
+            o.pushKVEnd("asm", ScriptToAsmStr(txin.scriptSig, true));
+            o.pushKVEnd("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
+            in.pushKVEnd("scriptSig", std::move(o));
             if (!tx.vin[i].scriptWitness.IsNull()) {
                 UniValue txinwitness(UniValue::VARR);
+                txinwitness.reserve(tx.vin[i].scriptWitness.stack.size());
                 for (const auto& item : tx.vin[i].scriptWitness.stack) {
                     txinwitness.push_back(HexStr(item.begin(), item.end()));
                 }
-                in.pushKV("txinwitness", txinwitness);
+                in.pushKVEnd("txinwitness", std::move(txinwitness));
             }
         }
-        in.pushKV("sequence", (int64_t)txin.nSequence);
-        vin.push_back(in);
+        in.pushKVEnd("sequence", (int64_t)txin.nSequence);
+        vin.push_back(std::move(in));
     }
-    entry.pushKV("vin", vin);
+    entry.pushKV("vin", std::move(vin));
 
     UniValue vout(UniValue::VARR);
+    vout.reserve(tx.vout.size());
     for (unsigned int i = 0; i < tx.vout.size(); i++) {
         const CTxOut& txout = tx.vout[i];
 
         UniValue out(UniValue::VOBJ);
 
-        out.pushKV("value", ValueFromAmount(txout.nValue));
-        out.pushKV("n", (int64_t)i);
+        out.pushKVEnd("value", ValueFromAmount(txout.nValue));
+        out.pushKVEnd("n", (int64_t)i);
 
         UniValue o(UniValue::VOBJ);
         ScriptPubKeyToUniv(txout.scriptPubKey, o, true);
-        out.pushKV("scriptPubKey", o);
-        vout.push_back(out);
+        out.pushKVEnd("scriptPubKey", std::move(o));
+        vout.push_back(std::move(out));
     }
-    entry.pushKV("vout", vout);
+    entry.pushKV("vout", std::move(vout));
 
     if (!hashBlock.IsNull())
         entry.pushKV("blockhash", hashBlock.GetHex());
@@ -236,3 +242,75 @@ void TxToUniv(const CTransaction& tx, const uint256& hashBlock, UniValue& entry,
         entry.pushKV("hex", EncodeHexTx(tx, serialize_flags)); // The hex-encoded transaction. Used the name "hex" to be consistent with the verbose output of "getrawtransaction".
     }
 }
+
+void ScriptPubKeyToCBOR(const CScript& scriptPubKey, CBORWriter& out)
+{
+    txnouttype type;
+    std::vector<CTxDestination> addresses;
+    int nRequired;
+
+    const bool fExtracted = ExtractDestinations(scriptPubKey, type, addresses, nRequired);
+    out.BeginMap();
+    out.Key("hex").WriteBytes(scriptPubKey);
+    out.Key("type").WriteText(GetTxnOutputType(type));
+    if (fExtracted) {
+        out.Key("reqSigs").WriteInt(nRequired);
+        out.Key("addresses").BeginArray(addresses.size());
+        for (const std::string& addr : EncodeDestinations(addresses)) {
+            out.WriteText(addr);
+        }
+    }
+    out.End();
+}
+
+void TxToCBOR(const CTransaction& tx, const uint256& hashBlock, CBORWriter& out, bool include_hex, int serialize_flags)
+{
+    out.BeginMap();
+    out.Key("txid").WriteHash(tx.GetHash());
+    out.Key("hash").WriteHash(tx.GetWitnessHash());
+    out.Key("version").WriteInt(tx.nVersion);
+    out.Key("size").WriteUInt(::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION));
+    out.Key("vsize").WriteInt((GetTransactionWeight(tx) + WITNESS_SCALE_FACTOR - 1) / WITNESS_SCALE_FACTOR);
+    out.Key("weight").WriteInt(GetTransactionWeight(tx));
+    out.Key("locktime").WriteUInt(tx.nLockTime);
+
+    out.Key("vin").BeginArray(tx.vin.size());
+    for (const CTxIn& txin : tx.vin) {
+        out.BeginMap();
+        if (tx.IsCoinBase()) {
+            out.Key("coinbase").WriteBytes(txin.scriptSig);
+        } else {
+            out.Key("txid").WriteHash(txin.prevout.hash);
+            out.Key("vout").WriteUInt(txin.prevout.n);
+            out.Key("scriptSig").WriteBytes(txin.scriptSig);
+            if (!txin.scriptWitness.IsNull()) {
+                out.Key("txinwitness").BeginArray(txin.scriptWitness.stack.size());
+                for (const auto& item : txin.scriptWitness.stack) {
+                    out.WriteBytes(item);
+                }
+            }
+        }
+        out.Key("sequence").WriteUInt(txin.nSequence);
+        out.End();
+    }
+
+    out.Key("vout").BeginArray(tx.vout.size());
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        const CTxOut& txout = tx.vout[i];
+        out.BeginMap(3);
+        out.Key("value").WriteInt(txout.nValue);
+        out.Key("n").WriteUInt(i);
+        out.Key("scriptPubKey");
+        ScriptPubKeyToCBOR(txout.scriptPubKey, out);
+    }
+
+    if (!hashBlock.IsNull())
+        out.Key("blockhash").WriteHash(hashBlock);
+
+    if (include_hex) {
+        CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION | serialize_flags);
+        ssTx << tx;
+        out.Key("hex").WriteBytes((const unsigned char*)ssTx.data(), ssTx.size());
+    }
+    out.End();
+}
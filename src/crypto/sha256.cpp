@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <string.h>
 #include <atomic>
+#include <utility>
 
 #if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
 #if defined(USE_ASM)
@@ -22,11 +23,13 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 namespace sha256d64_sse41
 {
 void Transform_4way(unsigned char* out, const unsigned char* in);
+void TransformMulti_4way(uint32_t* s, const unsigned char* const* blocks);
 }
 
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* blocks);
 }
 
 namespace sha256d64_shani
@@ -416,6 +419,8 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+/** Transform one block in each of several lanes; the states are stored lane by lane, 8 words each. */
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -461,6 +466,121 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformMultiType TransformMulti_4way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
+
+/** A message being hashed in one lane of a multi-way transform. */
+struct MultiLane
+{
+    bool active = false;
+    bool second;                 //!< Hashing the first digest again, for double SHA256
+    size_t index;                //!< Index of the message and its output
+    const unsigned char* data;   //!< The next full block of the message
+    size_t blocks;               //!< Full blocks left at data
+    size_t tail_blocks;          //!< Blocks in tail
+    size_t tail_pos;             //!< Blocks of tail already hashed
+    unsigned char tail[128];     //!< The last partial block with padding
+
+    void Start(const unsigned char* in, size_t len)
+    {
+        data = in;
+        blocks = len / 64;
+        const size_t rem = len % 64;
+        tail_blocks = rem + 9 > 64 ? 2 : 1;
+        tail_pos = 0;
+        memset(tail, 0, sizeof(tail));
+        // An empty message may come with a null pointer
+        if (len != 0) memcpy(tail, in + 64 * blocks, rem);
+        tail[rem] = 0x80;
+        WriteBE64(tail + 64 * tail_blocks - 8, (uint64_t)len << 3);
+    }
+
+    bool Done() const { return blocks == 0 && tail_pos == tail_blocks; }
+
+    const unsigned char* Next()
+    {
+        if (blocks) {
+            --blocks;
+            data += 64;
+            return data - 64;
+        }
+        return tail + 64 * tail_pos++;
+    }
+};
+
+/** Hash count messages with an N-way transform, refilling each lane from the queue as soon as
+ *  its message is done. Once fewer than half of the lanes are busy the rest is finished one
+ *  lane at a time, so a few long messages at the end do not keep the idle lanes spinning. */
+template<size_t N>
+void HashMultiWay(TransformMultiType tr, bool twice, unsigned char* out, const unsigned char* const* in, const size_t* lens, size_t count)
+{
+    static const unsigned char idle[64] = {0};
+    uint32_t s[8 * N];
+    MultiLane lanes[N];
+    const unsigned char* blocks[N];
+    size_t next = 0;
+    size_t busy = 0;
+
+    // Called when a lane has hashed all of its blocks: either start the second hash over the
+    // digest, or store the result.
+    auto finish = [&](size_t l) {
+        MultiLane& lane = lanes[l];
+        uint32_t* state = s + 8 * l;
+        if (twice && !lane.second) {
+            unsigned char digest[32];
+            for (int i = 0; i < 8; ++i) WriteBE32(digest + 4 * i, state[i]);
+            lane.second = true;
+            lane.Start(digest, 32);
+            sha256::Initialize(state);
+        } else {
+            for (int i = 0; i < 8; ++i) WriteBE32(out + 32 * lane.index + 4 * i, state[i]);
+            lane.active = false;
+            --busy;
+        }
+    };
+
+    while (true) {
+        for (size_t l = 0; l < N && next < count; ++l) {
+            if (lanes[l].active) continue;
+            lanes[l].active = true;
+            lanes[l].second = false;
+            lanes[l].index = next;
+            lanes[l].Start(in[next], lens[next]);
+            sha256::Initialize(s + 8 * l);
+            ++next;
+            ++busy;
+        }
+        if (busy * 2 <= N) break;
+        for (size_t l = 0; l < N; ++l) {
+            blocks[l] = lanes[l].active ? lanes[l].Next() : idle;
+        }
+        tr(s, blocks);
+        for (size_t l = 0; l < N; ++l) {
+            if (lanes[l].active && lanes[l].Done()) finish(l);
+        }
+    }
+
+    for (size_t l = 0; l < N; ++l) {
+        while (lanes[l].active) {
+            while (!lanes[l].Done()) Transform(s + 8 * l, lanes[l].Next(), 1);
+            finish(l);
+        }
+    }
+}
+
+void HashMulti(bool twice, unsigned char* out, const unsigned char* const* in, const size_t* lens, size_t count)
+{
+    if (TransformMulti_8way) {
+        HashMultiWay<8>(TransformMulti_8way, twice, out, in, lens, count);
+    } else if (TransformMulti_4way) {
+        HashMultiWay<4>(TransformMulti_4way, twice, out, in, lens, count);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            CSHA256().Write(in[i], lens[i]).Finalize(out + 32 * i);
+            if (twice) CSHA256().Write(out + 32 * i, 32).Finalize(out + 32 * i);
+        }
+    }
+}
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +664,23 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformMulti_4way and TransformMulti_8way, if available. Lane i starts
+    // from the state after i blocks and hashes block i.
+    const std::pair<TransformMultiType, size_t> multi[] = {{TransformMulti_4way, 4}, {TransformMulti_8way, 8}};
+    for (const auto& tr : multi) {
+        if (!tr.first) continue;
+        uint32_t state[64];
+        const unsigned char* blocks[8];
+        for (size_t i = 0; i < tr.second; ++i) {
+            std::copy(result[i], result[i] + 8, state + 8 * i);
+            blocks[i] = data + 1 + 64 * i;
+        }
+        tr.first(state, blocks);
+        for (size_t i = 0; i < tr.second; ++i) {
+            if (!std::equal(state + 8 * i, state + 8 * i + 8, result[i + 1])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -622,6 +759,7 @@ std::string SHA256AutoDetect()
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        TransformMulti_4way = sha256d64_sse41::TransformMulti_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -629,6 +767,7 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256d64_avx2::TransformMulti_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -728,3 +867,18 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+bool SHA256MultiAvailable()
+{
+    return TransformMulti_8way || TransformMulti_4way;
+}
+
+void SHA256Multi(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    HashMulti(false, output, inputs, lengths, count);
+}
+
+void SHA256DMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    HashMulti(true, output, inputs, lengths, count);
+}
@@ -38,4 +38,20 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute the SHA256 of several messages of any length, hashing 4 or 8 of them
+ *  in parallel when the CPU supports it.
+ *  output:  pointer to a count*32 byte output buffer
+ *  inputs:  pointers to the messages
+ *  lengths: the lengths of the messages in bytes
+ *  count:   the number of messages.
+ */
+void SHA256Multi(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
+/** Whether SHA256Multi and SHA256DMulti hash messages in parallel. Without a
+ *  multi-way transform they hash one message at a time, like CSHA256. */
+bool SHA256MultiAvailable();
+
+/** Compute the double-SHA256 of several messages of any length, as SHA256Multi. */
+void SHA256DMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -4,6 +4,7 @@
 #include <immintrin.h>
 
 #include <crypto/sha256.h>
+#include <crypto/sha256_k.h>
 #include <crypto/common.h>
 
 namespace sha256d64_sse41 {
@@ -59,6 +60,27 @@ void inline Write4(unsigned char* out, int offset, __m128i v) {
     WriteLE32(out + 96 + offset, _mm_extract_epi32(v, 0));
 }
 
+__m128i inline ReadState4(const uint32_t* s, int word) {
+    return _mm_set_epi32(s[word], s[8 + word], s[16 + word], s[24 + word]);
+}
+
+void inline WriteState4(uint32_t* s, int word, __m128i v) {
+    s[word] = _mm_extract_epi32(v, 3);
+    s[8 + word] = _mm_extract_epi32(v, 2);
+    s[16 + word] = _mm_extract_epi32(v, 1);
+    s[24 + word] = _mm_extract_epi32(v, 0);
+}
+
+/** Word i of the message schedule, kept in the 16-word window w. */
+__m128i inline __attribute__((always_inline)) Schedule(__m128i* w, int i, const unsigned char* const* blocks)
+{
+    if (i < 16) {
+        const int offset = 4 * i;
+        return w[i] = _mm_set_epi32(ReadBE32(blocks[0] + offset), ReadBE32(blocks[1] + offset), ReadBE32(blocks[2] + offset), ReadBE32(blocks[3] + offset));
+    }
+    return Inc(w[i & 15], sigma1(w[(i + 14) & 15]), w[(i + 9) & 15], sigma0(w[(i + 1) & 15]));
+}
+
 }
 
 void Transform_4way(unsigned char* out, const unsigned char* in)
@@ -312,6 +334,40 @@ void Transform_4way(unsigned char* out, const unsigned char* in)
     Write4(out, 28, Add(h, K(0x5be0cd19ul)));
 }
 
+void TransformMulti_4way(uint32_t* s, const unsigned char* const* blocks)
+{
+    __m128i a = ReadState4(s, 0);
+    __m128i b = ReadState4(s, 1);
+    __m128i c = ReadState4(s, 2);
+    __m128i d = ReadState4(s, 3);
+    __m128i e = ReadState4(s, 4);
+    __m128i f = ReadState4(s, 5);
+    __m128i g = ReadState4(s, 6);
+    __m128i h = ReadState4(s, 7);
+    const __m128i a0 = a, b0 = b, c0 = c, d0 = d, e0 = e, f0 = f, g0 = g, h0 = h;
+    __m128i w[16];
+
+    for (int i = 0; i < 64; i += 8) {
+        Round(a, b, c, d, e, f, g, h, Add(K(sha256_k::ROUND_K[i + 0]), Schedule(w, i + 0, blocks)));
+        Round(h, a, b, c, d, e, f, g, Add(K(sha256_k::ROUND_K[i + 1]), Schedule(w, i + 1, blocks)));
+        Round(g, h, a, b, c, d, e, f, Add(K(sha256_k::ROUND_K[i + 2]), Schedule(w, i + 2, blocks)));
+        Round(f, g, h, a, b, c, d, e, Add(K(sha256_k::ROUND_K[i + 3]), Schedule(w, i + 3, blocks)));
+        Round(e, f, g, h, a, b, c, d, Add(K(sha256_k::ROUND_K[i + 4]), Schedule(w, i + 4, blocks)));
+        Round(d, e, f, g, h, a, b, c, Add(K(sha256_k::ROUND_K[i + 5]), Schedule(w, i + 5, blocks)));
+        Round(c, d, e, f, g, h, a, b, Add(K(sha256_k::ROUND_K[i + 6]), Schedule(w, i + 6, blocks)));
+        Round(b, c, d, e, f, g, h, a, Add(K(sha256_k::ROUND_K[i + 7]), Schedule(w, i + 7, blocks)));
+    }
+
+    WriteState4(s, 0, Add(a, a0));
+    WriteState4(s, 1, Add(b, b0));
+    WriteState4(s, 2, Add(c, c0));
+    WriteState4(s, 3, Add(d, d0));
+    WriteState4(s, 4, Add(e, e0));
+    WriteState4(s, 5, Add(f, f0));
+    WriteState4(s, 6, Add(g, g0));
+    WriteState4(s, 7, Add(h, h0));
+}
+
 }
 
 #endif
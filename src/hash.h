@@ -123,6 +123,8 @@ private:
 public:
 
     CHashWriter(int nTypeIn, int nVersionIn) : nType(nTypeIn), nVersion(nVersionIn) {}
+    //! Continue from the state of a hasher that already hashed a common prefix
+    CHashWriter(int nTypeIn, int nVersionIn, const CHash256& ctxIn) : ctx(ctxIn), nType(nTypeIn), nVersion(nVersionIn) {}
 
     int GetType() const { return nType; }
     int GetVersion() const { return nVersion; }
@@ -0,0 +1,106 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <httprpc.h>
+
+#include <httpserver.h>
+#include <logging.h>
+#include <metrics.h>
+#include <net.h>
+#include <pubkey.h>
+#include <rpc/protocol.h>
+#include <txmempool.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+/** Metrics of subsystems that keep their own statistics, read when scraped */
+static void CollectNodeMetrics(std::string& out)
+{
+    std::vector<std::pair<std::string, double>> depth, limit, requests, rejected, wait, run;
+    for (const HTTPWorkQueueStats& stats : GetHTTPWorkQueueStats()) {
+        const std::string label = "queue=\"" + stats.name + "\"";
+        depth.emplace_back(label, stats.depth);
+        limit.emplace_back(label, stats.max_depth);
+        requests.emplace_back(label, stats.processed);
+        rejected.emplace_back(label, stats.rejected);
+        wait.emplace_back(label, stats.total_wait_us / 1e6);
+        run.emplace_back(label, stats.total_run_us / 1e6);
+    }
+    AppendMetric(out, "http_workqueue_depth", "gauge", "Requests waiting in an HTTP work queue", depth);
+    AppendMetric(out, "http_workqueue_limit", "gauge", "Maximum depth of an HTTP work queue", limit);
+    AppendMetric(out, "http_requests_total", "counter", "Requests handled from an HTTP work queue", requests);
+    AppendMetric(out, "http_requests_rejected_total", "counter", "Requests rejected because an HTTP work queue was full", rejected);
+    AppendMetric(out, "http_request_wait_seconds_total", "counter", "Time handled requests spent in an HTTP work queue", wait);
+    AppendMetric(out, "http_request_run_seconds_total", "counter", "Time spent in HTTP handlers", run);
+
+    std::vector<std::pair<std::string, double>> pending, callbacks, callback_time;
+    for (const ValidationInterfaceStats& stats : GetValidationInterfaceStats()) {
+        const std::string label = "subscriber=\"" + stats.name + "\"";
+        pending.emplace_back(label, stats.pending);
+        callbacks.emplace_back(label, stats.processed);
+        callback_time.emplace_back(label, stats.total_run_us / 1e6);
+    }
+    AppendMetric(out, "validation_queue_pending", "gauge", "Validation interface callbacks queued for a subscriber", pending);
+    AppendMetric(out, "validation_callbacks_total", "counter", "Validation interface callbacks run for a subscriber", callbacks);
+    AppendMetric(out, "validation_callback_seconds_total", "counter", "Time spent in validation interface callbacks of a subscriber", callback_time);
+
+    const PubKeyCacheStats pubkey_cache = GetPubKeyCacheStats();
+    AppendMetric(out, "pubkey_cache_lookups_total", "counter", "Lookups in the cache of parsed public keys", {
+        {"result=\"hit\"", (double)pubkey_cache.nHits},
+        {"result=\"miss\"", (double)pubkey_cache.nMisses},
+    });
+
+    {
+        LOCK(mempool.cs);
+        AppendMetric(out, "mempool_transactions", "gauge", "Transactions in the mempool", {{"", (double)mempool.size()}});
+        AppendMetric(out, "mempool_tx_bytes", "gauge", "Sum of the virtual sizes of mempool transactions", {{"", (double)mempool.GetTotalTxSize()}});
+        AppendMetric(out, "mempool_usage_bytes", "gauge", "Memory used by the mempool", {{"", (double)mempool.DynamicMemoryUsage()}});
+    }
+
+    if (g_connman) {
+        AppendMetric(out, "peers", "gauge", "Connected peers", {
+            {"direction=\"inbound\"", (double)g_connman->GetNodeCount(CConnman::CONNECTIONS_IN)},
+            {"direction=\"outbound\"", (double)g_connman->GetNodeCount(CConnman::CONNECTIONS_OUT)},
+        });
+        AppendMetric(out, "net_bytes_total", "counter", "Bytes transferred over P2P connections", {
+            {"direction=\"received\"", (double)g_connman->GetTotalBytesRecv()},
+            {"direction=\"sent\"", (double)g_connman->GetTotalBytesSent()},
+        });
+    }
+
+    std::vector<std::pair<std::string, double>> suppressed;
+    for (const CLogCategoryActive& category : ListActiveLogCategories()) {
+        suppressed.emplace_back("category=\"" + category.category + "\"", category.suppressed);
+    }
+    AppendMetric(out, "log_messages_suppressed_total", "counter", "Debug messages suppressed by -logratelimit", suppressed);
+    AppendMetric(out, "log_messages_dropped_total", "counter", "Debug messages dropped because the log writer fell behind", {{"", (double)g_logger->GetDropped()}});
+}
+
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string&)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET is supported\r\n");
+        return false;
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, RenderMetrics());
+    return true;
+}
+
+bool StartHTTPMetrics()
+{
+    RegisterMetricsCollector("node", CollectNodeMetrics);
+    RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics, HTTPWorkClass::REST);
+    return true;
+}
+
+void InterruptHTTPMetrics()
+{
+}
+
+void StopHTTPMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+    UnregisterMetricsCollector("node");
+}
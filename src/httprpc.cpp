@@ -4,6 +4,7 @@
 
 #include <httprpc.h>
 
+#include <cbor.h>
 #include <chainparams.h>
 #include <httpserver.h>
 #include <key_io.h>
@@ -183,7 +184,7 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
+        UniValue reply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
@@ -191,16 +192,25 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            reply = JSONRPCReplyObj(result, NullUniValue, jreq.id);
 
         // array of requests
         } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
+            reply = JSONRPCExecBatch(jreq, valRequest.get_array());
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+        // Clients may ask for a binary reply; the request itself is always JSON
+        if (IsCBORMediaType(req->GetHeader("Accept").second)) {
+            std::string strReply;
+            CBORWriter writer(strReply);
+            UniValueToCBOR(writer, reply);
+            req->WriteHeader("Content-Type", CBOR_CONTENT_TYPE);
+            req->WriteReply(HTTP_OK, strReply);
+        } else {
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, reply.write() + "\n");
+        }
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
@@ -242,7 +252,7 @@ bool StartHTTPRPC()
     RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
 #ifdef ENABLE_WALLET
     // ifdef can be removed once we switch to better endpoint support and API versioning
-    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC, HTTPWorkClass::WALLET);
 #endif
     assert(EventBase());
     httpRPCTimerInterface = MakeUnique<HTTPRPCTimerInterface>(EventBase());
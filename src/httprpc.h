@@ -8,6 +8,8 @@
 #include <string>
 #include <map>
 
+static const bool DEFAULT_HTTP_METRICS = false;
+
 /** Start HTTP RPC subsystem.
  * Precondition; HTTP and RPC has been started.
  */
@@ -32,4 +34,16 @@ void InterruptREST();
  */
 void StopREST();
 
+/** Start serving metrics in the Prometheus text format on /metrics.
+ * Precondition; HTTP has been started.
+ */
+bool StartHTTPMetrics();
+/** Interrupt the metrics endpoint.
+ */
+void InterruptHTTPMetrics();
+/** Stop serving metrics.
+ * Precondition; HTTP has been stopped.
+ */
+void StopHTTPMetrics();
+
 #endif
@@ -12,7 +12,10 @@
 #include <rpc/protocol.h> // For HTTP status codes
 #include <sync.h>
 #include <ui_interface.h>
+#include <utiltime.h>
 
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
@@ -71,10 +74,17 @@ private:
     /** Mutex protects entire object */
     std::mutex cs;
     std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
+    /** Queued items with their enqueue time (in microseconds) */
+    std::deque<std::pair<std::unique_ptr<WorkItem>, int64_t>> queue;
     bool running;
     size_t maxDepth;
 
+    uint64_t nProcessed = 0;
+    uint64_t nRejected = 0;
+    int64_t nTotalWaitMicros = 0;
+    int64_t nMaxWaitMicros = 0;
+    int64_t nTotalRunMicros = 0;
+
 public:
     explicit WorkQueue(size_t _maxDepth) : running(true),
                                  maxDepth(_maxDepth)
@@ -90,9 +100,10 @@ public:
     {
         std::unique_lock<std::mutex> lock(cs);
         if (queue.size() >= maxDepth) {
+            nRejected++;
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        queue.emplace_back(std::unique_ptr<WorkItem>(item), GetTimeMicros());
         cond.notify_one();
         return true;
     }
@@ -101,18 +112,39 @@ public:
     {
         while (true) {
             std::unique_ptr<WorkItem> i;
+            int64_t nStart;
             {
                 std::unique_lock<std::mutex> lock(cs);
                 while (running && queue.empty())
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
+                i = std::move(queue.front().first);
+                nStart = GetTimeMicros();
+                const int64_t nWait = nStart - queue.front().second;
                 queue.pop_front();
+                nTotalWaitMicros += nWait;
+                nMaxWaitMicros = std::max(nMaxWaitMicros, nWait);
             }
             (*i)();
+            const int64_t nRun = GetTimeMicros() - nStart;
+            std::unique_lock<std::mutex> lock(cs);
+            nProcessed++;
+            nTotalRunMicros += nRun;
         }
     }
+    /** Fill in the queue part of stats */
+    void GetStats(HTTPWorkQueueStats& stats)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        stats.depth = queue.size();
+        stats.max_depth = maxDepth;
+        stats.processed = nProcessed;
+        stats.rejected = nRejected;
+        stats.total_wait_us = nTotalWaitMicros;
+        stats.max_wait_us = nMaxWaitMicros;
+        stats.total_run_us = nTotalRunMicros;
+    }
     /** Interrupt and exit loops */
     void Interrupt()
     {
@@ -125,15 +157,30 @@ public:
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPWorkClass _workClass):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), workClass(_workClass)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPWorkClass workClass;
 };
 
+/** Name and sizing options of each HTTPWorkClass, in enum order */
+static const struct {
+    const char* name;
+    const char* threadsArg;
+    int defaultThreads;
+    const char* depthArg;
+    int defaultDepth;
+} HTTP_WORK_CLASSES[] = {
+    {"rpc", "-rpcthreads", DEFAULT_HTTP_THREADS, "-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE},
+    {"wallet", "-rpcwalletthreads", DEFAULT_HTTP_WALLET_THREADS, "-rpcwalletworkqueue", DEFAULT_HTTP_WORKQUEUE},
+    {"rest", "-restthreads", DEFAULT_HTTP_REST_THREADS, "-restworkqueue", DEFAULT_HTTP_REST_WORKQUEUE},
+};
+static const size_t NUM_HTTP_WORK_CLASSES = ARRAYLEN(HTTP_WORK_CLASSES);
+
 /** HTTP module state */
 
 //! libevent event loop
@@ -142,8 +189,8 @@ static struct event_base* eventBase = nullptr;
 struct evhttp* eventHTTP = nullptr;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static WorkQueue<HTTPClosure>* workQueue = nullptr;
+//! Work queues for handling longer requests off the event loop thread, one per HTTPWorkClass
+static WorkQueue<HTTPClosure>* workQueues[NUM_HTTP_WORK_CLASSES] = {};
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -263,11 +310,14 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
     // Dispatch to worker thread
     if (i != iend) {
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
+        const size_t nClass = static_cast<size_t>(i->workClass);
+        WorkQueue<HTTPClosure>* workQueue = workQueues[nClass];
         assert(workQueue);
         if (workQueue->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: request rejected because http %s work queue depth exceeded, it can be increased with the %s= setting\n",
+                      HTTP_WORK_CLASSES[nClass].name, HTTP_WORK_CLASSES[nClass].depthArg);
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
         }
     } else {
@@ -399,10 +449,11 @@ bool InitHTTPServer()
     }
 
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
-    int workQueueDepth = std::max((long)gArgs.GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
-
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    for (size_t n = 0; n < NUM_HTTP_WORK_CLASSES; n++) {
+        int workQueueDepth = std::max((long)gArgs.GetArg(HTTP_WORK_CLASSES[n].depthArg, HTTP_WORK_CLASSES[n].defaultDepth), 1L);
+        LogPrintf("HTTP: creating %s work queue of depth %d\n", HTTP_WORK_CLASSES[n].name, workQueueDepth);
+        workQueues[n] = new WorkQueue<HTTPClosure>(workQueueDepth);
+    }
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -425,19 +476,30 @@ bool UpdateHTTPServerLogging(bool enable) {
 
 std::thread threadHTTP;
 std::future<bool> threadResult;
-static std::vector<std::thread> g_thread_http_workers;
+static std::vector<std::thread> g_thread_http_workers[NUM_HTTP_WORK_CLASSES];
+//! Size of g_thread_http_workers, for GetHTTPWorkQueueStats callers on other threads
+static std::atomic<int> g_http_worker_count[NUM_HTTP_WORK_CLASSES];
 
 void StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
-    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     std::packaged_task<bool(event_base*)> task(ThreadHTTP);
     threadResult = task.get_future();
     threadHTTP = std::thread(std::move(task), eventBase);
 
-    for (int i = 0; i < rpcThreads; i++) {
-        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue);
+    for (size_t n = 0; n < NUM_HTTP_WORK_CLASSES; n++) {
+        // Classes without handlers never receive work
+        bool fUsed = false;
+        for (const HTTPPathHandler& handler : pathHandlers) {
+            fUsed |= (static_cast<size_t>(handler.workClass) == n);
+        }
+        if (!fUsed) continue;
+        int nThreads = std::max((long)gArgs.GetArg(HTTP_WORK_CLASSES[n].threadsArg, HTTP_WORK_CLASSES[n].defaultThreads), 1L);
+        LogPrintf("HTTP: starting %d %s worker threads\n", nThreads, HTTP_WORK_CLASSES[n].name);
+        for (int i = 0; i < nThreads; i++) {
+            g_thread_http_workers[n].emplace_back(HTTPWorkQueueRun, workQueues[n]);
+        }
+        g_http_worker_count[n] = nThreads;
     }
 }
 
@@ -452,21 +514,28 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
     }
-    if (workQueue)
-        workQueue->Interrupt();
+    for (WorkQueue<HTTPClosure>* workQueue : workQueues) {
+        if (workQueue)
+            workQueue->Interrupt();
+    }
 }
 
 void StopHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Stopping HTTP server\n");
-    if (workQueue) {
-        LogPrint(BCLog::HTTP, "Waiting for HTTP worker threads to exit\n");
-        for (auto& thread: g_thread_http_workers) {
+    LogPrint(BCLog::HTTP, "Waiting for HTTP worker threads to exit\n");
+    for (size_t n = 0; n < NUM_HTTP_WORK_CLASSES; n++) {
+        g_http_worker_count[n] = 0;
+        for (auto& thread: g_thread_http_workers[n]) {
             thread.join();
         }
-        g_thread_http_workers.clear();
-        delete workQueue;
-        workQueue = nullptr;
+        g_thread_http_workers[n].clear();
+    }
+    // Only delete the queues once no worker of any class is left to read
+    // them through GetHTTPWorkQueueStats
+    for (size_t n = 0; n < NUM_HTTP_WORK_CLASSES; n++) {
+        delete workQueues[n];
+        workQueues[n] = nullptr;
     }
     if (eventBase) {
         LogPrint(BCLog::HTTP, "Waiting for HTTP event thread to exit\n");
@@ -500,6 +569,20 @@ struct event_base* EventBase()
     return eventBase;
 }
 
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    std::vector<HTTPWorkQueueStats> vStats;
+    for (size_t n = 0; n < NUM_HTTP_WORK_CLASSES; n++) {
+        HTTPWorkQueueStats stats{};
+        stats.name = HTTP_WORK_CLASSES[n].name;
+        stats.threads = g_http_worker_count[n];
+        if (workQueues[n])
+            workQueues[n]->GetStats(stats);
+        vStats.push_back(stats);
+    }
+    return vStats;
+}
+
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
 {
     // Static handler: simply call inner handler
@@ -650,10 +733,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, HTTPWorkClass work_class)
 {
-    LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d, %s)\n", prefix, exactMatch, HTTP_WORK_CLASSES[static_cast<size_t>(work_class)].name);
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, work_class));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
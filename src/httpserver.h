@@ -8,9 +8,13 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
+static const int DEFAULT_HTTP_WALLET_THREADS=2;
+static const int DEFAULT_HTTP_REST_THREADS=4;
+static const int DEFAULT_HTTP_REST_WORKQUEUE=64;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
 struct evhttp_request;
@@ -36,13 +40,42 @@ void StopHTTPServer();
  * libevent doesn't support debug logging.*/
 bool UpdateHTTPServerLogging(bool enable);
 
+/** Endpoint classes. Each class has its own worker threads and work queue
+ * (with its own depth limit), so that e.g. a flood of explorer requests can
+ * not fill the queue or occupy the threads that serve mining RPCs.
+ */
+enum class HTTPWorkClass {
+    RPC,    //!< JSON-RPC on "/": node, mining and default wallet calls
+    WALLET, //!< JSON-RPC on "/wallet/<name>"
+    REST,   //!< Public REST and /api/ explorer endpoints
+};
+
+/** Snapshot of the state of the work queue of one endpoint class */
+struct HTTPWorkQueueStats
+{
+    std::string name;
+    int threads;
+    size_t depth;
+    size_t max_depth;
+    uint64_t processed;
+    uint64_t rejected;
+    int64_t total_wait_us;  //!< Time spent queued by processed requests
+    int64_t max_wait_us;
+    int64_t total_run_us;   //!< Time spent in handlers by processed requests
+};
+
+/** Return work queue statistics for every endpoint class. The queues stay valid
+ * until StopHTTPServer has joined the worker threads of all classes. */
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Requests are served by the workers of work_class; only
+ * classes with handlers registered before StartHTTPServer get threads.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, HTTPWorkClass work_class = HTTPWorkClass::RPC);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -13,9 +13,12 @@
 
 #include <addrman.h>
 #include <amount.h>
+#include <blockfilecache.h>
+#include <blockstats.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
+#include <coinsprefetch.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
 #include <fs.h>
@@ -29,6 +32,7 @@
 #include <net_processing.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
+#include <restcache.h>
 #include <rpc/server.h>
 #include <rpc/register.h>
 #include <rpc/blockchain.h>
@@ -62,6 +66,7 @@
 
 #if ENABLE_ZMQ
 #include <zmq/zmqnotificationinterface.h>
+#include <zmq/zmqpublisher.h>
 #include <zmq/zmqrpc.h>
 #endif
 
@@ -172,6 +177,7 @@ void Interrupt()
     InterruptHTTPRPC();
     InterruptRPC();
     InterruptREST();
+    InterruptHTTPMetrics();
     InterruptTorControl();
     InterruptMapPort();
     if (g_connman)
@@ -195,6 +201,7 @@ void Shutdown()
 
     StopHTTPRPC();
     StopREST();
+    StopHTTPMetrics();
     StopRPC();
     StopHTTPServer();
     g_wallet_init_interface.Flush();
@@ -242,11 +249,13 @@ void Shutdown()
             FlushStateToDisk();
         }
         pcoinsTip.reset();
+        pcoinsprefetch.reset();
         pcoinscatcher.reset();
         pcoinsdbview.reset();
         pblocktree.reset();
         if (fTxIndex) pblocktxindex.reset();
         if (fAddressIndex) pblockaddressindex.reset();
+        if (fBlockStatsIndex) pblockstatsindex.reset();
     }
     g_wallet_init_interface.Stop();
 
@@ -272,6 +281,7 @@ void Shutdown()
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    g_logger->StopAsync();
 }
 
 /**
@@ -340,8 +350,10 @@ void SetupServerArgs()
     gArgs.AddArg("-?", "Print this help message and exit", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-version", "Print version and exit", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-asyncflush", strprintf("Write the UTXO cache to disk from a background thread while validation continues (default: %u)", DEFAULT_ASYNC_FLUSH), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify blocks directory (default: <datadir>/blocks)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockfilemmap", strprintf("Read blocks from finalized blk files through memory mappings instead of pread. A disk error while reading a mapped file terminates the process (default: %u)", DEFAULT_BLOCKFILE_MMAP), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to operate in a blocks only mode (default: %u)", DEFAULT_BLOCKSONLY), true, OptionsCategory::OPTIONS);
@@ -359,6 +371,7 @@ void SetupServerArgs()
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-prefetchthreads=<n>", strprintf("Set the number of threads reading block inputs from the UTXO database ahead of validation (0 to %d, default: %d)", MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), false, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), false, OptionsCategory::OPTIONS);
@@ -370,13 +383,16 @@ void SetupServerArgs()
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-schedulerthreads=<n>", strprintf("Set the number of background scheduler threads. Notifications to the wallet, ZMQ and other subscribers of validation events are delivered concurrently on them (default: %d)", DEFAULT_SCHEDULER_THREADS), false, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", false, OptionsCategory::OPTIONS);
 #else
     hidden_args.emplace_back("-sysperms");
 #endif
     gArgs.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-undoretain=<n>", strprintf("Without pruning, keep the undo data of the last <n> blocks and delete older rev*.dat files, 0 keeps all (minimum %u, default: %u)", MIN_BLOCKS_TO_KEEP, DEFAULT_UNDO_RETAIN), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-addressindex", strprintf("Maintain a full address index, used by the getaddressbalance rpc call (default: %u)", false), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockstatsindex", strprintf("Maintain the getblockstats values of every block, used by the getblockstats and getblockstatsrange rpc calls (default: %u)", DEFAULT_BLOCKSTATSINDEX), false, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-gen", "PoW generate enable", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-gencomment", "coinbase comment", false, OptionsCategory::OPTIONS);
@@ -430,11 +446,17 @@ void SetupServerArgs()
     gArgs.AddArg("-zmqpubhashtx=<address>", "Enable publish hash transaction in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblock=<address>", "Enable publish raw block in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubmempoolremoval=<address>", "Enable publish of transactions leaving the mempool, with the reason, in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubaddressdelta=<address>", "Enable publish of per-block address index changes in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubqueue=<n>", strprintf("Maximum number of notifications waiting to be published before new ones are dropped (default: %u)", DEFAULT_ZMQ_PUBLISH_QUEUE), false, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
     hidden_args.emplace_back("-zmqpubrawblock=<address>");
     hidden_args.emplace_back("-zmqpubrawtx=<address>");
+    hidden_args.emplace_back("-zmqpubmempoolremoval=<address>");
+    hidden_args.emplace_back("-zmqpubaddressdelta=<address>");
+    hidden_args.emplace_back("-zmqpubqueue=<n>");
 #endif
 
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), true, OptionsCategory::DEBUG_TEST);
@@ -444,6 +466,7 @@ void SetupServerArgs()
     gArgs.AddArg("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages", true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-fastprune", "Use 64 KiB block files, to test pruning and -undoretain with short chains (default: 0)", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", DEFAULT_STOPAFTERBLOCKIMPORT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopatheight", strprintf("Stop running after reaching the given height in the main chain (default: %u)", DEFAULT_STOPATHEIGHT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-limitancestorcount=<n>", strprintf("Do not accept transactions if number of in-mempool ancestors is <n> or more (default: %u)", DEFAULT_ANCESTOR_LIMIT), true, OptionsCategory::DEBUG_TEST);
@@ -456,7 +479,9 @@ void SetupServerArgs()
         "If <category> is not supplied or if <category> = 1, output all debugging information. <category> can be: " + ListLogCategories() + ".", false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-debugexclude=<category>", strprintf("Exclude debugging information for a category. Can be used in conjunction with -debug=1 to output debug logs for all categories except one or more specified categories."), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-help-debug", "Show all debugging options (usage: --help -help-debug)", false, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-logasync", strprintf("Write the debug log from a background thread. Debug category messages are dropped if it falls behind (default: %u)", DEFAULT_LOGASYNC), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logips", strprintf("Include IP addresses in debug output (default: %u)", DEFAULT_LOGIPS), false, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-logratelimit=<[category:]n>", strprintf("Log at most <n> messages per second of each debug category, or of <category> only. Can be specified multiple times (0 = unlimited, default: %u)", DEFAULT_LOGRATELIMIT), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)", true, OptionsCategory::DEBUG_TEST);
@@ -488,7 +513,12 @@ void SetupServerArgs()
     gArgs.AddArg("-blockmintxfee=<amt>", strprintf("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)), false, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-blockversion=<n>", "Override block version to test forking scenarios", true, OptionsCategory::BLOCK_CREATION);
 
+    gArgs.AddArg("-metrics", strprintf("Serve node metrics in the Prometheus text format on /metrics, without authentication (default: %u)", DEFAULT_HTTP_METRICS), false, OptionsCategory::RPC);
     gArgs.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), false, OptionsCategory::RPC);
+    gArgs.AddArg("-restcachedepth=<n>", strprintf("Only cache REST and /api/ replies for blocks with at least <n> confirmations (default: %d)", DEFAULT_REST_CACHE_DEPTH), true, OptionsCategory::RPC);
+    gArgs.AddArg("-restcachesize=<n>", strprintf("Maximum size of the REST and /api/ reply cache in MiB, 0 to disable (default: %d)", DEFAULT_REST_CACHE_SIZE), false, OptionsCategory::RPC);
+    gArgs.AddArg("-restthreads=<n>", strprintf("Set the number of threads to service REST and /api/ requests, separate from the RPC threads (default: %d)", DEFAULT_HTTP_REST_THREADS), false, OptionsCategory::RPC);
+    gArgs.AddArg("-restworkqueue=<n>", strprintf("Set the depth of the work queue to service REST and /api/ requests (default: %d)", DEFAULT_HTTP_REST_WORKQUEUE), true, OptionsCategory::RPC);
     gArgs.AddArg("-restapi", strprintf("Accept public API requests (default: %u)", false), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcauth=<userpw>", "Username and hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcauth. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times", false, OptionsCategory::RPC);
@@ -500,6 +530,8 @@ void SetupServerArgs()
     gArgs.AddArg("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT), true, OptionsCategory::RPC);
     gArgs.AddArg("-rpcthreads=<n>", strprintf("Set the number of threads to service RPC calls (default: %d)", DEFAULT_HTTP_THREADS), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcuser=<user>", "Username for JSON-RPC connections", false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcwalletthreads=<n>", strprintf("Set the number of threads to service RPC calls to /wallet/<name> endpoints (default: %d)", DEFAULT_HTTP_WALLET_THREADS), false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcwalletworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls to /wallet/<name> endpoints (default: %d)", DEFAULT_HTTP_WORKQUEUE), true, OptionsCategory::RPC);
     gArgs.AddArg("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE), true, OptionsCategory::RPC);
     gArgs.AddArg("-server", "Accept command line and JSON-RPC commands", false, OptionsCategory::RPC);
 
@@ -727,6 +759,8 @@ static bool AppInitServers()
         return false;
     if ((gArgs.GetBoolArg("-rest", DEFAULT_REST_ENABLE) || gArgs.GetBoolArg("-restapi", false)) && !StartREST())
         return false;
+    if (gArgs.GetBoolArg("-metrics", DEFAULT_HTTP_METRICS) && !StartHTTPMetrics())
+        return false;
     StartHTTPServer();
     return true;
 }
@@ -941,13 +975,16 @@ bool AppInitParameterInteraction()
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
+    // Block and undo files kept open for reading and writing
+    const int nBlockFileDescriptors = MAX_OPEN_BLOCK_FILES + BLOCK_FILE_WRITER_DESCRIPTORS;
+
     // Trim requested connection counts, to fit into system limitations
     // <int> in std::min<int>(...) to work around FreeBSD compilation issue described in #2695
-    nMaxConnections = std::max(std::min<int>(nMaxConnections, FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS), 0);
-    nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
+    nMaxConnections = std::max(std::min<int>(nMaxConnections, FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS - nBlockFileDescriptors), 0);
+    nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS + nBlockFileDescriptors);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
-    nMaxConnections = std::min(nFD - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS, nMaxConnections);
+    nMaxConnections = std::min(nFD - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS - nBlockFileDescriptors, nMaxConnections);
 
     if (nMaxConnections < nUserMaxConnections)
         InitWarning(strprintf(_("Reducing -maxconnections from %d to %d, because of system limitations."), nUserMaxConnections, nMaxConnections));
@@ -977,6 +1014,12 @@ bool AppInitParameterInteraction()
         }
     }
 
+    for (const std::string& limit : gArgs.GetArgs("-logratelimit")) {
+        if (!SetLogRateLimit(limit)) {
+            return InitError(strprintf(_("Invalid -logratelimit value: '%s'"), limit));
+        }
+    }
+
     // Check for -debugnet
     if (gArgs.GetBoolArg("-debugnet", false))
         InitWarning(_("Unsupported argument -debugnet ignored, use -debug=net."));
@@ -1003,6 +1046,7 @@ bool AppInitParameterInteraction()
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fMapBlockFiles = gArgs.GetBoolArg("-blockfilemmap", DEFAULT_BLOCKFILE_MMAP);
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1066,6 +1110,15 @@ bool AppInitParameterInteraction()
         fPruneMode = true;
     }
 
+    // undo data retention when not pruning; 0 keeps all of it
+    nUndoRetain = gArgs.GetArg("-undoretain", DEFAULT_UNDO_RETAIN);
+    if (nUndoRetain < 0) {
+        return InitError(_("Undo retention cannot be configured with a negative value."));
+    }
+    if (nUndoRetain > 0 && nUndoRetain < (int64_t)MIN_BLOCKS_TO_KEEP) {
+        return InitError(strprintf(_("Undo retention configured below the minimum of %d blocks."), MIN_BLOCKS_TO_KEEP));
+    }
+
     nConnectTimeout = gArgs.GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0)
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1205,6 +1258,9 @@ bool AppInitMain()
                                        g_logger->m_file_path.string()));
         }
     }
+    if (gArgs.GetBoolArg("-logasync", DEFAULT_LOGASYNC)) {
+        g_logger->StartAsync();
+    }
 
     if (!g_logger->m_log_timestamps)
         LogPrintf("Startup time: %s\n", FormatISO8601DateTime(GetTime()));
@@ -1231,9 +1287,14 @@ bool AppInitMain()
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads. Validation callbacks
+    // for different subscribers run on them concurrently.
+    int nSchedulerThreads = std::max((int)gArgs.GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), 1);
+    LogPrintf("Using %d scheduler threads\n", nSchedulerThreads);
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
-    threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    for (int i = 0; i < nSchedulerThreads; i++) {
+        threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    }
 
     GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
     GetMainSignals().RegisterWithMempoolSignals(mempool);
@@ -1273,7 +1334,7 @@ bool AppInitMain()
     CConnman& connman = *g_connman;
 
     peerLogic.reset(new PeerLogicValidation(&connman, scheduler, gArgs.GetBoolArg("-enablebip61", DEFAULT_ENABLE_BIP61)));
-    RegisterValidationInterface(peerLogic.get());
+    RegisterValidationInterface(peerLogic.get(), "net");
 
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
@@ -1365,7 +1426,8 @@ bool AppInitMain()
     g_zmq_notification_interface = CZMQNotificationInterface::Create();
 
     if (g_zmq_notification_interface) {
-        RegisterValidationInterface(g_zmq_notification_interface);
+        // Notifications are queued for the ZMQ publisher thread, which drops them when it falls behind
+        RegisterValidationInterface(g_zmq_notification_interface, "zmq", ValidationQueuePolicy::NO_WAIT);
     }
 #endif
     uint64_t nMaxOutboundLimit = 0; //unlimited unless -maxuploadtarget is set
@@ -1395,6 +1457,8 @@ bool AppInitMain()
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    const int nPrefetchThreads = std::max(0, std::min<int>(MAX_PREFETCH_THREADS, gArgs.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS)));
+    LogPrintf("* Using %d threads to prefetch block inputs\n", nPrefetchThreads);
 
     bool fLoaded = false;
     while (!fLoaded && !ShutdownRequested()) {
@@ -1410,6 +1474,7 @@ bool AppInitMain()
             try {
                 UnloadBlockIndex();
                 pcoinsTip.reset();
+                pcoinsprefetch.reset();
                 pcoinsdbview.reset();
                 pcoinscatcher.reset();
                 // new CBlockTreeDB tries to delete the existing file, which
@@ -1439,6 +1504,12 @@ bool AppInitMain()
                 if (fTxIndex) pblocktxindex.reset(new CTxIndexDB(fReset));
                 if (fAddressIndex) pblockaddressindex.reset();
                 if (fAddressIndex) pblockaddressindex.reset(new CAddressIndexDB(fReset));
+                if (fAddressIndex && !pblockaddressindex->Upgrade()) {
+                    strLoadError = _("Error upgrading address index database");
+                    break;
+                }
+                if (fBlockStatsIndex) pblockstatsindex.reset();
+                if (fBlockStatsIndex) pblockstatsindex.reset(new CBlockStatsIndexDB(fReset));
 
                 // If the loaded chain has a wrong genesis, bail out immediately
                 // (we're likely using a testnet datadir, or the other way around).
@@ -1486,6 +1557,26 @@ bool AppInitMain()
                     } else { fLoaded = true; break; }
                 }
 
+                // Check for changed -blockstatsindex state
+                if (fBlockStatsIndex != gArgs.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -blockstatsindex");
+                    if (!fReset) {
+                        bool fRet = uiInterface.ThreadSafeQuestion(
+                            strLoadError + ".\n\n" + _("Do you want to rebuild the block database now?"),
+                            strLoadError + ".\nPlease restart with -reindex or -reindex-chainstate to recover.",
+                            "", CClientUIInterface::MSG_ERROR | CClientUIInterface::BTN_ABORT);
+                        if (fRet) {
+                            fReindex = true;
+                            fReset = true;
+                            AbortShutdown();
+                            continue;
+                        } else {
+                            LogPrintf("Aborted block database rebuild. Exiting.\n");
+                            return InitError(strLoadError);
+                        }
+                    } else { fLoaded = true; break; }
+                }
+
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1522,7 +1613,9 @@ bool AppInitMain()
                 }
 
                 // The on-disk coinsdb is now in a good state, create the cache
-                pcoinsTip.reset(new CCoinsViewCache(pcoinscatcher.get()));
+                pcoinsprefetch.reset(new CCoinsViewPrefetch(pcoinscatcher.get(), nPrefetchThreads));
+                pcoinsTip.reset(new CCoinsViewCache(pcoinsprefetch.get()));
+                pcoinsdbview->SetAsyncWrites(gArgs.GetBoolArg("-asyncflush", DEFAULT_ASYNC_FLUSH));
 
                 bool is_coinsview_empty = fReset || fReindexChainState || pcoinsTip->GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
@@ -1532,6 +1625,12 @@ bool AppInitMain()
                         break;
                     }
                     assert(chainActive.Tip() != nullptr);
+
+                    // Indexes written up to a different block before a crash are caught up with the tip
+                    if (!ReplayIndexes(chainparams)) {
+                        strLoadError = _("Unable to replay blocks into the indexes. You will need to rebuild the database using -reindex.");
+                        break;
+                    }
                 }
 
                 if (!is_coinsview_empty) {
@@ -355,6 +355,9 @@ void ECC_Start() {
     }
 
     secp256k1_context_sign = ctx;
+
+    // Salt the slot hash of the parsed public key cache
+    InitPubKeyParseCache(GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max()));
 }
 
 void ECC_Stop() {
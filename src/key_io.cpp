@@ -6,6 +6,7 @@
 
 #include <base58.h>
 #include <bech32.h>
+#include <metrics.h>
 #include <script/script.h>
 #include <utilstrencodings.h>
 
@@ -15,6 +16,9 @@
 #include <assert.h>
 #include <string.h>
 #include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 namespace
 {
@@ -72,6 +76,92 @@ public:
 
     std::string operator()(const CNoDestination& no) const { return {}; }
 };
+static CMetricCounter g_metric_address_cache_hits("address_string_cache_lookups_total", "Lookups in the cache of encoded addresses", "result=\"hit\"");
+static CMetricCounter g_metric_address_cache_misses("address_string_cache_lookups_total", "Lookups in the cache of encoded addresses", "result=\"miss\"");
+
+/**
+ * LRU cache of recently encoded base58 addresses. Explorers render the
+ * outputs of busy addresses over and over, and each encoding costs a double
+ * SHA256 and a base58 conversion. Entries are keyed by the destination type
+ * and hash, and dropped when the address prefixes of the chain parameters
+ * change.
+ */
+class CAddressStringCache
+{
+private:
+    static const size_t MAX_ENTRIES = 4096;
+    typedef std::pair<std::string, std::string> Item;
+
+    std::mutex m_mutex;
+    //! The prefixes the entries were encoded with
+    std::vector<unsigned char> m_pubkey_prefix;
+    std::vector<unsigned char> m_script_prefix;
+    std::string m_bech32_hrp;
+    std::list<Item> m_lru; //!< Most recently used first
+    std::unordered_map<std::string, std::list<Item>::iterator> m_map;
+
+public:
+    //! The cache key of a key or script hash
+    static std::string Key(char type, const uint160& hash)
+    {
+        std::string key(1, type);
+        key.append(hash.begin(), hash.end());
+        return key;
+    }
+
+    bool SamePrefixes(const CChainParams& params) const
+    {
+        return m_pubkey_prefix == params.Base58Prefix(CChainParams::PUBKEY_ADDRESS) &&
+               m_script_prefix == params.Base58Prefix(CChainParams::SCRIPT_ADDRESS) &&
+               m_bech32_hrp == params.Bech32HRP();
+    }
+
+    bool Lookup(const std::string& key, const CChainParams& params, std::string& str)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!SamePrefixes(params)) {
+            m_lru.clear();
+            m_map.clear();
+            m_pubkey_prefix = params.Base58Prefix(CChainParams::PUBKEY_ADDRESS);
+            m_script_prefix = params.Base58Prefix(CChainParams::SCRIPT_ADDRESS);
+            m_bech32_hrp = params.Bech32HRP();
+        }
+        auto it = m_map.find(key);
+        if (it == m_map.end()) {
+            g_metric_address_cache_misses.Inc();
+            return false;
+        }
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        g_metric_address_cache_hits.Inc();
+        str = it->second->second;
+        return true;
+    }
+
+    void Insert(std::string key, const CChainParams& params, const std::string& str)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!SamePrefixes(params) || m_map.count(key)) return;
+        m_lru.emplace_front(key, str);
+        m_map.emplace(std::move(key), m_lru.begin());
+        if (m_lru.size() > MAX_ENTRIES) {
+            m_map.erase(m_lru.back().first);
+            m_lru.pop_back();
+        }
+    }
+
+    template <typename Hash>
+    std::string Encode(char type, const Hash& hash, const CChainParams& params)
+    {
+        std::string key = Key(type, hash);
+        std::string str;
+        if (Lookup(key, params, str)) return str;
+        str = DestinationEncoder(params)(hash);
+        Insert(std::move(key), params, str);
+        return str;
+    }
+};
+
+CAddressStringCache g_address_strings;
 
 CTxDestination DecodeDestination(const std::string& str, const CChainParams& params)
 {
@@ -211,7 +301,42 @@ std::string EncodeExtKey(const CExtKey& key)
 
 std::string EncodeDestination(const CTxDestination& dest)
 {
-    return boost::apply_visitor(DestinationEncoder(Params()), dest);
+    const CChainParams& params = Params();
+    if (const CKeyID* id = boost::get<CKeyID>(&dest)) return g_address_strings.Encode('k', *id, params);
+    if (const CScriptID* id = boost::get<CScriptID>(&dest)) return g_address_strings.Encode('s', *id, params);
+    return boost::apply_visitor(DestinationEncoder(params), dest);
+}
+
+std::vector<std::string> EncodeDestinations(const std::vector<CTxDestination>& dests)
+{
+    const CChainParams& params = Params();
+    std::vector<std::string> ret(dests.size());
+    // Base58 addresses missing from the cache are encoded together
+    std::vector<size_t> missing;
+    std::vector<std::string> keys;
+    std::vector<std::vector<unsigned char>> payloads;
+    for (size_t i = 0; i < dests.size(); i++) {
+        const CKeyID* keyid = boost::get<CKeyID>(&dests[i]);
+        const CScriptID* scriptid = boost::get<CScriptID>(&dests[i]);
+        if (!keyid && !scriptid) {
+            ret[i] = boost::apply_visitor(DestinationEncoder(params), dests[i]);
+            continue;
+        }
+        const uint160& hash = keyid ? static_cast<const uint160&>(*keyid) : static_cast<const uint160&>(*scriptid);
+        std::string key = CAddressStringCache::Key(keyid ? 'k' : 's', hash);
+        if (g_address_strings.Lookup(key, params, ret[i])) continue;
+        std::vector<unsigned char> data = params.Base58Prefix(keyid ? CChainParams::PUBKEY_ADDRESS : CChainParams::SCRIPT_ADDRESS);
+        data.insert(data.end(), hash.begin(), hash.end());
+        missing.push_back(i);
+        keys.push_back(std::move(key));
+        payloads.push_back(std::move(data));
+    }
+    std::vector<std::string> encoded = EncodeBase58CheckMulti(payloads);
+    for (size_t j = 0; j < missing.size(); j++) {
+        g_address_strings.Insert(std::move(keys[j]), params, encoded[j]);
+        ret[missing[j]] = std::move(encoded[j]);
+    }
+    return ret;
 }
 
 CTxDestination DecodeDestination(const std::string& str)
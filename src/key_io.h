@@ -12,6 +12,7 @@
 #include <script/standard.h>
 
 #include <string>
+#include <vector>
 
 CKey DecodeSecret(const std::string& str);
 std::string EncodeSecret(const CKey& key);
@@ -22,6 +23,8 @@ CExtPubKey DecodeExtPubKey(const std::string& str);
 std::string EncodeExtPubKey(const CExtPubKey& extpubkey);
 
 std::string EncodeDestination(const CTxDestination& dest);
+//! EncodeDestination of several destinations, with the base58 checksums hashed together
+std::vector<std::string> EncodeDestinations(const std::vector<CTxDestination>& dests);
 CTxDestination DecodeDestination(const std::string& str);
 bool IsValidDestinationString(const std::string& str);
 bool IsValidDestinationString(const std::string& str, const CChainParams& params);
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <logging.h>
+#include <utilstrencodings.h>
 #include <utiltime.h>
 
 const char * const DEFAULT_DEBUGLOGFILE = "debug.log";
@@ -30,6 +31,96 @@ static int FileWriteStr(const std::string &str, FILE *fp)
     return fwrite(str.data(), 1, str.size(), fp);
 }
 
+/**
+ * Bounded multi-producer single-consumer queue. Producers claim a slot with
+ * a compare-and-swap on the enqueue position and publish it through the
+ * slot's sequence number, so logging threads never wait on each other or on
+ * the writer.
+ */
+class BCLog::LogRingBuffer
+{
+private:
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        LogEntry entry;
+    };
+
+    const size_t m_mask;
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<size_t> m_enqueue_pos{0};
+    //! Only advanced by the single consumer, read by GetQueued()
+    std::atomic<size_t> m_dequeue_pos{0};
+
+public:
+    explicit LogRingBuffer(size_t size) : m_mask(size - 1), m_slots(new Slot[size])
+    {
+        assert(size >= 2 && (size & m_mask) == 0);
+        for (size_t i = 0; i < size; i++) {
+            m_slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool TryPush(LogEntry& entry)
+    {
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &m_slots[pos & m_mask];
+            const size_t seq = slot->seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                // The writer has not consumed this slot yet
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->entry = std::move(entry);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(LogEntry& entry)
+    {
+        const size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        Slot& slot = m_slots[pos & m_mask];
+        if (slot.seq.load(std::memory_order_acquire) != pos + 1) return false;
+        entry = std::move(slot.entry);
+        slot.entry.msg.clear();
+        slot.seq.store(pos + m_mask + 1, std::memory_order_release);
+        m_dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        const size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        return m_slots[pos & m_mask].seq.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    size_t Size() const
+    {
+        const size_t dequeued = m_dequeue_pos.load(std::memory_order_relaxed);
+        const size_t enqueued = m_enqueue_pos.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+};
+
+BCLog::Logger::Logger() : m_buffer(new LogRingBuffer(LOG_BUFFER_ENTRIES))
+{
+}
+
+BCLog::Logger::~Logger()
+{
+    StopAsync();
+    if (m_fileout) {
+        fclose(m_fileout);
+    }
+}
+
 bool BCLog::Logger::OpenDebugLog()
 {
     std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
@@ -78,11 +169,6 @@ bool BCLog::Logger::DisableCategory(const std::string& str)
     return true;
 }
 
-bool BCLog::Logger::WillLogCategory(BCLog::LogFlags category) const
-{
-    return (m_categories.load(std::memory_order_relaxed) & category) != 0;
-}
-
 bool BCLog::Logger::DefaultShrinkDebugFile() const
 {
     return m_categories == BCLog::NONE;
@@ -163,57 +249,115 @@ std::vector<CLogCategoryActive> ListActiveLogCategories()
             CLogCategoryActive catActive;
             catActive.category = category_desc.category;
             catActive.active = LogAcceptCategory(category_desc.flag);
+            catActive.rate_limit = g_logger->GetRateLimit(category_desc.flag);
+            catActive.suppressed = g_logger->GetSuppressed(category_desc.flag);
             ret.push_back(catActive);
         }
     }
     return ret;
 }
 
-std::string BCLog::Logger::LogTimestampStr(const std::string &str)
+static std::string LogCategoryToStr(BCLog::LogFlags flag)
 {
-    std::string strStamped;
+    for (const CLogCategoryDesc& category_desc : LogCategories) {
+        if (category_desc.flag == flag) return category_desc.category;
+    }
+    return "";
+}
 
-    if (!m_log_timestamps)
-        return str;
+/** Index of the lowest bit of category into the rate limiter array, or -1 */
+static int CategoryIndex(BCLog::LogFlags category)
+{
+    for (int i = 0; i < BCLog::NUM_CATEGORIES; i++) {
+        if (category & (1U << i)) return i;
+    }
+    return -1;
+}
 
-    if (m_started_new_line) {
-        int64_t nTimeMicros = GetTimeMicros();
-        strStamped = FormatISO8601DateTime(nTimeMicros/1000000);
-        if (m_log_time_micros) {
-            strStamped.pop_back();
-            strStamped += strprintf(".%06dZ", nTimeMicros%1000000);
-        }
-        int64_t mocktime = GetMockTime();
-        if (mocktime) {
-            strStamped += " (mocktime: " + FormatISO8601DateTime(mocktime) + ")";
+bool SetLogRateLimit(const std::string& str)
+{
+    BCLog::LogFlags flag = BCLog::ALL;
+    std::string value = str;
+    const size_t pos = str.find(':');
+    if (pos != std::string::npos) {
+        if (!GetLogCategory(flag, str.substr(0, pos))) return false;
+        value = str.substr(pos + 1);
+    }
+    uint32_t limit;
+    if (!ParseUInt32(value, &limit)) return false;
+    g_logger->SetRateLimit(flag, limit);
+    return true;
+}
+
+void BCLog::Logger::SetRateLimit(BCLog::LogFlags category, unsigned int limit)
+{
+    for (int i = 0; i < NUM_CATEGORIES; i++) {
+        if (category & (1U << i)) m_rate_limiters[i].limit = limit;
+    }
+}
+
+unsigned int BCLog::Logger::GetRateLimit(BCLog::LogFlags category) const
+{
+    const int index = CategoryIndex(category);
+    return index < 0 ? 0 : m_rate_limiters[index].limit.load();
+}
+
+uint64_t BCLog::Logger::GetSuppressed(BCLog::LogFlags category) const
+{
+    const int index = CategoryIndex(category);
+    return index < 0 ? 0 : m_rate_limiters[index].suppressed.load();
+}
+
+bool BCLog::Logger::RateLimitCategory(BCLog::LogFlags category)
+{
+    const int index = CategoryIndex(category);
+    if (index < 0) return true;
+    LogRateLimiter& limiter = m_rate_limiters[index];
+    const unsigned int limit = limiter.limit.load(std::memory_order_relaxed);
+    if (limit == 0) return true;
+
+    const int64_t now = GetTimeMicros() / 1000000;
+    int64_t window = limiter.window.load(std::memory_order_relaxed);
+    if (window != now && limiter.window.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+        limiter.count.store(0, std::memory_order_relaxed);
+        const unsigned int suppressed = limiter.window_suppressed.exchange(0);
+        if (suppressed > 0) {
+            // Logged unconditionally so the notice itself is never dropped
+            LogPrintStr(strprintf("Suppressed %u %s messages over the -logratelimit of %u per second\n", suppressed, LogCategoryToStr(category), limit), BCLog::NONE);
         }
-        strStamped += ' ' + str;
-    } else
-        strStamped = str;
+    }
+    if (limiter.count.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+    limiter.window_suppressed++;
+    limiter.suppressed++;
+    return false;
+}
 
-    if (!str.empty() && str[str.size()-1] == '\n')
-        m_started_new_line = true;
-    else
-        m_started_new_line = false;
+std::string BCLog::Logger::LogTimestampStr(const LogEntry& entry) const
+{
+    if (!entry.stamp) return entry.msg;
 
+    std::string strStamped = FormatISO8601DateTime(entry.time_micros/1000000);
+    if (m_log_time_micros) {
+        strStamped.pop_back();
+        strStamped += strprintf(".%06dZ", entry.time_micros%1000000);
+    }
+    if (entry.mocktime) {
+        strStamped += " (mocktime: " + FormatISO8601DateTime(entry.mocktime) + ")";
+    }
+    strStamped += ' ' + entry.msg;
     return strStamped;
 }
 
-void BCLog::Logger::LogPrintStr(const std::string &str)
+void BCLog::Logger::WriteStr(const std::string& str)
 {
-    std::string strTimestamped = LogTimestampStr(str);
-
     if (m_print_to_console) {
         // print to console
-        fwrite(strTimestamped.data(), 1, strTimestamped.size(), stdout);
-        fflush(stdout);
+        fwrite(str.data(), 1, str.size(), stdout);
     }
     if (m_print_to_file) {
-        std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
-
         // buffer if we haven't opened the log yet
         if (m_fileout == nullptr) {
-            m_msgs_before_open.push_back(strTimestamped);
+            m_msgs_before_open.push_back(str);
         }
         else
         {
@@ -227,9 +371,133 @@ void BCLog::Logger::LogPrintStr(const std::string &str)
                 setbuf(m_fileout, nullptr); // unbuffered
             }
 
-            FileWriteStr(strTimestamped, m_fileout);
+            FileWriteStr(str, m_fileout);
+        }
+    }
+}
+
+void BCLog::Logger::LogPrintStr(std::string str, BCLog::LogFlags category)
+{
+    // The timestamp is taken now but only formatted by whoever writes the message
+    LogEntry entry;
+    if (m_log_timestamps) {
+        entry.stamp = m_started_new_line;
+        m_started_new_line = !str.empty() && str.back() == '\n';
+        if (entry.stamp) {
+            entry.time_micros = GetTimeMicros();
+            entry.mocktime = GetMockTime();
         }
     }
+    entry.msg = std::move(str);
+
+    m_async_pushing++;
+    while (m_async_running) {
+        if (m_buffer->TryPush(entry)) {
+            m_async_pushing--;
+            WakeWriter();
+            return;
+        }
+        if (category != BCLog::NONE) {
+            m_async_pushing--;
+            m_dropped++;
+            return;
+        }
+        // Unconditional messages are never dropped, wait for the writer to make room
+        WakeWriter();
+        std::this_thread::yield();
+    }
+    m_async_pushing--;
+
+    const std::string strTimestamped = LogTimestampStr(entry);
+    std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
+    WriteStr(strTimestamped);
+    if (m_print_to_console) {
+        fflush(stdout);
+    }
+}
+
+void BCLog::Logger::WakeWriter()
+{
+    // Pairs with the fence in WriterThread: either the writer sees the new
+    // message before it sleeps, or we see that it is about to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_writer_waiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        m_writer_cv.notify_one();
+    }
+}
+
+void BCLog::Logger::WriterThread()
+{
+    // Largest batch handed to a single write
+    constexpr size_t MAX_BATCH_SIZE = 1 << 16;
+
+    LogEntry entry;
+    std::string batch;
+    while (true) {
+        batch.clear();
+        while (batch.size() < MAX_BATCH_SIZE && m_buffer->TryPop(entry)) {
+            batch += LogTimestampStr(entry);
+        }
+        if (!batch.empty()) {
+            std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
+            WriteStr(batch);
+            if (m_print_to_console) {
+                fflush(stdout);
+            }
+            continue;
+        }
+        if (m_async_stop) break;
+
+        std::unique_lock<std::mutex> lock(m_writer_mutex);
+        m_writer_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_buffer->Empty() && !m_async_stop) {
+            m_writer_cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        m_writer_waiting.store(false, std::memory_order_relaxed);
+    }
+}
+
+void BCLog::Logger::StartAsync()
+{
+    if (m_writer.joinable()) return;
+    m_async_stop = false;
+    m_writer = std::thread(&BCLog::Logger::WriterThread, this);
+    m_async_running = true;
+}
+
+void BCLog::Logger::StopAsync()
+{
+    if (!m_writer.joinable()) return;
+    // Send new messages to the synchronous path, then wait for those already
+    // being pushed, which the writer is still running to make room for
+    m_async_running = false;
+    while (m_async_pushing > 0) {
+        WakeWriter();
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        m_async_stop = true;
+        m_writer_cv.notify_one();
+    }
+    m_writer.join();
+
+    // Write out what the writer left behind
+    LogEntry entry;
+    std::lock_guard<std::mutex> scoped_lock(m_file_mutex);
+    while (m_buffer->TryPop(entry)) {
+        WriteStr(LogTimestampStr(entry));
+    }
+    if (m_print_to_console) {
+        fflush(stdout);
+    }
+}
+
+size_t BCLog::Logger::GetQueued() const
+{
+    return m_buffer->Size();
 }
 
 void BCLog::Logger::ShrinkDebugFile()
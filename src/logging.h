@@ -10,15 +10,23 @@
 #include <tinyformat.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
+static const bool DEFAULT_LOGASYNC      = true;
+//! Debug messages per second allowed for each category, 0 = unlimited
+static const unsigned int DEFAULT_LOGRATELIMIT = 0;
+//! Messages the asynchronous log buffer holds, must be a power of two
+static const size_t LOG_BUFFER_ENTRIES = 8192;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -27,6 +35,8 @@ struct CLogCategoryActive
 {
     std::string category;
     bool active;
+    unsigned int rate_limit;
+    uint64_t suppressed;
 };
 
 namespace BCLog {
@@ -57,6 +67,31 @@ namespace BCLog {
         ALL         = ~(uint32_t)0,
     };
 
+    //! Number of distinct LogFlags bits
+    static const int NUM_CATEGORIES = 32;
+
+    /** A message waiting in the asynchronous log buffer */
+    struct LogEntry
+    {
+        std::string msg;
+        int64_t time_micros = 0;
+        int64_t mocktime = 0;
+        bool stamp = false;
+    };
+
+    class LogRingBuffer;
+
+    /** Fixed one-second window rate limiter of one category */
+    struct LogRateLimiter
+    {
+        std::atomic<unsigned int> limit{DEFAULT_LOGRATELIMIT};
+        std::atomic<int64_t> window{0};
+        std::atomic<unsigned int> count{0};
+        //! Messages suppressed in the current window, reported when it ends
+        std::atomic<unsigned int> window_suppressed{0};
+        std::atomic<uint64_t> suppressed{0};
+    };
+
     class Logger
     {
     private:
@@ -64,6 +99,26 @@ namespace BCLog {
         std::mutex m_file_mutex;
         std::list<std::string> m_msgs_before_open;
 
+        /**
+         * Messages are handed to a background writer through a lock-free
+         * multi-producer ring while m_async_running is set. Otherwise, and
+         * before the writer is started, they are written on the calling
+         * thread. m_async_pushing counts producers between checking
+         * m_async_running and handing over their message, so StopAsync can
+         * wait for them before the final drain.
+         */
+        std::unique_ptr<LogRingBuffer> m_buffer;
+        std::thread m_writer;
+        std::atomic<bool> m_async_running{false};
+        std::atomic<bool> m_async_stop{false};
+        std::atomic<int> m_async_pushing{0};
+        std::mutex m_writer_mutex;
+        std::condition_variable m_writer_cv;
+        std::atomic<bool> m_writer_waiting{false};
+        std::atomic<uint64_t> m_dropped{0};
+
+        LogRateLimiter m_rate_limiters[NUM_CATEGORIES];
+
         /**
          * m_started_new_line is a state variable that will suppress printing of
          * the timestamp when multiple calls are made that don't end in a
@@ -74,9 +129,16 @@ namespace BCLog {
         /** Log categories bitfield. */
         std::atomic<uint32_t> m_categories{0};
 
-        std::string LogTimestampStr(const std::string& str);
+        std::string LogTimestampStr(const LogEntry& entry) const;
+        /** Write a string to the console and the debug log, caller holds m_file_mutex */
+        void WriteStr(const std::string& str);
+        void WakeWriter();
+        void WriterThread();
 
     public:
+        Logger();
+        ~Logger();
+
         bool m_print_to_console = false;
         bool m_print_to_file = false;
 
@@ -86,8 +148,11 @@ namespace BCLog {
         fs::path m_file_path;
         std::atomic<bool> m_reopen_file{false};
 
-        /** Send a string to the log output */
-        void LogPrintStr(const std::string &str);
+        /**
+         * Send a string to the log output. Messages of a debug category are
+         * dropped if the asynchronous buffer is full, others wait for room.
+         */
+        void LogPrintStr(std::string str, LogFlags category = NONE);
 
         /** Returns whether logs will be written to any output */
         bool Enabled() const { return m_print_to_console || m_print_to_file; }
@@ -102,7 +167,27 @@ namespace BCLog {
         void DisableCategory(LogFlags flag);
         bool DisableCategory(const std::string& str);
 
-        bool WillLogCategory(LogFlags category) const;
+        bool WillLogCategory(LogFlags category) const
+        {
+            return (m_categories.load(std::memory_order_relaxed) & category) != 0;
+        }
+
+        /** Count a message of category against its rate limit, returns false if it should be suppressed */
+        bool RateLimitCategory(LogFlags category);
+        void SetRateLimit(LogFlags category, unsigned int limit);
+        unsigned int GetRateLimit(LogFlags category) const;
+        /** Messages of category suppressed by its rate limit */
+        uint64_t GetSuppressed(LogFlags category) const;
+
+        /** Start writing messages from a background thread */
+        void StartAsync();
+        /** Write out all buffered messages and stop the background thread */
+        void StopAsync();
+        bool IsAsync() const { return m_async_running; }
+        /** Messages dropped because the asynchronous buffer was full */
+        uint64_t GetDropped() const { return m_dropped; }
+        /** Messages waiting in the asynchronous buffer */
+        size_t GetQueued() const;
 
         bool DefaultShrinkDebugFile() const;
     };
@@ -126,6 +211,9 @@ std::vector<CLogCategoryActive> ListActiveLogCategories();
 /** Return true if str parses as a log category and set the flag */
 bool GetLogCategory(BCLog::LogFlags& flag, const std::string& str);
 
+/** Parse a -logratelimit value, either <n> for all categories or <category>:<n> */
+bool SetLogRateLimit(const std::string& str);
+
 /** Get format string from VA_ARGS for error reporting */
 template<typename... Args> std::string FormatStringFromLogArgs(const char *fmt, const Args&... args) { return fmt; }
 
@@ -140,26 +228,33 @@ template<typename T, typename... Args> static inline void MarkUsed(const T& t, c
 // unconditionally log to debug.log! It should not be the case that an inbound
 // peer can fill up a user's disk with debug.log entries.
 
+// Arguments are only formatted once a message is known to be written, so a
+// disabled or rate limited category costs no more than a branch.
+
 #ifdef USE_COVERAGE
 #define LogPrintf(...) do { MarkUsed(__VA_ARGS__); } while(0)
 #define LogPrint(category, ...) do { MarkUsed(__VA_ARGS__); } while(0)
 #else
+#define LogPrintCategory(category, ...) do { \
+    std::string _log_msg_; /* Unlikely name to avoid shadowing variables */ \
+    try { \
+        _log_msg_ = tfm::format(__VA_ARGS__); \
+    } catch (tinyformat::format_error &fmterr) { \
+        /* Original format string will have newline so don't add one here */ \
+        _log_msg_ = "Error \"" + std::string(fmterr.what()) + "\" while formatting log message: " + FormatStringFromLogArgs(__VA_ARGS__); \
+    } \
+    g_logger->LogPrintStr(std::move(_log_msg_), (category)); \
+} while(0)
+
 #define LogPrintf(...) do { \
     if (g_logger->Enabled()) { \
-        std::string _log_msg_; /* Unlikely name to avoid shadowing variables */ \
-        try { \
-            _log_msg_ = tfm::format(__VA_ARGS__); \
-        } catch (tinyformat::format_error &fmterr) { \
-            /* Original format string will have newline so don't add one here */ \
-            _log_msg_ = "Error \"" + std::string(fmterr.what()) + "\" while formatting log message: " + FormatStringFromLogArgs(__VA_ARGS__); \
-        } \
-        g_logger->LogPrintStr(_log_msg_); \
+        LogPrintCategory(BCLog::NONE, __VA_ARGS__); \
     } \
 } while(0)
 
 #define LogPrint(category, ...) do { \
-    if (LogAcceptCategory((category))) { \
-        LogPrintf(__VA_ARGS__); \
+    if (LogAcceptCategory((category)) && g_logger->Enabled() && g_logger->RateLimitCategory((category))) { \
+        LogPrintCategory((category), __VA_ARGS__); \
     } \
 } while(0)
 #endif
@@ -0,0 +1,163 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <metrics.h>
+
+#include <tinyformat.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+namespace {
+
+struct MetricsRegistry
+{
+    std::mutex m_mutex;
+    //! Registered metrics, in registration order
+    std::vector<const CMetric*> m_metrics;
+    std::map<std::string, MetricsCollector> m_collectors;
+};
+
+/** Constructed on first use so that metrics with static storage duration can register */
+MetricsRegistry& GetRegistry()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+std::string SampleName(const std::string& name, const std::string& labels)
+{
+    if (labels.empty()) return name;
+    return name + "{" + labels + "}";
+}
+
+void AppendHeader(std::string& out, const std::string& name, const char* type, const std::string& help)
+{
+    out += "# HELP " + name + " " + help + "\n";
+    out += "# TYPE " + name + " " + type + "\n";
+}
+
+} // namespace
+
+CMetric::CMetric(const std::string& name, const std::string& help, const std::string& labels) :
+    m_name(METRICS_PREFIX + name), m_help(help), m_labels(labels)
+{
+    MetricsRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+    registry.m_metrics.push_back(this);
+}
+
+CMetric::~CMetric()
+{
+    MetricsRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+    registry.m_metrics.erase(std::remove(registry.m_metrics.begin(), registry.m_metrics.end(), this), registry.m_metrics.end());
+}
+
+void CMetricCounter::Render(std::string& out) const
+{
+    out += SampleName(m_name, m_labels) + " " + std::to_string(Get()) + "\n";
+}
+
+void CMetricGauge::Render(std::string& out) const
+{
+    out += SampleName(m_name, m_labels) + " " + std::to_string(Get()) + "\n";
+}
+
+CMetricHistogram::CMetricHistogram(const std::string& name, const std::string& help, const std::string& labels) :
+    CMetric(name, help, labels)
+{
+    for (std::atomic<uint64_t>& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void CMetricHistogram::Observe(int64_t micros)
+{
+    if (micros < 0) micros = 0;
+    int bucket = 0;
+    int64_t bound = FIRST_BUCKET_MICROS;
+    while (bucket < NUM_BUCKETS && micros > bound) {
+        bucket++;
+        bound <<= 1;
+    }
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_sum_micros.fetch_add(micros, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CMetricHistogram::Render(std::string& out) const
+{
+    const std::string prefix = m_labels.empty() ? "" : m_labels + ",";
+    uint64_t cumulative = 0;
+    int64_t bound = FIRST_BUCKET_MICROS;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        cumulative += m_buckets[i].load(std::memory_order_relaxed);
+        // Bounds are 10us * 2^i, exact with five decimals
+        out += strprintf("%s_bucket{%sle=\"%.5f\"} %u\n", m_name, prefix, bound / 1e6, cumulative);
+        bound <<= 1;
+    }
+    cumulative += m_buckets[NUM_BUCKETS].load(std::memory_order_relaxed);
+    // Buckets and the count are read separately; never let +Inf fall below a bucket
+    out += strprintf("%s_bucket{%sle=\"+Inf\"} %u\n", m_name, prefix, std::max(cumulative, Count()));
+    out += strprintf("%s %.6f\n", SampleName(m_name + "_sum", m_labels), SumMicros() / 1e6);
+    out += strprintf("%s %u\n", SampleName(m_name + "_count", m_labels), std::max(cumulative, Count()));
+}
+
+void RegisterMetricsCollector(const std::string& name, MetricsCollector collector)
+{
+    MetricsRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+    registry.m_collectors[name] = std::move(collector);
+}
+
+void UnregisterMetricsCollector(const std::string& name)
+{
+    MetricsRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+    registry.m_collectors.erase(name);
+}
+
+void AppendMetric(std::string& out, const std::string& name, const char* type, const std::string& help, const std::vector<std::pair<std::string, double>>& samples)
+{
+    const std::string full_name = METRICS_PREFIX + name;
+    AppendHeader(out, full_name, type, help);
+    for (const auto& sample : samples) {
+        out += strprintf("%s %.17g\n", SampleName(full_name, sample.first), sample.second);
+    }
+}
+
+std::string RenderMetrics()
+{
+    MetricsRegistry& registry = GetRegistry();
+    std::string out;
+    std::vector<MetricsCollector> collectors;
+    {
+        std::lock_guard<std::mutex> lock(registry.m_mutex);
+        // Group label sets under one header, in order of first registration
+        std::vector<std::string> names;
+        std::map<std::string, std::vector<const CMetric*>> by_name;
+        for (const CMetric* metric : registry.m_metrics) {
+            std::vector<const CMetric*>& group = by_name[metric->m_name];
+            if (group.empty()) names.push_back(metric->m_name);
+            group.push_back(metric);
+        }
+        for (const std::string& name : names) {
+            const std::vector<const CMetric*>& group = by_name[name];
+            AppendHeader(out, name, group.front()->Type(), group.front()->m_help);
+            for (const CMetric* metric : group) {
+                metric->Render(out);
+            }
+        }
+        for (const auto& collector : registry.m_collectors) {
+            collectors.push_back(collector.second);
+        }
+    }
+    // Collectors may take other locks, so run them without holding ours
+    for (const MetricsCollector& collector : collectors) {
+        collector(out);
+    }
+    return out;
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_METRICS_H
+#define BITCOIN_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! Prefix of all exported metric names
+static const char METRICS_PREFIX[] = "doge_";
+
+/**
+ * Base of the metrics exported in the Prometheus text format by /metrics.
+ * Metrics register themselves on construction and are updated with relaxed
+ * atomics only, so recording one never takes a lock. Metrics sharing a name
+ * must have the same type and differ in their labels.
+ */
+class CMetric
+{
+public:
+    const std::string m_name;
+    const std::string m_help;
+    //! Prometheus label set without braces, e.g. stage="verify"
+    const std::string m_labels;
+
+    CMetric(const std::string& name, const std::string& help, const std::string& labels);
+    virtual ~CMetric();
+
+    CMetric(const CMetric&) = delete;
+    CMetric& operator=(const CMetric&) = delete;
+
+    virtual const char* Type() const = 0;
+    /** Append the sample lines of this metric */
+    virtual void Render(std::string& out) const = 0;
+};
+
+/** Monotonically increasing counter */
+class CMetricCounter final : public CMetric
+{
+private:
+    std::atomic<uint64_t> m_value{0};
+
+public:
+    CMetricCounter(const std::string& name, const std::string& help, const std::string& labels = "") : CMetric(name, help, labels) {}
+
+    void Inc(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const { return m_value.load(std::memory_order_relaxed); }
+
+    const char* Type() const override { return "counter"; }
+    void Render(std::string& out) const override;
+};
+
+/** Value that can go up and down */
+class CMetricGauge final : public CMetric
+{
+private:
+    std::atomic<int64_t> m_value{0};
+
+public:
+    CMetricGauge(const std::string& name, const std::string& help, const std::string& labels = "") : CMetric(name, help, labels) {}
+
+    void Set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+    int64_t Get() const { return m_value.load(std::memory_order_relaxed); }
+
+    const char* Type() const override { return "gauge"; }
+    void Render(std::string& out) const override;
+};
+
+/** Distribution of durations, in buckets doubling from 10us to about 21s */
+class CMetricHistogram final : public CMetric
+{
+public:
+    static const int NUM_BUCKETS = 22;
+    static const int64_t FIRST_BUCKET_MICROS = 10;
+
+private:
+    //! Non-cumulative counts, the last one collects everything above the largest bound
+    std::atomic<uint64_t> m_buckets[NUM_BUCKETS + 1];
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum_micros{0};
+
+public:
+    CMetricHistogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    void Observe(int64_t micros);
+    uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t SumMicros() const { return m_sum_micros.load(std::memory_order_relaxed); }
+
+    const char* Type() const override { return "histogram"; }
+    void Render(std::string& out) const override;
+};
+
+/** Produces metrics whose values are only computed when scraped */
+typedef std::function<void(std::string& out)> MetricsCollector;
+
+/** Register a collector, replacing any previous one of the same name */
+void RegisterMetricsCollector(const std::string& name, MetricsCollector collector);
+void UnregisterMetricsCollector(const std::string& name);
+
+/** Append one metric with a sample per label set, for use by collectors */
+void AppendMetric(std::string& out, const std::string& name, const char* type, const std::string& help, const std::vector<std::pair<std::string, double>>& samples);
+
+/** Render all registered metrics and collectors in the Prometheus text format */
+std::string RenderMetrics();
+
+#endif // BITCOIN_METRICS_H
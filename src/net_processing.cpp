@@ -13,6 +13,7 @@
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <hash.h>
+#include <metrics.h>
 #include <validation.h>
 #include <merkleblock.h>
 #include <netmessagemaker.h>
@@ -24,6 +25,7 @@
 #include <reverse_iterator.h>
 #include <scheduler.h>
 #include <tinyformat.h>
+#include <txdb.h>
 #include <txmempool.h>
 #include <ui_interface.h>
 #include <util.h>
@@ -1914,45 +1916,62 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        LOCK(cs_main);
-        if (IsInitialBlockDownload() && !pfrom->fWhitelisted) {
-            LogPrint(BCLog::NET, "Ignoring getheaders from peer=%d because node is in initial block download\n", pfrom->GetId());
-            return true;
-        }
-
-        CNodeState *nodestate = State(pfrom->GetId());
+        // The blocks to send headers for, and the last one sent if it is not the tip
+        std::vector<const CBlockIndex*> vIndexes;
         const CBlockIndex* pindex = nullptr;
-        if (locator.IsNull())
         {
-            // If locator is null, return the hashStop block
-            pindex = LookupBlockIndex(hashStop);
-            if (!pindex) {
+            LOCK(cs_main);
+            if (IsInitialBlockDownload() && !pfrom->fWhitelisted) {
+                LogPrint(BCLog::NET, "Ignoring getheaders from peer=%d because node is in initial block download\n", pfrom->GetId());
                 return true;
             }
 
-            if (!BlockRequestAllowed(pindex, chainparams.GetConsensus())) {
-                LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block header that isn't in the main chain\n", __func__, pfrom->GetId());
-                return true;
+            if (locator.IsNull())
+            {
+                // If locator is null, return the hashStop block
+                pindex = LookupBlockIndex(hashStop);
+                if (!pindex) {
+                    return true;
+                }
+
+                if (!BlockRequestAllowed(pindex, chainparams.GetConsensus())) {
+                    LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block header that isn't in the main chain\n", __func__, pfrom->GetId());
+                    return true;
+                }
+            }
+            else
+            {
+                // Find the last block the caller has in the main chain
+                pindex = chainActive.FindFork(locator);
+                if (pindex)
+                    pindex = chainActive.Next(pindex);
+            }
+
+            int nLimit = MAX_HEADERS_RESULTS;
+            LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), pfrom->GetId());
+            for (; pindex; pindex = chainActive.Next(pindex))
+            {
+                vIndexes.push_back(pindex);
+                if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
+                    break;
             }
-        }
-        else
-        {
-            // Find the last block the caller has in the main chain
-            pindex = chainActive.FindFork(locator);
-            if (pindex)
-                pindex = chainActive.Next(pindex);
         }
 
+        // The merkle roots of old headers are read from the block index
+        // database. Read them into its cache without holding cs_main, the
+        // headers are then built from memory.
+        std::vector<uint256> vHashes;
+        vHashes.reserve(vIndexes.size());
+        for (const CBlockIndex* pindexHeader : vIndexes)
+            vHashes.push_back(pindexHeader->GetBlockHash());
+        pblocktree->CacheMerkleRoots(vHashes);
+
+        LOCK(cs_main);
         // we must use CBlocks, as CBlockHeaders won't include the 0x00 nTx count at the end
         std::vector<CBlock> vHeaders;
-        int nLimit = MAX_HEADERS_RESULTS;
-        LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.IsNull() ? "end" : hashStop.ToString(), pfrom->GetId());
-        for (; pindex; pindex = chainActive.Next(pindex))
-        {
-            vHeaders.push_back(pindex->GetBlockHeader());
-            if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
-                break;
-        }
+        vHeaders.reserve(vIndexes.size());
+        for (const CBlockIndex* pindexHeader : vIndexes)
+            vHeaders.push_back(pindexHeader->GetBlockHeader());
         // pindex can be nullptr either if we sent chainActive.Tip() OR
         // if our peer has chainActive.Tip() (and thus we are sending an empty
         // headers message). In both cases it's safe to update
@@ -1965,6 +1984,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         // without the new block. By resetting the BestHeaderSent, we ensure we
         // will re-announce the new block via headers (or compact blocks again)
         // in the SendMessages logic.
+        CNodeState *nodestate = State(pfrom->GetId());
         nodestate->pindexBestHeaderSent = pindex ? pindex : chainActive.Tip();
         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
     }
@@ -2465,6 +2485,24 @@ static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman* connman, bool en
     return false;
 }
 
+/** Time spent in ProcessMessage, by command; unknown commands share "other" */
+static CMetricHistogram& MessageProcessingMetric(const std::string& command)
+{
+    static const char METRIC[] = "message_processing_duration_seconds";
+    static const char METRIC_HELP[] = "Time spent processing a P2P message, by command";
+    static const std::map<std::string, std::unique_ptr<CMetricHistogram>> histograms = [] {
+        std::map<std::string, std::unique_ptr<CMetricHistogram>> ret;
+        for (const std::string& type : getAllNetMessageTypes()) {
+            ret.emplace(type, MakeUnique<CMetricHistogram>(METRIC, METRIC_HELP, strprintf("command=\"%s\"", type)));
+        }
+        ret.emplace("other", MakeUnique<CMetricHistogram>(METRIC, METRIC_HELP, "command=\"other\""));
+        return ret;
+    }();
+    auto it = histograms.find(command);
+    if (it == histograms.end()) it = histograms.find("other");
+    return *it->second;
+}
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -2538,6 +2576,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
 
     // Process message
     bool fRet = false;
+    const int64_t nProcessStart = GetTimeMicros();
     try
     {
         fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
@@ -2576,6 +2615,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     } catch (...) {
         PrintExceptionContinue(nullptr, "ProcessMessages()");
     }
+    MessageProcessingMetric(strCommand).Observe(GetTimeMicros() - nProcessStart);
 
     if (!fRet) {
         LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
@@ -2881,46 +2921,53 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                 // Try to find first header that our peer doesn't have, and
                 // then send all headers past that one.  If we come across any
                 // headers that aren't on chainActive, give up.
-                for (const uint256 &hash : pto->vBlockHashesToAnnounce) {
-                    const CBlockIndex* pindex = LookupBlockIndex(hash);
-                    assert(pindex);
-                    if (chainActive[pindex->nHeight] != pindex) {
-                        // Bail out if we reorged away from this block
-                        fRevertToInv = true;
-                        break;
-                    }
-                    if (pBestIndex != nullptr && pindex->pprev != pBestIndex) {
-                        // This means that the list of blocks to announce don't
-                        // connect to each other.
-                        // This shouldn't really be possible to hit during
-                        // regular operation (because reorgs should take us to
-                        // a chain that has some block not on the prior chain,
-                        // which should be caught by the prior check), but one
-                        // way this could happen is by using invalidateblock /
-                        // reconsiderblock repeatedly on the tip, causing it to
-                        // be added multiple times to vBlockHashesToAnnounce.
-                        // Robustly deal with this rare situation by reverting
-                        // to an inv.
-                        fRevertToInv = true;
-                        break;
-                    }
-                    pBestIndex = pindex;
-                    if (fFoundStartingHeader) {
-                        // add this to the headers message
-                        vHeaders.push_back(pindex->GetBlockHeader());
-                    } else if (PeerHasHeader(&state, pindex)) {
-                        continue; // keep looking for the first new block
-                    } else if (pindex->pprev == nullptr || PeerHasHeader(&state, pindex->pprev)) {
-                        // Peer doesn't have this header but they do have the prior one.
-                        // Start sending headers.
-                        fFoundStartingHeader = true;
-                        vHeaders.push_back(pindex->GetBlockHeader());
-                    } else {
-                        // Peer doesn't have this header or the prior one -- nothing will
-                        // connect, so bail out.
-                        fRevertToInv = true;
-                        break;
+                // GetBlockHeader throws if the block index database is corrupt,
+                // which shuts the node down
+                try {
+                    for (const uint256 &hash : pto->vBlockHashesToAnnounce) {
+                        const CBlockIndex* pindex = LookupBlockIndex(hash);
+                        assert(pindex);
+                        if (chainActive[pindex->nHeight] != pindex) {
+                            // Bail out if we reorged away from this block
+                            fRevertToInv = true;
+                            break;
+                        }
+                        if (pBestIndex != nullptr && pindex->pprev != pBestIndex) {
+                            // This means that the list of blocks to announce don't
+                            // connect to each other.
+                            // This shouldn't really be possible to hit during
+                            // regular operation (because reorgs should take us to
+                            // a chain that has some block not on the prior chain,
+                            // which should be caught by the prior check), but one
+                            // way this could happen is by using invalidateblock /
+                            // reconsiderblock repeatedly on the tip, causing it to
+                            // be added multiple times to vBlockHashesToAnnounce.
+                            // Robustly deal with this rare situation by reverting
+                            // to an inv.
+                            fRevertToInv = true;
+                            break;
+                        }
+                        pBestIndex = pindex;
+                        if (fFoundStartingHeader) {
+                            // add this to the headers message
+                            vHeaders.push_back(pindex->GetBlockHeader());
+                        } else if (PeerHasHeader(&state, pindex)) {
+                            continue; // keep looking for the first new block
+                        } else if (pindex->pprev == nullptr || PeerHasHeader(&state, pindex->pprev)) {
+                            // Peer doesn't have this header but they do have the prior one.
+                            // Start sending headers.
+                            fFoundStartingHeader = true;
+                            vHeaders.push_back(pindex->GetBlockHeader());
+                        } else {
+                            // Peer doesn't have this header or the prior one -- nothing will
+                            // connect, so bail out.
+                            fRevertToInv = true;
+                            break;
+                        }
                     }
+                } catch (const std::runtime_error& e) {
+                    LogPrintf("%s: %s\n", __func__, e.what());
+                    fRevertToInv = true;
                 }
             }
             if (!fRevertToInv && !vHeaders.empty()) {
@@ -8,6 +8,7 @@
 #ifndef BITCOIN_PRIMITIVES_BLOCK_H
 #define BITCOIN_PRIMITIVES_BLOCK_H
 
+#include <crypto/sha256.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
 #include <uint256.h>
@@ -132,12 +133,29 @@ public:
         *(static_cast<CBlockHeader*>(this)) = header;
     }
 
-    ADD_SERIALIZE_METHODS;
-
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITEAS(CBlockHeader, *this);
-        READWRITE(vtx);
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        s << *static_cast<const CBlockHeader*>(this);
+        s << vtx;
+    }
+
+    /** With a multi-way SHA256 transform, the transactions are read as
+     *  CMutableTransactions first, so that their txids can be computed together
+     *  by MakeTransactionRefs. */
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        s >> *static_cast<CBlockHeader*>(this);
+        if (!SHA256MultiAvailable()) {
+            s >> vtx;
+            return;
+        }
+        const uint64_t nTx = ReadCompactSize(s);
+        std::vector<CMutableTransaction> txs;
+        txs.reserve(std::min<uint64_t>(nTx, 5000000 / sizeof(CMutableTransaction)));
+        for (uint64_t i = 0; i < nTx; i++) {
+            txs.emplace_back(deserialize, s);
+        }
+        MakeTransactionRefs(std::move(txs), vtx);
     }
 
     void SetNull()
@@ -5,7 +5,9 @@
 
 #include <primitives/transaction.h>
 
+#include <crypto/sha256.h>
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <utilstrencodings.h>
 
@@ -79,6 +81,37 @@ uint256 CTransaction::ComputeWitnessHash() const
 CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash{}, m_witness_hash{} {}
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(CMutableTransaction&& tx, const uint256& txid) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{txid}, m_witness_hash{ComputeWitnessHash()} {}
+
+void MakeTransactionRefs(std::vector<CMutableTransaction>&& txs, std::vector<CTransactionRef>& vtx)
+{
+    // The txid commits to the serialization without witness
+    std::vector<unsigned char> data;
+    std::vector<size_t> offsets;
+    offsets.reserve(txs.size() + 1);
+    CVectorWriter writer(SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS, data, 0);
+    for (const CMutableTransaction& tx : txs) {
+        offsets.push_back(data.size());
+        writer << tx;
+    }
+    offsets.push_back(data.size());
+
+    std::vector<const unsigned char*> inputs(txs.size());
+    std::vector<size_t> lengths(txs.size());
+    for (size_t i = 0; i < txs.size(); i++) {
+        inputs[i] = data.data() + offsets[i];
+        lengths[i] = offsets[i + 1] - offsets[i];
+    }
+    static_assert(sizeof(uint256) == CSHA256::OUTPUT_SIZE, "txids are written back to back");
+    std::vector<uint256> txids(txs.size());
+    if (!txs.empty()) SHA256DMulti(txids[0].begin(), inputs.data(), lengths.data(), txs.size());
+
+    vtx.clear();
+    vtx.reserve(txs.size());
+    for (size_t i = 0; i < txs.size(); i++) {
+        vtx.push_back(std::make_shared<const CTransaction>(std::move(txs[i]), txids[i]));
+    }
+}
 
 CAmount CTransaction::GetValueOut() const
 {
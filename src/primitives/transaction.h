@@ -298,6 +298,8 @@ public:
     /** Convert a CMutableTransaction into a CTransaction. */
     CTransaction(const CMutableTransaction &tx);
     CTransaction(CMutableTransaction &&tx);
+    /** Convert a CMutableTransaction whose txid is already known, see MakeTransactionRefs. */
+    CTransaction(CMutableTransaction &&tx, const uint256& txid);
 
     template <typename Stream>
     inline void Serialize(Stream& s) const {
@@ -403,4 +405,7 @@ typedef std::shared_ptr<const CTransaction> CTransactionRef;
 static inline CTransactionRef MakeTransactionRef() { return std::make_shared<const CTransaction>(); }
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/** Convert many transactions at once, computing their txids in parallel with SHA256DMulti. */
+void MakeTransactionRefs(std::vector<CMutableTransaction>&& txs, std::vector<CTransactionRef>& vtx);
+
 #endif // BITCOIN_PRIMITIVES_TRANSACTION_H
@@ -6,12 +6,98 @@
 #include <pubkey.h>
 
 #include <secp256k1.h>
+#include <secp256k1_batch.h>
 #include <secp256k1_recovery.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string.h>
+
 namespace
 {
 /* Global secp256k1_context object used for verification. */
 secp256k1_context* secp256k1_context_verify = nullptr;
+
+/**
+ * Cache of parsed public keys. A few busy addresses account for much of the
+ * spends, and parsing their compressed keys again for every signature costs
+ * a square root each time. The cache is direct mapped: a key has one slot,
+ * picked by a SipHash of its x coordinate, and replaces whatever key was
+ * there before. The hash is keyed at startup so that peers cannot choose
+ * keys that all land in one slot.
+ */
+class CPubKeyParseCache
+{
+private:
+    static constexpr size_t SHARDS = 16;
+    static constexpr size_t SLOTS_PER_SHARD = 512;
+
+    struct Slot {
+        unsigned char len = 0;
+        unsigned char key[CPubKey::PUBLIC_KEY_SIZE];
+        secp256k1_pubkey parsed;
+    };
+    struct Shard {
+        std::mutex mutex;
+        std::array<Slot, SLOTS_PER_SHARD> slots;
+    };
+    std::array<Shard, SHARDS> shards;
+
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+    std::atomic<uint64_t> nMissNanos{0};
+
+    uint64_t k0 = 0;
+    uint64_t k1 = 0;
+
+public:
+    void SetKey(uint64_t k0In, uint64_t k1In)
+    {
+        k0 = k0In;
+        k1 = k1In;
+    }
+
+    bool Parse(const CPubKey& pubkey, secp256k1_pubkey& parsed)
+    {
+        // Bytes 1 to 32 are the x coordinate for both key encodings
+        const uint64_t x = CSipHasher(k0, k1).Write(pubkey.begin() + 1, 32).Finalize();
+        Shard& shard = shards[x % SHARDS];
+        Slot& slot = shard.slots[(x / SHARDS) % SLOTS_PER_SHARD];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (slot.len == pubkey.size() && memcmp(slot.key, pubkey.begin(), pubkey.size()) == 0) {
+                parsed = slot.parsed;
+                nHits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const bool ret = secp256k1_ec_pubkey_parse(secp256k1_context_verify, &parsed, pubkey.begin(), pubkey.size());
+        nMissNanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+        nMisses.fetch_add(1, std::memory_order_relaxed);
+        if (ret) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            slot.len = pubkey.size();
+            memcpy(slot.key, pubkey.begin(), pubkey.size());
+            slot.parsed = parsed;
+        }
+        return ret;
+    }
+
+    PubKeyCacheStats GetStats() const
+    {
+        PubKeyCacheStats stats;
+        stats.nHits = nHits.load(std::memory_order_relaxed);
+        stats.nMisses = nMisses.load(std::memory_order_relaxed);
+        stats.nMissNanos = nMissNanos.load(std::memory_order_relaxed);
+        return stats;
+    }
+};
+
+CPubKeyParseCache pubkeyParseCache;
 } // namespace
 
 /** This function is taken from the libsecp256k1 distribution and implements
@@ -171,7 +257,7 @@ bool CPubKey::Verify(const uint256 &hash, const std::vector<unsigned char>& vchS
         return false;
     secp256k1_pubkey pubkey;
     secp256k1_ecdsa_signature sig;
-    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, vch, size())) {
+    if (!pubkeyParseCache.Parse(*this, pubkey)) {
         return false;
     }
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
@@ -279,6 +365,64 @@ bool CExtPubKey::Derive(CExtPubKey &out, unsigned int _nChild) const {
     return (!secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, nullptr, &sig));
 }
 
+bool CSignatureBatch::Add(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const uint256& hash)
+{
+    static_assert(sizeof(secp256k1_pubkey) == sizeof(Entry::pubkey), "unexpected secp256k1_pubkey size");
+    static_assert(sizeof(secp256k1_ecdsa_signature) == sizeof(Entry::sig), "unexpected secp256k1_ecdsa_signature size");
+    if (!pubkey.IsValid())
+        return false;
+    secp256k1_ecdsa_signature sig;
+    if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
+        return false;
+    }
+    secp256k1_pubkey key;
+    if (!pubkeyParseCache.Parse(pubkey, key)) {
+        return false;
+    }
+    Entry entry;
+    memcpy(entry.pubkey, key.data, sizeof(entry.pubkey));
+    /* See CPubKey::Verify. */
+    secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, &sig, &sig);
+    memcpy(entry.sig, sig.data, sizeof(entry.sig));
+    entry.hash = hash;
+    entries.push_back(entry);
+    return true;
+}
+
+bool CSignatureBatch::Verify(std::vector<int>* pvResults) const
+{
+    const size_t n = entries.size();
+    std::vector<secp256k1_pubkey> keys(n);
+    std::vector<secp256k1_ecdsa_signature> sigs(n);
+    std::vector<const secp256k1_pubkey*> pkeys(n);
+    std::vector<const secp256k1_ecdsa_signature*> psigs(n);
+    std::vector<const unsigned char*> pmsgs(n);
+    for (size_t i = 0; i < n; i++) {
+        memcpy(keys[i].data, entries[i].pubkey, sizeof(keys[i].data));
+        memcpy(sigs[i].data, entries[i].sig, sizeof(sigs[i].data));
+        pkeys[i] = &keys[i];
+        psigs[i] = &sigs[i];
+        pmsgs[i] = entries[i].hash.begin();
+    }
+    if (pvResults) pvResults->assign(n, 0);
+    return secp256k1_ecdsa_verify_batch(secp256k1_context_verify, pvResults ? pvResults->data() : nullptr, psigs.data(), pmsgs.data(), pkeys.data(), n);
+}
+
+void CSignatureBatch::clear()
+{
+    entries.clear();
+}
+
+void InitPubKeyParseCache(uint64_t k0, uint64_t k1)
+{
+    pubkeyParseCache.SetKey(k0, k1);
+}
+
+PubKeyCacheStats GetPubKeyCacheStats()
+{
+    return pubkeyParseCache.GetStats();
+}
+
 /* static */ int ECCVerifyHandle::refcount = 0;
 
 ECCVerifyHandle::ECCVerifyHandle()
@@ -249,6 +249,56 @@ struct CExtPubKey {
     }
 };
 
+/**
+ * Signatures collected to be verified together. Verifying a batch gives the
+ * same results as CPubKey::Verify on each signature, but shares the scalar
+ * inversions between them.
+ */
+class CSignatureBatch
+{
+private:
+    //! Parsed key and normalized signature, in libsecp256k1's 64 byte internal form
+    struct Entry {
+        unsigned char pubkey[64];
+        unsigned char sig[64];
+        uint256 hash;
+    };
+    std::vector<Entry> entries;
+
+public:
+    /**
+     * Add a DER signature of hash by pubkey. Returns false, without adding
+     * it, if the key or signature cannot be parsed, in which case
+     * CPubKey::Verify would fail too.
+     */
+    bool Add(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const uint256& hash);
+
+    /**
+     * Verify all signatures added so far. Returns whether all of them are
+     * valid; if pvResults is given, it is set to the result of each.
+     */
+    bool Verify(std::vector<int>* pvResults = nullptr) const;
+
+    size_t size() const { return entries.size(); }
+    void clear();
+};
+
+/**
+ * Lookups in the cache of parsed public keys that CPubKey::Verify and
+ * CSignatureBatch share, and the time spent parsing the keys not found.
+ */
+struct PubKeyCacheStats
+{
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nMissNanos;
+};
+
+PubKeyCacheStats GetPubKeyCacheStats();
+
+/** Key the slot hash of the parsed public key cache, at startup before keys are parsed */
+void InitPubKeyParseCache(uint64_t k0, uint64_t k1);
+
 /** Users of this module must hold an ECCVerifyHandle. The constructor and
  *  destructor of these are not allowed to run in parallel, though. */
 class ECCVerifyHandle
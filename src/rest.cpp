@@ -4,6 +4,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <cbor.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <core_io.h>
@@ -13,8 +14,10 @@
 #include <txdb.h>
 #include <net.h>
 #include <net_processing.h>
+#include <restcache.h>
 #include <key_io.h>
 #include <httpserver.h>
+#include <metrics.h>
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
 #include <streams.h>
@@ -36,6 +39,7 @@ enum class RetFormat {
     BINARY,
     HEX,
     JSON,
+    CBOR,
 };
 
 static const struct {
@@ -46,6 +50,7 @@ static const struct {
       {RetFormat::BINARY, "bin"},
       {RetFormat::HEX, "hex"},
       {RetFormat::JSON, "json"},
+      {RetFormat::CBOR, "cbor"},
 };
 
 struct CCoin {
@@ -111,6 +116,29 @@ static std::string AvailableDataFormatsString()
     return formats;
 }
 
+/** A JSON request is answered in CBOR instead if the client's Accept header asks for it */
+static RetFormat NegotiateDataFormat(HTTPRequest* req, RetFormat rf)
+{
+    if (rf == RetFormat::JSON && IsCBORMediaType(req->GetHeader("Accept").second))
+        return RetFormat::CBOR;
+    return rf;
+}
+
+static bool WriteCBORReply(HTTPRequest* req, const std::string& strCBOR)
+{
+    req->WriteHeader("Content-Type", CBOR_CONTENT_TYPE);
+    req->WriteReply(HTTP_OK, strCBOR);
+    return true;
+}
+
+static const char* FormatName(RetFormat rf)
+{
+    for (unsigned int i = 0; i < ARRAYLEN(rf_names); i++)
+        if (rf_names[i].rf == rf)
+            return rf_names[i].name;
+    return "";
+}
+
 static bool ParseHashStr(const std::string& strReq, uint256& v)
 {
     if (!IsHex(strReq) || (strReq.size() != 64))
@@ -128,13 +156,85 @@ static bool CheckWarmup(HTTPRequest* req)
     return true;
 }
 
+//! Replies for resources that only change on a reorg, see restcache.h
+static CRESTCache g_rest_cache;
+static int g_rest_cache_depth = DEFAULT_REST_CACHE_DEPTH;
+
+/** Response cache state of one request, captured before rendering the reply */
+struct RESTCacheRequest
+{
+    std::string key;
+    uint256 tip;
+    uint64_t generation;
+};
+
+static bool WriteCachedReply(HTTPRequest* req, const CRESTCacheEntry& entry)
+{
+    req->WriteHeader("ETag", entry.etag);
+    // Replies without tip-relative fields only change in a deep reorg; the
+    // others must be revalidated, which the ETag makes cheap
+    req->WriteHeader("Cache-Control", entry.tip.IsNull() ? "public, max-age=86400" : "no-cache");
+    if (req->GetHeader("If-None-Match").second == entry.etag) {
+        req->WriteReply(HTTP_NOT_MODIFIED);
+        return true;
+    }
+    req->WriteHeader("Content-Type", entry.content_type);
+    req->WriteReply(HTTP_OK, entry.body);
+    return true;
+}
+
+/**
+ * Answer req from the response cache if possible. key must identify both the
+ * resource and the reply format. Returns true if a reply was sent.
+ */
+static bool RESTCacheLookup(HTTPRequest* req, RESTCacheRequest& creq, const std::string& key)
+{
+    if (!g_rest_cache.Enabled())
+        return false;
+    creq.key = key;
+    creq.generation = g_rest_cache.Generation();
+    {
+        LOCK(cs_main);
+        if (chainActive.Tip())
+            creq.tip = chainActive.Tip()->GetBlockHash();
+    }
+    std::shared_ptr<const CRESTCacheEntry> entry = g_rest_cache.Lookup(key, creq.tip);
+    if (!entry)
+        return false;
+    return WriteCachedReply(req, *entry);
+}
+
+/**
+ * Send a freshly rendered reply, and cache it if pindex, the newest block it
+ * depends on, is buried at least -restcachedepth deep. fTipDependent marks
+ * replies with fields relative to the tip, such as confirmations.
+ */
+static bool RESTCacheReply(HTTPRequest* req, const RESTCacheRequest& creq, const CBlockIndex* pindex, bool fTipDependent,
+                           const std::string& content_type, std::string&& body)
+{
+    bool fCacheable = false;
+    if (!creq.key.empty() && pindex) {
+        LOCK(cs_main);
+        fCacheable = chainActive.Contains(pindex) && chainActive.Height() - pindex->nHeight + 1 >= g_rest_cache_depth;
+    }
+    if (!fCacheable) {
+        req->WriteHeader("Content-Type", content_type);
+        req->WriteReply(HTTP_OK, body);
+        return true;
+    }
+    std::shared_ptr<const CRESTCacheEntry> entry = std::make_shared<const CRESTCacheEntry>(
+        std::move(body), content_type, pindex->nHeight, fTipDependent ? creq.tip : uint256());
+    g_rest_cache.Insert(creq.key, entry, creq.generation);
+    return WriteCachedReply(req, *entry);
+}
+
 static bool rest_headers(HTTPRequest* req,
                          const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
         return false;
     std::string param;
-    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    const RetFormat rf = NegotiateDataFormat(req, ParseDataFormat(param, strURIPart));
     std::vector<std::string> path;
     boost::split(path, param, boost::is_any_of("/"));
 
@@ -150,6 +250,10 @@ static bool rest_headers(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    RESTCacheRequest creq;
+    if (RESTCacheLookup(req, creq, strprintf("/rest/headers/%d/%s.%s", count, hash.GetHex(), FormatName(rf))))
+        return true;
+
     std::vector<const CBlockIndex *> headers;
     headers.reserve(count);
     {
@@ -163,24 +267,25 @@ static bool rest_headers(HTTPRequest* req,
         }
     }
 
+    // Reading the merkle roots here, without cs_main, also caches them for the JSON replies
     CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
-    for (const CBlockIndex *pindex : headers) {
-        ssHeader << pindex->GetBlockHeader();
+    try {
+        for (const CBlockIndex *pindex : headers) {
+            ssHeader << pindex->GetBlockHeader();
+        }
+    } catch (const std::runtime_error& e) {
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, e.what());
     }
+    // A short range ends at the tip and grows with it
+    const CBlockIndex* plast = headers.size() == (unsigned long)count ? headers.back() : nullptr;
 
     switch (rf) {
     case RetFormat::BINARY: {
-        std::string binaryHeader = ssHeader.str();
-        req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryHeader);
-        return true;
+        return RESTCacheReply(req, creq, plast, false, "application/octet-stream", ssHeader.str());
     }
 
     case RetFormat::HEX: {
-        std::string strHex = HexStr(ssHeader.begin(), ssHeader.end()) + "\n";
-        req->WriteHeader("Content-Type", "text/plain");
-        req->WriteReply(HTTP_OK, strHex);
-        return true;
+        return RESTCacheReply(req, creq, plast, false, "text/plain", HexStr(ssHeader.begin(), ssHeader.end()) + "\n");
     }
     case RetFormat::JSON: {
         UniValue jsonHeaders(UniValue::VARR);
@@ -190,10 +295,20 @@ static bool rest_headers(HTTPRequest* req,
                 jsonHeaders.push_back(blockheaderToJSON(pindex));
             }
         }
-        std::string strJSON = jsonHeaders.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
-        return true;
+        return RESTCacheReply(req, creq, plast, true, "application/json", jsonHeaders.write() + "\n");
+    }
+    case RetFormat::CBOR: {
+        UniValue jsonHeaders(UniValue::VARR);
+        {
+            LOCK(cs_main);
+            for (const CBlockIndex *pindex : headers) {
+                jsonHeaders.push_back(blockheaderToJSON(pindex));
+            }
+        }
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        UniValueToCBOR(writer, jsonHeaders);
+        return RESTCacheReply(req, creq, plast, true, CBOR_CONTENT_TYPE, std::move(strCBOR));
     }
     default: {
         return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex)");
@@ -208,12 +323,16 @@ static bool rest_block(HTTPRequest* req,
     if (!CheckWarmup(req))
         return false;
     std::string hashStr;
-    const RetFormat rf = ParseDataFormat(hashStr, strURIPart);
+    const RetFormat rf = NegotiateDataFormat(req, ParseDataFormat(hashStr, strURIPart));
 
     uint256 hash;
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    RESTCacheRequest creq;
+    if (RESTCacheLookup(req, creq, strprintf("/rest/block/%s%s.%s", showTxDetails ? "" : "notxdetails/", hash.GetHex(), FormatName(rf))))
+        return true;
+
     CBlock block;
     CBlockIndex* pblockindex = nullptr;
     {
@@ -235,17 +354,11 @@ static bool rest_block(HTTPRequest* req,
 
     switch (rf) {
     case RetFormat::BINARY: {
-        std::string binaryBlock = ssBlock.str();
-        req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryBlock);
-        return true;
+        return RESTCacheReply(req, creq, pblockindex, false, "application/octet-stream", ssBlock.str());
     }
 
     case RetFormat::HEX: {
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
-        req->WriteHeader("Content-Type", "text/plain");
-        req->WriteReply(HTTP_OK, strHex);
-        return true;
+        return RESTCacheReply(req, creq, pblockindex, false, "text/plain", HexStr(ssBlock.begin(), ssBlock.end()) + "\n");
     }
 
     case RetFormat::JSON: {
@@ -254,10 +367,17 @@ static bool rest_block(HTTPRequest* req,
             LOCK(cs_main);
             objBlock = blockToJSON(block, pblockindex, showTxDetails);
         }
-        std::string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
-        return true;
+        return RESTCacheReply(req, creq, pblockindex, true, "application/json", objBlock.write() + "\n");
+    }
+
+    case RetFormat::CBOR: {
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        {
+            LOCK(cs_main);
+            blockToCBOR(block, pblockindex, showTxDetails, writer);
+        }
+        return RESTCacheReply(req, creq, pblockindex, true, CBOR_CONTENT_TYPE, std::move(strCBOR));
     }
 
     default: {
@@ -284,7 +404,7 @@ static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
     if (!CheckWarmup(req))
         return false;
     std::string param;
-    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    const RetFormat rf = NegotiateDataFormat(req, ParseDataFormat(param, strURIPart));
 
     switch (rf) {
     case RetFormat::JSON: {
@@ -296,8 +416,16 @@ static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
         req->WriteReply(HTTP_OK, strJSON);
         return true;
     }
+    case RetFormat::CBOR: {
+        JSONRPCRequest jsonRequest;
+        jsonRequest.params = UniValue(UniValue::VARR);
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        UniValueToCBOR(writer, getblockchaininfo(jsonRequest));
+        return WriteCBORReply(req, strCBOR);
+    }
     default: {
-        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json, cbor)");
     }
     }
 }
@@ -307,7 +435,7 @@ static bool rest_mempool_info(HTTPRequest* req, const std::string& strURIPart)
     if (!CheckWarmup(req))
         return false;
     std::string param;
-    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    const RetFormat rf = NegotiateDataFormat(req, ParseDataFormat(param, strURIPart));
 
     switch (rf) {
     case RetFormat::JSON: {
@@ -318,8 +446,14 @@ static bool rest_mempool_info(HTTPRequest* req, const std::string& strURIPart)
         req->WriteReply(HTTP_OK, strJSON);
         return true;
     }
+    case RetFormat::CBOR: {
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        UniValueToCBOR(writer, mempoolInfoToJSON());
+        return WriteCBORReply(req, strCBOR);
+    }
     default: {
-        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json, cbor)");
     }
     }
 }
@@ -329,7 +463,7 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
     if (!CheckWarmup(req))
         return false;
     std::string param;
-    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    const RetFormat rf = NegotiateDataFormat(req, ParseDataFormat(param, strURIPart));
 
     switch (rf) {
     case RetFormat::JSON: {
@@ -340,8 +474,14 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
         req->WriteReply(HTTP_OK, strJSON);
         return true;
     }
+    case RetFormat::CBOR: {
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        mempoolToCBOR(true, writer);
+        return WriteCBORReply(req, strCBOR);
+    }
     default: {
-        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json, cbor)");
     }
     }
 }
@@ -351,42 +491,52 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     if (!CheckWarmup(req))
         return false;
     std::string hashStr;
-    const RetFormat rf = ParseDataFormat(hashStr, strURIPart);
+    const RetFormat rf = NegotiateDataFormat(req, ParseDataFormat(hashStr, strURIPart));
 
     uint256 hash;
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    RESTCacheRequest creq;
+    if (RESTCacheLookup(req, creq, strprintf("/rest/tx/%s.%s", hash.GetHex(), FormatName(rf))))
+        return true;
+
     CTransactionRef tx;
     uint256 hashBlock = uint256();
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true))
         return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
 
+    // Mempool transactions are never cached
+    const CBlockIndex* pblockindex = nullptr;
+    if (!hashBlock.IsNull()) {
+        LOCK(cs_main);
+        pblockindex = LookupBlockIndex(hashBlock);
+    }
+
     CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
     ssTx << tx;
 
+    // The JSON and CBOR replies only carry the block hash, not confirmations
     switch (rf) {
     case RetFormat::BINARY: {
-        std::string binaryTx = ssTx.str();
-        req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryTx);
-        return true;
+        return RESTCacheReply(req, creq, pblockindex, false, "application/octet-stream", ssTx.str());
     }
 
     case RetFormat::HEX: {
-        std::string strHex = HexStr(ssTx.begin(), ssTx.end()) + "\n";
-        req->WriteHeader("Content-Type", "text/plain");
-        req->WriteReply(HTTP_OK, strHex);
-        return true;
+        return RESTCacheReply(req, creq, pblockindex, false, "text/plain", HexStr(ssTx.begin(), ssTx.end()) + "\n");
     }
 
     case RetFormat::JSON: {
         UniValue objTx(UniValue::VOBJ);
         TxToUniv(*tx, hashBlock, objTx);
-        std::string strJSON = objTx.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
-        return true;
+        return RESTCacheReply(req, creq, pblockindex, false, "application/json", objTx.write() + "\n");
+    }
+
+    case RetFormat::CBOR: {
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        TxToCBOR(*tx, hashBlock, writer);
+        return RESTCacheReply(req, creq, pblockindex, false, CBOR_CONTENT_TYPE, std::move(strCBOR));
     }
 
     default: {
@@ -595,22 +745,55 @@ static const struct {
 
 // restapi
 
-static bool API_ERROR (HTTPRequest* req, std::string message) {
-    UniValue root (UniValue::VOBJ);
-    root.pushKV("status", "error");
-    root.pushKV("errmsg", message);
+static bool API_CBOR (HTTPRequest* req) {
+    return IsCBORMediaType(req->GetHeader("Accept").second);
+}
+
+static bool API_WRITE (HTTPRequest* req, const UniValue& root) {
+    if (API_CBOR(req)) {
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        UniValueToCBOR(writer, root);
+        return WriteCBORReply(req, strCBOR);
+    }
     std::string strJSON = root.write() + "\n";
     req->WriteHeader("Content-Type", "application/json");
     req->WriteReply(HTTP_OK, strJSON);
     return true;
 }
 
+static bool API_ERROR (HTTPRequest* req, std::string message) {
+    UniValue root (UniValue::VOBJ);
+    root.pushKV("status", "error");
+    root.pushKV("errmsg", message);
+    return API_WRITE (req, root);
+}
+
 static bool API_OK (HTTPRequest* req, UniValue& json) {
     json.pushKV("status", "ok");
-    std::string strJSON = json.write() + "\n";
-    req->WriteHeader("Content-Type", "application/json");
-    req->WriteReply(HTTP_OK, strJSON);
-    return true;
+    return API_WRITE (req, json);
+}
+
+/** API_OK for replies that may be cached once pindex is buried deep enough. All /api/ replies carry confirmations. */
+static bool API_OK (HTTPRequest* req, UniValue& json, const RESTCacheRequest& creq, const CBlockIndex* pindex) {
+    json.pushKV("status", "ok");
+    if (API_CBOR(req)) {
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        UniValueToCBOR(writer, json);
+        return RESTCacheReply(req, creq, pindex, true, CBOR_CONTENT_TYPE, std::move(strCBOR));
+    }
+    return RESTCacheReply(req, creq, pindex, true, "application/json", json.write() + "\n");
+}
+
+static bool API_OK (HTTPRequest* req, std::string& strCBOR, CBORWriter& writer, const RESTCacheRequest& creq, const CBlockIndex* pindex) {
+    writer.Key("status").WriteText("ok");
+    writer.End();
+    return RESTCacheReply(req, creq, pindex, true, CBOR_CONTENT_TYPE, std::move(strCBOR));
+}
+
+static bool API_CACHED (HTTPRequest* req, RESTCacheRequest& creq, const std::string& uri) {
+    return RESTCacheLookup(req, creq, uri + (API_CBOR(req) ? ".cbor" : ".json"));
 }
 
 UniValue GetNetworkHash () {
@@ -699,6 +882,26 @@ bool api_net (HTTPRequest* req, const std::string& strURIPart) {
     return API_OK (req, root);
 }
 
+/** Output spent by an input, for showing its address and value */
+static bool getSpentOutput (const COutPoint& prevout, CTxOut& txout) {
+    CTransactionRef intx;
+    uint256 inhashBlock = uint256();
+    if (!GetTransaction(prevout.hash, intx, Params().GetConsensus(), inhashBlock, true)) return false;
+    if (intx->vout.size() < prevout.n + 1) return false;
+    txout = intx->vout[prevout.n];
+    return true;
+}
+
+/** The addresses of the outputs of a transaction, encoded together. fExtracted tells which outputs have one. */
+static std::vector<std::string> getOutputAddresses (const CTransaction& tx, std::vector<bool>& fExtracted) {
+    std::vector<CTxDestination> dests(tx.vout.size());
+    fExtracted.resize(tx.vout.size());
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        fExtracted[i] = ExtractDestination(tx.vout[i].scriptPubKey, dests[i]);
+    }
+    return EncodeDestinations(dests);
+}
+
 void getTxData (UniValue& obj, const CTransactionRef tx, uint256 hashBlock) {
     obj.pushKV("hash", tx->GetHash().GetHex());
     obj.pushKV("size", (int)::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION));
@@ -714,33 +917,68 @@ void getTxData (UniValue& obj, const CTransactionRef tx, uint256 hashBlock) {
         else {
             in.pushKV("tx_id", txin.prevout.hash.GetHex());
             in.pushKV("tx_out", (int64_t)txin.prevout.n);
-            CTransactionRef intx;
-            uint256 inhashBlock = uint256();
-            if (GetTransaction(txin.prevout.hash, intx, Params().GetConsensus(), inhashBlock, true)) {
-                if (intx->vout.size() >= txin.prevout.n + 1) {
-                    CTxDestination addr;
-                    if (ExtractDestination(intx->vout[txin.prevout.n].scriptPubKey, addr))
-                        in.pushKV("address", EncodeDestination(addr));
-                    in.pushKV("value", ValueFromAmount(intx->vout[txin.prevout.n].nValue));
-                }  
+            CTxOut prevout;
+            if (getSpentOutput(txin.prevout, prevout)) {
+                CTxDestination addr;
+                if (ExtractDestination(prevout.scriptPubKey, addr))
+                    in.pushKV("address", EncodeDestination(addr));
+                in.pushKV("value", ValueFromAmount(prevout.nValue));
             }
         }
         vin.push_back(in);
     }
     obj.pushKV("input", vin);
     UniValue vout(UniValue::VARR);
+    std::vector<bool> fExtracted;
+    const std::vector<std::string> addresses = getOutputAddresses(*tx, fExtracted);
     for (unsigned int i = 0; i < tx->vout.size(); i++) {
         const CTxOut& txout = tx->vout[i];
         UniValue out(UniValue::VOBJ);
-        CTxDestination addr;
-        if (ExtractDestination(txout.scriptPubKey, addr))
-            out.pushKV("address", EncodeDestination(addr));
+        if (fExtracted[i])
+            out.pushKV("address", addresses[i]);
         out.pushKV("value", ValueFromAmount(txout.nValue));
         vout.push_back(out);
     }
     obj.pushKV("output", vout);
 }
 
+/** getTxData for CBOR replies: hashes and scripts as bytes, values in satoshis. Writes keys into an open map. */
+void getTxDataCBOR (CBORWriter& out, const CTransactionRef tx, uint256 hashBlock) {
+    out.Key("hash").WriteHash(tx->GetHash());
+    out.Key("size").WriteUInt(::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION));
+    out.Key("version").WriteInt(tx->nVersion);
+    out.Key("locktime").WriteUInt(tx->nLockTime);
+    if (!hashBlock.IsNull()) out.Key("blockhash").WriteHash(hashBlock);
+    out.Key("input").BeginArray(tx->vin.size());
+    for (const CTxIn& txin : tx->vin) {
+        out.BeginMap();
+        if (tx->IsCoinBase())
+            out.Key("coinbase").WriteBytes(txin.scriptSig);
+        else {
+            out.Key("tx_id").WriteHash(txin.prevout.hash);
+            out.Key("tx_out").WriteUInt(txin.prevout.n);
+            CTxOut prevout;
+            if (getSpentOutput(txin.prevout, prevout)) {
+                CTxDestination addr;
+                if (ExtractDestination(prevout.scriptPubKey, addr))
+                    out.Key("address").WriteText(EncodeDestination(addr));
+                out.Key("value").WriteInt(prevout.nValue);
+            }
+        }
+        out.End();
+    }
+    out.Key("output").BeginArray(tx->vout.size());
+    std::vector<bool> fExtracted;
+    const std::vector<std::string> addresses = getOutputAddresses(*tx, fExtracted);
+    for (unsigned int i = 0; i < tx->vout.size(); i++) {
+        out.BeginMap();
+        if (fExtracted[i])
+            out.Key("address").WriteText(addresses[i]);
+        out.Key("value").WriteInt(tx->vout[i].nValue);
+        out.End();
+    }
+}
+
 bool api_mempool (HTTPRequest* req, const std::string& strURIPart) {
     if (!CheckWarmup(req)) return false;
 
@@ -800,6 +1038,43 @@ std::string getHeaderData (UniValue& obj, const CBlockIndex* pi, bool full_tx) {
     return "";
 }
 
+std::string getHeaderDataCBOR (CBORWriter& out, const CBlockIndex* pi, bool full_tx) {
+    CBlock block;
+    if (!pi) return " not found";
+    if (IsBlockPruned(pi)) return " not available (pruned data)";
+    if (!ReadBlockFromDisk(block, pi, Params().GetConsensus())) return " not found";
+    out.BeginMap();
+    out.Key("hash").WriteHash(pi->GetBlockHash());
+    int confirmations = -1;
+    if (chainActive.Contains(pi)) confirmations = chainActive.Height() - pi->nHeight + 1;
+    out.Key("confirmations").WriteInt(confirmations);
+    out.Key("height").WriteInt(pi->nHeight);
+    out.Key("version").WriteInt(block.nVersion);
+    out.Key("merkleroot").WriteHash(block.hashMerkleRoot);
+    out.Key("time").WriteInt(block.GetBlockTime());
+    out.Key("nonce").WriteUInt(block.nNonce);
+    out.Key("bits").WriteUInt(block.nBits);
+    out.Key("difficulty").WriteDouble(GetDifficulty(pi));
+    if (pi->pprev) out.Key("prevblockhash").WriteHash(pi->pprev->GetBlockHash());
+    CBlockIndex *pnext = chainActive.Next(pi);
+    if (pnext) out.Key("nextblockhash").WriteHash(pnext->GetBlockHash());
+    out.Key("size").WriteUInt(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    out.Key("chainwork").WriteHash(ArithToUint256(pi->nChainWork()));
+    out.Key("nTx").WriteUInt(pi->nTx);
+    out.Key("tx").BeginArray(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        if (full_tx) {
+            out.BeginMap();
+            getTxDataCBOR (out, tx, uint256());
+            out.End();
+        } else {
+            out.WriteHash(tx->GetHash());
+        }
+    }
+    out.End();
+    return "";
+}
+
 bool api_header (HTTPRequest* req, const std::string& strURIPart) {
     if (!CheckWarmup(req)) return false;
     const CBlockIndex* pi = NULL;
@@ -826,16 +1101,22 @@ bool api_header (HTTPRequest* req, const std::string& strURIPart) {
         pi = chainActive[chainActive.Height() <= count ? 0 : chainActive.Height() - count];
         if (!pi) return API_ERROR (req, "header hash " + strURIPart + " not found");
     } else return API_ERROR (req, "params " + strURIPart + " is invalid");
+    RESTCacheRequest creq;
+    if (s1 != "" && API_CACHED (req, creq, "/api/header/" + strURIPart)) return true;
     UniValue root (UniValue::VOBJ);
+    const CBlockIndex* plast = nullptr;
     while (pi != nullptr && chainActive.Contains(pi)) {
         UniValue obj (UniValue::VOBJ);
         std::string ret = getHeaderData (obj, pi, false);
         if (ret != "") return API_ERROR (req, strprintf("[%d]: %s", pi->nHeight, ret));
-        root.pushKV(strprintf("%d", pi->nHeight), obj);
+        root.pushKVEnd(strprintf("%d", pi->nHeight), std::move(obj));
+        plast = pi;
         if (count-- <= 0) break;
         pi = chainActive.Next(pi);
     }
-    return API_OK (req, root);
+    // A range cut short by the tip grows with it
+    if (count >= 0) plast = nullptr;
+    return API_OK (req, root, creq, plast);
 }
 
 bool api_block (HTTPRequest* req, const std::string& strURIPart) {
@@ -854,12 +1135,23 @@ bool api_block (HTTPRequest* req, const std::string& strURIPart) {
         pi = chainActive.Tip();
         if (!pi) return API_ERROR (req, "block index " + strURIPart + " not found");
     } else return API_ERROR (req, "params " + strURIPart + " is invalid");
+    RESTCacheRequest creq;
+    if (API_CACHED (req, creq, "/api/block/" + pi->GetBlockHash().GetHex())) return true;
+    if (API_CBOR(req)) {
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        writer.BeginMap();
+        writer.WriteText(strprintf("%d", pi->nHeight));
+        std::string ret = getHeaderDataCBOR (writer, pi, true);
+        if (ret != "") return API_ERROR (req, strprintf("[%d]: %s", pi->nHeight, ret));
+        return API_OK (req, strCBOR, writer, creq, pi);
+    }
     UniValue root (UniValue::VOBJ);
     UniValue obj (UniValue::VOBJ);
     std::string ret = getHeaderData (obj, pi, true);
     if (ret != "") return API_ERROR (req, strprintf("[%d]: %s", pi->nHeight, ret));
-    root.pushKV(strprintf("%d", pi->nHeight), obj);
-    return API_OK (req, root);
+    root.pushKV(strprintf("%d", pi->nHeight), std::move(obj));
+    return API_OK (req, root, creq, pi);
 }
 
 bool api_tx (HTTPRequest* req, const std::string& strURIPart) {
@@ -867,27 +1159,46 @@ bool api_tx (HTTPRequest* req, const std::string& strURIPart) {
     uint256 hash;
     if (!ParseHashStr(strURIPart, hash))
         return API_ERROR (req, "tx hash " + strURIPart + " is invalid");
+    RESTCacheRequest creq;
+    if (API_CACHED (req, creq, "/api/tx/" + hash.GetHex())) return true;
     CTransactionRef tx;
     uint256 hashBlock = uint256();
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true))
         return API_ERROR (req, "tx hash " + strURIPart + " not found");
+    // Block fields are resolved once, so that both formats carry the same ones
+    CBlockIndex* pi;
+    uint256 blockhash = hashBlock;
+    int confirmations = -1, height = -1;
+    int64_t blocktime = 0;
+    {
+        LOCK(cs_main);
+        pi = LookupBlockIndex(hashBlock);
+        if (pi) {
+            blockhash = pi->GetBlockHash();
+            if (chainActive.Contains(pi)) confirmations = chainActive.Height() - pi->nHeight + 1;
+            height = pi->nHeight;
+            blocktime = pi->GetBlockTime();
+        }
+    }
+    if (API_CBOR(req)) {
+        std::string strCBOR;
+        CBORWriter writer(strCBOR);
+        writer.BeginMap();
+        getTxDataCBOR (writer, tx, hashBlock);
+        // getTxDataCBOR leaves out the hash of mempool transactions
+        if (hashBlock.IsNull()) writer.Key("blockhash").WriteHash(blockhash);
+        writer.Key("blockconfirmations").WriteInt(confirmations);
+        writer.Key("blockheight").WriteInt(height);
+        writer.Key("blocktime").WriteInt(blocktime);
+        return API_OK (req, strCBOR, writer, creq, pi);
+    }
     UniValue root (UniValue::VOBJ);
     getTxData (root, tx, hashBlock);
-    CBlockIndex* pi = LookupBlockIndex(hashBlock);
-    if (pi) {
-        root.pushKV("blockhash", pi->GetBlockHash().GetHex());
-        int confirmations = -1;
-        if (chainActive.Contains(pi)) confirmations = chainActive.Height() - pi->nHeight + 1;
-        root.pushKV("blockconfirmations", confirmations);
-        root.pushKV("blockheight", pi->nHeight);
-        root.pushKV("blocktime", pi->GetBlockTime());
-    } else {
-        root.pushKV("blockhash", hashBlock.GetHex());
-        root.pushKV("blockconfirmations", (int)-1);
-        root.pushKV("blockheight", (int)-1);
-        root.pushKV("blocktime", (int)0);
-    }
-    return API_OK (req, root);
+    root.pushKV("blockhash", blockhash.GetHex());
+    root.pushKV("blockconfirmations", confirmations);
+    root.pushKV("blockheight", height);
+    root.pushKV("blocktime", blocktime);
+    return API_OK (req, root, creq, pi);
 }
 
 bool api_address (HTTPRequest* req, const std::string& strURIPart) {
@@ -925,7 +1236,7 @@ bool api_address (HTTPRequest* req, const std::string& strURIPart) {
         output.pushKV("height", (int64_t)it.second.height);
         const CBlockIndex* pi = chainActive[it.second.height];
         if (pi) output.pushKV("time", pi->GetBlockTime());
-        output.pushKV("script", HexStr(it.first.script.begin(), it.first.script.end()));
+        output.pushKV("script", HexStr(it.first.script.GetScript()));
         if (isspent) {
             output.pushKV("spent_tx_hash", it.second.spend_hash.GetHex());
             output.pushKV("spent_tx_out", (int64_t)it.second.spend_n);
@@ -1024,15 +1335,31 @@ static const struct {
       {"/api/send/", api_send},         // TX HEX
 };
 
+static void CollectRESTCacheMetrics(std::string& out)
+{
+    AppendMetric(out, "rest_cache_lookups_total", "counter", "Lookups in the REST reply cache", {
+        {"result=\"hit\"", (double)g_rest_cache.Hits()},
+        {"result=\"miss\"", (double)g_rest_cache.Misses()},
+    });
+    AppendMetric(out, "rest_cache_entries", "gauge", "Replies in the REST reply cache", {{"", (double)g_rest_cache.Size()}});
+    AppendMetric(out, "rest_cache_bytes", "gauge", "Memory used by the REST reply cache", {{"", (double)g_rest_cache.Bytes()}});
+}
+
 bool StartREST()
 {
+    g_rest_cache_depth = std::max((int)gArgs.GetArg("-restcachedepth", DEFAULT_REST_CACHE_DEPTH), 1);
+    g_rest_cache.SetMaxBytes(std::max(gArgs.GetArg("-restcachesize", DEFAULT_REST_CACHE_SIZE), (int64_t)0) << 20);
+    if (g_rest_cache.Enabled()) {
+        RegisterValidationInterface(&g_rest_cache, "restcache", ValidationQueuePolicy::NO_WAIT);
+        RegisterMetricsCollector("restcache", CollectRESTCacheMetrics);
+    }
     if (gArgs.GetBoolArg("-server", false)) {
         for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
-            RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler);
+            RegisterHTTPHandler(uri_prefixes[i].prefix, false, uri_prefixes[i].handler, HTTPWorkClass::REST);
     }
     if (gArgs.GetBoolArg("-restapi", false)) {
         for (unsigned int i = 0; i < ARRAYLEN(api_uri_prefixes); i++)
-            RegisterHTTPHandler(api_uri_prefixes[i].prefix, false, api_uri_prefixes[i].handler);
+            RegisterHTTPHandler(api_uri_prefixes[i].prefix, false, api_uri_prefixes[i].handler, HTTPWorkClass::REST);
     }
     return true;
 }
@@ -1043,6 +1370,11 @@ void InterruptREST()
 
 void StopREST()
 {
+    if (g_rest_cache.Enabled()) {
+        UnregisterMetricsCollector("restcache");
+        UnregisterValidationInterface(&g_rest_cache);
+        g_rest_cache.SetMaxBytes(0);
+    }
     if (gArgs.GetBoolArg("-server", false)) {
         for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
             UnregisterHTTPHandler(uri_prefixes[i].prefix, false);
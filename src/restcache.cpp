@@ -0,0 +1,178 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <restcache.h>
+
+#include <chain.h>
+#include <crypto/sha256.h>
+#include <primitives/block.h>
+#include <utilstrencodings.h>
+#include <validation.h>
+
+//! Rough per-entry bookkeeping overhead (list node, map node, shared_ptr control block)
+static const size_t ENTRY_OVERHEAD = 192;
+
+CRESTCacheEntry::CRESTCacheEntry(std::string&& _body, const std::string& _content_type, int _nHeight, const uint256& _tip) :
+    body(std::move(_body)), content_type(_content_type), nHeight(_nHeight), tip(_tip)
+{
+    // Strong validator derived from the content, so that it is stable across
+    // restarts and identical between nodes serving the same chain
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write((const unsigned char*)body.data(), body.size()).Finalize(hash);
+    etag = "\"" + HexStr(hash, hash + 16) + "\"";
+}
+
+size_t CRESTCacheEntry::DynamicMemoryUsage() const
+{
+    return body.capacity() + content_type.capacity() + etag.capacity() + sizeof(*this);
+}
+
+CRESTCache::CRESTCache(size_t max_bytes) :
+    m_max_bytes(max_bytes), m_bytes(0), m_generation(0), m_hits(0), m_misses(0)
+{
+}
+
+void CRESTCache::EraseItem(std::list<Item>::iterator it)
+{
+    m_bytes -= it->first.capacity() + it->second->DynamicMemoryUsage() + ENTRY_OVERHEAD;
+    m_map.erase(it->first);
+    m_lru.erase(it);
+}
+
+void CRESTCache::SetMaxBytes(size_t max_bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_bytes = max_bytes;
+    while (m_bytes > m_max_bytes && !m_lru.empty()) {
+        EraseItem(std::prev(m_lru.end()));
+    }
+}
+
+bool CRESTCache::Enabled() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_bytes > 0;
+}
+
+uint64_t CRESTCache::Generation() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generation;
+}
+
+std::shared_ptr<const CRESTCacheEntry> CRESTCache::Lookup(const std::string& key, const uint256& tip)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_map.find(key);
+    if (it == m_map.end()) {
+        m_misses++;
+        return nullptr;
+    }
+    const std::shared_ptr<const CRESTCacheEntry>& entry = it->second->second;
+    if (!entry->tip.IsNull() && entry->tip != tip) {
+        // Rendered at an older tip; its confirmations are stale
+        EraseItem(it->second);
+        m_misses++;
+        return nullptr;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    m_hits++;
+    return entry;
+}
+
+bool CRESTCache::Insert(const std::string& key, std::shared_ptr<const CRESTCacheEntry> entry, uint64_t generation)
+{
+    const size_t nBytes = key.capacity() + entry->DynamicMemoryUsage() + ENTRY_OVERHEAD;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // A block was disconnected while the reply was being rendered
+    if (generation != m_generation) return false;
+    // Never let a single reply take more than a quarter of the budget
+    if (nBytes > m_max_bytes / 4) return false;
+
+    auto it = m_map.find(key);
+    if (it != m_map.end()) {
+        EraseItem(it->second);
+    }
+    m_lru.emplace_front(key, std::move(entry));
+    m_map.emplace(key, m_lru.begin());
+    m_bytes += nBytes;
+    while (m_bytes > m_max_bytes) {
+        EraseItem(std::prev(m_lru.end()));
+    }
+    return true;
+}
+
+void CRESTCache::InvalidateFrom(int nHeight)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+    for (auto it = m_lru.begin(); it != m_lru.end();) {
+        auto next = std::next(it);
+        if (it->second->nHeight >= nHeight) {
+            EraseItem(it);
+        }
+        it = next;
+    }
+}
+
+void CRESTCache::EraseTipDependent()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_lru.begin(); it != m_lru.end();) {
+        auto next = std::next(it);
+        if (!it->second->tip.IsNull()) {
+            EraseItem(it);
+        }
+        it = next;
+    }
+}
+
+void CRESTCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+    m_lru.clear();
+    m_map.clear();
+    m_bytes = 0;
+}
+
+void CRESTCache::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    EraseTipDependent();
+}
+
+void CRESTCache::BlockDisconnected(const std::shared_ptr<const CBlock>& block)
+{
+    int nHeight = 0;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = LookupBlockIndex(block->GetHash());
+        if (pindex) nHeight = pindex->nHeight;
+    }
+    InvalidateFrom(nHeight);
+}
+
+size_t CRESTCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lru.size();
+}
+
+size_t CRESTCache::Bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+uint64_t CRESTCache::Hits() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+uint64_t CRESTCache::Misses() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RESTCACHE_H
+#define BITCOIN_RESTCACHE_H
+
+#include <uint256.h>
+#include <validationinterface.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+static const int64_t DEFAULT_REST_CACHE_SIZE = 32; // MiB
+//! Replies are only cached once the newest block they depend on has this many confirmations
+static const int DEFAULT_REST_CACHE_DEPTH = 10;
+
+/** A rendered REST reply */
+struct CRESTCacheEntry
+{
+    std::string body;
+    std::string content_type;
+    std::string etag;
+    //! Height of the newest block the reply depends on
+    int nHeight;
+    //! Tip the reply was rendered at if it carries tip-relative fields
+    //! (confirmations, nextblockhash), or null if it only depends on block data
+    uint256 tip;
+
+    CRESTCacheEntry(std::string&& body, const std::string& content_type, int nHeight, const uint256& tip);
+
+    size_t DynamicMemoryUsage() const;
+};
+
+/**
+ * Byte-budgeted LRU cache of replies for REST resources that can not change
+ * short of a reorg: blocks, transactions and header ranges that are buried
+ * deeper than a reorg-safe depth.
+ *
+ * Entries are dropped when a block at or below their height is disconnected.
+ * Replies that embed tip-relative fields are only served while the tip they
+ * were rendered at is still the tip.
+ *
+ * To avoid caching a reply rendered from pre-reorg data after the
+ * corresponding invalidation already ran, callers take Generation() before
+ * reading chain state and pass it to Insert().
+ */
+class CRESTCache final : public CValidationInterface
+{
+private:
+    typedef std::pair<std::string, std::shared_ptr<const CRESTCacheEntry>> Item;
+
+    mutable std::mutex m_mutex;
+    std::list<Item> m_lru; //!< Most recently used first
+    std::unordered_map<std::string, std::list<Item>::iterator> m_map;
+    size_t m_max_bytes;
+    size_t m_bytes;
+    uint64_t m_generation;
+    uint64_t m_hits;
+    uint64_t m_misses;
+
+    void EraseItem(std::list<Item>::iterator it);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override;
+
+public:
+    explicit CRESTCache(size_t max_bytes = 0);
+
+    /** Change the byte budget, evicting as needed. A budget of 0 disables the cache. */
+    void SetMaxBytes(size_t max_bytes);
+    bool Enabled() const;
+    uint64_t Generation() const;
+
+    /** Return the entry for key if it is still valid with tip as the active tip */
+    std::shared_ptr<const CRESTCacheEntry> Lookup(const std::string& key, const uint256& tip);
+    /** Store an entry rendered after generation was taken. Returns false if it was not stored. */
+    bool Insert(const std::string& key, std::shared_ptr<const CRESTCacheEntry> entry, uint64_t generation);
+
+    /** Drop entries depending on blocks at nHeight or above */
+    void InvalidateFrom(int nHeight);
+    /** Drop entries that carry tip-relative fields */
+    void EraseTipDependent();
+    void Clear();
+
+    size_t Size() const;
+    size_t Bytes() const;
+    uint64_t Hits() const;
+    uint64_t Misses() const;
+};
+
+#endif // BITCOIN_RESTCACHE_H
@@ -9,6 +9,7 @@
 
 #include <amount.h>
 #include <base58.h>
+#include <cbor.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -100,7 +101,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.pushKV("height", blockindex->nHeight);
     result.pushKV("version", blockindex->nVersion);
     result.pushKV("versionHex", strprintf("%08x", blockindex->nVersion));
-    result.pushKV("merkleroot", blockindex->hashMerkleRoot.GetHex());
+    result.pushKV("merkleroot", blockindex->GetMerkleRoot().GetHex());
     result.pushKV("time", (int64_t)blockindex->nTime);
     result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
     result.pushKV("nonce", (uint64_t)blockindex->nNonce);
@@ -135,18 +136,19 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.pushKV("versionHex", strprintf("%08x", block.nVersion));
     result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
     UniValue txs(UniValue::VARR);
+    txs.reserve(block.vtx.size());
     for(const auto& tx : block.vtx)
     {
         if(txDetails)
         {
             UniValue objTx(UniValue::VOBJ);
             TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
-            txs.push_back(objTx);
+            txs.push_back(std::move(objTx));
         }
         else
             txs.push_back(tx->GetHash().GetHex());
     }
-    result.pushKV("tx", txs);
+    result.pushKV("tx", std::move(txs));
     result.pushKV("time", block.GetBlockTime());
     result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
     result.pushKV("nonce", (uint64_t)block.nNonce);
@@ -163,6 +165,45 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     return result;
 }
 
+void blockToCBOR(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, CBORWriter& out)
+{
+    AssertLockHeld(cs_main);
+    int confirmations = -1;
+    // Only report confirmations if the block is on the main chain
+    if (chainActive.Contains(blockindex))
+        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    out.BeginMap();
+    out.Key("hash").WriteHash(blockindex->GetBlockHash());
+    out.Key("confirmations").WriteInt(confirmations);
+    out.Key("strippedsize").WriteUInt(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    out.Key("size").WriteUInt(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    out.Key("weight").WriteInt(::GetBlockWeight(block));
+    out.Key("height").WriteInt(blockindex->nHeight);
+    out.Key("version").WriteInt(block.nVersion);
+    out.Key("merkleroot").WriteHash(block.hashMerkleRoot);
+    out.Key("tx").BeginArray(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        if (txDetails)
+            TxToCBOR(*tx, uint256(), out, true, RPCSerializationFlags());
+        else
+            out.WriteHash(tx->GetHash());
+    }
+    out.Key("time").WriteInt(block.GetBlockTime());
+    out.Key("mediantime").WriteInt(blockindex->GetMedianTimePast());
+    out.Key("nonce").WriteUInt(block.nNonce);
+    out.Key("bits").WriteUInt(block.nBits);
+    out.Key("difficulty").WriteDouble(GetDifficulty(blockindex));
+    out.Key("chainwork").WriteHash(ArithToUint256(blockindex->nChainWork()));
+    out.Key("nTx").WriteUInt(blockindex->nTx);
+
+    if (blockindex->pprev)
+        out.Key("previousblockhash").WriteHash(blockindex->pprev->GetBlockHash());
+    CBlockIndex *pnext = chainActive.Next(blockindex);
+    if (pnext)
+        out.Key("nextblockhash").WriteHash(pnext->GetBlockHash());
+    out.End();
+}
+
 static UniValue getblockcount(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -398,7 +439,7 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e) EXCLUSIVE_LOCK
     fees.pushKV("modified", ValueFromAmount(e.GetModifiedFee()));
     fees.pushKV("ancestor", ValueFromAmount(e.GetModFeesWithAncestors()));
     fees.pushKV("descendant", ValueFromAmount(e.GetModFeesWithDescendants()));
-    info.pushKV("fees", fees);
+    info.pushKV("fees", std::move(fees));
 
     info.pushKV("size", (int)e.GetTxSize());
     info.pushKV("fee", ValueFromAmount(e.GetFee()));
@@ -426,7 +467,7 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e) EXCLUSIVE_LOCK
         depends.push_back(dep);
     }
 
-    info.pushKV("depends", depends);
+    info.pushKV("depends", std::move(depends));
 
     UniValue spent(UniValue::VARR);
     const CTxMemPool::txiter &it = mempool.mapTx.find(tx.GetHash());
@@ -435,7 +476,7 @@ static void entryToJSON(UniValue &info, const CTxMemPoolEntry &e) EXCLUSIVE_LOCK
         spent.push_back(childiter->GetTx().GetHash().ToString());
     }
 
-    info.pushKV("spentby", spent);
+    info.pushKV("spentby", std::move(spent));
 }
 
 UniValue mempoolToJSON(bool fVerbose)
@@ -444,12 +485,14 @@ UniValue mempoolToJSON(bool fVerbose)
     {
         LOCK(mempool.cs);
         UniValue o(UniValue::VOBJ);
+        o.reserve(mempool.mapTx.size());
         for (const CTxMemPoolEntry& e : mempool.mapTx)
         {
             const uint256& hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
             entryToJSON(info, e);
-            o.pushKV(hash.ToString(), info);
+            // txids are unique, so skip pushKV's per-key duplicate scan
+            o.pushKVEnd(hash.ToString(), std::move(info));
         }
         return o;
     }
@@ -466,6 +509,70 @@ UniValue mempoolToJSON(bool fVerbose)
     }
 }
 
+static void entryToCBOR(const CTxMemPoolEntry &e, CBORWriter& out) EXCLUSIVE_LOCKS_REQUIRED(::mempool.cs)
+{
+    AssertLockHeld(mempool.cs);
+
+    out.BeginMap();
+    out.Key("fees").BeginMap(4);
+    out.Key("base").WriteInt(e.GetFee());
+    out.Key("modified").WriteInt(e.GetModifiedFee());
+    out.Key("ancestor").WriteInt(e.GetModFeesWithAncestors());
+    out.Key("descendant").WriteInt(e.GetModFeesWithDescendants());
+
+    out.Key("size").WriteUInt(e.GetTxSize());
+    out.Key("time").WriteInt(e.GetTime());
+    out.Key("height").WriteUInt(e.GetHeight());
+    out.Key("descendantcount").WriteUInt(e.GetCountWithDescendants());
+    out.Key("descendantsize").WriteUInt(e.GetSizeWithDescendants());
+    out.Key("ancestorcount").WriteUInt(e.GetCountWithAncestors());
+    out.Key("ancestorsize").WriteUInt(e.GetSizeWithAncestors());
+    out.Key("wtxid").WriteHash(mempool.vTxHashes[e.vTxHashesIdx].first);
+    const CTransaction& tx = e.GetTx();
+    std::set<uint256> setDepends;
+    for (const CTxIn& txin : tx.vin)
+    {
+        if (mempool.exists(txin.prevout.hash))
+            setDepends.insert(txin.prevout.hash);
+    }
+    out.Key("depends").BeginArray(setDepends.size());
+    for (const uint256& dep : setDepends) {
+        out.WriteHash(dep);
+    }
+
+    const CTxMemPool::txiter &it = mempool.mapTx.find(tx.GetHash());
+    const CTxMemPool::setEntries &setChildren = mempool.GetMemPoolChildren(it);
+    out.Key("spentby").BeginArray(setChildren.size());
+    for (const CTxMemPool::txiter &childiter : setChildren) {
+        out.WriteHash(childiter->GetTx().GetHash());
+    }
+    out.End();
+}
+
+void mempoolToCBOR(bool fVerbose, CBORWriter& out)
+{
+    if (fVerbose)
+    {
+        LOCK(mempool.cs);
+        out.BeginMap(mempool.mapTx.size());
+        for (const CTxMemPoolEntry& e : mempool.mapTx)
+        {
+            // Map keys stay text so that the reply has the same shape as the JSON one
+            out.WriteText(e.GetTx().GetHash().ToString());
+            entryToCBOR(e, out);
+        }
+    }
+    else
+    {
+        std::vector<uint256> vtxid;
+        mempool.queryHashes(vtxid);
+
+        out.BeginArray(vtxid.size());
+        for (const uint256& hash : vtxid)
+            out.WriteHash(hash);
+    }
+}
+
 static UniValue getrawmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
@@ -1571,51 +1678,6 @@ static UniValue getchaintxstats(const JSONRPCRequest& request)
     return ret;
 }
 
-template<typename T>
-static T CalculateTruncatedMedian(std::vector<T>& scores)
-{
-    size_t size = scores.size();
-    if (size == 0) {
-        return 0;
-    }
-
-    std::sort(scores.begin(), scores.end());
-    if (size % 2 == 0) {
-        return (scores[size / 2 - 1] + scores[size / 2]) / 2;
-    } else {
-        return scores[size / 2];
-    }
-}
-
-void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight)
-{
-    if (scores.empty()) {
-        return;
-    }
-
-    std::sort(scores.begin(), scores.end());
-
-    // 10th, 25th, 50th, 75th, and 90th percentile weight units.
-    const double weights[NUM_GETBLOCKSTATS_PERCENTILES] = {
-        total_weight / 10.0, total_weight / 4.0, total_weight / 2.0, (total_weight * 3.0) / 4.0, (total_weight * 9.0) / 10.0
-    };
-
-    int64_t next_percentile_index = 0;
-    int64_t cumulative_weight = 0;
-    for (const auto& element : scores) {
-        cumulative_weight += element.second;
-        while (next_percentile_index < NUM_GETBLOCKSTATS_PERCENTILES && cumulative_weight >= weights[next_percentile_index]) {
-            result[next_percentile_index] = element.first;
-            ++next_percentile_index;
-        }
-    }
-
-    // Fill any remaining percentiles with the last value.
-    for (int64_t i = next_percentile_index; i < NUM_GETBLOCKSTATS_PERCENTILES; i++) {
-        result[i] = scores.back().first;
-    }
-}
-
 template<typename T>
 static inline bool SetHasKeys(const std::set<T>& set) {return false;}
 template<typename T, typename Tk, typename... Args>
@@ -1624,109 +1686,12 @@ static inline bool SetHasKeys(const std::set<T>& set, const Tk& key, const Args&
     return (set.count(key) != 0) || SetHasKeys(set, args...);
 }
 
-// outpoint (needed for the utxo index) + nHeight + fCoinBase
-static constexpr size_t PER_UTXO_OVERHEAD = sizeof(COutPoint) + sizeof(uint32_t) + sizeof(bool);
-
-static UniValue getblockstats(const JSONRPCRequest& request)
+/** getblockstats without the block stats index, with the spent outputs looked up in the transaction index */
+static CBlockStats GetBlockStatsFromTxIndex(const CBlockIndex* pindex, const std::set<std::string>& stats)
 {
-    if (request.fHelp || request.params.size() < 1 || request.params.size() > 4) {
-        throw std::runtime_error(
-            "getblockstats hash_or_height ( stats )\n"
-            "\nCompute per block statistics for a given window. All amounts are in satoshis.\n"
-            "It won't work for some heights with pruning.\n"
-            "It won't work without -txindex for utxo_size_inc, *fee or *feerate stats.\n"
-            "\nArguments:\n"
-            "1. \"hash_or_height\"     (string or numeric, required) The block hash or height of the target block\n"
-            "2. \"stats\"              (array,  optional) Values to plot, by default all values (see result below)\n"
-            "    [\n"
-            "      \"height\",         (string, optional) Selected statistic\n"
-            "      \"time\",           (string, optional) Selected statistic\n"
-            "      ,...\n"
-            "    ]\n"
-            "\nResult:\n"
-            "{                           (json object)\n"
-            "  \"avgfee\": xxxxx,          (numeric) Average fee in the block\n"
-            "  \"avgfeerate\": xxxxx,      (numeric) Average feerate (in satoshis per virtual byte)\n"
-            "  \"avgtxsize\": xxxxx,       (numeric) Average transaction size\n"
-            "  \"blockhash\": xxxxx,       (string) The block hash (to check for potential reorgs)\n"
-            "  \"feerate_percentiles\": [  (array of numeric) Feerates at the 10th, 25th, 50th, 75th, and 90th percentile weight unit (in satoshis per virtual byte)\n"
-            "      \"10th_percentile_feerate\",      (numeric) The 10th percentile feerate\n"
-            "      \"25th_percentile_feerate\",      (numeric) The 25th percentile feerate\n"
-            "      \"50th_percentile_feerate\",      (numeric) The 50th percentile feerate\n"
-            "      \"75th_percentile_feerate\",      (numeric) The 75th percentile feerate\n"
-            "      \"90th_percentile_feerate\",      (numeric) The 90th percentile feerate\n"
-            "  ],\n"
-            "  \"height\": xxxxx,          (numeric) The height of the block\n"
-            "  \"ins\": xxxxx,             (numeric) The number of inputs (excluding coinbase)\n"
-            "  \"maxfee\": xxxxx,          (numeric) Maximum fee in the block\n"
-            "  \"maxfeerate\": xxxxx,      (numeric) Maximum feerate (in satoshis per virtual byte)\n"
-            "  \"maxtxsize\": xxxxx,       (numeric) Maximum transaction size\n"
-            "  \"medianfee\": xxxxx,       (numeric) Truncated median fee in the block\n"
-            "  \"mediantime\": xxxxx,      (numeric) The block median time past\n"
-            "  \"mediantxsize\": xxxxx,    (numeric) Truncated median transaction size\n"
-            "  \"minfee\": xxxxx,          (numeric) Minimum fee in the block\n"
-            "  \"minfeerate\": xxxxx,      (numeric) Minimum feerate (in satoshis per virtual byte)\n"
-            "  \"mintxsize\": xxxxx,       (numeric) Minimum transaction size\n"
-            "  \"outs\": xxxxx,            (numeric) The number of outputs\n"
-            "  \"subsidy\": xxxxx,         (numeric) The block subsidy\n"
-            "  \"swtotal_size\": xxxxx,    (numeric) Total size of all segwit transactions\n"
-            "  \"swtotal_weight\": xxxxx,  (numeric) Total weight of all segwit transactions divided by segwit scale factor (4)\n"
-            "  \"swtxs\": xxxxx,           (numeric) The number of segwit transactions\n"
-            "  \"time\": xxxxx,            (numeric) The block time\n"
-            "  \"total_out\": xxxxx,       (numeric) Total amount in all outputs (excluding coinbase and thus reward [ie subsidy + totalfee])\n"
-            "  \"total_size\": xxxxx,      (numeric) Total size of all non-coinbase transactions\n"
-            "  \"total_weight\": xxxxx,    (numeric) Total weight of all non-coinbase transactions divided by segwit scale factor (4)\n"
-            "  \"totalfee\": xxxxx,        (numeric) The fee total\n"
-            "  \"txs\": xxxxx,             (numeric) The number of transactions (excluding coinbase)\n"
-            "  \"utxo_increase\": xxxxx,   (numeric) The increase/decrease in the number of unspent outputs\n"
-            "  \"utxo_size_inc\": xxxxx,   (numeric) The increase/decrease in size for the utxo index (not discounting op_return and similar)\n"
-            "}\n"
-            "\nExamples:\n"
-            + HelpExampleCli("getblockstats", "1000 '[\"minfeerate\",\"avgfeerate\"]'")
-            + HelpExampleRpc("getblockstats", "1000 '[\"minfeerate\",\"avgfeerate\"]'")
-        );
-    }
-
-    LOCK(cs_main);
-
-    CBlockIndex* pindex;
-    if (request.params[0].isNum()) {
-        const int height = request.params[0].get_int();
-        const int current_tip = chainActive.Height();
-        if (height < 0) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d is negative", height));
-        }
-        if (height > current_tip) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d after current tip %d", height, current_tip));
-        }
-
-        pindex = chainActive[height];
-    } else {
-        const std::string strHash = request.params[0].get_str();
-        const uint256 hash(uint256S(strHash));
-        pindex = LookupBlockIndex(hash);
-        if (!pindex) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-        }
-        if (!chainActive.Contains(pindex)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Block is not in chain %s", Params().NetworkIDString()));
-        }
-    }
-
-    assert(pindex != nullptr);
-
-    std::set<std::string> stats;
-    if (!request.params[1].isNull()) {
-        const UniValue stats_univalue = request.params[1].get_array();
-        for (unsigned int i = 0; i < stats_univalue.size(); i++) {
-            const std::string stat = stats_univalue[i].get_str();
-            stats.insert(stat);
-        }
-    }
-
     const CBlock block = GetBlockChecked(pindex);
 
-    const bool do_all = stats.size() == 0; // Calculate everything if nothing selected (default)
+    const bool do_all = stats.empty(); // Calculate everything if nothing selected (default)
     const bool do_mediantxsize = do_all || stats.count("mediantxsize") != 0;
     const bool do_medianfee = do_all || stats.count("medianfee") != 0;
     const bool do_feerate_percentiles = do_all || stats.count("feerate_percentiles") != 0;
@@ -1834,46 +1799,89 @@ static UniValue getblockstats(const JSONRPCRequest& request)
         }
     }
 
-    CAmount feerate_percentiles[NUM_GETBLOCKSTATS_PERCENTILES] = { 0 };
-    CalculatePercentilesByWeight(feerate_percentiles, feerate_array, total_weight);
+    CBlockStats blockstats;
+    blockstats.hashBlock = pindex->GetBlockHash();
+    blockstats.nTxs = block.vtx.size();
+    blockstats.nIns = inputs;
+    blockstats.nOuts = outputs;
+    blockstats.nTotalOut = total_out;
+    blockstats.nTotalFee = totalfee;
+    blockstats.nMinFee = (minfee == MAX_MONEY) ? 0 : minfee;
+    blockstats.nMaxFee = maxfee;
+    blockstats.nMedianFee = CalculateTruncatedMedian(fee_array);
+    blockstats.nMinFeeRate = (minfeerate == MAX_MONEY) ? 0 : minfeerate;
+    blockstats.nMaxFeeRate = maxfeerate;
+    CalculatePercentilesByWeight(blockstats.vFeeRatePercentiles, feerate_array, total_weight);
+    blockstats.nTotalSize = total_size;
+    blockstats.nMinTxSize = mintxsize == MAX_BLOCK_SERIALIZED_SIZE ? 0 : mintxsize;
+    blockstats.nMaxTxSize = maxtxsize;
+    blockstats.nMedianTxSize = CalculateTruncatedMedian(txsize_array);
+    blockstats.nTotalWeight = total_weight;
+    blockstats.nSwTxs = swtxs;
+    blockstats.nSwTotalSize = swtotal_size;
+    blockstats.nSwTotalWeight = swtotal_weight;
+    blockstats.nUtxoSizeInc = utxo_size_inc;
+    return blockstats;
+}
 
+static UniValue BlockStatsToJSON(const CBlockStats& blockstats, const CBlockIndex* pindex)
+{
     UniValue feerates_res(UniValue::VARR);
     for (int64_t i = 0; i < NUM_GETBLOCKSTATS_PERCENTILES; i++) {
-        feerates_res.push_back(feerate_percentiles[i]);
+        feerates_res.push_back(blockstats.vFeeRatePercentiles[i]);
     }
 
+    const int64_t txs = blockstats.nTxs;
     UniValue ret_all(UniValue::VOBJ);
-    ret_all.pushKV("avgfee", (block.vtx.size() > 1) ? totalfee / (block.vtx.size() - 1) : 0);
-    ret_all.pushKV("avgfeerate", total_weight ? (totalfee * WITNESS_SCALE_FACTOR) / total_weight : 0); // Unit: sat/vbyte
-    ret_all.pushKV("avgtxsize", (block.vtx.size() > 1) ? total_size / (block.vtx.size() - 1) : 0);
+    ret_all.pushKV("avgfee", (txs > 1) ? blockstats.nTotalFee / (txs - 1) : 0);
+    ret_all.pushKV("avgfeerate", blockstats.nTotalWeight ? (blockstats.nTotalFee * WITNESS_SCALE_FACTOR) / blockstats.nTotalWeight : 0); // Unit: sat/vbyte
+    ret_all.pushKV("avgtxsize", (txs > 1) ? blockstats.nTotalSize / (txs - 1) : 0);
     ret_all.pushKV("blockhash", pindex->GetBlockHash().GetHex());
     ret_all.pushKV("feerate_percentiles", feerates_res);
     ret_all.pushKV("height", (int64_t)pindex->nHeight);
-    ret_all.pushKV("ins", inputs);
-    ret_all.pushKV("maxfee", maxfee);
-    ret_all.pushKV("maxfeerate", maxfeerate);
-    ret_all.pushKV("maxtxsize", maxtxsize);
-    ret_all.pushKV("medianfee", CalculateTruncatedMedian(fee_array));
+    ret_all.pushKV("ins", blockstats.nIns);
+    ret_all.pushKV("maxfee", blockstats.nMaxFee);
+    ret_all.pushKV("maxfeerate", blockstats.nMaxFeeRate);
+    ret_all.pushKV("maxtxsize", blockstats.nMaxTxSize);
+    ret_all.pushKV("medianfee", blockstats.nMedianFee);
     ret_all.pushKV("mediantime", pindex->GetMedianTimePast());
-    ret_all.pushKV("mediantxsize", CalculateTruncatedMedian(txsize_array));
-    ret_all.pushKV("minfee", (minfee == MAX_MONEY) ? 0 : minfee);
-    ret_all.pushKV("minfeerate", (minfeerate == MAX_MONEY) ? 0 : minfeerate);
-    ret_all.pushKV("mintxsize", mintxsize == MAX_BLOCK_SERIALIZED_SIZE ? 0 : mintxsize);
-    ret_all.pushKV("outs", outputs);
+    ret_all.pushKV("mediantxsize", blockstats.nMedianTxSize);
+    ret_all.pushKV("minfee", blockstats.nMinFee);
+    ret_all.pushKV("minfeerate", blockstats.nMinFeeRate);
+    ret_all.pushKV("mintxsize", blockstats.nMinTxSize);
+    ret_all.pushKV("outs", blockstats.nOuts);
     ret_all.pushKV("subsidy", GetBlockSubsidy(pindex->nHeight, Params().GetConsensus()));
-    ret_all.pushKV("swtotal_size", swtotal_size);
-    ret_all.pushKV("swtotal_weight", swtotal_weight);
-    ret_all.pushKV("swtxs", swtxs);
+    ret_all.pushKV("swtotal_size", blockstats.nSwTotalSize);
+    ret_all.pushKV("swtotal_weight", blockstats.nSwTotalWeight);
+    ret_all.pushKV("swtxs", blockstats.nSwTxs);
     ret_all.pushKV("time", pindex->GetBlockTime());
-    ret_all.pushKV("total_out", total_out);
-    ret_all.pushKV("total_size", total_size);
-    ret_all.pushKV("total_weight", total_weight);
-    ret_all.pushKV("totalfee", totalfee);
-    ret_all.pushKV("txs", (int64_t)block.vtx.size());
-    ret_all.pushKV("utxo_increase", outputs - inputs);
-    ret_all.pushKV("utxo_size_inc", utxo_size_inc);
-
-    if (do_all) {
+    ret_all.pushKV("total_out", blockstats.nTotalOut);
+    ret_all.pushKV("total_size", blockstats.nTotalSize);
+    ret_all.pushKV("total_weight", blockstats.nTotalWeight);
+    ret_all.pushKV("totalfee", blockstats.nTotalFee);
+    ret_all.pushKV("txs", txs);
+    ret_all.pushKV("utxo_increase", blockstats.nOuts - blockstats.nIns);
+    ret_all.pushKV("utxo_size_inc", blockstats.nUtxoSizeInc);
+    return ret_all;
+}
+
+static std::set<std::string> ParseBlockStats(const UniValue& param)
+{
+    std::set<std::string> stats;
+    if (!param.isNull()) {
+        const UniValue stats_univalue = param.get_array();
+        for (unsigned int i = 0; i < stats_univalue.size(); i++) {
+            const std::string stat = stats_univalue[i].get_str();
+            stats.insert(stat);
+        }
+    }
+    return stats;
+}
+
+/** Keep the requested stats of a getblockstats result */
+static UniValue SelectBlockStats(const UniValue& ret_all, const std::set<std::string>& stats)
+{
+    if (stats.empty()) {
         return ret_all;
     }
 
@@ -1888,6 +1896,174 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue getblockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 4) {
+        throw std::runtime_error(
+            "getblockstats hash_or_height ( stats )\n"
+            "\nCompute per block statistics for a given window. All amounts are in satoshis.\n"
+            "It won't work for some heights with pruning.\n"
+            "It won't work without -txindex for utxo_size_inc, *fee or *feerate stats.\n"
+            "With -blockstatsindex the stats are read from the index, also for pruned heights.\n"
+            "\nArguments:\n"
+            "1. \"hash_or_height\"     (string or numeric, required) The block hash or height of the target block\n"
+            "2. \"stats\"              (array,  optional) Values to plot, by default all values (see result below)\n"
+            "    [\n"
+            "      \"height\",         (string, optional) Selected statistic\n"
+            "      \"time\",           (string, optional) Selected statistic\n"
+            "      ,...\n"
+            "    ]\n"
+            "\nResult:\n"
+            "{                           (json object)\n"
+            "  \"avgfee\": xxxxx,          (numeric) Average fee in the block\n"
+            "  \"avgfeerate\": xxxxx,      (numeric) Average feerate (in satoshis per virtual byte)\n"
+            "  \"avgtxsize\": xxxxx,       (numeric) Average transaction size\n"
+            "  \"blockhash\": xxxxx,       (string) The block hash (to check for potential reorgs)\n"
+            "  \"feerate_percentiles\": [  (array of numeric) Feerates at the 10th, 25th, 50th, 75th, and 90th percentile weight unit (in satoshis per virtual byte)\n"
+            "      \"10th_percentile_feerate\",      (numeric) The 10th percentile feerate\n"
+            "      \"25th_percentile_feerate\",      (numeric) The 25th percentile feerate\n"
+            "      \"50th_percentile_feerate\",      (numeric) The 50th percentile feerate\n"
+            "      \"75th_percentile_feerate\",      (numeric) The 75th percentile feerate\n"
+            "      \"90th_percentile_feerate\",      (numeric) The 90th percentile feerate\n"
+            "  ],\n"
+            "  \"height\": xxxxx,          (numeric) The height of the block\n"
+            "  \"ins\": xxxxx,             (numeric) The number of inputs (excluding coinbase)\n"
+            "  \"maxfee\": xxxxx,          (numeric) Maximum fee in the block\n"
+            "  \"maxfeerate\": xxxxx,      (numeric) Maximum feerate (in satoshis per virtual byte)\n"
+            "  \"maxtxsize\": xxxxx,       (numeric) Maximum transaction size\n"
+            "  \"medianfee\": xxxxx,       (numeric) Truncated median fee in the block\n"
+            "  \"mediantime\": xxxxx,      (numeric) The block median time past\n"
+            "  \"mediantxsize\": xxxxx,    (numeric) Truncated median transaction size\n"
+            "  \"minfee\": xxxxx,          (numeric) Minimum fee in the block\n"
+            "  \"minfeerate\": xxxxx,      (numeric) Minimum feerate (in satoshis per virtual byte)\n"
+            "  \"mintxsize\": xxxxx,       (numeric) Minimum transaction size\n"
+            "  \"outs\": xxxxx,            (numeric) The number of outputs\n"
+            "  \"subsidy\": xxxxx,         (numeric) The block subsidy\n"
+            "  \"swtotal_size\": xxxxx,    (numeric) Total size of all segwit transactions\n"
+            "  \"swtotal_weight\": xxxxx,  (numeric) Total weight of all segwit transactions divided by segwit scale factor (4)\n"
+            "  \"swtxs\": xxxxx,           (numeric) The number of segwit transactions\n"
+            "  \"time\": xxxxx,            (numeric) The block time\n"
+            "  \"total_out\": xxxxx,       (numeric) Total amount in all outputs (excluding coinbase and thus reward [ie subsidy + totalfee])\n"
+            "  \"total_size\": xxxxx,      (numeric) Total size of all non-coinbase transactions\n"
+            "  \"total_weight\": xxxxx,    (numeric) Total weight of all non-coinbase transactions divided by segwit scale factor (4)\n"
+            "  \"totalfee\": xxxxx,        (numeric) The fee total\n"
+            "  \"txs\": xxxxx,             (numeric) The number of transactions (excluding coinbase)\n"
+            "  \"utxo_increase\": xxxxx,   (numeric) The increase/decrease in the number of unspent outputs\n"
+            "  \"utxo_size_inc\": xxxxx,   (numeric) The increase/decrease in size for the utxo index (not discounting op_return and similar)\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockstats", "1000 '[\"minfeerate\",\"avgfeerate\"]'")
+            + HelpExampleRpc("getblockstats", "1000 '[\"minfeerate\",\"avgfeerate\"]'")
+        );
+    }
+
+    LOCK(cs_main);
+
+    CBlockIndex* pindex;
+    if (request.params[0].isNum()) {
+        const int height = request.params[0].get_int();
+        const int current_tip = chainActive.Height();
+        if (height < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d is negative", height));
+        }
+        if (height > current_tip) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d after current tip %d", height, current_tip));
+        }
+
+        pindex = chainActive[height];
+    } else {
+        const std::string strHash = request.params[0].get_str();
+        const uint256 hash(uint256S(strHash));
+        pindex = LookupBlockIndex(hash);
+        if (!pindex) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        if (!chainActive.Contains(pindex)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Block is not in chain %s", Params().NetworkIDString()));
+        }
+    }
+
+    assert(pindex != nullptr);
+
+    const std::set<std::string> stats = ParseBlockStats(request.params[1]);
+
+    // The block stats index has everything at once, and for blocks whose
+    // undo data is gone
+    CBlockStats blockstats;
+    if (!fBlockStatsIndex || !pblockstatsindex->Read(pindex->nHeight, blockstats) || blockstats.hashBlock != pindex->GetBlockHash()) {
+        blockstats = GetBlockStatsFromTxIndex(pindex, stats);
+    }
+    return SelectBlockStats(BlockStatsToJSON(blockstats, pindex), stats);
+}
+
+//! Heights getblockstatsrange returns at most, it holds cs_main throughout
+//! and reads blocks whose stats are missing from disk
+static const int MAX_BLOCK_STATS_RANGE = 1000;
+
+static UniValue getblockstatsrange(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 3) {
+        throw std::runtime_error(
+            "getblockstatsrange start_height end_height ( stats )\n"
+            "\nReturn getblockstats results for a range of active chain heights, read from the block stats index.\n"
+            "Requires -blockstatsindex. Amounts are in satoshis. At most " + std::to_string(MAX_BLOCK_STATS_RANGE) + " heights are returned at once.\n"
+            "\nArguments:\n"
+            "1. start_height           (numeric, required) The height of the first block\n"
+            "2. end_height             (numeric, required) The height of the last block\n"
+            "3. \"stats\"              (array,  optional) Values to return, by default all values (see getblockstats)\n"
+            "\nResult:\n"
+            "[                           (json array) The stats of each block, lowest height first\n"
+            "  {...},                    (json object) As returned by getblockstats\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockstatsrange", "1000 1999 '[\"height\",\"totalfee\"]'")
+            + HelpExampleRpc("getblockstatsrange", "1000, 1999, [\"height\",\"totalfee\"]")
+        );
+    }
+
+    if (!fBlockStatsIndex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block stats index not enabled (use -blockstatsindex)");
+    }
+
+    LOCK(cs_main);
+
+    const int start_height = request.params[0].get_int();
+    const int end_height = request.params[1].get_int();
+    if (start_height < 0 || start_height > end_height) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid height range %d to %d", start_height, end_height));
+    }
+    if (end_height - start_height >= MAX_BLOCK_STATS_RANGE) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Height range %d to %d is larger than %d blocks", start_height, end_height, MAX_BLOCK_STATS_RANGE));
+    }
+    if (end_height > chainActive.Height()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d after current tip %d", end_height, chainActive.Height()));
+    }
+    const std::set<std::string> stats = ParseBlockStats(request.params[2]);
+
+    std::vector<CBlockStats> vstats;
+    if (!pblockstatsindex->ReadRange(start_height, end_height, vstats)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the block stats index");
+    }
+
+    // Walk the range down from its end, a lookup by height would search from the tip each time
+    std::vector<const CBlockIndex*> vindex(end_height - start_height + 1);
+    const CBlockIndex* pindex = chainActive[end_height];
+    for (size_t i = vindex.size(); i-- > 0; pindex = pindex->pprev) {
+        vindex[i] = pindex;
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (size_t i = 0; i < vindex.size(); i++) {
+        // The genesis block is never connected, so it has no entry
+        if (vstats[i].hashBlock != vindex[i]->GetBlockHash()) {
+            vstats[i] = GetBlockStatsFromTxIndex(vindex[i], stats);
+        }
+        ret.push_back(SelectBlockStats(BlockStatsToJSON(vstats[i], vindex[i]), stats));
+    }
+    return ret;
+}
+
 static UniValue savemempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0) {
@@ -2156,6 +2332,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {} },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
     { "blockchain",         "getblockstats",          &getblockstats,          {"hash_or_height", "stats"} },
+    { "blockchain",         "getblockstatsrange",     &getblockstatsrange,     {"start_height", "end_height", "stats"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
@@ -8,13 +8,13 @@
 #include <vector>
 #include <stdint.h>
 #include <amount.h>
+#include <blockstats.h>
 
 class CBlock;
+class CBORWriter;
 class CBlockIndex;
 class UniValue;
 
-static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
-
 /**
  * Get the difficulty of the net wrt to the given block index, or the chain tip if
  * not provided.
@@ -30,16 +30,19 @@ void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 /** Block description to JSON */
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
 
+/** Block description to CBOR, written directly without an intermediate UniValue */
+void blockToCBOR(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, CBORWriter& out);
+
 /** Mempool information to JSON */
 UniValue mempoolInfoToJSON();
 
 /** Mempool to JSON */
 UniValue mempoolToJSON(bool fVerbose = false);
 
+/** Mempool to CBOR. The deprecated duplicate fee fields of the JSON entries are left out. */
+void mempoolToCBOR(bool fVerbose, CBORWriter& out);
+
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
-/** Used by getblockstats to get feerates at different percentiles by weight  */
-void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight);
-
 #endif
@@ -21,6 +21,7 @@
 #include <timedata.h>
 #include <util.h>
 #include <utilstrencodings.h>
+#include <validationinterface.h>
 #ifdef ENABLE_WALLET
 #include <wallet/rpcwallet.h>
 #include <wallet/wallet.h>
@@ -336,7 +337,7 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
     for (auto& it : info.data) {
         UniValue output(UniValue::VOBJ);
         output.pushKV("address", it.first.GetAddr());
-        output.pushKV("script", HexStr(it.first.script.begin(), it.first.script.end()));
+        output.pushKV("script", HexStr(it.first.script.GetScript()));
         if (it.second.iscoinbase) output.pushKV("coinbase", "true");
         output.pushKV("value", ValueFromAmount(it.second.value));
         output.pushKV("from", strprintf("[%d] %s:%d", it.second.height, it.first.out.hash.ToString(), it.first.out.n));
@@ -363,6 +364,20 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCBlockIndexMemoryInfo()
+{
+    LOCK(cs_main);
+    const BlockIndexMemoryStats stats = GetBlockIndexMemoryStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("entries", uint64_t(stats.nEntries));
+    obj.pushKV("active", uint64_t(stats.nActiveEntries));
+    obj.pushKV("side", uint64_t(stats.nEntries - stats.nActiveEntries));
+    obj.pushKV("entry_bytes", uint64_t(stats.nEntryBytes));
+    obj.pushKV("map_bytes", uint64_t(stats.nMapBytes));
+    obj.pushKV("pending_merkle_roots", uint64_t(stats.nPendingMerkleRoots));
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -404,6 +419,14 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"blockindex\": {           (json object) Information about the block index\n"
+            "    \"entries\": xxxxx,       (numeric) Number of block index entries\n"
+            "    \"active\": xxxxx,        (numeric) Number of entries in the active chain\n"
+            "    \"side\": xxxxx,          (numeric) Number of entries on side branches or not connected yet\n"
+            "    \"entry_bytes\": xxxxx,   (numeric) Bytes allocated for the entries\n"
+            "    \"map_bytes\": xxxxx,     (numeric) Bytes used by the hash map of the entries\n"
+            "    \"pending_merkle_roots\": xxxxx, (numeric) Merkle roots kept in memory until their entries are written\n"
             "  }\n"
             "}\n"
             "\nResult (mode \"mallocinfo\"):\n"
@@ -417,6 +440,7 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        obj.pushKV("blockindex", RPCBlockIndexMemoryInfo());
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -449,9 +473,9 @@ static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
 
 UniValue logging(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() > 2) {
+    if (request.fHelp || request.params.size() > 3) {
         throw std::runtime_error(
-            "logging ( <include> <exclude> )\n"
+            "logging ( <include> <exclude> verbose )\n"
             "Gets and sets the logging configuration.\n"
             "When called without an argument, returns the list of categories with status that are currently being debug logged or not.\n"
             "When called with arguments, adds or removes categories from debug logging and return the lists above.\n"
@@ -472,11 +496,26 @@ UniValue logging(const JSONRPCRequest& request)
             "       \"category\"   (string) the valid logging category\n"
             "       ,...\n"
             "     ]\n"
+            "3. verbose          (boolean, optional, default=false) Also return rate limits and drop counters\n"
             "\nResult:\n"
             "{                   (json object where keys are the logging categories, and values indicates its status\n"
             "  \"category\": 0|1,  (numeric) if being debug logged or not. 0:inactive, 1:active\n"
             "  ...\n"
             "}\n"
+            "\nResult (verbose):\n"
+            "{\n"
+            "  \"categories\": {\n"
+            "    \"category\": {\n"
+            "      \"active\": true|false,  (boolean) if being debug logged or not\n"
+            "      \"ratelimit\": n,        (numeric) messages allowed per second, 0 = unlimited\n"
+            "      \"suppressed\": n        (numeric) messages suppressed by the rate limit\n"
+            "    },\n"
+            "    ...\n"
+            "  },\n"
+            "  \"async\": true|false,      (boolean) if the log is written from a background thread\n"
+            "  \"queued\": n,              (numeric) messages waiting to be written\n"
+            "  \"dropped\": n              (numeric) debug messages dropped because the writer fell behind\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("logging", "\"[\\\"all\\\"]\" \"[\\\"http\\\"]\"")
             + HelpExampleRpc("logging", "[\"all\"], \"[libevent]\"")
@@ -507,12 +546,30 @@ UniValue logging(const JSONRPCRequest& request)
         }
     }
 
+    const bool fVerbose = !request.params[2].isNull() && request.params[2].get_bool();
+
     UniValue result(UniValue::VOBJ);
     std::vector<CLogCategoryActive> vLogCatActive = ListActiveLogCategories();
     for (const auto& logCatActive : vLogCatActive) {
-        result.pushKV(logCatActive.category, logCatActive.active);
+        if (fVerbose) {
+            UniValue category(UniValue::VOBJ);
+            category.pushKV("active", logCatActive.active);
+            category.pushKV("ratelimit", (uint64_t)logCatActive.rate_limit);
+            category.pushKV("suppressed", logCatActive.suppressed);
+            result.pushKV(logCatActive.category, category);
+        } else {
+            result.pushKV(logCatActive.category, logCatActive.active);
+        }
     }
 
+    if (fVerbose) {
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("categories", result);
+        ret.pushKV("async", g_logger->IsAsync());
+        ret.pushKV("queued", (uint64_t)g_logger->GetQueued());
+        ret.pushKV("dropped", g_logger->GetDropped());
+        return ret;
+    }
     return result;
 }
 
@@ -529,6 +586,87 @@ static UniValue echo(const JSONRPCRequest& request)
     return request.params;
 }
 
+static UniValue gethttpqueueinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "gethttpqueueinfo\n"
+            "Returns the state of the HTTP work queue of each endpoint class.\n"
+            "Classes are \"rpc\" (JSON-RPC on /), \"wallet\" (JSON-RPC on /wallet/<name>) and \"rest\" (REST and /api/).\n"
+            "Each class has its own worker threads and queue depth limit.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"class\": {              (json object) One entry per endpoint class\n"
+            "    \"threads\": n,         (numeric) Number of worker threads\n"
+            "    \"depth\": n,           (numeric) Number of requests currently queued\n"
+            "    \"maxdepth\": n,        (numeric) Queue depth limit\n"
+            "    \"processed\": n,       (numeric) Number of requests handled\n"
+            "    \"rejected\": n,        (numeric) Number of requests rejected because the queue was full\n"
+            "    \"avgwait_us\": n,      (numeric) Average time handled requests spent queued, in microseconds\n"
+            "    \"maxwait_us\": n,      (numeric) Longest time a handled request spent queued, in microseconds\n"
+            "    \"avgrun_us\": n,       (numeric) Average time spent in the handler, in microseconds\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("gethttpqueueinfo", "")
+            + HelpExampleRpc("gethttpqueueinfo", "")
+        );
+
+    UniValue result(UniValue::VOBJ);
+    for (const HTTPWorkQueueStats& stats : GetHTTPWorkQueueStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("threads", stats.threads);
+        obj.pushKV("depth", (uint64_t)stats.depth);
+        obj.pushKV("maxdepth", (uint64_t)stats.max_depth);
+        obj.pushKV("processed", stats.processed);
+        obj.pushKV("rejected", stats.rejected);
+        obj.pushKV("avgwait_us", stats.processed ? stats.total_wait_us / (int64_t)stats.processed : 0);
+        obj.pushKV("maxwait_us", stats.max_wait_us);
+        obj.pushKV("avgrun_us", stats.processed ? stats.total_run_us / (int64_t)stats.processed : 0);
+        result.pushKV(stats.name, std::move(obj));
+    }
+    return result;
+}
+
+static UniValue getvalidationqueueinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getvalidationqueueinfo\n"
+            "Returns the state of the validation notification queue of each subscriber (wallets, ZMQ, peer logic, ...).\n"
+            "Each subscriber processes its notifications in order, independently of the others.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",        (string) Subscriber\n"
+            "    \"policy\": \"xxxx\",      (string) \"wait\" if block connection waits for the subscriber to catch up, \"nowait\" otherwise\n"
+            "    \"pending\": n,           (numeric) Number of notifications queued\n"
+            "    \"maxpending\": n,        (numeric) Highest number of notifications queued at once\n"
+            "    \"processed\": n,         (numeric) Number of notifications handled\n"
+            "    \"avgrun_us\": n,         (numeric) Average time spent handling a notification, in microseconds\n"
+            "    \"maxrun_us\": n,         (numeric) Longest time spent handling a notification, in microseconds\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getvalidationqueueinfo", "")
+            + HelpExampleRpc("getvalidationqueueinfo", "")
+        );
+
+    UniValue result(UniValue::VARR);
+    for (const ValidationInterfaceStats& stats : GetValidationInterfaceStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("policy", stats.policy == ValidationQueuePolicy::WAIT ? "wait" : "nowait");
+        obj.pushKV("pending", (uint64_t)stats.pending);
+        obj.pushKV("maxpending", (uint64_t)stats.max_pending);
+        obj.pushKV("processed", stats.processed);
+        obj.pushKV("avgrun_us", stats.processed ? stats.total_run_us / (int64_t)stats.processed : 0);
+        obj.pushKV("maxrun_us", stats.max_run_us);
+        result.push_back(std::move(obj));
+    }
+    return result;
+}
+
 static UniValue getinfo_deprecated(const JSONRPCRequest& request)
 {
     throw JSONRPCError(RPC_METHOD_NOT_FOUND,
@@ -545,7 +683,9 @@ static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
-    { "control",            "logging",                &logging,                {"include", "exclude"}},
+    { "control",            "logging",                &logging,                {"include", "exclude", "verbose"}},
+    { "control",            "gethttpqueueinfo",       &gethttpqueueinfo,       {} },
+    { "control",            "getvalidationqueueinfo", &getvalidationqueueinfo, {} },
     { "util",               "validateaddress",        &validateaddress,        {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys","address_type"} },
     { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
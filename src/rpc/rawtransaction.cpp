@@ -28,9 +28,9 @@
 #include <utilstrencodings.h>
 #ifdef ENABLE_WALLET
 #include <wallet/rpcwallet.h>
+#include <wallet/wallet.h>
 #endif
 
-#include <future>
 #include <stdint.h>
 
 #include <univalue.h>
@@ -1096,8 +1096,6 @@ static UniValue sendrawtransaction(const JSONRPCRequest& request)
             + HelpExampleRpc("sendrawtransaction", "\"signedhex\"")
         );
 
-    std::promise<void> promise;
-
     RPCTypeCheck(request.params, {UniValue::VSTR, UniValue::VBOOL});
 
     // parse hex string from parameter
@@ -1111,6 +1109,7 @@ static UniValue sendrawtransaction(const JSONRPCRequest& request)
     if (!request.params[1].isNull() && request.params[1].get_bool())
         nMaxRawTxFee = 0;
 
+    bool fSyncWallets = false;
     { // cs_main scope
     LOCK(cs_main);
     CCoinsViewCache &view = *pcoinsTip;
@@ -1140,21 +1139,23 @@ static UniValue sendrawtransaction(const JSONRPCRequest& request)
             // where a user might call sendrawtransaction with a transaction
             // to/from their wallet, immediately call some wallet RPC, and get
             // a stale result because callbacks have not yet been processed.
-            CallFunctionInValidationInterfaceQueue([&promise] {
-                promise.set_value();
-            });
+            // Only the wallets' queues are waited for, other subscribers
+            // such as ZMQ do not hold up the submission.
+            fSyncWallets = true;
         }
     } else if (fHaveChain) {
         throw JSONRPCError(RPC_TRANSACTION_ALREADY_IN_CHAIN, "transaction already in block chain");
-    } else {
-        // Make sure we don't block forever if re-sending
-        // a transaction already in mempool.
-        promise.set_value();
     }
 
     } // cs_main
 
-    promise.get_future().wait();
+    if (fSyncWallets) {
+#ifdef ENABLE_WALLET
+        for (const std::shared_ptr<CWallet>& pwallet : GetWallets()) {
+            SyncWithValidationInterfaceQueue(pwallet.get());
+        }
+#endif
+    }
 
     if(!g_connman)
         throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
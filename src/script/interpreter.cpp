@@ -10,6 +10,7 @@
 #include <crypto/sha256.h>
 #include <pubkey.h>
 #include <script/script.h>
+#include <streams.h>
 #include <uint256.h>
 
 typedef std::vector<unsigned char> valtype;
@@ -1182,6 +1183,100 @@ public:
     }
 };
 
+//! Serialized size of an input with a blank script: prevout, empty script and sequence
+static const size_t LEGACY_SIGHASH_INPUT_SIZE = 36 + 1 + 4;
+
+/** Offset of an input in PrecomputedLegacySigHash::inputs, after the version and input count */
+size_t LegacyInputOffset(size_t nInputs, size_t nInput)
+{
+    return 4 + GetSizeOfCompactSize(nInputs) + nInput * LEGACY_SIGHASH_INPUT_SIZE;
+}
+
+template <class T>
+void PrecomputeLegacySigHash(const T& txTo, PrecomputedLegacySigHash& data)
+{
+    const size_t nInputs = txTo.vin.size();
+    for (int variant = 0; variant < 2; variant++) {
+        std::vector<unsigned char>& inputs = data.inputs[variant];
+        inputs.reserve(LegacyInputOffset(nInputs, nInputs));
+        CVectorWriter writer(SER_GETHASH, 0, inputs, 0);
+        writer << txTo.nVersion;
+        WriteCompactSize(writer, nInputs);
+        for (const CTxIn& txin : txTo.vin) {
+            writer << txin.prevout << CScript() << (variant == 0 ? txin.nSequence : 0U);
+        }
+
+        CHash256 hasher;
+        size_t nPos = 0;
+        for (size_t nInput = 0; nInput < nInputs; nInput += LEGACY_SIGHASH_CHECKPOINT_INPUTS) {
+            const size_t nEnd = LegacyInputOffset(nInputs, nInput);
+            hasher.Write(inputs.data() + nPos, nEnd - nPos);
+            nPos = nEnd;
+            data.midstates[variant].push_back(hasher);
+        }
+    }
+    CVectorWriter(SER_GETHASH, 0, data.outputs, 0) << txTo.vout;
+}
+
+/** The precomputed legacy signature hash parts of txTo, built on first use */
+template <class T>
+std::shared_ptr<const PrecomputedLegacySigHash> GetLegacySigHash(const T& txTo, const PrecomputedTransactionData& cache)
+{
+    std::shared_ptr<const PrecomputedLegacySigHash> legacy = std::atomic_load(&cache.legacy);
+    if (!legacy) {
+        std::shared_ptr<PrecomputedLegacySigHash> computed = std::make_shared<PrecomputedLegacySigHash>();
+        PrecomputeLegacySigHash(txTo, *computed);
+        // Another script check of the same transaction may have been faster,
+        // then legacy is set to its result
+        if (std::atomic_compare_exchange_strong(&cache.legacy, &legacy, std::shared_ptr<const PrecomputedLegacySigHash>(computed))) {
+            legacy = computed;
+        }
+    }
+    return legacy;
+}
+
+/**
+ * The legacy signature hash from the precomputed parts of the transaction.
+ * Only the bytes between the closest hash state and the end of the
+ * transaction are hashed, from contiguous buffers. Not for
+ * SIGHASH_ANYONECANPAY, or SIGHASH_SINGLE without a matching output.
+ */
+template <class T>
+uint256 LegacySignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn, int nHashType, const PrecomputedLegacySigHash& cache)
+{
+    const bool fHashSingle = (nHashType & 0x1f) == SIGHASH_SINGLE;
+    const bool fHashNone = (nHashType & 0x1f) == SIGHASH_NONE;
+    const int variant = (fHashSingle || fHashNone) ? 1 : 0;
+    const std::vector<unsigned char>& inputs = cache.inputs[variant];
+    const size_t nInputs = txTo.vin.size();
+
+    // The inputs before the one being signed, from the last hash state before it
+    const size_t nCheckpoint = nIn / LEGACY_SIGHASH_CHECKPOINT_INPUTS;
+    CHashWriter ss(SER_GETHASH, 0, cache.midstates[variant][nCheckpoint]);
+    const size_t nBegin = LegacyInputOffset(nInputs, nCheckpoint * LEGACY_SIGHASH_CHECKPOINT_INPUTS);
+    const size_t nInput = LegacyInputOffset(nInputs, nIn);
+    ss.write((const char*)inputs.data() + nBegin, nInput - nBegin);
+    // The input being signed keeps its sequence and gets the script code
+    ss << txTo.vin[nIn].prevout;
+    CTransactionSignatureSerializer<T>(txTo, scriptCode, nIn, nHashType).SerializeScriptCode(ss);
+    ss << txTo.vin[nIn].nSequence;
+    const size_t nNext = LegacyInputOffset(nInputs, nIn + 1);
+    ss.write((const char*)inputs.data() + nNext, inputs.size() - nNext);
+
+    if (fHashNone) {
+        WriteCompactSize(ss, 0);
+    } else if (fHashSingle) {
+        WriteCompactSize(ss, nIn + 1);
+        for (unsigned int nOutput = 0; nOutput < nIn; nOutput++)
+            ss << CTxOut();
+        ss << txTo.vout[nIn];
+    } else {
+        ss.write((const char*)cache.outputs.data(), cache.outputs.size());
+    }
+    ss << txTo.nLockTime << nHashType;
+    return ss.GetHash();
+}
+
 template <class T>
 uint256 GetPrevoutHash(const T& txTo)
 {
@@ -1291,6 +1386,14 @@ uint256 SignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn
         }
     }
 
+    // The legacy signature hash is quadratic in the number of inputs without the precomputed parts
+    if (cache && txTo.vin.size() >= LEGACY_SIGHASH_MIN_INPUTS && !(nHashType & SIGHASH_ANYONECANPAY)) {
+        const std::shared_ptr<const PrecomputedLegacySigHash> legacy = GetLegacySigHash(txTo, *cache);
+        if (legacy->inputs[0].size() == LegacyInputOffset(txTo.vin.size(), txTo.vin.size())) {
+            return LegacySignatureHash(scriptCode, txTo, nIn, nHashType, *legacy);
+        }
+    }
+
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer<T> txTmp(txTo, scriptCode, nIn, nHashType);
 
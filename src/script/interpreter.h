@@ -6,6 +6,7 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include <hash.h>
 #include <script/script_error.h>
 #include <primitives/transaction.h>
 
@@ -119,11 +120,40 @@ enum
 
 bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned int flags, ScriptError* serror);
 
+//! Transactions with fewer inputs compute the legacy signature hash without PrecomputedTransactionData
+static const size_t LEGACY_SIGHASH_MIN_INPUTS = 8;
+//! Inputs between the legacy signature hash states kept by PrecomputedTransactionData
+static const size_t LEGACY_SIGHASH_CHECKPOINT_INPUTS = 16;
+
+/**
+ * The parts of the legacy (SigVersion::BASE) signature hash that are the
+ * same for every input, so that transactions with many inputs are not
+ * serialized again for each of them. Per variant, SIGHASH_ALL and
+ * SIGHASH_NONE/SINGLE (which zero the sequence of the other inputs): the
+ * version and the inputs with blank scripts, and the hash states after
+ * every LEGACY_SIGHASH_CHECKPOINT_INPUTS of those inputs.
+ */
+struct PrecomputedLegacySigHash
+{
+    std::vector<unsigned char> inputs[2];
+    std::vector<CHash256> midstates[2];
+    //! The outputs as hashed with SIGHASH_ALL
+    std::vector<unsigned char> outputs;
+};
+
 struct PrecomputedTransactionData
 {
     uint256 hashPrevouts, hashSequence, hashOutputs;
     bool ready = false;
 
+    /**
+     * Built by the first legacy signature hash of a transaction with at least
+     * LEGACY_SIGHASH_MIN_INPUTS inputs, so that transactions whose scripts are
+     * not checked do not pay for it. Accessed atomically, as the script
+     * checks of one transaction run on several threads.
+     */
+    mutable std::shared_ptr<const PrecomputedLegacySigHash> legacy;
+
     template <class T>
     explicit PrecomputedTransactionData(const T& tx);
 };
@@ -80,6 +80,26 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+bool BatchingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
+    uint256 entry;
+    signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
+    if (signatureCache.Get(entry, !store))
+        return true;
+    if (!batch.Add(pubkey, vchSig, sighash))
+        return false;
+    vCacheEntries.push_back(store ? entry : uint256());
+    return true;
+}
+
+void AddSignatureCacheEntries(const std::vector<uint256>& vEntries)
+{
+    for (uint256 entry : vEntries) {
+        if (!entry.IsNull())
+            signatureCache.Set(entry);
+    }
+}
+
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -18,6 +18,7 @@ static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
 
 class CPubKey;
+class CSignatureBatch;
 
 /**
  * We're hashing a nonce into the entries themselves, so we don't need extra
@@ -42,7 +43,7 @@ public:
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
-private:
+protected:
     bool store;
 
 public:
@@ -51,6 +52,27 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
+/**
+ * Signature checker for running many scripts and verifying their signatures
+ * in one go. Signatures found in the cache are valid as usual; any other
+ * signature is assumed valid and added to the batch. vCacheEntries gets the
+ * cache entry of each batched signature, or null if it is not to be stored.
+ * The result of the script only stands if its signatures in the batch verify.
+ */
+class BatchingTransactionSignatureChecker : public CachingTransactionSignatureChecker
+{
+private:
+    CSignatureBatch& batch;
+    std::vector<uint256>& vCacheEntries;
+
+public:
+    BatchingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn, CSignatureBatch& batchIn, std::vector<uint256>& vCacheEntriesIn) : CachingTransactionSignatureChecker(txToIn, nInIn, amountIn, storeIn, txdataIn), batch(batchIn), vCacheEntries(vCacheEntriesIn) {}
+    bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
+};
+
+/** Add the cache entries of batched signatures found valid */
+void AddSignatureCacheEntries(const std::vector<uint256>& vEntries);
+
 void InitSignatureCache();
 
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -69,6 +69,29 @@ static constexpr bool IsSmallInteger(opcodetype opcode)
     return opcode >= OP_1 && opcode <= OP_16;
 }
 
+/** Match the templates with a 20-byte hash address by their bytes, without the allocations of Solver */
+static uint8_t MatchCompactScript(const CScript& script, uint160& hash)
+{
+    if (script.IsPayToScriptHash()) {
+        std::copy(script.begin() + 2, script.begin() + 22, hash.begin());
+        return CCompactScript::SCRIPTHASH;
+    }
+    if (script.size() == WITNESS_V0_KEYHASH_SIZE + 2 && script[0] == OP_0 && script[1] == WITNESS_V0_KEYHASH_SIZE) {
+        std::copy(script.begin() + 2, script.end(), hash.begin());
+        return CCompactScript::WITNESS_V0_KEYHASH;
+    }
+    if (script.size() == 25 && script[0] == OP_DUP && script[1] == OP_HASH160 && script[2] == 20 && script[23] == OP_EQUALVERIFY && script[24] == OP_CHECKSIG) {
+        std::copy(script.begin() + 3, script.begin() + 23, hash.begin());
+        return CCompactScript::PUBKEYHASH;
+    }
+    valtype pubkey;
+    if (MatchPayToPubkey(script, pubkey)) {
+        hash = Hash160(pubkey);
+        return CCompactScript::PUBKEYHASH;
+    }
+    return CCompactScript::OTHER;
+}
+
 static bool MatchMultisig(const CScript& script, unsigned int& required, std::vector<valtype>& pubkeys)
 {
     opcodetype opcode;
@@ -164,6 +187,11 @@ bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::v
 
 bool ExtractDestination(const CScript& scriptPubKey, CTxDestination& addressRet)
 {
+    // The templates with a 20-byte hash are matched without Solver
+    CCompactScript compact;
+    compact.nType = MatchCompactScript(scriptPubKey, compact.hash);
+    if (compact.GetDestination(addressRet)) return true;
+
     std::vector<valtype> vSolutions;
     txnouttype whichType;
     if (!Solver(scriptPubKey, whichType, vSolutions))
@@ -343,3 +371,29 @@ CScript GetScriptForWitness(const CScript& redeemscript)
 bool IsValidDestination(const CTxDestination& dest) {
     return dest.which() != 0;
 }
+
+CCompactScript::CCompactScript(const CScript& scriptPubKey)
+{
+    nType = MatchCompactScript(scriptPubKey, hash);
+    if (nType == OTHER) script = scriptPubKey;
+}
+
+CScript CCompactScript::GetScript() const
+{
+    switch (nType) {
+    case PUBKEYHASH: return CScript() << OP_DUP << OP_HASH160 << ToByteVector(hash) << OP_EQUALVERIFY << OP_CHECKSIG;
+    case SCRIPTHASH: return CScript() << OP_HASH160 << ToByteVector(hash) << OP_EQUAL;
+    case WITNESS_V0_KEYHASH: return CScript() << OP_0 << ToByteVector(hash);
+    }
+    return script;
+}
+
+bool CCompactScript::GetDestination(CTxDestination& dest) const
+{
+    switch (nType) {
+    case PUBKEYHASH: dest = CKeyID(hash); return true;
+    case SCRIPTHASH: dest = CScriptID(hash); return true;
+    case WITNESS_V0_KEYHASH: dest = WitnessV0KeyHash(hash); return true;
+    }
+    return false;
+}
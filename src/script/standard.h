@@ -122,6 +122,60 @@ struct WitnessUnknown
  */
 typedef boost::variant<CNoDestination, CKeyID, CScriptID, WitnessV0ScriptHash, WitnessV0KeyHash, WitnessUnknown> CTxDestination;
 
+/**
+ * An output script reduced to its class and the 20-byte hash behind its
+ * address, computed once so that indexes and REST replies do not run Solver
+ * and rebuild the destination for every output they show. Pay-to-pubkey
+ * scripts become the pay-to-pubkey-hash of their key, which has the same
+ * address. Scripts of other classes are kept whole.
+ */
+class CCompactScript
+{
+public:
+    enum : uint8_t {
+        OTHER = 0,
+        PUBKEYHASH = 1,
+        SCRIPTHASH = 2,
+        WITNESS_V0_KEYHASH = 3,
+    };
+
+    uint8_t nType;
+    uint160 hash;
+    //! The script itself, for OTHER only
+    CScript script;
+
+    CCompactScript() : nType(OTHER) {}
+    explicit CCompactScript(const CScript& scriptPubKey);
+
+    /** The script this stands for, with pay-to-pubkey turned into pay-to-pubkey-hash */
+    CScript GetScript() const;
+    /** The destination of the script, as ExtractDestination would find it */
+    bool GetDestination(CTxDestination& dest) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nType);
+        if (nType > WITNESS_V0_KEYHASH) {
+            throw std::ios_base::failure("Unknown compact script type");
+        }
+        if (nType == OTHER) {
+            READWRITE(script);
+        } else {
+            READWRITE(hash);
+        }
+    }
+
+    friend bool operator==(const CCompactScript& a, const CCompactScript& b) {
+        return a.nType == b.nType && a.hash == b.hash && a.script == b.script;
+    }
+
+    friend bool operator!=(const CCompactScript& a, const CCompactScript& b) {
+        return !(a == b);
+    }
+};
+
 /** Check whether a CTxDestination is a CNoDestination. */
 bool IsValidDestination(const CTxDestination& dest);
 
@@ -0,0 +1,40 @@
+#ifndef SECP256K1_BATCH_H
+#define SECP256K1_BATCH_H
+
+#include "secp256k1.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Verify several ECDSA signatures at once.
+ *
+ *  Gives the same result as calling secp256k1_ecdsa_verify on every entry,
+ *  but computes the inverses of the s values of the signatures with a single
+ *  scalar inversion per group of signatures (Montgomery's trick) instead of
+ *  one inversion each.
+ *
+ *  Returns: 1: all signatures are valid
+ *           0: at least one signature is invalid
+ *  Args:    ctx:       a secp256k1 context object, initialized for verification.
+ *  Out:     results:   if non-NULL, an array of n ints set to 1 for each valid
+ *                      and 0 for each invalid signature.
+ *  In:      sigs:      an array of n pointers to signatures, in lower-S form.
+ *           msgs32:    an array of n pointers to 32-byte messages.
+ *           pubkeys:   an array of n pointers to parsed public keys.
+ *           n:         the number of signatures.
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_verify_batch(
+    const secp256k1_context* ctx,
+    int *results,
+    const secp256k1_ecdsa_signature * const *sigs,
+    const unsigned char * const *msgs32,
+    const secp256k1_pubkey * const *pubkeys,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SECP256K1_BATCH_H */
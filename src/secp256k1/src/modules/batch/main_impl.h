@@ -0,0 +1,77 @@
+/**********************************************************************
+ * Copyright (c) 2023 Uladzimir (t.me/cryptadev)                      *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef SECP256K1_MODULE_BATCH_MAIN_H
+#define SECP256K1_MODULE_BATCH_MAIN_H
+
+#include "include/secp256k1_batch.h"
+
+/** Number of signatures sharing one scalar inversion, bounded to keep the
+ *  scratch arrays on the stack. */
+#define SECP256K1_ECDSA_VERIFY_BATCH_SIZE 64
+
+int secp256k1_ecdsa_verify_batch(const secp256k1_context* ctx, int *results, const secp256k1_ecdsa_signature * const *sigs, const unsigned char * const *msgs32, const secp256k1_pubkey * const *pubkeys, size_t n) {
+    secp256k1_scalar r[SECP256K1_ECDSA_VERIFY_BATCH_SIZE];
+    secp256k1_scalar s[SECP256K1_ECDSA_VERIFY_BATCH_SIZE];
+    secp256k1_scalar acc[SECP256K1_ECDSA_VERIFY_BATCH_SIZE];
+    secp256k1_ge q[SECP256K1_ECDSA_VERIFY_BATCH_SIZE];
+    int valid[SECP256K1_ECDSA_VERIFY_BATCH_SIZE];
+    secp256k1_scalar inv, sn, m;
+    size_t start, count, i;
+    int ret = 1;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n == 0 || (sigs != NULL && msgs32 != NULL && pubkeys != NULL));
+
+    for (start = 0; start < n; start += count) {
+        count = n - start;
+        if (count > SECP256K1_ECDSA_VERIFY_BATCH_SIZE) {
+            count = SECP256K1_ECDSA_VERIFY_BATCH_SIZE;
+        }
+
+        /* Load the signatures and keys, and accumulate the product of the
+         * s values of the well-formed ones. Rejected entries take part as 1. */
+        secp256k1_scalar_set_int(&inv, 1);
+        for (i = 0; i < count; i++) {
+            ARG_CHECK(sigs[start + i] != NULL);
+            ARG_CHECK(msgs32[start + i] != NULL);
+            ARG_CHECK(pubkeys[start + i] != NULL);
+            secp256k1_ecdsa_signature_load(ctx, &r[i], &s[i], sigs[start + i]);
+            valid[i] = !secp256k1_scalar_is_high(&s[i]) &&
+                       !secp256k1_scalar_is_zero(&r[i]) &&
+                       !secp256k1_scalar_is_zero(&s[i]) &&
+                       secp256k1_pubkey_load(ctx, &q[i], pubkeys[start + i]);
+            if (!valid[i]) {
+                secp256k1_scalar_set_int(&s[i], 1);
+            }
+            secp256k1_scalar_mul(&inv, &inv, &s[i]);
+            acc[i] = inv;
+        }
+
+        /* One inversion of the product, then peel the individual inverses off
+         * from the end: s_i^-1 = (s_0...s_i)^-1 * (s_0...s_i-1). */
+        secp256k1_scalar_inverse_var(&inv, &inv);
+        for (i = count; i-- > 0;) {
+            if (i > 0) {
+                secp256k1_scalar_mul(&sn, &inv, &acc[i - 1]);
+                secp256k1_scalar_mul(&inv, &inv, &s[i]);
+            } else {
+                sn = inv;
+            }
+            if (valid[i]) {
+                secp256k1_scalar_set_b32(&m, msgs32[start + i], NULL);
+                valid[i] = secp256k1_ecdsa_sig_verify_inv(&ctx->ecmult_ctx, &r[i], &sn, &q[i], &m);
+            }
+            if (results != NULL) {
+                results[start + i] = valid[i];
+            }
+            ret &= valid[i];
+        }
+    }
+    return ret;
+}
+
+#endif /* SECP256K1_MODULE_BATCH_MAIN_H */
@@ -0,0 +1,67 @@
+/**********************************************************************
+ * Copyright (c) 2023 Uladzimir (t.me/cryptadev)                      *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef SECP256K1_MODULE_BATCH_TESTS_H
+#define SECP256K1_MODULE_BATCH_TESTS_H
+
+void test_ecdsa_verify_batch(size_t n) {
+    secp256k1_ecdsa_signature sig[100];
+    secp256k1_pubkey pubkey[100];
+    unsigned char msg[100][32];
+    const secp256k1_ecdsa_signature *psig[100] = { NULL };
+    const secp256k1_pubkey *ppubkey[100] = { NULL };
+    const unsigned char *pmsg[100] = { NULL };
+    int results[100];
+    int expected = 1;
+    size_t i;
+    CHECK(n <= 100);
+
+    for (i = 0; i < n; i++) {
+        unsigned char privkey[32];
+        secp256k1_scalar key;
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msg[i]);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkey[i], privkey) == 1);
+        CHECK(secp256k1_ecdsa_sign(ctx, &sig[i], msg[i], privkey, NULL, NULL) == 1);
+        /* Break some of the signatures, either by changing the message or by
+         * using another entry's key. */
+        switch (secp256k1_rand_int(8)) {
+        case 0:
+            msg[i][secp256k1_rand_int(32)] ^= 1 + secp256k1_rand_int(255);
+            break;
+        case 1:
+            if (i > 0) {
+                pubkey[i] = pubkey[i - 1];
+            }
+            break;
+        }
+        psig[i] = &sig[i];
+        ppubkey[i] = &pubkey[i];
+        pmsg[i] = msg[i];
+    }
+
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, results, psig, pmsg, ppubkey, n) == secp256k1_ecdsa_verify_batch(ctx, NULL, psig, pmsg, ppubkey, n));
+    for (i = 0; i < n; i++) {
+        int single = secp256k1_ecdsa_verify(ctx, &sig[i], msg[i], &pubkey[i]);
+        CHECK(results[i] == single);
+        expected &= single;
+    }
+    CHECK(secp256k1_ecdsa_verify_batch(ctx, results, psig, pmsg, ppubkey, n) == expected);
+}
+
+void run_ecdsa_verify_batch_tests(void) {
+    int i;
+    test_ecdsa_verify_batch(0);
+    test_ecdsa_verify_batch(1);
+    /* Crosses the boundary of SECP256K1_ECDSA_VERIFY_BATCH_SIZE */
+    test_ecdsa_verify_batch(100);
+    for (i = 0; i < count; i++) {
+        test_ecdsa_verify_batch(1 + secp256k1_rand_int(100));
+    }
+}
+
+#endif /* SECP256K1_MODULE_BATCH_TESTS_H */
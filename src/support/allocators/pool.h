@@ -0,0 +1,212 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Memory resource for many allocations of a few small sizes, like the nodes
+ * of a node based container.
+ *
+ * Memory is requested from the system in chunks which are cut into blocks of
+ * a multiple of ALIGN_BYTES. Freed blocks are kept in a free list per size
+ * and handed out again for allocations of the same size, so a block costs no
+ * malloc bookkeeping. Memory is only returned to the system when the resource
+ * is destroyed. Allocations larger than MAX_BLOCK_SIZE_BYTES, or with a
+ * stricter alignment than ALIGN_BYTES, use operator new.
+ *
+ * Not thread safe.
+ */
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolResource
+{
+    static_assert(ALIGN_BYTES > 0 && (ALIGN_BYTES & (ALIGN_BYTES - 1)) == 0, "ALIGN_BYTES must be a power of two");
+    static_assert(ALIGN_BYTES >= sizeof(void*), "a free block must be able to hold a pointer");
+    static_assert(ALIGN_BYTES <= alignof(std::max_align_t), "chunks are only aligned to max_align_t");
+    static_assert(MAX_BLOCK_SIZE_BYTES >= ALIGN_BYTES, "MAX_BLOCK_SIZE_BYTES too small");
+
+    //! Overlays a free block
+    struct FreeBlock {
+        FreeBlock* m_next;
+    };
+
+    static const std::size_t NUM_SIZES = MAX_BLOCK_SIZE_BYTES / ALIGN_BYTES + 1;
+
+    const std::size_t m_chunk_size_bytes;
+    std::vector<void*> m_chunks;
+    //! Free lists, indexed by block size in multiples of ALIGN_BYTES
+    std::array<FreeBlock*, NUM_SIZES> m_free_lists;
+    //! Not yet used part of the last chunk
+    char* m_available_begin = nullptr;
+    char* m_available_end = nullptr;
+    std::size_t m_pooled_bytes_in_use = 0;
+    //! Bytes of the blocks in the free lists
+    std::size_t m_free_bytes = 0;
+
+    static std::size_t SizeIndex(std::size_t bytes)
+    {
+        return bytes == 0 ? 1 : (bytes + ALIGN_BYTES - 1) / ALIGN_BYTES;
+    }
+
+    static bool IsPooled(std::size_t bytes, std::size_t alignment)
+    {
+        return bytes <= MAX_BLOCK_SIZE_BYTES && alignment <= ALIGN_BYTES;
+    }
+
+    void PushFree(void* p, std::size_t index)
+    {
+        m_free_lists[index] = new (p) FreeBlock{m_free_lists[index]};
+        m_free_bytes += index * ALIGN_BYTES;
+    }
+
+    void AllocateChunk()
+    {
+        // Keep the rest of the current chunk usable. Blocks are multiples of
+        // ALIGN_BYTES and smaller than the block that did not fit.
+        const std::size_t remaining = m_available_end - m_available_begin;
+        if (remaining > 0) {
+            PushFree(m_available_begin, remaining / ALIGN_BYTES);
+        }
+        void* chunk = ::operator new(m_chunk_size_bytes);
+        m_chunks.push_back(chunk);
+        m_available_begin = static_cast<char*>(chunk);
+        m_available_end = m_available_begin + m_chunk_size_bytes;
+    }
+
+public:
+    static const std::size_t DEFAULT_CHUNK_SIZE_BYTES = 256 * 1024;
+
+    explicit PoolResource(std::size_t chunk_size_bytes = DEFAULT_CHUNK_SIZE_BYTES) :
+        m_chunk_size_bytes(chunk_size_bytes - chunk_size_bytes % ALIGN_BYTES)
+    {
+        assert(m_chunk_size_bytes >= MAX_BLOCK_SIZE_BYTES);
+        m_free_lists.fill(nullptr);
+    }
+
+    ~PoolResource()
+    {
+        for (void* chunk : m_chunks) {
+            ::operator delete(chunk);
+        }
+    }
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    void* Allocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (!IsPooled(bytes, alignment)) {
+            return ::operator new(bytes);
+        }
+        const std::size_t index = SizeIndex(bytes);
+        const std::size_t block_size = index * ALIGN_BYTES;
+        void* p;
+        if (m_free_lists[index] != nullptr) {
+            FreeBlock* block = m_free_lists[index];
+            m_free_lists[index] = block->m_next;
+            block->~FreeBlock();
+            m_free_bytes -= block_size;
+            p = block;
+        } else {
+            if (static_cast<std::size_t>(m_available_end - m_available_begin) < block_size) {
+                AllocateChunk();
+            }
+            p = m_available_begin;
+            m_available_begin += block_size;
+        }
+        m_pooled_bytes_in_use += block_size;
+        return p;
+    }
+
+    void Deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+    {
+        if (!IsPooled(bytes, alignment)) {
+            ::operator delete(p);
+            return;
+        }
+        const std::size_t index = SizeIndex(bytes);
+        m_pooled_bytes_in_use -= index * ALIGN_BYTES;
+        PushFree(p, index);
+    }
+
+    //! Bytes of the pooled blocks that are currently allocated
+    std::size_t PooledBytesInUse() const { return m_pooled_bytes_in_use; }
+    //! Bytes of the freed blocks that are kept for reuse
+    std::size_t PooledBytesFree() const { return m_free_bytes; }
+    std::size_t NumAllocatedChunks() const { return m_chunks.size(); }
+    std::size_t ChunkSizeBytes() const { return m_chunk_size_bytes; }
+};
+
+/**
+ * Allocator that takes memory from a PoolResource. A default constructed
+ * allocator has no resource and uses operator new, so containers using it
+ * stay default constructible; copies of a container also get no resource.
+ */
+template <typename T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(void*)>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+    typedef PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> ResourceType;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind {
+        typedef PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> other;
+    };
+
+    PoolAllocator() noexcept : m_resource(nullptr) {}
+    PoolAllocator(ResourceType* resource) noexcept : m_resource(resource) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) noexcept : m_resource(other.resource())
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if (m_resource == nullptr) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(m_resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        if (m_resource == nullptr) {
+            ::operator delete(p);
+            return;
+        }
+        m_resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    PoolAllocator select_on_container_copy_construction() const { return PoolAllocator(); }
+
+    ResourceType* resource() const noexcept { return m_resource; }
+
+private:
+    ResourceType* m_resource;
+};
+
+template <typename T, typename U, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator==(const PoolAllocator<T, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a, const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return a.resource() == b.resource();
+}
+
+template <typename T, typename U, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator!=(const PoolAllocator<T, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a, const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return !(a == b);
+}
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
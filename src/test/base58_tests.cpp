@@ -6,6 +6,7 @@
 
 #include <base58.h>
 #include <test/test_bitcoin.h>
+#include <uint256.h>
 #include <utilstrencodings.h>
 
 #include <univalue.h>
@@ -66,4 +67,37 @@ BOOST_AUTO_TEST_CASE(base58_DecodeBase58)
     BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
 }
 
+// Random lengths cover every combination of partial limbs and leading zeroes
+BOOST_AUTO_TEST_CASE(base58_random_roundtrip)
+{
+    for (int i = 0; i < 1000; i++) {
+        std::vector<unsigned char> data(InsecureRandRange(100));
+        const size_t zeroes = InsecureRandRange(4);
+        for (size_t j = zeroes; j < data.size(); j++) {
+            data[j] = InsecureRandBits(8);
+        }
+        const std::string str = EncodeBase58(data);
+        BOOST_CHECK_EQUAL(str.size() > 0, data.size() > 0);
+        BOOST_CHECK(str.empty() || str[0] != '1' || data[0] == 0);
+        std::vector<unsigned char> result;
+        BOOST_CHECK(DecodeBase58(str, result));
+        BOOST_CHECK(result == data);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(base58_EncodeBase58CheckMulti)
+{
+    std::vector<std::vector<unsigned char>> payloads;
+    for (int i = 0; i < 20; i++) {
+        const uint256 hash = InsecureRand256();
+        payloads.emplace_back(hash.begin(), hash.begin() + InsecureRandRange(33));
+    }
+    const std::vector<std::string> encoded = EncodeBase58CheckMulti(payloads);
+    BOOST_REQUIRE_EQUAL(encoded.size(), payloads.size());
+    for (size_t i = 0; i < payloads.size(); i++) {
+        BOOST_CHECK_EQUAL(encoded[i], EncodeBase58Check(payloads[i]));
+    }
+    BOOST_CHECK(EncodeBase58CheckMulti({}).empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,143 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilecache.h>
+#include <test/test_bitcoin.h>
+
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** Write a file whose byte at offset n is n % 251 */
+fs::path WriteTestFile(const fs::path& dir, int n, size_t size)
+{
+    fs::path path = dir / ("blk" + std::to_string(n) + ".dat");
+    std::vector<unsigned char> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = i % 251;
+    }
+    FILE* file = fsbridge::fopen(path, "wb");
+    BOOST_REQUIRE(file);
+    BOOST_REQUIRE_EQUAL(fwrite(data.data(), 1, data.size(), file), data.size());
+    fclose(file);
+    return path;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockfilecache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockfilecache_read)
+{
+    const fs::path dir = SetDataDir("blockfilecache_read");
+    const fs::path path = WriteTestFile(dir, 0, 10000);
+    CBlockFileCache cache(4);
+
+    unsigned char buf[100];
+    BOOST_CHECK(cache.Read(path, 1000, buf, sizeof(buf)));
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        BOOST_CHECK_EQUAL(buf[i], (1000 + i) % 251);
+    }
+    BOOST_CHECK(cache.Read(path, 9900, buf, sizeof(buf)));
+    BOOST_CHECK_EQUAL(buf[99], 9999 % 251);
+
+    // Reads past the end and of missing files fail
+    BOOST_CHECK(!cache.Read(path, 9950, buf, sizeof(buf)));
+    BOOST_CHECK(!cache.Read(dir / "missing.dat", 0, buf, 1));
+    BOOST_CHECK_EQUAL(cache.GetOpenFiles(), 1U);
+    BOOST_CHECK(cache.GetHitsAndMisses() == std::make_pair(uint64_t{2}, uint64_t{2}));
+
+    cache.Close(path);
+    BOOST_CHECK_EQUAL(cache.GetOpenFiles(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilecache_map)
+{
+    const fs::path dir = SetDataDir("blockfilecache_map");
+    const fs::path path = WriteTestFile(dir, 0, 10000);
+    CBlockFileCache cache(1);
+
+    Span<const unsigned char> data;
+    std::shared_ptr<const void> keepalive;
+    if (!cache.Map(path, data, keepalive)) {
+        // Not supported on this platform
+        return;
+    }
+    BOOST_CHECK_EQUAL(data.size(), 10000);
+    BOOST_CHECK_EQUAL(data[1000], 1000 % 251);
+
+    // Reads of a mapped file are served from the mapping
+    unsigned char buf[10];
+    BOOST_CHECK(cache.Read(path, 5000, buf, sizeof(buf)));
+    BOOST_CHECK_EQUAL(buf[9], 5009 % 251);
+    BOOST_CHECK(!cache.Read(path, 9995, buf, sizeof(buf)));
+
+    // The mapping outlives the file being closed
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.GetOpenFiles(), 0U);
+    BOOST_CHECK_EQUAL(data[9999], 9999 % 251);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilecache_evicts_least_recently_used)
+{
+    const fs::path dir = SetDataDir("blockfilecache_evict");
+    std::vector<fs::path> paths;
+    for (int n = 0; n < 4; n++) {
+        paths.push_back(WriteTestFile(dir, n, 100));
+    }
+    CBlockFileCache cache(3);
+    unsigned char buf[1];
+    BOOST_CHECK(cache.Read(paths[0], 0, buf, 1));
+    BOOST_CHECK(cache.Read(paths[1], 0, buf, 1));
+    BOOST_CHECK(cache.Read(paths[2], 0, buf, 1));
+    BOOST_CHECK(cache.Read(paths[0], 0, buf, 1));
+
+    // Opening a fourth file closes the least recently used one
+    BOOST_CHECK(cache.Read(paths[3], 0, buf, 1));
+    BOOST_CHECK_EQUAL(cache.GetOpenFiles(), 3U);
+    BOOST_CHECK(cache.GetHitsAndMisses() == std::make_pair(uint64_t{1}, uint64_t{4}));
+    BOOST_CHECK(cache.Read(paths[0], 0, buf, 1));
+    BOOST_CHECK(cache.Read(paths[1], 0, buf, 1));
+    BOOST_CHECK(cache.GetHitsAndMisses() == std::make_pair(uint64_t{2}, uint64_t{5}));
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.GetOpenFiles(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilecache_concurrent_reads)
+{
+    const fs::path dir = SetDataDir("blockfilecache_concurrent");
+    std::vector<fs::path> paths;
+    for (int n = 0; n < 3; n++) {
+        paths.push_back(WriteTestFile(dir, n, 5000));
+    }
+    // Fewer open files than the threads read, so files are closed under them
+    CBlockFileCache cache(2);
+    std::vector<std::thread> threads;
+    std::vector<int> errors(4, 0);
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            unsigned char buf[64];
+            for (int i = 0; i < 500; i++) {
+                const size_t pos = (i * 37 + t * 101) % (5000 - sizeof(buf));
+                if (!cache.Read(paths[(i + t) % paths.size()], pos, buf, sizeof(buf)) ||
+                    buf[0] != pos % 251 || buf[63] != (pos + 63) % 251) {
+                    errors[t]++;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < 4; t++) {
+        BOOST_CHECK_EQUAL(errors[t], 0);
+    }
+    BOOST_CHECK(cache.GetOpenFiles() <= 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
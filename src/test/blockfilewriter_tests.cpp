@@ -0,0 +1,89 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilewriter.h>
+#include <test/test_bitcoin.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** Read a whole file */
+std::vector<unsigned char> ReadTestFile(const fs::path& path)
+{
+    std::vector<unsigned char> data;
+    FILE* file = fsbridge::fopen(path, "rb");
+    BOOST_REQUIRE(file);
+    unsigned char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(file);
+    return data;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockfilewriter_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockfilewriter_write)
+{
+    const fs::path dir = SetDataDir("blockfilewriter_write") / "blocks";
+    auto path = [&dir](int nFile) { return dir / ("blk" + std::to_string(nFile) + ".dat"); };
+    CBlockFileWriter writer(path);
+
+    // Consecutive writes append to the open file, rewrites seek back
+    BOOST_CHECK(writer.Write(CDiskBlockPos(0, 0), {1, 2, 3}));
+    BOOST_CHECK(writer.IsOpen(0));
+    BOOST_CHECK(writer.Write(CDiskBlockPos(0, 3), {4, 5}));
+    BOOST_CHECK(writer.Write(CDiskBlockPos(0, 1), {9}));
+    // Unbuffered writes are visible to readers before a sync
+    BOOST_CHECK(ReadTestFile(path(0)) == std::vector<unsigned char>({1, 9, 3, 4, 5}));
+
+    // Moving on to another file closes the previous one
+    BOOST_CHECK(writer.Write(CDiskBlockPos(1, 0), {7}));
+    BOOST_CHECK(!writer.IsOpen(0));
+    BOOST_CHECK(writer.IsOpen(1));
+
+    writer.Close(0);
+    BOOST_CHECK(writer.IsOpen(1));
+    writer.Close(1);
+    BOOST_CHECK(!writer.IsOpen(1));
+    BOOST_CHECK(ReadTestFile(path(1)) == std::vector<unsigned char>({7}));
+}
+
+BOOST_AUTO_TEST_CASE(blockfilewriter_commit)
+{
+    const fs::path dir = SetDataDir("blockfilewriter_commit") / "blocks";
+    auto path = [&dir](int nFile) { return dir / ("rev" + std::to_string(nFile) + ".dat"); };
+    CBlockFileWriter writer(path);
+
+    writer.Allocate(CDiskBlockPos(0, 0), 1000);
+    BOOST_CHECK(writer.Write(CDiskBlockPos(0, 0), {1, 2, 3, 4}));
+    BOOST_CHECK_EQUAL(fs::file_size(path(0)), 1000U);
+    BOOST_CHECK(writer.Commit(0, false, 4));
+    BOOST_CHECK_EQUAL(writer.GetSyncs(), 1U);
+
+    // Syncing a file nothing was written to since is skipped
+    BOOST_CHECK(writer.Commit(0, false, 4));
+    BOOST_CHECK_EQUAL(writer.GetSyncs(), 1U);
+
+    // Finalizing truncates the preallocated space
+    BOOST_CHECK(writer.Commit(0, true, 4));
+    BOOST_CHECK_EQUAL(writer.GetSyncs(), 2U);
+    BOOST_CHECK(ReadTestFile(path(0)) == std::vector<unsigned char>({1, 2, 3, 4}));
+
+    // A file the writer moved on from is reopened to be finalized
+    BOOST_CHECK(writer.Write(CDiskBlockPos(0, 4), {5, 6}));
+    BOOST_CHECK(writer.Write(CDiskBlockPos(1, 0), {8}));
+    BOOST_CHECK(writer.Commit(0, true, 5));
+    BOOST_CHECK_EQUAL(writer.GetSyncs(), 3U);
+    BOOST_CHECK(writer.IsOpen(1));
+    BOOST_CHECK(ReadTestFile(path(0)) == std::vector<unsigned char>({1, 2, 3, 4, 5}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockstats.h>
+#include <clientversion.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <undo.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+CMutableTransaction SpendingTx(int nInputs, CAmount nValueOut)
+{
+    CMutableTransaction tx;
+    for (int i = 0; i < nInputs; i++) {
+        tx.vin.emplace_back(COutPoint(InsecureRand256(), i));
+    }
+    tx.vout.emplace_back(nValueOut, CScript() << OP_TRUE);
+    return tx;
+}
+
+/** A coinbase and two transactions paying fees of 1 and 0.5 coins, with their undo data */
+void BuildBlock(CBlock& block, CBlockUndo& blockundo)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.emplace_back();
+    coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.vtx.push_back(MakeTransactionRef(SpendingTx(1, 9 * COIN)));
+    block.vtx.push_back(MakeTransactionRef(SpendingTx(2, 9 * COIN + COIN / 2)));
+
+    const CScript script = CScript() << OP_TRUE;
+    blockundo.vtxundo.resize(2);
+    blockundo.vtxundo[0].vprevout.emplace_back(CTxOut(10 * COIN, script), 1, false);
+    blockundo.vtxundo[1].vprevout.emplace_back(CTxOut(5 * COIN, script), 1, false);
+    blockundo.vtxundo[1].vprevout.emplace_back(CTxOut(5 * COIN, script), 1, false);
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockstats_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockstats_compute)
+{
+    CBlock block;
+    CBlockUndo blockundo;
+    BuildBlock(block, blockundo);
+
+    CBlockStats stats;
+    BOOST_REQUIRE(ComputeBlockStats(block, blockundo, stats));
+    BOOST_CHECK(stats.hashBlock == block.GetHash());
+    BOOST_CHECK_EQUAL(stats.nTxs, 3);
+    BOOST_CHECK_EQUAL(stats.nIns, 3);
+    BOOST_CHECK_EQUAL(stats.nOuts, 3);
+    BOOST_CHECK_EQUAL(stats.nTotalOut, 18 * COIN + COIN / 2);
+    BOOST_CHECK_EQUAL(stats.nTotalFee, COIN + COIN / 2);
+    BOOST_CHECK_EQUAL(stats.nMinFee, COIN / 2);
+    BOOST_CHECK_EQUAL(stats.nMaxFee, COIN);
+    BOOST_CHECK_EQUAL(stats.nMedianFee, COIN * 3 / 4);
+
+    const int64_t size1 = block.vtx[1]->GetTotalSize();
+    const int64_t size2 = block.vtx[2]->GetTotalSize();
+    BOOST_CHECK_EQUAL(stats.nTotalSize, size1 + size2);
+    BOOST_CHECK_EQUAL(stats.nMinTxSize, std::min(size1, size2));
+    BOOST_CHECK_EQUAL(stats.nMaxTxSize, std::max(size1, size2));
+    BOOST_CHECK_EQUAL(stats.nTotalWeight, GetTransactionWeight(*block.vtx[1]) + GetTransactionWeight(*block.vtx[2]));
+    BOOST_CHECK_EQUAL(stats.nSwTxs, 0);
+    // Three outputs created and three spent, all of the same size
+    BOOST_CHECK_EQUAL(stats.nUtxoSizeInc, 0);
+    BOOST_CHECK_EQUAL(stats.nMaxFeeRate, COIN * WITNESS_SCALE_FACTOR / GetTransactionWeight(*block.vtx[1]));
+
+    // Undo data of another block is rejected
+    blockundo.vtxundo.pop_back();
+    BOOST_CHECK(!ComputeBlockStats(block, blockundo, stats));
+}
+
+BOOST_AUTO_TEST_CASE(blockstats_serialization)
+{
+    CBlock block;
+    CBlockUndo blockundo;
+    BuildBlock(block, blockundo);
+    CBlockStats stats;
+    BOOST_REQUIRE(ComputeBlockStats(block, blockundo, stats));
+    stats.nUtxoSizeInc = -1234;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << stats;
+    CBlockStats stats2;
+    ss >> stats2;
+    BOOST_CHECK(stats2.hashBlock == stats.hashBlock);
+    BOOST_CHECK_EQUAL(stats2.nTotalFee, stats.nTotalFee);
+    BOOST_CHECK_EQUAL(stats2.nMedianTxSize, stats.nMedianTxSize);
+    BOOST_CHECK_EQUAL(stats2.vFeeRatePercentiles[4], stats.vFeeRatePercentiles[4]);
+    BOOST_CHECK_EQUAL(stats2.nUtxoSizeInc, -1234);
+    BOOST_CHECK(ss.empty());
+
+    // Disconnected heights are stored as null stats
+    BOOST_CHECK(CBlockStats().IsNull());
+    BOOST_CHECK(!stats2.IsNull());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
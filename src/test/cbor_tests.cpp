@@ -0,0 +1,111 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cbor.h>
+#include <uint256.h>
+#include <utilstrencodings.h>
+#include <test/test_bitcoin.h>
+
+#include <univalue.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(cbor_tests, BasicTestingSetup)
+
+static std::string ToHex(const std::string& s)
+{
+    return HexStr(s.begin(), s.end());
+}
+
+BOOST_AUTO_TEST_CASE(cbor_integers)
+{
+    // Test vectors from RFC 7049 appendix A
+    std::string out;
+    CBORWriter w(out);
+    w.WriteUInt(0);
+    BOOST_CHECK_EQUAL(ToHex(out), "00");
+    out.clear(); w.WriteUInt(23);
+    BOOST_CHECK_EQUAL(ToHex(out), "17");
+    out.clear(); w.WriteUInt(24);
+    BOOST_CHECK_EQUAL(ToHex(out), "1818");
+    out.clear(); w.WriteUInt(1000);
+    BOOST_CHECK_EQUAL(ToHex(out), "1903e8");
+    out.clear(); w.WriteUInt(1000000);
+    BOOST_CHECK_EQUAL(ToHex(out), "1a000f4240");
+    out.clear(); w.WriteUInt(1000000000000ULL);
+    BOOST_CHECK_EQUAL(ToHex(out), "1b000000e8d4a51000");
+    out.clear(); w.WriteInt(-1);
+    BOOST_CHECK_EQUAL(ToHex(out), "20");
+    out.clear(); w.WriteInt(-1000);
+    BOOST_CHECK_EQUAL(ToHex(out), "3903e7");
+    out.clear(); w.WriteInt(std::numeric_limits<int64_t>::min());
+    BOOST_CHECK_EQUAL(ToHex(out), "3b7fffffffffffffff");
+}
+
+BOOST_AUTO_TEST_CASE(cbor_simple_and_strings)
+{
+    std::string out;
+    CBORWriter w(out);
+    w.WriteBool(false);
+    w.WriteBool(true);
+    w.WriteNull();
+    BOOST_CHECK_EQUAL(ToHex(out), "f4f5f6");
+    out.clear(); w.WriteDouble(1.1);
+    BOOST_CHECK_EQUAL(ToHex(out), "fb3ff199999999999a");
+    out.clear(); w.WriteText("IETF");
+    BOOST_CHECK_EQUAL(ToHex(out), "6449455446");
+    out.clear(); w.WriteBytes(ParseHex("01020304"));
+    BOOST_CHECK_EQUAL(ToHex(out), "4401020304");
+    out.clear(); w.WriteBytes(std::vector<unsigned char>());
+    BOOST_CHECK_EQUAL(ToHex(out), "40");
+
+    // Hashes are written in display order
+    out.clear();
+    w.WriteHash(uint256S("0x00000000000000000000000000000000000000000000000000000000000000ff"));
+    BOOST_CHECK_EQUAL(ToHex(out), "5820" + std::string(62, '0') + "ff");
+}
+
+BOOST_AUTO_TEST_CASE(cbor_containers)
+{
+    std::string out;
+    CBORWriter w(out);
+    w.BeginArray(3);
+    w.WriteUInt(1);
+    w.BeginArray(2);
+    w.WriteUInt(2);
+    w.WriteUInt(3);
+    w.BeginArray();
+    w.WriteUInt(4);
+    w.End();
+    BOOST_CHECK_EQUAL(ToHex(out), "83018202039f04ff");
+
+    out.clear();
+    w.BeginMap();
+    w.Key("a").WriteUInt(1);
+    w.End();
+    BOOST_CHECK_EQUAL(ToHex(out), "bf616101ff");
+}
+
+BOOST_AUTO_TEST_CASE(cbor_univalue)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("a", 1);
+    obj.pushKV("b", -2);
+    UniValue arr(UniValue::VARR);
+    arr.push_back("x");
+    arr.push_back(UniValue(true));
+    arr.push_back(NullUniValue);
+    obj.pushKV("c", arr);
+
+    std::string out;
+    CBORWriter w(out);
+    UniValueToCBOR(w, obj);
+    BOOST_CHECK_EQUAL(ToHex(out), "a36161016162216163836178f5f6");
+
+    BOOST_CHECK(IsCBORMediaType("application/cbor"));
+    BOOST_CHECK(IsCBORMediaType("application/cbor, application/json;q=0.5"));
+    BOOST_CHECK(!IsCBORMediaType("application/json"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,38 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <test/test_bitcoin.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(chain_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockindexarena_test)
+{
+    const size_t nChunk = CBlockIndexArena::CHUNK_ENTRIES;
+    CBlockIndexArena arena;
+    std::vector<CBlockIndex*> vIndex;
+    for (size_t i = 0; i < nChunk + 10; i++) {
+        vIndex.push_back(arena.Allocate());
+        vIndex.back()->nHeight = i;
+        vIndex.back()->pprev = i > 0 ? vIndex[i - 1] : nullptr;
+    }
+    BOOST_CHECK_EQUAL(arena.size(), nChunk + 10);
+
+    // Entries stay in place when the arena grows
+    for (size_t i = 1; i < vIndex.size(); i++) {
+        BOOST_CHECK_EQUAL(vIndex[i]->nHeight, (int)i);
+        BOOST_CHECK(vIndex[i]->pprev == vIndex[i - 1]);
+    }
+    BOOST_CHECK(arena.DynamicMemoryUsage() >= 2 * nChunk * sizeof(CBlockIndex));
+
+    arena.Clear();
+    BOOST_CHECK_EQUAL(arena.size(), 0U);
+    BOOST_CHECK_EQUAL(arena.DynamicMemoryUsage(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
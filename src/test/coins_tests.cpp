@@ -8,6 +8,7 @@
 #include <undo.h>
 #include <utilstrencodings.h>
 #include <test/test_bitcoin.h>
+#include <txdb.h>
 #include <validation.h>
 #include <consensus/validation.h>
 
@@ -855,4 +856,133 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+static COutPoint SyncTestOutpoint(uint32_t n)
+{
+    return COutPoint(uint256S("0xa5"), n);
+}
+
+static Coin SyncTestCoin(CAmount value)
+{
+    return Coin(CTxOut(value, CScript() << OP_TRUE), 1, false);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_sync)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest parent(&base);
+    parent.AddCoin(SyncTestOutpoint(0), SyncTestCoin(10), false);
+    parent.AddCoin(SyncTestOutpoint(1), SyncTestCoin(11), false);
+    parent.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(parent.Flush());
+
+    CCoinsViewCacheTest cache(&parent);
+    cache.AddCoin(SyncTestOutpoint(2), SyncTestCoin(12), false);
+    cache.AddCoin(SyncTestOutpoint(3), SyncTestCoin(13), false);
+    BOOST_CHECK(cache.SpendCoin(SyncTestOutpoint(0)));
+    BOOST_CHECK(cache.SpendCoin(SyncTestOutpoint(3)));
+    BOOST_CHECK(cache.HaveCoin(SyncTestOutpoint(1)));
+    uint256 hashBlock = InsecureRand256();
+    cache.SetBestBlock(hashBlock);
+    BOOST_CHECK(cache.Sync());
+    cache.SelfTest();
+
+    // Written to the parent
+    BOOST_CHECK(parent.GetBestBlock() == hashBlock);
+    BOOST_CHECK(!parent.HaveCoin(SyncTestOutpoint(0)));
+    BOOST_CHECK(parent.HaveCoin(SyncTestOutpoint(2)));
+    // The spent FRESH coin never reaches the parent
+    BOOST_CHECK(!parent.HaveCoinInCache(SyncTestOutpoint(3)));
+
+    // Unspent coins stay cached and clean, spent ones are gone
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 2U);
+    for (const auto& entry : cache.map()) {
+        BOOST_CHECK_EQUAL(entry.second.flags, 0);
+        BOOST_CHECK(!entry.second.coin.IsSpent());
+    }
+    BOOST_CHECK(cache.HaveCoinInCache(SyncTestOutpoint(1)));
+    BOOST_CHECK(cache.HaveCoinInCache(SyncTestOutpoint(2)));
+
+    // Trim evicts clean entries only
+    cache.AddCoin(SyncTestOutpoint(4), SyncTestCoin(14), false);
+    cache.Trim(0);
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1U);
+    BOOST_CHECK(cache.HaveCoinInCache(SyncTestOutpoint(4)));
+    BOOST_CHECK(cache.HaveCoin(SyncTestOutpoint(2)));
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_trim_releases_memory)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+    const uint32_t nCoins = 20000;
+    for (uint32_t n = 0; n < nCoins; n++) {
+        cache.AddCoin(SyncTestOutpoint(n), SyncTestCoin(n + 1), false);
+    }
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache.Sync());
+    cache.AddCoin(SyncTestOutpoint(nCoins), SyncTestCoin(nCoins + 1), false);
+
+    // Erased entries only go back to the memory pool, the usage has to drop anyway
+    const size_t max_usage = cache.DynamicMemoryUsage() / 2;
+    cache.Trim(max_usage);
+    cache.SelfTest();
+    BOOST_CHECK(cache.DynamicMemoryUsage() <= max_usage);
+    BOOST_CHECK(cache.GetCacheSize() > nCoins / 4);
+    BOOST_CHECK(cache.GetCacheSize() < nCoins);
+
+    // The dirty entry and the clean ones that are left keep their coins
+    BOOST_CHECK(cache.HaveCoinInCache(SyncTestOutpoint(nCoins)));
+    size_t nClean = 0;
+    for (const auto& entry : cache.map()) {
+        BOOST_CHECK_EQUAL(entry.second.coin.out.nValue, entry.first.n + 1);
+        if (entry.second.flags == 0) nClean++;
+    }
+    BOOST_CHECK_EQUAL(nClean, cache.GetCacheSize() - 1);
+
+    // Coins that were evicted are still found in the base
+    for (uint32_t n = 0; n < nCoins; n++) {
+        BOOST_CHECK(cache.HaveCoin(SyncTestOutpoint(n)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(coins_db_async_write)
+{
+    SetDataDir("coins_db_async_write");
+    CCoinsViewDB db(1 << 20, true, true);
+    db.SetAsyncWrites(true);
+    CCoinsViewCache cache(&db);
+
+    for (uint32_t n = 0; n < 1000; n++) {
+        cache.AddCoin(SyncTestOutpoint(n), SyncTestCoin(n + 1), false);
+    }
+    uint256 hashFirst = InsecureRand256();
+    cache.SetBestBlock(hashFirst);
+    BOOST_CHECK(cache.Sync());
+    // Served from memory or disk, whichever the write has reached
+    BOOST_CHECK(db.GetBestBlock() == hashFirst);
+    Coin coin;
+    BOOST_CHECK(db.GetCoin(SyncTestOutpoint(7), coin));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 8);
+
+    BOOST_CHECK(cache.SpendCoin(SyncTestOutpoint(7)));
+    uint256 hashSecond = InsecureRand256();
+    cache.SetBestBlock(hashSecond);
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK(!db.HaveCoin(SyncTestOutpoint(7)));
+    BOOST_CHECK(db.GetBestBlock() == hashSecond);
+
+    BOOST_CHECK(db.WaitForWrites());
+    BOOST_CHECK_EQUAL(db.PendingMemoryUsage(), 0U);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK(db.GetBestBlock() == hashSecond);
+    BOOST_CHECK(!db.HaveCoin(SyncTestOutpoint(7)));
+    BOOST_CHECK(db.HaveCoin(SyncTestOutpoint(999)));
+
+    size_t count = 0;
+    std::unique_ptr<CCoinsViewCursor> cursor(db.Cursor());
+    for (; cursor->Valid(); cursor->Next()) count++;
+    BOOST_CHECK_EQUAL(count, 999U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,206 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coinsprefetch.h>
+#include <test/test_bitcoin.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** Fixed set of coins that counts its reads */
+class CCoinsViewCounting : public CCoinsView
+{
+public:
+    std::map<COutPoint, Coin> m_coins;
+    mutable std::atomic<int> m_reads{0};
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override
+    {
+        m_reads++;
+        auto it = m_coins.find(outpoint);
+        if (it == m_coins.end()) return false;
+        coin = it->second;
+        return true;
+    }
+
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override
+    {
+        mapCoins.clear();
+        return true;
+    }
+};
+
+/** Coins view whose read of one outpoint blocks until released, records the order of reads */
+class CCoinsViewGated : public CCoinsViewCounting
+{
+public:
+    COutPoint m_gate;
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cv;
+    bool m_open{false};
+    mutable std::vector<COutPoint> m_order;
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_order.push_back(outpoint);
+            if (outpoint == m_gate) m_cv.wait(lock, [this] { return m_open; });
+        }
+        return CCoinsViewCounting::GetCoin(outpoint, coin);
+    }
+
+    void Open()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = true;
+        m_cv.notify_all();
+    }
+};
+
+COutPoint PrefetchOutpoint(uint32_t n)
+{
+    return COutPoint(uint256S("0xb7"), n);
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(coinsprefetch_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(prefetch_serves_misses)
+{
+    CCoinsViewCounting base;
+    for (uint32_t n = 0; n < 100; n++) {
+        base.m_coins.emplace(PrefetchOutpoint(n), Coin(CTxOut(n + 1, CScript() << OP_TRUE), 1, false));
+    }
+    CCoinsViewPrefetch prefetch(&base, 3);
+    CCoinsViewCache cache(&prefetch);
+
+    // Outpoints that do not exist are read but not kept
+    std::vector<COutPoint> outpoints;
+    for (uint32_t n = 0; n < 150; n++) {
+        outpoints.push_back(PrefetchOutpoint(n));
+    }
+    prefetch.Prefetch(outpoints, 1, true);
+    BOOST_CHECK_EQUAL(base.m_reads.load(), 150);
+    BOOST_CHECK_EQUAL(prefetch.GetPrefetchedCount(), 100U);
+    const size_t usage = prefetch.DynamicMemoryUsage();
+    BOOST_CHECK(usage > 0);
+
+    // Already prefetched outpoints are not read again
+    prefetch.Prefetch(outpoints, 1, true);
+    BOOST_CHECK_EQUAL(base.m_reads.load(), 200);
+
+    // Cache misses take the prefetched coins without reading the base
+    for (uint32_t n = 0; n < 100; n++) {
+        BOOST_CHECK_EQUAL(cache.AccessCoin(PrefetchOutpoint(n)).out.nValue, (CAmount)n + 1);
+    }
+    BOOST_CHECK_EQUAL(base.m_reads.load(), 200);
+    BOOST_CHECK_EQUAL(prefetch.GetPrefetchedCount(), 0U);
+    BOOST_CHECK(prefetch.DynamicMemoryUsage() < usage);
+
+    // A write to the base drops coins that were read before it
+    prefetch.Prefetch({PrefetchOutpoint(0)}, 1, true);
+    BOOST_CHECK_EQUAL(prefetch.GetPrefetchedCount(), 1U);
+    cache.SetBestBlock(uint256S("0x01"));
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK_EQUAL(prefetch.GetPrefetchedCount(), 0U);
+    BOOST_CHECK(cache.HaveCoin(PrefetchOutpoint(0)));
+    BOOST_CHECK_EQUAL(base.m_reads.load(), 202);
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_evict)
+{
+    CCoinsViewCounting base;
+    for (uint32_t n = 0; n < 3; n++) {
+        base.m_coins.emplace(PrefetchOutpoint(n), Coin(CTxOut(n + 1, CScript() << OP_TRUE), 1, false));
+    }
+    CCoinsViewPrefetch prefetch(&base, 2);
+    prefetch.Prefetch({PrefetchOutpoint(0)}, 10, true);
+    prefetch.Prefetch({PrefetchOutpoint(1)}, 11, true);
+    prefetch.Prefetch({PrefetchOutpoint(2)}, 12, true);
+    // An input of a later block as well is kept for that one
+    prefetch.Prefetch({PrefetchOutpoint(0)}, 12, true);
+    BOOST_CHECK_EQUAL(prefetch.GetPrefetchedCount(), 3U);
+    const size_t usage = prefetch.DynamicMemoryUsage();
+
+    // Coins of the blocks up to the tip go, those of later blocks stay
+    prefetch.Evict(11);
+    BOOST_CHECK_EQUAL(prefetch.GetPrefetchedCount(), 2U);
+    BOOST_CHECK(prefetch.DynamicMemoryUsage() < usage);
+    Coin coin;
+    BOOST_CHECK(prefetch.GetCoin(PrefetchOutpoint(0), coin));
+    BOOST_CHECK_EQUAL(base.m_reads.load(), 3);
+    BOOST_CHECK(prefetch.GetCoin(PrefetchOutpoint(1), coin));
+    BOOST_CHECK_EQUAL(base.m_reads.load(), 4);
+
+    prefetch.Evict(12);
+    BOOST_CHECK_EQUAL(prefetch.GetPrefetchedCount(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_priority)
+{
+    CCoinsViewGated base;
+    base.m_gate = PrefetchOutpoint(1000);
+    for (uint32_t n = 0; n < 100; n++) {
+        base.m_coins.emplace(PrefetchOutpoint(n), Coin(CTxOut(n + 1, CScript() << OP_TRUE), 1, false));
+    }
+    CCoinsViewPrefetch prefetch(&base, 1);
+
+    // Hold the only thread on a read while more is queued behind it
+    prefetch.Prefetch({base.m_gate}, 1, false);
+    while (true) {
+        std::lock_guard<std::mutex> lock(base.m_mutex);
+        if (!base.m_order.empty()) break;
+    }
+    std::vector<COutPoint> lookahead;
+    for (uint32_t n = 0; n < 40; n++) {
+        lookahead.push_back(PrefetchOutpoint(n));
+    }
+    prefetch.Prefetch(lookahead, 5, false);
+    // Queued outpoints are not queued again
+    prefetch.Prefetch(lookahead, 5, false);
+    BOOST_CHECK_EQUAL(prefetch.GetQueuedCount(), 41U);
+
+    // The inputs of the tip are read before the lookahead, taking over the one they share
+    std::thread waiter([&prefetch] { prefetch.Prefetch({PrefetchOutpoint(39), PrefetchOutpoint(50)}, 2, true); });
+    while (prefetch.GetQueuedCount() < 42) {
+        std::this_thread::yield();
+    }
+    base.Open();
+    waiter.join();
+    {
+        std::lock_guard<std::mutex> lock(base.m_mutex);
+        BOOST_REQUIRE(base.m_order.size() >= 3U);
+        BOOST_CHECK(base.m_order[1] == PrefetchOutpoint(39));
+        BOOST_CHECK(base.m_order[2] == PrefetchOutpoint(50));
+    }
+    while (prefetch.GetQueuedCount() > 0) {
+        std::this_thread::yield();
+    }
+    // Every outpoint was read once
+    BOOST_CHECK_EQUAL(base.m_reads.load(), 42);
+    BOOST_CHECK_EQUAL(prefetch.GetPrefetchedCount(), 41U);
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_disabled)
+{
+    CCoinsViewCounting base;
+    base.m_coins.emplace(PrefetchOutpoint(0), Coin(CTxOut(1, CScript() << OP_TRUE), 1, false));
+    CCoinsViewPrefetch prefetch(&base, 0);
+    prefetch.Prefetch({PrefetchOutpoint(0)}, 1, true);
+    BOOST_CHECK_EQUAL(base.m_reads.load(), 0);
+    Coin coin;
+    BOOST_CHECK(prefetch.GetCoin(PrefetchOutpoint(0), coin));
+    BOOST_CHECK_EQUAL(base.m_reads.load(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
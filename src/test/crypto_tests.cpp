@@ -562,4 +562,40 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256_multi)
+{
+    // Lengths around the padding boundaries, some long messages to keep single lanes
+    // busy, and counts that do not fill the lanes evenly
+    std::vector<std::vector<unsigned char>> msgs;
+    for (size_t len = 0; len <= 200; ++len) {
+        msgs.emplace_back(len);
+    }
+    msgs.emplace_back(5000);
+    msgs.emplace_back(1000);
+    for (auto& msg : msgs) {
+        for (auto& c : msg) c = InsecureRandBits(8);
+    }
+
+    for (size_t count : {(size_t)0, (size_t)1, (size_t)3, (size_t)9, msgs.size()}) {
+        std::vector<const unsigned char*> inputs;
+        std::vector<size_t> lengths;
+        for (size_t i = 0; i < count; ++i) {
+            // Take messages from both ends, so the long ones are hashed alongside short ones
+            const auto& msg = msgs[i % 2 ? msgs.size() - 1 - i / 2 : i / 2];
+            inputs.push_back(msg.data());
+            lengths.push_back(msg.size());
+        }
+        std::vector<unsigned char> single(32 * count), twice(32 * count);
+        SHA256Multi(single.data(), inputs.data(), lengths.data(), count);
+        SHA256DMulti(twice.data(), inputs.data(), lengths.data(), count);
+        for (size_t i = 0; i < count; ++i) {
+            unsigned char out[32];
+            CSHA256().Write(inputs[i], lengths[i]).Finalize(out);
+            BOOST_CHECK(memcmp(out, &single[32 * i], 32) == 0);
+            CHash256().Write(inputs[i], lengths[i]).Finalize(out);
+            BOOST_CHECK(memcmp(out, &twice[32 * i], 32) == 0);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 #include <key.h>
 #include <key_io.h>
 #include <script/script.h>
+#include <script/standard.h>
 #include <utilstrencodings.h>
 #include <test/test_bitcoin.h>
 
@@ -118,6 +119,54 @@ BOOST_AUTO_TEST_CASE(key_io_valid_gen)
 }
 
 
+BOOST_AUTO_TEST_CASE(key_io_encode_cached)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CTxDestination keyid = key.GetPubKey().GetID();
+    const CTxDestination scriptid = CScriptID(GetScriptForDestination(keyid));
+
+    // Repeated encodings are served from the cache and stay the same
+    const std::string main_key = EncodeDestination(keyid);
+    const std::string main_script = EncodeDestination(scriptid);
+    BOOST_CHECK_EQUAL(EncodeDestination(keyid), main_key);
+    BOOST_CHECK_EQUAL(EncodeDestination(scriptid), main_script);
+    BOOST_CHECK(main_key != main_script);
+    BOOST_CHECK(DecodeDestination(main_key) == keyid);
+    BOOST_CHECK(DecodeDestination(main_script) == scriptid);
+
+    // Switching chains does not return addresses of the previous one
+    SelectParams(CBaseChainParams::TESTNET);
+    const std::string test_key = EncodeDestination(keyid);
+    BOOST_CHECK(test_key != main_key);
+    BOOST_CHECK(DecodeDestination(test_key) == keyid);
+    SelectParams(CBaseChainParams::MAIN);
+    BOOST_CHECK_EQUAL(EncodeDestination(keyid), main_key);
+}
+
+BOOST_AUTO_TEST_CASE(key_io_encode_several)
+{
+    std::vector<CTxDestination> dests;
+    for (int i = 0; i < 10; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        dests.push_back(key.GetPubKey().GetID());
+        dests.push_back(CScriptID(GetScriptForDestination(dests.back())));
+        dests.push_back(WitnessV0KeyHash(key.GetPubKey().GetID()));
+        dests.push_back(CNoDestination());
+    }
+    // Some are cached already
+    EncodeDestination(dests[0]);
+    EncodeDestination(dests[5]);
+    dests.push_back(dests[1]);
+
+    const std::vector<std::string> encoded = EncodeDestinations(dests);
+    BOOST_REQUIRE_EQUAL(encoded.size(), dests.size());
+    for (size_t i = 0; i < dests.size(); i++) {
+        BOOST_CHECK_EQUAL(encoded[i], EncodeDestination(dests[i]));
+    }
+}
+
 // Goal: check that base58 parsing code is robust against a variety of corrupted data
 BOOST_AUTO_TEST_CASE(key_io_invalid)
 {
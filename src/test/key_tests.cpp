@@ -188,4 +188,65 @@ BOOST_AUTO_TEST_CASE(key_signature_tests)
     BOOST_CHECK(found_small);
 }
 
+BOOST_AUTO_TEST_CASE(key_signature_batch)
+{
+    CKey key1, key2;
+    key1.MakeNewKey(false);
+    key2.MakeNewKey(true);
+    CSignatureBatch batch;
+    std::vector<bool> vExpected;
+    for (int i = 0; i < 100; i++) {
+        const CKey& key = (i % 3) ? key1 : key2;
+        std::string msg = "A message to be signed" + std::to_string(i);
+        uint256 msg_hash = Hash(msg.begin(), msg.end());
+        std::vector<unsigned char> sig;
+        BOOST_CHECK(key.Sign(msg_hash, sig));
+        // Every seventh signature is for another message
+        if (i % 7 == 0) msg_hash = Hash(sig.begin(), sig.end());
+        BOOST_CHECK(batch.Add(key.GetPubKey(), sig, msg_hash));
+        vExpected.push_back(key.GetPubKey().Verify(msg_hash, sig));
+    }
+    // Signatures or keys that do not parse are not added
+    BOOST_CHECK(!batch.Add(key1.GetPubKey(), std::vector<unsigned char>(10, 0), uint256()));
+    BOOST_CHECK(!batch.Add(CPubKey(), std::vector<unsigned char>(), uint256()));
+    BOOST_CHECK_EQUAL(batch.size(), 100U);
+
+    std::vector<int> vResults;
+    BOOST_CHECK(!batch.Verify(&vResults));
+    BOOST_REQUIRE_EQUAL(vResults.size(), vExpected.size());
+    for (size_t i = 0; i < vResults.size(); i++) {
+        BOOST_CHECK_EQUAL(vResults[i] != 0, vExpected[i]);
+        BOOST_CHECK_EQUAL(vExpected[i], i % 7 != 0);
+    }
+
+    batch.clear();
+    BOOST_CHECK(batch.Verify());
+}
+
+BOOST_AUTO_TEST_CASE(key_pubkey_parse_cache)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    const uint256 hash = Hash(pubkey.begin(), pubkey.end());
+    std::vector<unsigned char> sig;
+    BOOST_CHECK(key.Sign(hash, sig));
+
+    // The first verification parses the key, later ones find it in the cache
+    const PubKeyCacheStats before = GetPubKeyCacheStats();
+    for (int i = 0; i < 3; i++) {
+        BOOST_CHECK(pubkey.Verify(hash, sig));
+    }
+    const PubKeyCacheStats after = GetPubKeyCacheStats();
+    BOOST_CHECK_EQUAL(after.nMisses - before.nMisses, 1U);
+    BOOST_CHECK_EQUAL(after.nHits - before.nHits, 2U);
+
+    // A cached key of the other encoding is not mixed up with this one
+    CPubKey uncompressed = pubkey;
+    BOOST_CHECK(uncompressed.Decompress());
+    BOOST_CHECK(!uncompressed.Verify(Hash(sig.begin(), sig.end()), sig));
+    BOOST_CHECK(uncompressed.Verify(hash, sig));
+    BOOST_CHECK_EQUAL(GetPubKeyCacheStats().nMisses - after.nMisses, 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
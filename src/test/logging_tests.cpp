@@ -0,0 +1,120 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <logging.h>
+#include <test/test_bitcoin.h>
+
+#include <fstream>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(logging_tests, BasicTestingSetup)
+
+static std::vector<std::string> ReadLines(const fs::path& path)
+{
+    std::vector<std::string> lines;
+    std::ifstream file(path.string());
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+BOOST_AUTO_TEST_CASE(logging_ratelimit)
+{
+    BCLog::Logger logger;
+    BOOST_CHECK(logger.RateLimitCategory(BCLog::NET));
+
+    logger.SetRateLimit(BCLog::NET, 5);
+    BOOST_CHECK_EQUAL(logger.GetRateLimit(BCLog::NET), 5U);
+    BOOST_CHECK_EQUAL(logger.GetRateLimit(BCLog::MEMPOOL), 0U);
+
+    // Other categories are not affected
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK(logger.RateLimitCategory(BCLog::MEMPOOL));
+    }
+
+    // The first second may straddle two windows, so allow for one reset
+    int allowed = 0;
+    for (int i = 0; i < 100; i++) {
+        if (logger.RateLimitCategory(BCLog::NET)) allowed++;
+    }
+    BOOST_CHECK(allowed >= 5 && allowed <= 10);
+    BOOST_CHECK_EQUAL(logger.GetSuppressed(BCLog::NET), 100U - allowed);
+    BOOST_CHECK_EQUAL(logger.GetSuppressed(BCLog::MEMPOOL), 0U);
+
+    logger.SetRateLimit(BCLog::ALL, 0);
+    BOOST_CHECK(logger.RateLimitCategory(BCLog::NET));
+}
+
+BOOST_AUTO_TEST_CASE(logging_async)
+{
+    BCLog::Logger logger;
+    logger.m_print_to_file = true;
+    logger.m_log_timestamps = false;
+    logger.m_file_path = GetDataDir() / "async.log";
+    BOOST_REQUIRE(logger.OpenDebugLog());
+
+    logger.LogPrintStr("sync\n");
+    logger.StartAsync();
+    BOOST_CHECK(logger.IsAsync());
+
+    // Unconditional messages from several threads all make it to the file
+    boost::thread_group threads;
+    for (int t = 0; t < 4; t++) {
+        threads.create_thread([&logger, t] {
+            for (int i = 0; i < 5000; i++) {
+                logger.LogPrintStr(strprintf("thread %d line %d\n", t, i));
+            }
+        });
+    }
+    threads.join_all();
+    logger.StopAsync();
+    BOOST_CHECK(!logger.IsAsync());
+    BOOST_CHECK_EQUAL(logger.GetQueued(), 0U);
+    logger.LogPrintStr("after\n");
+
+    const std::vector<std::string> lines = ReadLines(logger.m_file_path);
+    BOOST_REQUIRE_EQUAL(lines.size(), 20002U);
+    BOOST_CHECK_EQUAL(lines.front(), "sync");
+    BOOST_CHECK_EQUAL(lines.back(), "after");
+
+    // Messages of each thread keep their order
+    std::vector<int> next(4, 0);
+    for (size_t i = 1; i + 1 < lines.size(); i++) {
+        int t, n;
+        BOOST_REQUIRE(sscanf(lines[i].c_str(), "thread %d line %d", &t, &n) == 2);
+        BOOST_CHECK_EQUAL(n, next[t]++);
+    }
+    BOOST_CHECK_EQUAL(logger.GetDropped(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(logging_async_stop)
+{
+    BCLog::Logger logger;
+    logger.m_print_to_file = true;
+    logger.m_log_timestamps = false;
+    logger.m_file_path = GetDataDir() / "async_stop.log";
+    BOOST_REQUIRE(logger.OpenDebugLog());
+    logger.StartAsync();
+
+    // Messages logged while the writer is being stopped are not lost
+    boost::thread_group threads;
+    for (int t = 0; t < 4; t++) {
+        threads.create_thread([&logger, t] {
+            for (int i = 0; i < 5000; i++) {
+                logger.LogPrintStr(strprintf("thread %d line %d\n", t, i));
+            }
+        });
+    }
+    logger.StopAsync();
+    threads.join_all();
+    BOOST_CHECK(!logger.IsAsync());
+
+    BOOST_CHECK_EQUAL(ReadLines(logger.m_file_path).size(), 20000U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,72 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <metrics.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(metrics_tests, BasicTestingSetup)
+
+static bool Contains(const std::string& haystack, const std::string& needle)
+{
+    return haystack.find(needle) != std::string::npos;
+}
+
+BOOST_AUTO_TEST_CASE(metrics_render)
+{
+    {
+        CMetricCounter hits("test_lookups_total", "Test lookups", "result=\"hit\"");
+        CMetricCounter misses("test_lookups_total", "Test lookups", "result=\"miss\"");
+        CMetricGauge gauge("test_height", "Test height");
+        hits.Inc(3);
+        misses.Inc();
+        gauge.Set(42);
+        BOOST_CHECK_EQUAL(hits.Get(), 3U);
+
+        const std::string out = RenderMetrics();
+        // One header for both label sets
+        const size_t header = out.find("# TYPE doge_test_lookups_total counter\n");
+        BOOST_REQUIRE(header != std::string::npos);
+        BOOST_CHECK(out.find("# TYPE doge_test_lookups_total", header + 1) == std::string::npos);
+        BOOST_CHECK(Contains(out, "doge_test_lookups_total{result=\"hit\"} 3\n"));
+        BOOST_CHECK(Contains(out, "doge_test_lookups_total{result=\"miss\"} 1\n"));
+        BOOST_CHECK(Contains(out, "doge_test_height 42\n"));
+    }
+    // Destroyed metrics are no longer exported
+    BOOST_CHECK(!Contains(RenderMetrics(), "doge_test_height"));
+}
+
+BOOST_AUTO_TEST_CASE(metrics_histogram)
+{
+    CMetricHistogram histogram("test_duration_seconds", "Test durations", "stage=\"a\"");
+    histogram.Observe(5);        // first bucket
+    histogram.Observe(15);       // <= 20us
+    histogram.Observe(60000000); // beyond the largest bound
+    BOOST_CHECK_EQUAL(histogram.Count(), 3U);
+    BOOST_CHECK_EQUAL(histogram.SumMicros(), 60000020U);
+
+    const std::string out = RenderMetrics();
+    BOOST_CHECK(Contains(out, "# TYPE doge_test_duration_seconds histogram\n"));
+    BOOST_CHECK(Contains(out, "doge_test_duration_seconds_bucket{stage=\"a\",le=\"0.00001\"} 1\n"));
+    BOOST_CHECK(Contains(out, "doge_test_duration_seconds_bucket{stage=\"a\",le=\"0.00002\"} 2\n"));
+    BOOST_CHECK(Contains(out, "doge_test_duration_seconds_bucket{stage=\"a\",le=\"+Inf\"} 3\n"));
+    BOOST_CHECK(Contains(out, "doge_test_duration_seconds_sum{stage=\"a\"} 60.000020\n"));
+    BOOST_CHECK(Contains(out, "doge_test_duration_seconds_count{stage=\"a\"} 3\n"));
+}
+
+BOOST_AUTO_TEST_CASE(metrics_collector)
+{
+    RegisterMetricsCollector("test", [](std::string& out) {
+        AppendMetric(out, "test_queue_depth", "gauge", "Test queue depth", {{"queue=\"x\"", 7}});
+    });
+    const std::string out = RenderMetrics();
+    BOOST_CHECK(Contains(out, "# TYPE doge_test_queue_depth gauge\n"));
+    BOOST_CHECK(Contains(out, "doge_test_queue_depth{queue=\"x\"} 7\n"));
+
+    UnregisterMetricsCollector("test");
+    BOOST_CHECK(!Contains(RenderMetrics(), "doge_test_queue_depth"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
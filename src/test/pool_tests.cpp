@@ -0,0 +1,92 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/test_bitcoin.h>
+
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(pool_resource_reuse)
+{
+    PoolResource<64, 8> resource(1024);
+    void* a = resource.Allocate(24, 8);
+    void* b = resource.Allocate(20, 4);
+    BOOST_CHECK(a != b);
+    BOOST_CHECK_EQUAL(resource.PooledBytesInUse(), 48U);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // Freed blocks are reused for the same size class
+    resource.Deallocate(a, 24, 8);
+    BOOST_CHECK_EQUAL(resource.PooledBytesInUse(), 24U);
+    BOOST_CHECK_EQUAL(resource.PooledBytesFree(), 24U);
+    BOOST_CHECK(resource.Allocate(17, 8) == a);
+    BOOST_CHECK_EQUAL(resource.PooledBytesFree(), 0U);
+
+    // Too large or too strictly aligned allocations bypass the pool
+    void* big = resource.Allocate(65, 8);
+    resource.Deallocate(big, 65, 8);
+    BOOST_CHECK_EQUAL(resource.PooledBytesInUse(), 48U);
+
+    // A new chunk is started once the current one is used up
+    for (int i = 0; i < 40; i++) {
+        resource.Allocate(64, 8);
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 3U);
+    BOOST_CHECK_EQUAL(resource.PooledBytesInUse(), 48U + 40 * 64);
+}
+
+BOOST_AUTO_TEST_CASE(pool_allocator_map)
+{
+    typedef PoolAllocator<std::pair<const int, int>, 64, 8> Allocator;
+    Allocator::ResourceType resource;
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Allocator> map(0, std::hash<int>(), std::equal_to<int>(), &resource);
+    for (int i = 0; i < 10000; i++) {
+        map[i] = i;
+    }
+    const size_t usage = memusage::DynamicUsage(map);
+    BOOST_CHECK(resource.PooledBytesInUse() > 0);
+    BOOST_CHECK(usage >= resource.PooledBytesInUse());
+
+    // Erased nodes go back to the pool and are no longer counted
+    for (int i = 0; i < 5000; i++) {
+        map.erase(i);
+    }
+    BOOST_CHECK(memusage::DynamicUsage(map) < usage);
+    const size_t chunks = resource.NumAllocatedChunks();
+    for (int i = 0; i < 5000; i++) {
+        map[i] = i;
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), chunks);
+
+    // Copies do not share the resource
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Allocator> copy(map);
+    BOOST_CHECK(copy.get_allocator().resource() == nullptr);
+    BOOST_CHECK_EQUAL(copy.size(), map.size());
+}
+
+BOOST_AUTO_TEST_CASE(pool_coins_cache_usage)
+{
+    // Pooled nodes cost less than separately allocated ones
+    CCoinsView base;
+    CCoinsViewCache cache(&base);
+    CCoinsMap unpooled;
+    for (uint32_t n = 0; n < 20000; n++) {
+        COutPoint outpoint(uint256S("0x1"), n);
+        cache.AddCoin(outpoint, Coin(CTxOut(n, CScript() << OP_TRUE), 1, false), false);
+        unpooled.emplace(outpoint, CCoinsCacheEntry());
+    }
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 20000U);
+    BOOST_CHECK(cache.DynamicMemoryUsage() < memusage::DynamicUsage(unpooled));
+    // Flushing returns the pool to the system
+    cache.Flush();
+    BOOST_CHECK(cache.DynamicMemoryUsage() < 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <restcache.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(restcache_tests, BasicTestingSetup)
+
+static std::shared_ptr<const CRESTCacheEntry> MakeEntry(const std::string& body, int nHeight, const uint256& tip = uint256())
+{
+    return std::make_shared<const CRESTCacheEntry>(std::string(body), "application/json", nHeight, tip);
+}
+
+BOOST_AUTO_TEST_CASE(restcache_lookup_insert)
+{
+    CRESTCache cache(1 << 20);
+    const uint256 tip = uint256S("01");
+    BOOST_CHECK(!cache.Lookup("a", tip));
+    BOOST_CHECK(cache.Insert("a", MakeEntry("body a", 10), cache.Generation()));
+    std::shared_ptr<const CRESTCacheEntry> entry = cache.Lookup("a", tip);
+    BOOST_REQUIRE(entry);
+    BOOST_CHECK_EQUAL(entry->body, "body a");
+    BOOST_CHECK_EQUAL(cache.Hits(), 1U);
+    BOOST_CHECK_EQUAL(cache.Misses(), 1U);
+
+    // ETags depend on content only
+    BOOST_CHECK_EQUAL(entry->etag, MakeEntry("body a", 5)->etag);
+    BOOST_CHECK(entry->etag != MakeEntry("body b", 10)->etag);
+
+    // Tip-dependent entries are only served at the tip they were rendered at
+    BOOST_CHECK(cache.Insert("b", MakeEntry("body b", 10, tip), cache.Generation()));
+    BOOST_CHECK(cache.Lookup("b", tip));
+    BOOST_CHECK(!cache.Lookup("b", uint256S("02")));
+    BOOST_CHECK(!cache.Lookup("b", tip));
+
+    BOOST_CHECK(cache.Insert("c", MakeEntry("body c", 10, tip), cache.Generation()));
+    cache.EraseTipDependent();
+    BOOST_CHECK(!cache.Lookup("c", tip));
+    BOOST_CHECK(cache.Lookup("a", tip));
+}
+
+BOOST_AUTO_TEST_CASE(restcache_invalidate)
+{
+    CRESTCache cache(1 << 20);
+    const uint256 tip;
+    const uint64_t generation = cache.Generation();
+    BOOST_CHECK(cache.Insert("low", MakeEntry("x", 100), generation));
+    BOOST_CHECK(cache.Insert("high", MakeEntry("y", 200), generation));
+
+    // A disconnect drops entries at or above its height
+    cache.InvalidateFrom(150);
+    BOOST_CHECK(cache.Lookup("low", tip));
+    BOOST_CHECK(!cache.Lookup("high", tip));
+
+    // Replies rendered before the disconnect are refused
+    BOOST_CHECK(!cache.Insert("high", MakeEntry("y", 200), generation));
+    BOOST_CHECK(cache.Insert("high", MakeEntry("y", 200), cache.Generation()));
+    BOOST_CHECK_EQUAL(cache.Size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(restcache_budget)
+{
+    CRESTCache disabled;
+    BOOST_CHECK(!disabled.Enabled());
+    BOOST_CHECK(!disabled.Insert("a", MakeEntry("a", 1), disabled.Generation()));
+
+    CRESTCache cache(64 * 1024);
+    const std::string body(4000, 'x');
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK(cache.Insert(std::to_string(i), MakeEntry(body, i), cache.Generation()));
+        BOOST_CHECK(cache.Bytes() <= 64 * 1024);
+    }
+    // Least recently used entries went first
+    BOOST_CHECK(cache.Size() < 100);
+    BOOST_CHECK(!cache.Lookup("0", uint256()));
+    BOOST_CHECK(cache.Lookup("99", uint256()));
+
+    // Replies larger than a quarter of the budget are not cached
+    BOOST_CHECK(!cache.Insert("big", MakeEntry(std::string(20000, 'x'), 1), cache.Generation()));
+
+    cache.SetMaxBytes(16 * 1024);
+    BOOST_CHECK(cache.Bytes() <= 16 * 1024);
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+    BOOST_CHECK_EQUAL(cache.Bytes(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 #include <script/script.h>
 #include <script/script_error.h>
 #include <script/standard.h>
+#include <streams.h>
 #include <test/test_bitcoin.h>
 
 #include <boost/test/unit_test.hpp>
@@ -245,6 +246,55 @@ BOOST_AUTO_TEST_CASE(script_standard_ExtractDestination)
     BOOST_CHECK(boost::get<WitnessUnknown>(&address) && *boost::get<WitnessUnknown>(&address) == unk);
 }
 
+BOOST_AUTO_TEST_CASE(script_standard_CCompactScript)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey = key.GetPubKey();
+    const CScript p2pkh = GetScriptForDestination(pubkey.GetID());
+
+    const std::vector<std::pair<CScript, uint8_t>> cases{
+        {GetScriptForRawPubKey(pubkey), CCompactScript::PUBKEYHASH},
+        {p2pkh, CCompactScript::PUBKEYHASH},
+        {GetScriptForDestination(CScriptID(p2pkh)), CCompactScript::SCRIPTHASH},
+        {CScript() << OP_0 << ToByteVector(pubkey.GetID()), CCompactScript::WITNESS_V0_KEYHASH},
+        {GetScriptForMultisig(1, {pubkey}), CCompactScript::OTHER},
+        {CScript() << OP_RETURN << std::vector<unsigned char>({75}), CCompactScript::OTHER},
+        {CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(19) << OP_EQUALVERIFY << OP_CHECKSIG, CCompactScript::OTHER},
+    };
+    for (const auto& c : cases) {
+        const CCompactScript compact(c.first);
+        BOOST_CHECK_EQUAL(compact.nType, c.second);
+
+        // The destination agrees with ExtractDestination
+        CTxDestination dest, expected;
+        BOOST_CHECK_EQUAL(compact.GetDestination(dest), c.second != CCompactScript::OTHER);
+        if (ExtractDestination(c.first, expected) && c.second != CCompactScript::OTHER) {
+            BOOST_CHECK(dest == expected);
+        }
+
+        // Pay-to-pubkey is kept as pay-to-pubkey-hash, everything else as it was
+        if (c.first == cases[0].first) {
+            BOOST_CHECK(compact.GetScript() == p2pkh);
+        } else {
+            BOOST_CHECK(compact.GetScript() == c.first);
+        }
+        BOOST_CHECK_EQUAL(compact.script.empty(), c.second != CCompactScript::OTHER);
+
+        CDataStream ss(SER_DISK, 0);
+        ss << compact;
+        BOOST_CHECK_EQUAL(ss.size(), c.second == CCompactScript::OTHER ? 1 + GetSerializeSize(c.first, SER_DISK, 0) : 21U);
+        CCompactScript compact2;
+        ss >> compact2;
+        BOOST_CHECK(compact2 == compact);
+    }
+
+    CDataStream ss(SER_DISK, 0);
+    ss << uint8_t{4} << uint160();
+    CCompactScript compact;
+    BOOST_CHECK_THROW(ss >> compact, std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_CASE(script_standard_ExtractDestinations)
 {
     CKey keys[3];
@@ -161,6 +161,46 @@ BOOST_AUTO_TEST_CASE(sighash_test)
     #endif
 }
 
+// Goal: check that the precomputed legacy signature hash agrees with the plain one
+BOOST_AUTO_TEST_CASE(sighash_legacy_precomputed)
+{
+    SeedInsecureRand(false);
+
+    for (int i = 0; i < 100; i++) {
+        CMutableTransaction txTo;
+        RandomTransaction(txTo, false);
+        // Span several midstate checkpoints, with fewer outputs than inputs
+        // so SIGHASH_SINGLE also hits the out of range case
+        int ins = LEGACY_SIGHASH_MIN_INPUTS + InsecureRandRange(4 * LEGACY_SIGHASH_CHECKPOINT_INPUTS);
+        txTo.vin.resize(ins);
+        for (int in = 0; in < ins; in++) {
+            txTo.vin[in].prevout.hash = InsecureRand256();
+            txTo.vin[in].prevout.n = InsecureRandBits(2);
+            RandomScript(txTo.vin[in].scriptSig);
+            txTo.vin[in].nSequence = InsecureRand32();
+        }
+        txTo.vout.resize(ins - InsecureRandRange(3));
+        for (CTxOut& txout : txTo.vout) {
+            txout.nValue = InsecureRandRange(100000000);
+            RandomScript(txout.scriptPubKey);
+        }
+        const CTransaction tx(txTo);
+        const PrecomputedTransactionData txdata(tx);
+        // Built by the first legacy signature hash only
+        BOOST_CHECK(!txdata.legacy);
+
+        for (int nIn = 0; nIn < ins; nIn++) {
+            int nHashType = InsecureRand32();
+            CScript scriptCode;
+            RandomScript(scriptCode);
+            uint256 sh = SignatureHash(scriptCode, tx, nIn, nHashType, 0, SigVersion::BASE, &txdata);
+            BOOST_CHECK(sh == SignatureHashOld(scriptCode, tx, nIn, nHashType));
+        }
+        SignatureHash(CScript(), tx, 0, SIGHASH_ALL, 0, SigVersion::BASE, &txdata);
+        BOOST_CHECK(txdata.legacy && !txdata.legacy->midstates[0].empty());
+    }
+}
+
 // Goal: check that SignatureHash generates correct hash
 BOOST_AUTO_TEST_CASE(sighash_from_data)
 {
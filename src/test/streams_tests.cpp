@@ -68,6 +68,30 @@ BOOST_AUTO_TEST_CASE(streams_vector_writer)
     vch.clear();
 }
 
+BOOST_AUTO_TEST_CASE(streams_span_reader)
+{
+    const std::vector<unsigned char> vch = {1, 255, 3, 4, 5, 6};
+    SpanReader reader(SER_NETWORK, INIT_PROTO_VERSION, MakeSpan(vch));
+    BOOST_CHECK_EQUAL(reader.size(), 6U);
+
+    unsigned char a;
+    reader >> a;
+    BOOST_CHECK_EQUAL(a, 1);
+    uint16_t b;
+    reader >> b;
+    BOOST_CHECK_EQUAL(b, 0x03ff); // little endian
+    reader.ignore(1);
+    BOOST_CHECK_EQUAL(reader.size(), 2U);
+
+    // Reading past the end throws and leaves the rest unread
+    uint32_t c;
+    BOOST_CHECK_THROW(reader >> c, std::ios_base::failure);
+    BOOST_CHECK_THROW(reader.ignore(3), std::ios_base::failure);
+    reader >> b;
+    BOOST_CHECK_EQUAL(b, 0x0605);
+    BOOST_CHECK(reader.empty());
+}
+
 BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
 {
     std::vector<char> in;
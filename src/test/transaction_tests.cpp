@@ -8,6 +8,7 @@
 
 #include <clientversion.h>
 #include <checkqueue.h>
+#include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
 #include <core_io.h>
@@ -677,6 +678,39 @@ BOOST_AUTO_TEST_CASE(test_witness)
     CheckWithFlag(output1, input1, STANDARD_SCRIPT_VERIFY_FLAGS, true);
 }
 
+BOOST_AUTO_TEST_CASE(transaction_refs_txids)
+{
+    CBlock block;
+    for (int i = 0; i < 20; i++) {
+        CMutableTransaction tx;
+        tx.nVersion = i;
+        tx.vin.resize(1 + i % 3);
+        tx.vout.resize(i);
+        for (CTxOut& out : tx.vout) {
+            out.nValue = i;
+            out.scriptPubKey = CScript() << std::vector<unsigned char>(i * 10, i);
+        }
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+
+    // Deserialization computes the txids together, and must agree with the one at a time way
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    CBlock block2;
+    ss >> block2;
+    BOOST_REQUIRE_EQUAL(block2.vtx.size(), block.vtx.size());
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        BOOST_CHECK(block2.vtx[i]->GetHash() == block.vtx[i]->GetHash());
+        BOOST_CHECK(block2.vtx[i]->GetWitnessHash() == block.vtx[i]->GetWitnessHash());
+    }
+    BOOST_CHECK(block2.GetHash() == block.GetHash());
+    BOOST_CHECK(BlockMerkleRoot(block2) == BlockMerkleRoot(block));
+
+    std::vector<CTransactionRef> vtx;
+    MakeTransactionRefs(std::vector<CMutableTransaction>(), vtx);
+    BOOST_CHECK(vtx.empty());
+}
+
 BOOST_AUTO_TEST_CASE(test_IsStandard)
 {
     LOCK(cs_main);
@@ -0,0 +1,155 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <key.h>
+#include <txdb.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+CBlockLocator TestLocator(const std::string& hash)
+{
+    return CBlockLocator(std::vector<uint256>{uint256S(hash), uint256S("0x01")});
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(txdb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(txindex_best_block)
+{
+    SetDataDir("txindex_best_block");
+    CTxIndexDB index(true);
+    CBlockLocator locator;
+    BOOST_CHECK(!index.ReadBestBlock(locator));
+
+    // The best block is written with the entries
+    const uint256 txid = InsecureRand256();
+    BOOST_CHECK(index.Write(txid, CDiskTxPos(CDiskBlockPos(1, 2), 3)));
+    index.SetBestBlock(TestLocator("0xaa"));
+    BOOST_CHECK(index.Flush());
+    BOOST_CHECK(index.ReadBestBlock(locator));
+    BOOST_CHECK(locator.vHave == TestLocator("0xaa").vHave);
+    CDiskTxPos pos;
+    BOOST_CHECK(index.Read(txid, pos));
+    BOOST_CHECK_EQUAL(pos.nTxOffset, 3U);
+
+    // Writes alone do not move it
+    BOOST_CHECK(index.Write(InsecureRand256(), CDiskTxPos()));
+    BOOST_CHECK(index.Flush());
+    BOOST_CHECK(index.ReadBestBlock(locator));
+    BOOST_CHECK(locator.vHave == TestLocator("0xaa").vHave);
+
+    // The cache is only written when asked to, however large it gets
+    for (size_t n = 0; n <= MAX_INDEX_CACHE_ENTRIES; n++) {
+        BOOST_CHECK(index.Write(ArithToUint256(arith_uint256(n)), CDiskTxPos()));
+    }
+    BOOST_CHECK(index.IsCacheLarge());
+    index.SetBestBlock(TestLocator("0xbb"));
+    BOOST_CHECK(index.Flush());
+    BOOST_CHECK(!index.IsCacheLarge());
+    BOOST_CHECK(index.ReadBestBlock(locator));
+    BOOST_CHECK(locator.vHave == TestLocator("0xbb").vHave);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_best_block)
+{
+    SetDataDir("addressindex_best_block");
+    CAddressIndexDB index(true);
+    const CScript script = CScript() << OP_TRUE;
+    const CAddressKey key(script, COutPoint(InsecureRand256(), 0));
+    BOOST_CHECK(index.Write(key, CAddressValue(5, 10, false)));
+    index.SetBestBlock(TestLocator("0xaa"));
+    BOOST_CHECK(index.Flush());
+
+    // Erasing the entry is written together with the new best block
+    BOOST_CHECK(index.Write(key, CAddressValue()));
+    index.SetBestBlock(TestLocator("0xbb"));
+    BOOST_CHECK(index.Flush());
+    std::map<CAddressKey, CAddressValue> entries;
+    BOOST_CHECK(index.Read(script, entries));
+    BOOST_CHECK(entries.empty());
+    CBlockLocator locator;
+    BOOST_CHECK(index.ReadBestBlock(locator));
+    BOOST_CHECK(locator.vHave == TestLocator("0xbb").vHave);
+}
+
+BOOST_AUTO_TEST_CASE(blocktree_merkle_roots)
+{
+    CBlockTreeDB db(1 << 20, true);
+    const uint256 hash = InsecureRand256();
+    const uint256 root = InsecureRand256();
+    CBlockIndex index;
+    index.phashBlock = &hash;
+    uint256 read;
+    BOOST_CHECK(!db.ReadMerkleRoot(hash, read));
+
+    db.WriteMerkleRoot(hash, root);
+    BOOST_CHECK_EQUAL(db.GetCachedMerkleRoots(), 1U);
+    BOOST_CHECK(db.ReadMerkleRoot(hash, read));
+    BOOST_CHECK(read == root);
+
+    // Once written the root is no longer pending, it is still found
+    BOOST_CHECK(db.WriteBatchSync({}, 0, {&index}));
+    BOOST_CHECK_EQUAL(db.GetCachedMerkleRoots(), 0U);
+    read.SetNull();
+    BOOST_CHECK(db.ReadMerkleRoot(hash, read));
+    BOOST_CHECK(read == root);
+
+    // Roots evicted from the read cache come from the stored entries
+    std::vector<uint256> others(MAX_MERKLE_ROOT_CACHE_ENTRIES);
+    std::vector<CBlockIndex> other_index(others.size());
+    std::vector<const CBlockIndex*> blockinfo;
+    for (size_t n = 0; n < others.size(); n++) {
+        others[n] = ArithToUint256(arith_uint256(n));
+        other_index[n].phashBlock = &others[n];
+        blockinfo.push_back(&other_index[n]);
+        db.WriteMerkleRoot(others[n], others[n]);
+    }
+    BOOST_CHECK(db.WriteBatchSync({}, 0, blockinfo));
+    read.SetNull();
+    BOOST_CHECK(db.ReadMerkleRoot(hash, read));
+    BOOST_CHECK(read == root);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_upgrade)
+{
+    SetDataDir("addressindex_upgrade");
+    CAddressIndexDB index(true);
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript p2pk = GetScriptForRawPubKey(key.GetPubKey());
+    const CScript p2pkh = GetScriptForDestination(key.GetPubKey().GetID());
+    const CScript other = CScript() << OP_TRUE;
+
+    const CLegacyAddressKey key1{p2pk, COutPoint(InsecureRand256(), 1)};
+    const CLegacyAddressKey key2{other, COutPoint(InsecureRand256(), 2)};
+    BOOST_CHECK(index.CDBWrapper::Write(std::make_pair('a', key1), CAddressValue(5, 10, false)));
+    BOOST_CHECK(index.CDBWrapper::Write(std::make_pair('a', key2), CAddressValue(7, 11, true)));
+    BOOST_CHECK(index.Upgrade());
+
+    // Pay-to-pubkey outputs are found under the key hash, as before
+    std::map<CAddressKey, CAddressValue> entries;
+    BOOST_CHECK(index.Read(p2pkh, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries.begin()->first.out == key1.out);
+    BOOST_CHECK(entries.begin()->first.script.GetScript() == p2pkh);
+    BOOST_CHECK_EQUAL(entries.begin()->second.value, 5);
+
+    entries.clear();
+    BOOST_CHECK(index.Read(other, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries.begin()->first.out == key2.out);
+    BOOST_CHECK(entries.begin()->second.iscoinbase);
+
+    // The old records are gone, so a second upgrade has nothing to do
+    BOOST_CHECK(!index.Exists(std::make_pair('a', key1)));
+    BOOST_CHECK(index.Upgrade());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -141,6 +141,72 @@ static void ValidateCheckInputsForAllFlags(const CTransaction &tx, uint32_t fail
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(runchecks_batch, BasicTestingSetup)
+{
+    CKey key[3];
+    for (CKey& k : key) k.MakeNewKey(true);
+
+    // Outputs to spend: P2PKH, a 2-of-3 multisig, and one that requires an
+    // invalid signature
+    std::vector<CTxOut> vOut;
+    vOut.emplace_back(1, GetScriptForDestination(key[0].GetPubKey().GetID()));
+    vOut.emplace_back(1, GetScriptForDestination(key[1].GetPubKey().GetID()));
+    vOut.emplace_back(1, GetScriptForMultisig(2, {key[0].GetPubKey(), key[1].GetPubKey(), key[2].GetPubKey()}));
+    vOut.emplace_back(1, CScript() << ToByteVector(key[2].GetPubKey()) << OP_CHECKSIG << OP_NOT);
+
+    CMutableTransaction spend;
+    spend.vin.resize(vOut.size());
+    for (size_t i = 0; i < vOut.size(); i++) {
+        spend.vin[i].prevout = COutPoint(InsecureRand256(), i);
+    }
+    spend.vout.emplace_back(1, CScript() << OP_TRUE);
+    auto Sign = [&](const CKey& k, unsigned int nIn) {
+        std::vector<unsigned char> sig;
+        uint256 hash = SignatureHash(vOut[nIn].scriptPubKey, spend, nIn, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(k.Sign(hash, sig));
+        sig.push_back(SIGHASH_ALL);
+        return sig;
+    };
+    // The multisig skips the second key, and the last input carries a
+    // signature by the wrong key. Neither is right if all signatures are
+    // assumed valid, so both take the fallback path.
+    std::vector<unsigned char> sigBad = Sign(key[0], 3);
+    spend.vin[0].scriptSig = CScript() << Sign(key[0], 0) << ToByteVector(key[0].GetPubKey());
+    spend.vin[1].scriptSig = CScript() << Sign(key[1], 1) << ToByteVector(key[1].GetPubKey());
+    spend.vin[2].scriptSig = CScript() << OP_0 << Sign(key[0], 2) << Sign(key[2], 2);
+    spend.vin[3].scriptSig = CScript() << sigBad;
+    const CTransaction tx(spend);
+    PrecomputedTransactionData txdata(tx);
+
+    auto MakeChecks = [&](unsigned int flags) {
+        std::vector<CScriptCheck> vChecks;
+        for (size_t i = 0; i < tx.vin.size(); i++) {
+            vChecks.emplace_back(vOut[i], tx, i, flags, false, &txdata);
+        }
+        return vChecks;
+    };
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC;
+    std::vector<CScriptCheck> vChecks = MakeChecks(flags);
+    for (CScriptCheck& check : vChecks) BOOST_CHECK(check());
+    vChecks = MakeChecks(flags);
+    BOOST_CHECK(RunChecks(vChecks));
+
+    // With NULLFAIL the last input is invalid, batched or not
+    vChecks = MakeChecks(flags | SCRIPT_VERIFY_NULLFAIL);
+    BOOST_CHECK(!RunChecks(vChecks));
+
+    // A signature of another input does not pass either
+    spend.vin[1].scriptSig = CScript() << Sign(key[1], 0) << ToByteVector(key[1].GetPubKey());
+    const CTransaction txBad(spend);
+    PrecomputedTransactionData txdataBad(txBad);
+    vChecks.clear();
+    for (size_t i = 0; i < txBad.vin.size(); i++) {
+        vChecks.emplace_back(vOut[i], txBad, i, flags, false, &txdataBad);
+    }
+    BOOST_CHECK(!vChecks[1]());
+    BOOST_CHECK(!RunChecks(vChecks));
+}
+
 BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
 {
     // Test that passing CheckInputs with one set of script flags doesn't imply
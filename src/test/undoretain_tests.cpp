@@ -0,0 +1,136 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <test/test_bitcoin.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+struct UndoRetainSetup : public TestChain100Setup {
+    const CScript m_script = CScript() << OP_TRUE;
+
+    ~UndoRetainSetup()
+    {
+        nUndoRetain = DEFAULT_UNDO_RETAIN;
+    }
+
+    //! Mine nBlocks into a new block file and return its number
+    int MineInNewFile(int nBlocks)
+    {
+        {
+            LOCK(cs_main);
+            GetBlockFileInfo(chainActive.Tip()->GetBlockPos().nFile)->nSize = MAX_BLOCKFILE_SIZE;
+        }
+        for (int i = 0; i < nBlocks; i++) {
+            CreateAndProcessBlock({}, m_script);
+        }
+        LOCK(cs_main);
+        return chainActive.Tip()->GetBlockPos().nFile;
+    }
+};
+
+bool HaveUndoFile(int nFile)
+{
+    return fs::exists(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "rev"));
+}
+
+bool HaveUndo(int nHeight)
+{
+    LOCK(cs_main);
+    return (chainActive[nHeight]->nStatus & BLOCK_HAVE_UNDO) != 0;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(undoretain_tests, UndoRetainSetup)
+
+BOOST_AUTO_TEST_CASE(undoretain_prune_and_restart)
+{
+    const CChainParams& chainparams = Params();
+    const int nHeight0 = chainActive.Height();
+    BOOST_CHECK_EQUAL(chainActive.Tip()->GetBlockPos().nFile, 0);
+
+    // Files 1 and 2 hold 50 blocks each, file 3 is the one written to
+    BOOST_CHECK_EQUAL(MineInNewFile(50), 1);
+    BOOST_CHECK_EQUAL(MineInNewFile(50), 2);
+    BOOST_CHECK_EQUAL(MineInNewFile(1), 3);
+    for (int nFile = 0; nFile <= 3; nFile++) {
+        BOOST_CHECK(HaveUndoFile(nFile));
+    }
+
+    // Only files whose last block is below the retention window lose their undo data
+    nUndoRetain = 60;
+    CreateAndProcessBlock({}, m_script);
+    BOOST_CHECK_EQUAL(chainActive.Height(), nHeight0 + 102);
+    BOOST_CHECK_EQUAL(GetBlockFileInfo(0)->nUndoSize, 0U);
+    BOOST_CHECK(!HaveUndoFile(0));
+    BOOST_CHECK(!HaveUndo(nHeight0));
+    for (int nFile = 1; nFile <= 3; nFile++) {
+        BOOST_CHECK(GetBlockFileInfo(nFile)->nUndoSize > 0);
+        BOOST_CHECK(HaveUndoFile(nFile));
+    }
+    BOOST_CHECK(HaveUndo(nHeight0 + 1));
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(chainActive[nHeight0]->nStatus & BLOCK_HAVE_DATA);
+    }
+
+    // A reorganization past the deleted undo data is refused without disconnecting anything
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(!InvalidateBlock(state, chainparams, chainActive[nHeight0 - 10]));
+        BOOST_CHECK(state.IsError());
+        BOOST_CHECK_EQUAL(chainActive.Height(), nHeight0 + 102);
+    }
+
+    // One within the retained undo data works
+    {
+        CValidationState state;
+        CBlockIndex* pindex;
+        {
+            LOCK(cs_main);
+            pindex = chainActive[nHeight0 + 10];
+            BOOST_CHECK(InvalidateBlock(state, chainparams, pindex));
+            BOOST_CHECK_EQUAL(chainActive.Height(), nHeight0 + 9);
+            ResetBlockFailureFlags(pindex);
+        }
+        BOOST_CHECK(ActivateBestChain(state, chainparams));
+        BOOST_CHECK_EQUAL(chainActive.Height(), nHeight0 + 102);
+    }
+
+    // Restart: the retained undo data is still there, and the block lists of
+    // the files are rebuilt from the block index
+    FlushStateToDisk();
+    UnloadBlockIndex();
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(LoadBlockIndex(chainparams));
+        BOOST_CHECK(LoadChainTip(chainparams));
+    }
+    BOOST_CHECK_EQUAL(chainActive.Height(), nHeight0 + 102);
+    BOOST_CHECK_EQUAL(GetBlockFileInfo(0)->nUndoSize, 0U);
+    BOOST_CHECK(!HaveUndo(nHeight0));
+    for (int nFile = 1; nFile <= 3; nFile++) {
+        BOOST_CHECK(GetBlockFileInfo(nFile)->nUndoSize > 0);
+        BOOST_CHECK(HaveUndoFile(nFile));
+    }
+    BOOST_CHECK(HaveUndo(nHeight0 + 1));
+
+    nUndoRetain = 30;
+    CreateAndProcessBlock({}, m_script);
+    BOOST_CHECK(!HaveUndoFile(1));
+    BOOST_CHECK(!HaveUndo(nHeight0 + 1));
+    BOOST_CHECK(!HaveUndo(nHeight0 + 50));
+    BOOST_CHECK(HaveUndoFile(2));
+    BOOST_CHECK(HaveUndo(nHeight0 + 51));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,80 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <primitives/block.h>
+#include <test/test_bitcoin.h>
+#include <validationinterface.h>
+
+#include <future>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, TestingSetup)
+
+struct FlushCounter : public CValidationInterface
+{
+    std::atomic<int> m_flushed{0};
+    std::shared_future<void> m_release;
+
+    void ChainStateFlushed(const CBlockLocator& locator) override
+    {
+        if (m_release.valid()) m_release.wait();
+        m_flushed++;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(subscriber_queues_are_independent)
+{
+    // A second scheduler thread lets the two queues make progress concurrently
+    boost::thread extra_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+
+    std::promise<void> release;
+    FlushCounter slow, fast;
+    slow.m_release = release.get_future().share();
+    RegisterValidationInterface(&slow, "slow", ValidationQueuePolicy::NO_WAIT);
+    RegisterValidationInterface(&fast, "fast");
+
+    for (int i = 0; i < 3; i++) {
+        GetMainSignals().ChainStateFlushed(CBlockLocator());
+    }
+
+    // The fast subscriber catches up while the slow one is stuck
+    SyncWithValidationInterfaceQueue(&fast);
+    BOOST_CHECK_EQUAL(fast.m_flushed, 3);
+    BOOST_CHECK_EQUAL(slow.m_flushed, 0);
+
+    // Only WAIT subscribers count towards the backlog validation waits for
+    BOOST_CHECK_EQUAL(GetMainSignals().CallbacksPending(), 0U);
+
+    bool found_slow = false;
+    for (const ValidationInterfaceStats& stats : GetValidationInterfaceStats()) {
+        if (stats.name == "fast") {
+            BOOST_CHECK(stats.policy == ValidationQueuePolicy::WAIT);
+            BOOST_CHECK_EQUAL(stats.pending, 0U);
+            BOOST_CHECK(stats.processed >= 3);
+        } else if (stats.name == "slow") {
+            found_slow = true;
+            BOOST_CHECK(stats.policy == ValidationQueuePolicy::NO_WAIT);
+            BOOST_CHECK(stats.pending >= 2);
+        }
+    }
+    BOOST_CHECK(found_slow);
+
+    release.set_value();
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(slow.m_flushed, 3);
+
+    // Unregistered subscribers no longer receive callbacks
+    UnregisterValidationInterface(&fast);
+    UnregisterValidationInterface(&slow);
+    GetMainSignals().ChainStateFlushed(CBlockLocator());
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(fast.m_flushed, 3);
+
+    extra_thread.interrupt();
+    extra_thread.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,12 +8,14 @@
 
 #include <chainparams.h>
 #include <hash.h>
+#include <metrics.h>
 #include <random.h>
 #include <pow.h>
 #include <shutdown.h>
 #include <uint256.h>
 #include <util.h>
 #include <ui_interface.h>
+#include <warnings.h>
 
 #include <stdint.h>
 
@@ -24,8 +26,10 @@ static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_BLOCK_INDEX = 'b';
-static const char DB_ADDRESS = 'a';
+static const char DB_ADDRESS = 'A';
+static const char DB_ADDRESS_SCRIPT = 'a'; //!< Address index keys with whole scripts, see CAddressIndexDB::Upgrade
 static const char DB_BLOCKAUX = 'x';
+static const char DB_BLOCKSTATS = 's';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -61,15 +65,49 @@ CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(Get
 {
 }
 
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (m_writer.joinable()) m_writer.join();
+}
+
+static CMetricCounter g_metric_coins_db_reads("coins_db_reads_total", "Coin lookups that reached the chainstate database");
+
+static CMetricHistogram g_metric_coins_flush("coins_flush_duration_seconds", "Writing coin cache entries to the chainstate database");
+
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        CCoinsMap::const_iterator it;
+        if (m_pending && (it = m_pending->find(outpoint)) != m_pending->end()) {
+            if (it->second.coin.IsSpent()) return false;
+            coin = it->second.coin;
+            return true;
+        }
+    }
+    g_metric_coins_db_reads.Inc();
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        CCoinsMap::const_iterator it;
+        if (m_pending && (it = m_pending->find(outpoint)) != m_pending->end()) {
+            return !it->second.coin.IsSpent();
+        }
+    }
     return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        if (!m_pending_block.IsNull()) return m_pending_block;
+    }
+    return ReadBestBlock();
+}
+
+uint256 CCoinsViewDB::ReadBestBlock() const {
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -85,6 +123,84 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    // Writes are applied in order, so wait for the previous one
+    if (!WaitForWrites()) return false;
+    if (m_writer.joinable()) m_writer.join();
+    if (!m_async_writes) {
+        int64_t nStart = GetTimeMicros();
+        bool ret = WriteCoins(mapCoins, hashBlock, true);
+        g_metric_coins_flush.Observe(GetTimeMicros() - nStart);
+        return ret;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        // Move the entries rather than the map, which may allocate from the caller's pool
+        m_pending.reset(new CCoinsMap());
+        m_pending->reserve(mapCoins.size());
+        for (auto& entry : mapCoins) {
+            m_pending->emplace(entry.first, std::move(entry.second));
+        }
+        m_pending_block = hashBlock;
+        m_pending_usage = memusage::DynamicUsage(*m_pending);
+        for (const auto& entry : *m_pending) {
+            m_pending_usage += entry.second.coin.DynamicMemoryUsage();
+        }
+        m_writing = true;
+    }
+    mapCoins.clear();
+    LogPrint(BCLog::COINDB, "Writing %u coin cache entries in the background\n", (unsigned int)m_pending->size());
+    m_writer = std::thread(&CCoinsViewDB::WriterThread, this);
+    return true;
+}
+
+void CCoinsViewDB::WriterThread()
+{
+    RenameThread("dogecoin-coinsflush");
+    int64_t nStart = GetTimeMicros();
+    bool fOk = false;
+    try {
+        // m_pending is not modified while m_writing is set, so it is read without the lock
+        fOk = WriteCoins(*m_pending, m_pending_block, false);
+    } catch (const std::exception& e) {
+        LogPrintf("%s: %s\n", __func__, e.what());
+    }
+    g_metric_coins_flush.Observe(GetTimeMicros() - nStart);
+    {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        if (fOk) {
+            m_pending.reset();
+            m_pending_block.SetNull();
+            m_pending_usage = 0;
+        } else {
+            // Keep serving the entries, the node is shutting down
+            m_write_failed = true;
+        }
+        m_writing = false;
+    }
+    m_pending_cv.notify_all();
+    if (!fOk) {
+        SetMiscWarning("Failed to write to coin database");
+        LogPrintf("*** Failed to write to coin database\n");
+        uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"), "", CClientUIInterface::MSG_ERROR);
+        StartShutdown();
+    }
+}
+
+bool CCoinsViewDB::WaitForWrites() const
+{
+    std::unique_lock<std::mutex> lock(m_pending_mutex);
+    m_pending_cv.wait(lock, [this] { return !m_writing; });
+    return !m_write_failed;
+}
+
+size_t CCoinsViewDB::PendingMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_pending_mutex);
+    return m_pending_usage;
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -92,7 +208,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
 
-    uint256 old_tip = GetBestBlock();
+    uint256 old_tip = ReadBestBlock();
     if (old_tip.IsNull()) {
         // We may be in the middle of replaying.
         std::vector<uint256> old_heads = GetHeadBlocks();
@@ -119,8 +235,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (fErase) {
+            CCoinsMap::iterator itOld = it++;
+            mapCoins.erase(itOld);
+        } else {
+            ++it;
+        }
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -174,6 +294,8 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
+    // Iterate over a database that has all entries written
+    WaitForWrites();
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
@@ -232,10 +354,26 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
         batch.Write(std::make_pair(DB_BLOCK_FILES, it->first), *it->second);
     }
     batch.Write(DB_LAST_BLOCK, nLastFile);
+    LOCK(CacheLock);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
-        batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+        uint256 hashMerkleRoot;
+        if (!ReadMerkleRoot((*it)->GetBlockHash(), hashMerkleRoot))
+            return error("%s: no merkle root for %s", __func__, (*it)->GetBlockHash().ToString());
+        batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it, hashMerkleRoot));
+    }
+    // Headers are read back from the auxpow cache, it must not lag behind the index
+    for (const auto& it : Cache)
+        batch.Write(std::make_pair(DB_BLOCKAUX, it.first), it.second);
+    if (!WriteBatch(batch, true)) return false;
+    Cache.clear();
+    // New headers are the ones most likely to be asked for
+    for (const CBlockIndex* pindex : blockinfo) {
+        auto it = MerkleRoots.find(pindex->GetBlockHash());
+        if (it == MerkleRoots.end()) continue;
+        CacheMerkleRoot(it->first, it->second);
+        MerkleRoots.erase(it);
     }
-    return WriteBatch(batch, true);
+    return true;
 }
 
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
@@ -258,18 +396,76 @@ bool CBlockTreeDB::ReadAuxPow (const uint256& hash, CAuxPow& auxpow) {
 
 bool CBlockTreeDB::WriteAuxPow (const uint256& hash, const CAuxPow& auxpow) {
     bool ret = true;
-    if (Cache.size() > 64000) ret = FlushAuxPow ();
+    if (Cache.size() > MAX_INDEX_CACHE_ENTRIES) ret = FlushAuxPow ();
     LOCK(CacheLock);
     Cache[hash] = auxpow;
     return ret;
 }
 
+bool CBlockTreeDB::ReadMerkleRoot (const uint256& hash, uint256& hashMerkleRoot) {
+    {
+        LOCK(CacheLock);
+        auto it = MerkleRoots.find(hash);
+        if (it != MerkleRoots.end()) { hashMerkleRoot = it->second; return true; }
+        it = MerkleRootCache.find(hash);
+        if (it != MerkleRootCache.end()) { hashMerkleRoot = it->second; return true; }
+    }
+    CDiskBlockIndex diskindex;
+    if (!CDBWrapper::Read(std::make_pair(DB_BLOCK_INDEX, hash), diskindex)) return false;
+    hashMerkleRoot = diskindex.hashMerkleRoot;
+    LOCK(CacheLock);
+    CacheMerkleRoot(hash, hashMerkleRoot);
+    return true;
+}
+
+void CBlockTreeDB::CacheMerkleRoots (const std::vector<uint256>& hashes) {
+    // Missing roots are reported when the headers are built
+    uint256 hashMerkleRoot;
+    for (const uint256& hash : hashes) {
+        ReadMerkleRoot(hash, hashMerkleRoot);
+    }
+}
+
+void CBlockTreeDB::CacheMerkleRoot (const uint256& hash, const uint256& hashMerkleRoot) {
+    AssertLockHeld(CacheLock);
+    if (!MerkleRootCache.emplace(hash, hashMerkleRoot).second) return;
+    MerkleRootCacheOrder.push_back(hash);
+    if (MerkleRootCacheOrder.size() > MAX_MERKLE_ROOT_CACHE_ENTRIES) {
+        MerkleRootCache.erase(MerkleRootCacheOrder.front());
+        MerkleRootCacheOrder.pop_front();
+    }
+}
+
+void CBlockTreeDB::WriteMerkleRoot (const uint256& hash, const uint256& hashMerkleRoot) {
+    LOCK(CacheLock);
+    MerkleRoots[hash] = hashMerkleRoot;
+}
+
+bool CBlockTreeDB::IsCacheLarge () {
+    LOCK(CacheLock);
+    return MerkleRoots.size() > MAX_INDEX_CACHE_ENTRIES;
+}
+
+size_t CBlockTreeDB::GetCachedMerkleRoots () {
+    LOCK(CacheLock);
+    return MerkleRoots.size();
+}
+
+static const char INDEX_FLUSH_METRIC[] = "index_flush_duration_seconds";
+static const char INDEX_FLUSH_METRIC_HELP[] = "Time spent writing the write-back cache of an index to its database";
+static CMetricHistogram g_metric_flush_auxpow(INDEX_FLUSH_METRIC, INDEX_FLUSH_METRIC_HELP, "index=\"auxpow\"");
+static CMetricHistogram g_metric_flush_txindex(INDEX_FLUSH_METRIC, INDEX_FLUSH_METRIC_HELP, "index=\"txindex\"");
+static CMetricHistogram g_metric_flush_addressindex(INDEX_FLUSH_METRIC, INDEX_FLUSH_METRIC_HELP, "index=\"addressindex\"");
+static CMetricHistogram g_metric_flush_blockstatsindex(INDEX_FLUSH_METRIC, INDEX_FLUSH_METRIC_HELP, "index=\"blockstatsindex\"");
+
 bool CBlockTreeDB::FlushAuxPow () {
     LOCK(CacheLock);
+    const int64_t nStart = GetTimeMicros();
     CDBBatch batch(*this);
     for (auto& it : Cache)
         batch.Write(std::make_pair(DB_BLOCKAUX, it.first), it.second);
     bool ret = WriteBatch(batch);
+    g_metric_flush_auxpow.Observe(GetTimeMicros() - nStart);
     Cache.clear();
     return ret;
 }
@@ -295,7 +491,6 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nDataPos       = diskindex.nDataPos;
                 pindexNew->nUndoPos       = diskindex.nUndoPos;
                 pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
                 pindexNew->nTime          = diskindex.nTime;
                 pindexNew->nBits          = diskindex.nBits;
                 pindexNew->nNonce         = diskindex.nNonce;
@@ -334,33 +529,50 @@ bool CTxIndexDB::Read (const uint256 &txid, CDiskTxPos &pos) {
 }
 
 bool CTxIndexDB::Write (const uint256 &txid, const CDiskTxPos &pos) {
-    bool ret = true;
-    if (Cache.size() > 64000) ret = Flush ();
     LOCK(CacheLock);
     Cache[txid] = pos;
-    return ret;
+    return true;
+}
+
+bool CTxIndexDB::ReadBestBlock (CBlockLocator &locator) {
+    return CDBWrapper::Read(DB_BEST_BLOCK, locator);
+}
+
+void CTxIndexDB::SetBestBlock (const CBlockLocator &locator) {
+    LOCK(CacheLock);
+    BestBlock = locator;
+}
+
+bool CTxIndexDB::IsCacheLarge () {
+    LOCK(CacheLock);
+    return Cache.size() > MAX_INDEX_CACHE_ENTRIES;
 }
 
 bool CTxIndexDB::Flush () {
     LOCK(CacheLock);
+    const int64_t nStart = GetTimeMicros();
     CDBBatch batch(*this);
     for (auto& it : Cache)
         batch.Write(std::make_pair(DB_TXINDEX, it.first), it.second);
+    if (!BestBlock.IsNull())
+        batch.Write(DB_BEST_BLOCK, BestBlock);
     bool ret = WriteBatch(batch);
+    g_metric_flush_txindex.Observe(GetTimeMicros() - nStart);
     Cache.clear();
     return ret;
 };
 
 // CAddressIndexDB
-// CScript, COutpoint  = value, height, spend_tx, spend_in, spend_height
+// CCompactScript, COutpoint  = value, height, spend_tx, spend_in, spend_height
 
 CAddressIndexDB::CAddressIndexDB(bool fWipe) : Cache(), CacheLock(), CDBWrapper(GetBlocksDir() / "addressindex", 32 << 20, false, fWipe) {
 }
 
-bool CAddressIndexDB::Read (const CScript& script, std::map<CAddressKey, CAddressValue>& vec) {
+bool CAddressIndexDB::Read (const CScript& scriptPubKey, std::map<CAddressKey, CAddressValue>& vec) {
     LOCK(CacheLock);
+    const CCompactScript script(scriptPubKey);
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_ADDRESS, CAddressKey(script, COutPoint())));
+    pcursor->Seek(std::make_pair(DB_ADDRESS, CAddressKey(scriptPubKey, COutPoint())));
     while (pcursor->Valid()) {
         std::pair<char, CAddressKey> key;
         if (pcursor->GetKey(key) && (key.first == DB_ADDRESS) && key.second.script == script) {
@@ -387,15 +599,78 @@ bool CAddressIndexDB::Read (const CScript& script, std::map<CAddressKey, CAddres
 }
 
 bool CAddressIndexDB::Write (const CAddressKey& key, const CAddressValue& value) {
-    bool ret = true;
-    if (Cache.size() > 64000) ret = Flush ();
     LOCK(CacheLock);
     Cache[key] = value;
+    return true;
+}
+
+bool CAddressIndexDB::Upgrade () {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(DB_ADDRESS_SCRIPT);
+    if (!pcursor->Valid()) return true;
+
+    // The keys are not spread evenly, progress is estimated from the part
+    // of the old records on disk that lies before the current one
+    const auto begin = std::make_pair(DB_ADDRESS_SCRIPT, CLegacyAddressKey());
+    const auto end = std::make_pair((char)(DB_ADDRESS_SCRIPT + 1), CLegacyAddressKey());
+    const size_t nTotalSize = EstimateSize(begin, end);
+    uiInterface.ShowProgress(_("Upgrading address index database"), 0, false);
+    LogPrintf("Upgrading address index database to compact script keys: [0%%]..."); /* Continued */
+    int reportDone = 0;
+    size_t nRecords = 0;
+    CDBBatch batch(*this);
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, CLegacyAddressKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESS_SCRIPT) break;
+        CAddressValue value;
+        if (!pcursor->GetValue(value)) {
+            uiInterface.ShowProgress("", 100, false);
+            return error("%s: cannot parse address index record", __func__);
+        }
+        batch.Write(std::make_pair(DB_ADDRESS, CAddressKey(key.second.script, key.second.out)), value);
+        batch.Erase(key);
+        nRecords++;
+        if (batch.SizeEstimate() > (size_t)nDefaultDbBatchSize) {
+            if (!WriteBatch(batch)) {
+                uiInterface.ShowProgress("", 100, false);
+                return false;
+            }
+            batch.Clear();
+            if (nTotalSize > 0) {
+                const int percentageDone = std::min<size_t>(99, EstimateSize(begin, key) * 100 / nTotalSize);
+                uiInterface.ShowProgress(_("Upgrading address index database"), percentageDone, false);
+                if (reportDone < percentageDone / 10) {
+                    // report max. every 10% step
+                    LogPrintf("[%d%%]...", percentageDone); /* Continued */
+                    reportDone = percentageDone / 10;
+                }
+            }
+        }
+    }
+    const bool ret = WriteBatch(batch);
+    uiInterface.ShowProgress("", 100, false);
+    LogPrintf("[%s].\n", ret ? "DONE" : "FAILED");
+    if (ret) LogPrintf("Upgraded %u address index records\n", nRecords);
     return ret;
 }
 
+bool CAddressIndexDB::ReadBestBlock (CBlockLocator &locator) {
+    return CDBWrapper::Read(DB_BEST_BLOCK, locator);
+}
+
+void CAddressIndexDB::SetBestBlock (const CBlockLocator &locator) {
+    LOCK(CacheLock);
+    BestBlock = locator;
+}
+
+bool CAddressIndexDB::IsCacheLarge () {
+    LOCK(CacheLock);
+    return Cache.size() > MAX_INDEX_CACHE_ENTRIES;
+}
+
 bool CAddressIndexDB::Flush () {
     LOCK(CacheLock);
+    const int64_t nStart = GetTimeMicros();
     CDBBatch batch(*this);
     for (auto& it : Cache) {
         if (it.second.height == 0) {
@@ -404,7 +679,93 @@ bool CAddressIndexDB::Flush () {
             batch.Write(std::make_pair(DB_ADDRESS, it.first), it.second);
         }
     }
+    if (!BestBlock.IsNull())
+        batch.Write(DB_BEST_BLOCK, BestBlock);
     bool ret = WriteBatch(batch);
+    g_metric_flush_addressindex.Observe(GetTimeMicros() - nStart);
     Cache.clear();
     return ret;
 };
+
+// CBlockStatsIndexDB
+
+namespace {
+
+/** Height key of the block stats index, big endian so that heights are stored in order */
+struct BlockStatsKey
+{
+    uint32_t nHeight;
+
+    explicit BlockStatsKey(int nHeightIn = 0) : nHeight(nHeightIn) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const { ser_writedata32be(s, nHeight); }
+    template <typename Stream>
+    void Unserialize(Stream& s) { nHeight = ser_readdata32be(s); }
+};
+
+} // namespace
+
+CBlockStatsIndexDB::CBlockStatsIndexDB(bool fWipe) : CDBWrapper(GetBlocksDir() / "blockstats", 8 << 20, false, fWipe), Cache(), CacheLock() {
+}
+
+bool CBlockStatsIndexDB::Read (int nHeight, CBlockStats &stats) {
+    LOCK(CacheLock);
+    auto it = Cache.find(nHeight);
+    if (it != Cache.end()) { stats = it->second; return !stats.IsNull(); }
+    return CDBWrapper::Read(std::make_pair(DB_BLOCKSTATS, BlockStatsKey(nHeight)), stats);
+}
+
+bool CBlockStatsIndexDB::ReadRange (int nStart, int nEnd, std::vector<CBlockStats> &vstats) {
+    LOCK(CacheLock);
+    vstats.assign(nEnd - nStart + 1, CBlockStats());
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    for (pcursor->Seek(std::make_pair(DB_BLOCKSTATS, BlockStatsKey(nStart))); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, BlockStatsKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCKSTATS || key.second.nHeight > (uint32_t)nEnd) break;
+        if (!pcursor->GetValue(vstats[key.second.nHeight - nStart]))
+            return error("%s: failed to read the stats of height %u", __func__, key.second.nHeight);
+    }
+    for (auto it = Cache.lower_bound(nStart); it != Cache.end() && it->first <= nEnd; it++)
+        vstats[it->first - nStart] = it->second;
+    return true;
+}
+
+bool CBlockStatsIndexDB::Write (int nHeight, const CBlockStats &stats) {
+    LOCK(CacheLock);
+    Cache[nHeight] = stats;
+    return true;
+}
+
+bool CBlockStatsIndexDB::ReadBestBlock (CBlockLocator &locator) {
+    return CDBWrapper::Read(DB_BEST_BLOCK, locator);
+}
+
+void CBlockStatsIndexDB::SetBestBlock (const CBlockLocator &locator) {
+    LOCK(CacheLock);
+    BestBlock = locator;
+}
+
+bool CBlockStatsIndexDB::IsCacheLarge () {
+    LOCK(CacheLock);
+    return Cache.size() > MAX_INDEX_CACHE_ENTRIES;
+}
+
+bool CBlockStatsIndexDB::Flush () {
+    LOCK(CacheLock);
+    const int64_t nStart = GetTimeMicros();
+    CDBBatch batch(*this);
+    for (auto& it : Cache) {
+        if (it.second.IsNull()) {
+            batch.Erase(std::make_pair(DB_BLOCKSTATS, BlockStatsKey(it.first)));
+        } else {
+            batch.Write(std::make_pair(DB_BLOCKSTATS, BlockStatsKey(it.first)), it.second);
+        }
+    }
+    if (!BestBlock.IsNull())
+        batch.Write(DB_BEST_BLOCK, BestBlock);
+    bool ret = WriteBatch(batch);
+    g_metric_flush_blockstatsindex.Observe(GetTimeMicros() - nStart);
+    Cache.clear();
+    return ret;
+}
@@ -7,14 +7,20 @@
 #ifndef BITCOIN_TXDB_H
 #define BITCOIN_TXDB_H
 
+#include <blockstats.h>
 #include <coins.h>
 #include <dbwrapper.h>
 #include <chain.h>
 #include <primitives/block.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -24,6 +30,8 @@ class uint256;
 
 //! No need to periodic flush if at least this much space still available.
 static constexpr int MAX_BLOCK_COINSDB_USAGE = 10;
+//! Share of the coin cache budget (percent) that unmodified coins may keep using after a flush.
+static constexpr int COINS_CACHE_RETAIN_PERCENT = 50;
 //! -dbcache default (MiB)
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
@@ -40,6 +48,12 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! -asyncflush default
+static const bool DEFAULT_ASYNC_FLUSH = true;
+//! Cached entries above which an index is written at the next block boundary
+static const size_t MAX_INDEX_CACHE_ENTRIES = 64000;
+//! Merkle roots of written block index entries kept in memory, enough for many full headers messages
+static const size_t MAX_MERKLE_ROOT_CACHE_ENTRIES = 64000;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -66,13 +80,39 @@ struct CDiskTxPos : public CDiskBlockPos
     }
 };
 
-/** CCoinsView backed by the coin database (chainstate/) */
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * With asynchronous writes enabled, BatchWrite takes over the given entries
+ * and writes them from a background thread. Until that write completes the
+ * entries are served from memory, so the view always reflects the last
+ * BatchWrite. A crash during the write is recovered like an interrupted
+ * synchronous one, through the head blocks and ReplayBlocks.
+ */
 class CCoinsViewDB final : public CCoinsView
 {
 protected:
     CDBWrapper db;
+
+private:
+    mutable std::mutex m_pending_mutex;
+    mutable std::condition_variable m_pending_cv;
+    //! Entries being written by m_writer, read-only while m_writing is set
+    std::unique_ptr<CCoinsMap> m_pending;
+    uint256 m_pending_block;
+    size_t m_pending_usage{0};
+    bool m_writing{false};
+    bool m_write_failed{false};
+    std::thread m_writer;
+    std::atomic<bool> m_async_writes{false};
+
+    uint256 ReadBestBlock() const;
+    bool WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase);
+    void WriterThread();
+
 public:
     explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -84,6 +124,13 @@ public:
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+    //! Make BatchWrite return once the entries are handed to the background writer
+    void SetAsyncWrites(bool fAsync) { m_async_writes = fAsync; }
+    //! Block until no write is in progress. Returns false if the last one failed.
+    bool WaitForWrites() const;
+    //! Memory held by entries that are not written yet
+    size_t PendingMemoryUsage() const;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -113,10 +160,20 @@ class CBlockTreeDB : public CDBWrapper
 {
 private:
     std::map<uint256, CAuxPow> Cache;
+    //! Merkle roots of the block index entries that were not written yet
+    std::map<uint256, uint256> MerkleRoots;
+    //! Merkle roots of written entries that were recently written or read,
+    //! the oldest are dropped first
+    std::map<uint256, uint256> MerkleRootCache;
+    std::deque<uint256> MerkleRootCacheOrder;
     CCriticalSection CacheLock;
+
+    void CacheMerkleRoot(const uint256 &hash, const uint256 &hashMerkleRoot);
 public:
     explicit CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
+    //! Write block index entries, together with the cached auxpow headers they refer to.
+    //! The merkle roots of the entries come from the cache or their stored version.
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &info);
     bool ReadLastBlockFile(int &nFile);
@@ -127,30 +184,95 @@ public:
     bool ReadAuxPow (const uint256 &txid, CAuxPow &auxpow);
     bool WriteAuxPow (const uint256 &txid, const CAuxPow &auxpow);
     bool FlushAuxPow ();
+    //! Merkle root of a block index entry, from the caches or the stored entry
+    bool ReadMerkleRoot (const uint256 &hash, uint256 &hashMerkleRoot);
+    //! Read the merkle roots of entries into the cache, so that a range of
+    //! headers can then be built without database reads
+    void CacheMerkleRoots (const std::vector<uint256> &hashes);
+    //! Keep the merkle root of a new entry until the entry is written
+    void WriteMerkleRoot (const uint256 &hash, const uint256 &hashMerkleRoot);
+    //! Whether enough merkle roots are cached for the block index to be written
+    bool IsCacheLarge ();
+    size_t GetCachedMerkleRoots ();
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
 
+/**
+ * The transaction and address indexes cache their writes and store them
+ * together with the locator of the block they lead up to, in one batch. After
+ * a crash each index is consistent with its own best block, from which
+ * ReplayIndexes() brings it to the chain tip.
+ */
 class CTxIndexDB : public CDBWrapper
 {
 private:
     std::map<uint256, CDiskTxPos> Cache;
+    CBlockLocator BestBlock;
     CCriticalSection CacheLock;
 public:
     explicit CTxIndexDB(bool fWipe);
     bool Read (const uint256 &txid, CDiskTxPos &pos);
     bool Write (const uint256 &txid, const CDiskTxPos &pos);
+    //! Read the best block of the index on disk, false if it has none
+    bool ReadBestBlock (CBlockLocator &locator);
+    //! Set the block the cached writes lead up to, after they are all made
+    void SetBestBlock (const CBlockLocator &locator);
+    //! Whether the cache is due to be written
+    bool IsCacheLarge ();
     bool Flush ();
 };
 
+/** An address index key as written before CCompactScript, with the whole script */
+struct CLegacyAddressKey
+{
+    CScript script;
+    COutPoint out;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(script);
+        READWRITE(out.hash);
+        READWRITE(VARINT(out.n));
+    }
+};
+
 class CAddressIndexDB : public CDBWrapper
 {
 private:
     std::map<CAddressKey, CAddressValue> Cache;
+    CBlockLocator BestBlock;
     CCriticalSection CacheLock;
 public:
     explicit CAddressIndexDB(bool fWipe);
-    bool Read (const CScript& script, std::map<CAddressKey, CAddressValue>& vec);
+    bool Read (const CScript& scriptPubKey, std::map<CAddressKey, CAddressValue>& vec);
     bool Write (const CAddressKey& key, const CAddressValue& value);
+    //! Convert keys written with whole scripts to compact scripts
+    bool Upgrade ();
+    bool ReadBestBlock (CBlockLocator &locator);
+    void SetBestBlock (const CBlockLocator &locator);
+    bool IsCacheLarge ();
+    bool Flush ();
+};
+
+/** getblockstats values of the active chain by height, see -blockstatsindex */
+class CBlockStatsIndexDB : public CDBWrapper
+{
+private:
+    //! Stats of connected blocks, null ones for disconnected heights
+    std::map<int, CBlockStats> Cache;
+    CBlockLocator BestBlock;
+    CCriticalSection CacheLock;
+public:
+    explicit CBlockStatsIndexDB(bool fWipe);
+    bool Read (int nHeight, CBlockStats &stats);
+    //! Read the stats of heights nStart to nEnd, null ones for missing heights
+    bool ReadRange (int nStart, int nEnd, std::vector<CBlockStats> &vstats);
+    bool Write (int nHeight, const CBlockStats &stats);
+    bool ReadBestBlock (CBlockLocator &locator);
+    void SetBestBlock (const CBlockLocator &locator);
+    bool IsCacheLarge ();
     bool Flush ();
 };
 
@@ -26,6 +26,10 @@ public:
         typ = initialType;
         val = initialStr;
     }
+    UniValue(UniValue::VType initialType, std::string&& initialStr) {
+        typ = initialType;
+        val = std::move(initialStr);
+    }
     UniValue(uint64_t val_) {
         setInt(val_);
     }
@@ -48,7 +52,13 @@ public:
         std::string s(val_);
         setStr(s);
     }
-    ~UniValue() {}
+    // Copies are deep; moves are cheap, so prefer std::move when handing a
+    // finished subtree to its parent.
+    UniValue(const UniValue&) = default;
+    UniValue(UniValue&&) = default;
+    UniValue& operator=(const UniValue&) = default;
+    UniValue& operator=(UniValue&&) = default;
+    ~UniValue() = default;
 
     void clear();
 
@@ -68,6 +78,8 @@ public:
     bool empty() const { return (values.size() == 0); }
 
     size_t size() const { return values.size(); }
+    /** Preallocate room for n array elements or object members */
+    void reserve(size_t n);
 
     bool getBool() const { return isTrue(); }
     void getObjMap(std::map<std::string,UniValue>& kv) const;
@@ -86,9 +98,10 @@ public:
     bool isObject() const { return (typ == VOBJ); }
 
     bool push_back(const UniValue& val);
+    bool push_back(UniValue&& val);
     bool push_back(const std::string& val_) {
         UniValue tmpVal(VSTR, val_);
-        return push_back(tmpVal);
+        return push_back(std::move(tmpVal));
     }
     bool push_back(const char *val_) {
         std::string s(val_);
@@ -96,27 +109,34 @@ public:
     }
     bool push_back(uint64_t val_) {
         UniValue tmpVal(val_);
-        return push_back(tmpVal);
+        return push_back(std::move(tmpVal));
     }
     bool push_back(int64_t val_) {
         UniValue tmpVal(val_);
-        return push_back(tmpVal);
+        return push_back(std::move(tmpVal));
     }
     bool push_back(int val_) {
         UniValue tmpVal(val_);
-        return push_back(tmpVal);
+        return push_back(std::move(tmpVal));
     }
     bool push_back(double val_) {
         UniValue tmpVal(val_);
-        return push_back(tmpVal);
+        return push_back(std::move(tmpVal));
     }
     bool push_backV(const std::vector<UniValue>& vec);
 
     void __pushKV(const std::string& key, const UniValue& val);
+    /**
+     * Append a member without searching for an existing one with the same
+     * key. Only for builders that guarantee unique keys (e.g. fixed field
+     * lists); pushKV() does a linear duplicate scan per call.
+     */
+    void pushKVEnd(const std::string& key, UniValue&& val);
     bool pushKV(const std::string& key, const UniValue& val);
+    bool pushKV(const std::string& key, UniValue&& val);
     bool pushKV(const std::string& key, const std::string& val_) {
         UniValue tmpVal(VSTR, val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, std::move(tmpVal));
     }
     bool pushKV(const std::string& key, const char *val_) {
         std::string _val(val_);
@@ -124,23 +144,23 @@ public:
     }
     bool pushKV(const std::string& key, int64_t val_) {
         UniValue tmpVal(val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, std::move(tmpVal));
     }
     bool pushKV(const std::string& key, uint64_t val_) {
         UniValue tmpVal(val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, std::move(tmpVal));
     }
     bool pushKV(const std::string& key, bool val_) {
         UniValue tmpVal((bool)val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, std::move(tmpVal));
     }
     bool pushKV(const std::string& key, int val_) {
         UniValue tmpVal((int64_t)val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, std::move(tmpVal));
     }
     bool pushKV(const std::string& key, double val_) {
         UniValue tmpVal(val_);
-        return pushKV(key, tmpVal);
+        return pushKV(key, std::move(tmpVal));
     }
     bool pushKVs(const UniValue& obj);
 
@@ -160,6 +180,7 @@ private:
     std::vector<UniValue> values;
 
     bool findKey(const std::string& key, size_t& retIdx) const;
+    void write(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
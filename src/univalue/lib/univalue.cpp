@@ -56,22 +56,44 @@ bool UniValue::setNumStr(const string& val_)
     return true;
 }
 
-bool UniValue::setInt(uint64_t val_)
+// Format the decimal digits of n backwards, ending at end; returns the first digit
+static char* formatUInt(uint64_t n, char* end)
 {
-    ostringstream oss;
+    char* p = end;
+    do {
+        *--p = '0' + (n % 10);
+        n /= 10;
+    } while (n);
+    return p;
+}
 
-    oss << val_;
+// Integers are always valid JSON numbers, so skip ostringstream and the
+// validNumStr() tokenizer pass; the result fits in std::string's inline buffer.
+bool UniValue::setInt(uint64_t val_)
+{
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* first = formatUInt(val_, end);
 
-    return setNumStr(oss.str());
+    clear();
+    typ = VNUM;
+    val.assign(first, end);
+    return true;
 }
 
 bool UniValue::setInt(int64_t val_)
 {
-    ostringstream oss;
-
-    oss << val_;
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    // Negate in unsigned arithmetic so that INT64_MIN does not overflow
+    char* first = formatUInt(val_ < 0 ? -(uint64_t)val_ : (uint64_t)val_, end);
+    if (val_ < 0)
+        *--first = '-';
 
-    return setNumStr(oss.str());
+    clear();
+    typ = VNUM;
+    val.assign(first, end);
+    return true;
 }
 
 bool UniValue::setFloat(double val_)
@@ -107,6 +129,13 @@ bool UniValue::setObject()
     return true;
 }
 
+void UniValue::reserve(size_t n)
+{
+    if (typ == VOBJ)
+        keys.reserve(n);
+    values.reserve(n);
+}
+
 bool UniValue::push_back(const UniValue& val_)
 {
     if (typ != VARR)
@@ -116,6 +145,15 @@ bool UniValue::push_back(const UniValue& val_)
     return true;
 }
 
+bool UniValue::push_back(UniValue&& val_)
+{
+    if (typ != VARR)
+        return false;
+
+    values.push_back(std::move(val_));
+    return true;
+}
+
 bool UniValue::push_backV(const std::vector<UniValue>& vec)
 {
     if (typ != VARR)
@@ -132,6 +170,13 @@ void UniValue::__pushKV(const std::string& key, const UniValue& val_)
     values.push_back(val_);
 }
 
+void UniValue::pushKVEnd(const std::string& key, UniValue&& val_)
+{
+    assert(typ == VOBJ);
+    keys.push_back(key);
+    values.push_back(std::move(val_));
+}
+
 bool UniValue::pushKV(const std::string& key, const UniValue& val_)
 {
     if (typ != VOBJ)
@@ -145,6 +190,19 @@ bool UniValue::pushKV(const std::string& key, const UniValue& val_)
     return true;
 }
 
+bool UniValue::pushKV(const std::string& key, UniValue&& val_)
+{
+    if (typ != VOBJ)
+        return false;
+
+    size_t idx;
+    if (findKey(key, idx))
+        values[idx] = std::move(val_);
+    else
+        pushKVEnd(key, std::move(val_));
+    return true;
+}
+
 bool UniValue::pushKVs(const UniValue& obj)
 {
     if (typ != VOBJ || obj.typ != VOBJ)
@@ -10,22 +10,19 @@
 
 using namespace std;
 
-static string json_escape(const string& inS)
+// Append the escaped form of inS to s, copying runs that need no escaping in bulk
+static void json_escape(const string& inS, string& s)
 {
-    string outS;
-    outS.reserve(inS.size() * 2);
-
-    for (unsigned int i = 0; i < inS.size(); i++) {
-        unsigned char ch = inS[i];
-        const char *escStr = escapes[ch];
-
-        if (escStr)
-            outS += escStr;
-        else
-            outS += ch;
+    size_t run = 0;
+    for (size_t i = 0; i < inS.size(); i++) {
+        const char *escStr = escapes[(unsigned char)inS[i]];
+        if (escStr) {
+            s.append(inS, run, i - run);
+            s += escStr;
+            run = i + 1;
+        }
     }
-
-    return outS;
+    s.append(inS, run, string::npos);
 }
 
 string UniValue::write(unsigned int prettyIndent,
@@ -33,7 +30,15 @@ string UniValue::write(unsigned int prettyIndent,
 {
     string s;
     s.reserve(1024);
+    write(prettyIndent, indentLevel, s);
+    return s;
+}
 
+// Serialize into the caller's buffer so that nested values don't each
+// allocate (and then copy) their own string
+void UniValue::write(unsigned int prettyIndent, unsigned int indentLevel,
+                     string& s) const
+{
     unsigned int modIndent = indentLevel;
     if (modIndent == 0)
         modIndent = 1;
@@ -49,7 +54,9 @@ string UniValue::write(unsigned int prettyIndent,
         writeArray(prettyIndent, modIndent, s);
         break;
     case VSTR:
-        s += "\"" + json_escape(val) + "\"";
+        s += '"';
+        json_escape(val, s);
+        s += '"';
         break;
     case VNUM:
         s += val;
@@ -58,8 +65,6 @@ string UniValue::write(unsigned int prettyIndent,
         s += (val == "1" ? "true" : "false");
         break;
     }
-
-    return s;
 }
 
 static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, string& s)
@@ -76,7 +81,7 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     for (unsigned int i = 0; i < values.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += values[i].write(prettyIndent, indentLevel + 1);
+        values[i].write(prettyIndent, indentLevel + 1, s);
         if (i != (values.size() - 1)) {
             s += ",";
         }
@@ -98,10 +103,12 @@ void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel,
     for (unsigned int i = 0; i < keys.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += "\"" + json_escape(keys[i]) + "\":";
+        s += '"';
+        json_escape(keys[i], s);
+        s += "\":";
         if (prettyIndent)
             s += " ";
-        s += values.at(i).write(prettyIndent, indentLevel + 1);
+        values.at(i).write(prettyIndent, indentLevel + 1, s);
         if (i != (values.size() - 1))
             s += ",";
         if (prettyIndent)
@@ -393,6 +393,63 @@ BOOST_AUTO_TEST_CASE(univalue_readwrite)
     BOOST_CHECK(!v.read("{} 42"));
 }
 
+BOOST_AUTO_TEST_CASE(univalue_build_fast)
+{
+    // Integer formatting at the limits
+    BOOST_CHECK_EQUAL(UniValue((int64_t)0).getValStr(), "0");
+    BOOST_CHECK_EQUAL(UniValue(INT64_MIN).getValStr(), "-9223372036854775808");
+    BOOST_CHECK_EQUAL(UniValue(INT64_MAX).getValStr(), "9223372036854775807");
+    BOOST_CHECK_EQUAL(UniValue(UINT64_MAX).getValStr(), "18446744073709551615");
+    BOOST_CHECK(UniValue(-42).isNum());
+
+    UniValue obj(UniValue::VOBJ);
+    obj.reserve(3);
+    obj.pushKVEnd("a", UniValue(1));
+    UniValue arr(UniValue::VARR);
+    arr.reserve(2);
+    arr.push_back(UniValue("x"));
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKVEnd("y", UniValue(true));
+    arr.push_back(std::move(inner));
+    obj.pushKVEnd("b", std::move(arr));
+    obj.pushKV("a", UniValue(2));
+    BOOST_CHECK_EQUAL(obj.size(), 2);
+    BOOST_CHECK_EQUAL(obj.write(), "{\"a\":2,\"b\":[\"x\",{\"y\":true}]}");
+
+    UniValue moved(std::move(obj));
+    BOOST_CHECK(moved.isObject());
+    BOOST_CHECK_EQUAL(moved["b"][1]["y"].getBool(), true);
+}
+
+BOOST_AUTO_TEST_CASE(univalue_readwrite_strings)
+{
+    // Long ASCII runs mixed with escapes and multi-byte UTF-8 round-trip
+    std::string str(300, 'a');
+    str += "\"\\\n\t\x01";
+    str += std::string(100, 'b');
+    str += "\xc3\xa9";
+    str += std::string(10, 'c');
+
+    UniValue arr(UniValue::VARR);
+    arr.push_back(str);
+    arr.push_back(UniValue(-123));
+    std::string json = arr.write();
+
+    UniValue v;
+    BOOST_CHECK(v.read(json));
+    BOOST_CHECK_EQUAL(v[0].getValStr(), str);
+    BOOST_CHECK_EQUAL(v[1].getValStr(), "-123");
+    BOOST_CHECK_EQUAL(v.write(), json);
+
+    // Invalid UTF-8 followed by ASCII is still rejected
+    BOOST_CHECK(!v.read("[\"\xc3" "abc\"]"));
+    BOOST_CHECK(!v.read("[\"abc\xc3\"]"));
+    BOOST_CHECK(v.read("[1.5e+10]"));
+    BOOST_CHECK_EQUAL(v[0].getValStr(), "1.5e+10");
+    BOOST_CHECK(v.read("{\"k\":\"\u00e9x\"}"));
+    BOOST_CHECK_EQUAL(v["k"].getValStr(), "\xc3\xa9x");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 int main (int argc, char *argv[])
@@ -403,6 +460,8 @@ int main (int argc, char *argv[])
     univalue_array();
     univalue_object();
     univalue_readwrite();
+    univalue_build_fast();
+    univalue_readwrite_strings();
     return 0;
 }
 
@@ -8,21 +8,28 @@
 #include <validation.h>
 
 #include <arith_uint256.h>
+#include <blockfilecache.h>
+#include <blockfilewriter.h>
+#include <blockstats.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
 #include <checkqueue.h>
+#include <coinsprefetch.h>
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
 #include <cuckoocache.h>
 #include <hash.h>
+#include <memusage.h>
+#include <metrics.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <pow.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
+#include <pubkey.h>
 #include <random.h>
 #include <reverse_iterator.h>
 #include <script/script.h>
@@ -46,6 +53,7 @@
 
 #include <future>
 #include <sstream>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -152,9 +160,9 @@ public:
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
-    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view);
+    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CAddressDeltas* pdeltas = nullptr);
     bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                    CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false);
+                    CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false, CAddressDeltas* pdeltas = nullptr, CBlockStats* pstats = nullptr);
 
     // Block disconnection on our pcoinsTip:
     bool DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions *disconnectpool);
@@ -202,14 +210,18 @@ std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fTxIndex = DEFAULT_TXINDEX;
 bool fAddressIndex = false;
+bool fBlockStatsIndex = DEFAULT_BLOCKSTATSINDEX;
+std::atomic_bool fNotifyAddressDeltas(false);
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fMapBlockFiles = DEFAULT_BLOCKFILE_MMAP;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
+int64_t nUndoRetain = DEFAULT_UNDO_RETAIN;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
 
@@ -245,18 +257,43 @@ namespace {
      */
     bool fCheckForPruning = false;
 
+    /** Storage of the entries of mapBlockIndex, which are freed all at once. */
+    CBlockIndexArena blockIndexArena;
+
     /** Dirty block index entries. */
     std::set<CBlockIndex*> setDirtyBlockIndex;
 
     /** Dirty block file entries. */
     std::set<int> setDirtyFileInfo;
+
+    /** Block index entries of the blocks stored in each block file, so that
+     *  pruning a file does not scan mapBlockIndex (protected by cs_main). */
+    std::vector<std::vector<CBlockIndex*>> vBlocksInFile;
+
+    /** Add a block with data to the list of its block file. */
+    void AddBlockToFileList(CBlockIndex* pindex)
+    {
+        if (vBlocksInFile.size() <= (size_t)pindex->nFile) {
+            vBlocksInFile.resize(pindex->nFile + 1);
+        }
+        vBlocksInFile[pindex->nFile].push_back(pindex);
+    }
+
+    /** The blk and rev files being appended to (protected by cs_LastBlockFile) */
+    CBlockFileWriter blockFileWriter([](int nFile) { return GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk"); });
+    CBlockFileWriter undoFileWriter([](int nFile) { return GetBlockPosFilename(CDiskBlockPos(nFile, 0), "rev"); });
+
+    /** Block and undo files open for reading */
+    CBlockFileCache blockFileCache(MAX_OPEN_BLOCK_FILES);
 } // anon namespace
 
 std::unique_ptr<CCoinsViewDB> pcoinsdbview;
+std::unique_ptr<CCoinsViewPrefetch> pcoinsprefetch;
 std::unique_ptr<CCoinsViewCache> pcoinsTip;
 std::unique_ptr<CBlockTreeDB> pblocktree;
 std::unique_ptr<CTxIndexDB> pblocktxindex;
 std::unique_ptr<CAddressIndexDB> pblockaddressindex;
+std::unique_ptr<CBlockStatsIndexDB> pblockstatsindex;
 
 enum class FlushStateMode {
     NONE,
@@ -269,8 +306,8 @@ enum class FlushStateMode {
 static bool FlushStateToDisk(const CChainParams& chainParams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight=0);
 static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPruneHeight);
 static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight);
+static void FindUndoFilesToPrune(std::set<int>& setFilesToPrune, int nMaxHeight);
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
-static FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 
 bool CheckFinalTx(const CTransaction &tx, int flags)
 {
@@ -960,6 +997,63 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, pfMissingInputs, GetTime(), plTxnReplaced, bypass_limits, nAbsurdFee, test_accept);
 }
 
+//! Index header in front of every record of the blk and rev files: message start and size
+static const unsigned int BLOCK_RECORD_HEADER_SIZE = CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+//! Bytes read from the start of a block to find a transaction through the txindex
+static const size_t TXINDEX_READ_SIZE = 16 * 1024;
+
+/** Read the index header in front of the record at pos */
+static bool ReadRecordHeader(const fs::path& path, const CDiskBlockPos& pos, CMessageHeader::MessageStartChars& start, unsigned int& nSize)
+{
+    unsigned char header[BLOCK_RECORD_HEADER_SIZE];
+    if (pos.nPos < BLOCK_RECORD_HEADER_SIZE || !blockFileCache.Read(path, pos.nPos - BLOCK_RECORD_HEADER_SIZE, header, sizeof(header)))
+        return false;
+    memcpy(start, header, CMessageHeader::MESSAGE_START_SIZE);
+    nSize = ReadLE32(header + CMessageHeader::MESSAGE_START_SIZE);
+    return true;
+}
+
+/**
+ * Read the record at pos of a blk or rev file into stream, with the nExtra
+ * bytes following it but at most nMaxLen bytes, and return its size.
+ */
+static bool ReadBlockFileRecord(const CDiskBlockPos& pos, const char* prefix, CDataStream& stream, unsigned int& nSize, size_t nExtra = 0, size_t nMaxLen = std::numeric_limits<size_t>::max())
+{
+    const fs::path path = GetBlockPosFilename(pos, prefix);
+    CMessageHeader::MessageStartChars start;
+    if (!ReadRecordHeader(path, pos, start, nSize) || nSize > MAX_SIZE)
+        return false;
+    stream.clear();
+    stream.resize(std::min(nSize + nExtra, nMaxLen));
+    return blockFileCache.Read(path, pos.nPos, (unsigned char*)stream.data(), stream.size());
+}
+
+/**
+ * Find the block at pos in memory if its file is mapped. Only files that
+ * blocks are no longer appended to are mapped, the others are read.
+ */
+static bool MapBlockRecord(const CDiskBlockPos& pos, Span<const unsigned char>& data, std::shared_ptr<const void>& keepalive)
+{
+    // An I/O error on a mapped file raises SIGBUS instead of failing the read
+    if (!fMapBlockFiles)
+        return false;
+    {
+        LOCK(cs_LastBlockFile);
+        if (pos.nFile >= nLastBlockFile)
+            return false;
+    }
+    Span<const unsigned char> file;
+    if (!blockFileCache.Map(GetBlockPosFilename(pos, "blk"), file, keepalive))
+        return false;
+    if (pos.nPos < BLOCK_RECORD_HEADER_SIZE || pos.nPos > (size_t)file.size())
+        return false;
+    const unsigned int nSize = ReadLE32(file.data() + pos.nPos - sizeof(uint32_t));
+    if (nSize > file.size() - pos.nPos)
+        return false;
+    data = file.subspan(pos.nPos, nSize);
+    return true;
+}
+
 /**
  * Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock.
  * If blockIndex is provided, the transaction is fetched from the corresponding block.
@@ -980,15 +1074,40 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
         if (fTxIndex) {
             CDiskTxPos postx;
             if (!pblocktxindex->Read(hash, postx)) return false;
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull()) return error("%s: OpenBlockFile failed", __func__);
             CBlockHeader header;
-            try {
-                file >> header;
-                if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) return error("%s: fseek(...) failed", __func__);
-                file >> txOut;
-            } catch (const std::exception& e) {
-                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            Span<const unsigned char> mapped;
+            std::shared_ptr<const void> keepalive;
+            const bool fMapped = MapBlockRecord(postx, mapped, keepalive);
+            if (fMapped) {
+                try {
+                    SpanReader stream(SER_DISK, CLIENT_VERSION, mapped);
+                    stream >> header;
+                    stream.ignore(postx.nTxOffset);
+                    stream >> txOut;
+                } catch (const std::exception& e) {
+                    return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+                }
+            }
+            // Most transactions are close enough to the start of their block to
+            // be found by a short read; the whole block is read for the others
+            CDataStream stream(SER_DISK, CLIENT_VERSION);
+            unsigned int nSize;
+            size_t nMaxLen = TXINDEX_READ_SIZE;
+            while (!fMapped) {
+                if (!ReadBlockFileRecord(postx, "blk", stream, nSize, 0, nMaxLen))
+                    return error("%s: reading %s failed", __func__, postx.ToString());
+                try {
+                    stream >> header;
+                    stream.ignore(postx.nTxOffset);
+                    stream >> txOut;
+                    break;
+                } catch (const std::exception& e) {
+                    if (nMaxLen < nSize) {
+                        nMaxLen = nSize;
+                        continue;
+                    }
+                    return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+                }
             }
             if (txOut->GetHash() != hash) return error("%s: txid mismatch", __func__);
             hashBlock = header.GetHash();
@@ -1029,21 +1148,21 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
 
 static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
-    // Open history file to append
-    CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("WriteBlockToDisk: OpenBlockFile failed");
-
-    // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, block);
-    fileout << messageStart << nSize;
-
-    // Write block
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0)
-        return error("WriteBlockToDisk: ftell failed");
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    // Serialize index header and block, to be appended in a single write
+    unsigned int nSize = GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+    std::vector<unsigned char> data;
+    data.reserve(CMessageHeader::MESSAGE_START_SIZE + sizeof(nSize) + nSize);
+    CVectorWriter stream(SER_DISK, CLIENT_VERSION, data, 0);
+    stream << messageStart << nSize;
+    const unsigned int nHeaderSize = data.size();
+    stream << block;
+
+    {
+        LOCK(cs_LastBlockFile);
+        if (!blockFileWriter.Write(pos, data))
+            return error("WriteBlockToDisk: writing to %s failed", pos.ToString());
+    }
+    pos.nPos += nHeaderSize;
 
     return true;
 }
@@ -1052,14 +1171,20 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-
-    // Read block
+    // Read block, in place if its file is mapped
+    Span<const unsigned char> mapped;
+    std::shared_ptr<const void> keepalive;
     try {
-        filein >> block;
+        if (MapBlockRecord(pos, mapped, keepalive)) {
+            SpanReader stream(SER_DISK, CLIENT_VERSION, mapped);
+            stream >> block;
+        } else {
+            CDataStream stream(SER_DISK, CLIENT_VERSION);
+            unsigned int nSize;
+            if (!ReadBlockFileRecord(pos, "blk", stream, nSize))
+                return error("ReadBlockFromDisk: reading %s failed", pos.ToString());
+            stream >> block;
+        }
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -1090,34 +1215,27 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
-    CDiskBlockPos hpos = pos;
-    hpos.nPos -= 8; // Seek back 8 bytes for meta header
-    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+    const fs::path path = GetBlockPosFilename(pos, "blk");
+    CMessageHeader::MessageStartChars blk_start;
+    unsigned int blk_size;
+    if (!ReadRecordHeader(path, pos, blk_start, blk_size)) {
+        return error("%s: Read from block file failed for %s", __func__, pos.ToString());
     }
 
-    try {
-        CMessageHeader::MessageStartChars blk_start;
-        unsigned int blk_size;
-
-        filein >> blk_start >> blk_size;
-
-        if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
-            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
-                    HexStr(blk_start, blk_start + CMessageHeader::MESSAGE_START_SIZE),
-                    HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE));
-        }
+    if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+        return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                HexStr(blk_start, blk_start + CMessageHeader::MESSAGE_START_SIZE),
+                HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE));
+    }
 
-        if (blk_size > MAX_SIZE) {
-            return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
-                    blk_size, MAX_SIZE);
-        }
+    if (blk_size > MAX_SIZE) {
+        return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                blk_size, MAX_SIZE);
+    }
 
-        block.resize(blk_size); // Zeroing of memory is intentional here
-        filein.read((char*)block.data(), blk_size);
-    } catch(const std::exception& e) {
-        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    block.resize(blk_size); // Zeroing of memory is intentional here
+    if (!blockFileCache.Read(path, pos.nPos, block.data(), blk_size)) {
+        return error("%s: Read from block file failed for %s", __func__, pos.ToString());
     }
 
     return true;
@@ -1334,6 +1452,52 @@ bool CScriptCheck::operator()() {
     return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
 }
 
+bool CScriptCheck::RunBatched(CSignatureBatch& batch, std::vector<uint256>& vCacheEntries) {
+    const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
+    const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
+    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, BatchingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata, batch, vCacheEntries), &error);
+}
+
+bool RunChecks(std::vector<CScriptCheck>& vChecks)
+{
+    if (vChecks.size() < 2) {
+        return vChecks.empty() || vChecks[0]();
+    }
+
+    CSignatureBatch batch;
+    std::vector<uint256> vCacheEntries;
+    // Batch entries of check i are [vFirst[i], vFirst[i + 1])
+    std::vector<size_t> vFirst;
+    std::vector<bool> vRerun(vChecks.size(), false);
+    vFirst.reserve(vChecks.size() + 1);
+    for (size_t i = 0; i < vChecks.size(); i++) {
+        vFirst.push_back(batch.size());
+        // Assuming a signature valid can make a script fail that would pass
+        // otherwise, e.g. one checking that a signature is invalid
+        vRerun[i] = !vChecks[i].RunBatched(batch, vCacheEntries);
+    }
+    vFirst.push_back(batch.size());
+
+    std::vector<int> vResults;
+    if (!batch.Verify(&vResults)) {
+        for (size_t i = 0; i < vChecks.size(); i++) {
+            for (size_t j = vFirst[i]; j < vFirst[i + 1]; j++) {
+                if (!vResults[j]) {
+                    vRerun[i] = true;
+                    vCacheEntries[j].SetNull();
+                }
+            }
+        }
+    }
+    AddSignatureCacheEntries(vCacheEntries);
+
+    for (size_t i = 0; i < vChecks.size(); i++) {
+        if (vRerun[i] && !vChecks[i]())
+            return false;
+    }
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -1457,27 +1621,27 @@ namespace {
 
 bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
-    // Open history file to append
-    CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("%s: OpenUndoFile failed", __func__);
-
-    // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, blockundo);
-    fileout << messageStart << nSize;
-
-    // Write undo data
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0)
-        return error("%s: ftell failed", __func__);
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    // Serialize index header and undo data, to be appended in a single write
+    unsigned int nSize = GetSerializeSize(blockundo, SER_DISK, CLIENT_VERSION);
+    std::vector<unsigned char> data;
+    data.reserve(CMessageHeader::MESSAGE_START_SIZE + sizeof(nSize) + nSize + sizeof(uint256));
+    CVectorWriter stream(SER_DISK, CLIENT_VERSION, data, 0);
+    stream << messageStart << nSize;
+    const unsigned int nHeaderSize = data.size();
+    stream << blockundo;
 
     // calculate & write checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << hashBlock;
     hasher << blockundo;
-    fileout << hasher.GetHash();
+    stream << hasher.GetHash();
+
+    {
+        LOCK(cs_LastBlockFile);
+        if (!undoFileWriter.Write(pos, data))
+            return error("%s: writing to %s failed", __func__, pos.ToString());
+    }
+    pos.nPos += nHeaderSize;
 
     return true;
 }
@@ -1489,18 +1653,18 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
         return error("%s: no undo data available", __func__);
     }
 
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("%s: OpenUndoFile failed", __func__);
+    // Read undo data and the checksum after it
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    unsigned int nSize;
+    if (!ReadBlockFileRecord(pos, "rev", stream, nSize, sizeof(uint256)))
+        return error("%s: reading %s failed", __func__, pos.ToString());
 
-    // Read block
     uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+    CHashVerifier<CDataStream> verifier(&stream); // We need a CHashVerifier as reserializing may lose data
     try {
         verifier << pindex->pprev->GetBlockHash();
         verifier >> blockundo;
-        filein >> hashChecksum;
+        stream >> hashChecksum;
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
@@ -1513,8 +1677,15 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     return true;
 }
 
-/** Abort with a message */
-static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
+static bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage="")
+{
+    ::AbortNode(strMessage, userMessage);
+    return state.Error(strMessage);
+}
+
+} // namespace
+
+bool AbortNode(const std::string& strMessage, const std::string& userMessage)
 {
     SetMiscWarning(strMessage);
     LogPrintf("*** %s\n", strMessage);
@@ -1525,14 +1696,6 @@ static bool AbortNode(const std::string& strMessage, const std::string& userMess
     return false;
 }
 
-static bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage="")
-{
-    AbortNode(strMessage, userMessage);
-    return state.Error(strMessage);
-}
-
-} // namespace
-
 std::map<CScript, std::pair<int, AddressInfo> > historyCache;
 CCriticalSection historyCacheLock;
 
@@ -1613,8 +1776,9 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 }
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
- *  When FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+ *  When FAILED is returned, view is left in an indeterminate state.
+ *  If pdeltas is given, the address index changes are appended to it. */
+DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CAddressDeltas* pdeltas)
 {
     bool fClean = true;
 
@@ -1641,8 +1805,8 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
             if (!tx.vout[o].scriptPubKey.IsUnspendable()) {
                 COutPoint out(hash, o);
                 Coin coin;
-                if (fAddressIndex)
-                    pblockaddressindex->Write (CAddressKey(tx.vout[o].scriptPubKey, out), CAddressValue());
+                if (pdeltas)
+                    pdeltas->emplace_back(CAddressKey(tx.vout[o].scriptPubKey, out), CAddressValue());
                 bool is_spent = view.SpendCoin(out, &coin);
                 if (!is_spent || tx.vout[o] != coin.out || pindex->nHeight != coin.nHeight || is_coinbase != coin.fCoinBase) {
                     fClean = false; // transaction output mismatch
@@ -1659,10 +1823,9 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
             }
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
                 const COutPoint &out = tx.vin[j].prevout;
-                if (fAddressIndex) {
+                if (pdeltas) {
                     const Coin& coin = txundo.vprevout[j];
-                    pblockaddressindex->Write (CAddressKey(coin.out.scriptPubKey, out),
-                                CAddressValue(coin.out.nValue, coin.nHeight, coin.IsCoinBase()));
+                    pdeltas->emplace_back(CAddressKey(coin.out.scriptPubKey, out), CAddressValue(coin.out.nValue, coin.nHeight, coin.IsCoinBase()));
                 }
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
@@ -1682,24 +1845,9 @@ void static FlushBlockFile(bool fFinalize = false)
 {
     LOCK(cs_LastBlockFile);
 
-    CDiskBlockPos posOld(nLastBlockFile, 0);
     bool status = true;
-
-    FILE *fileOld = OpenBlockFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            status &= TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nSize);
-        status &= FileCommit(fileOld);
-        fclose(fileOld);
-    }
-
-    fileOld = OpenUndoFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            status &= TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nUndoSize);
-        status &= FileCommit(fileOld);
-        fclose(fileOld);
-    }
+    status &= blockFileWriter.Commit(nLastBlockFile, fFinalize, vinfoBlockFile[nLastBlockFile].nSize);
+    status &= undoFileWriter.Commit(nLastBlockFile, fFinalize, vinfoBlockFile[nLastBlockFile].nUndoSize);
 
     if (!status) {
         AbortNode("Flushing block file to disk failed. This is likely the result of an I/O error.");
@@ -1762,7 +1910,7 @@ static unsigned int GetBlockScriptFlags(const CBlockIndex* pindex, const Consens
     return flags;
 }
 
-static bool WriteTxIndexDataForBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex)
+static bool WriteTxIndexDataForBlock(const CBlock& block, CValidationState& state, const CBlockIndex* pindex)
 {
     if (!fTxIndex) return true;
 
@@ -1784,11 +1932,38 @@ static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 static int64_t nBlocksTotal = 0;
 
+// The same stages as the BCLog::BENCH timings, exported by /metrics
+static const char CONNECTBLOCK_METRIC[] = "connectblock_duration_seconds";
+static const char CONNECTBLOCK_METRIC_HELP[] = "Time spent in each stage of ConnectBlock";
+static CMetricHistogram g_metric_connect_sanity(CONNECTBLOCK_METRIC, CONNECTBLOCK_METRIC_HELP, "stage=\"sanity\"");
+static CMetricHistogram g_metric_connect_forks(CONNECTBLOCK_METRIC, CONNECTBLOCK_METRIC_HELP, "stage=\"forks\"");
+static CMetricHistogram g_metric_connect_txs(CONNECTBLOCK_METRIC, CONNECTBLOCK_METRIC_HELP, "stage=\"connect\"");
+static CMetricHistogram g_metric_connect_verify(CONNECTBLOCK_METRIC, CONNECTBLOCK_METRIC_HELP, "stage=\"verify\"");
+static CMetricHistogram g_metric_connect_index(CONNECTBLOCK_METRIC, CONNECTBLOCK_METRIC_HELP, "stage=\"index\"");
+static CMetricCounter g_metric_connect_inputs("connectblock_inputs_total", "Transaction inputs of connected blocks");
+
+/** Report the parsed public key cache lookups since the last block, from
+ *  mempool validation as well as this block */
+static void LogPubKeyCacheStats()
+{
+    static PubKeyCacheStats last{0, 0, 0};
+    const PubKeyCacheStats stats = GetPubKeyCacheStats();
+    const uint64_t nHits = stats.nHits - last.nHits;
+    const uint64_t nMisses = stats.nMisses - last.nMisses;
+    last = stats;
+    // Hits would have taken as long to parse as the average miss
+    const double nSavedNanos = stats.nMisses ? (double)nHits * stats.nMissNanos / stats.nMisses : 0;
+    LogPrint(BCLog::BENCH, "    - Pubkey cache: %u hits, %u misses (%.1f%%), ~%.2fms parsing saved\n", nHits, nMisses, nHits + nMisses ? 100.0 * nHits / (nHits + nMisses) : 0.0, nSavedNanos * 0.000001);
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
- *  can fail if those validity checks fail (among other reasons). */
+ *  can fail if those validity checks fail (among other reasons).
+ *  If pdeltas is given, the address index changes are appended to it, and
+ *  if pstats is given the block stats are computed into it. Writing them is
+ *  left to the caller. */
 bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck, CAddressDeltas* pdeltas, CBlockStats* pstats)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -1859,6 +2034,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     }
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
+    g_metric_connect_sanity.Observe(nTime1 - nTimeStart);
     LogPrint(BCLog::BENCH, "    - Sanity checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime1 - nTimeStart), nTimeCheck * MICRO, nTimeCheck * MILLI / nBlocksTotal);
 
     bool fEnforceBIP30 = true;
@@ -1889,6 +2065,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     unsigned int flags = GetBlockScriptFlags(pindex, chainparams.GetConsensus());
 
     int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1;
+    g_metric_connect_forks.Observe(nTime2 - nTime1);
     LogPrint(BCLog::BENCH, "    - Fork checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime2 - nTime1), nTimeForks * MICRO, nTimeForks * MILLI / nBlocksTotal);
 
     CBlockUndo blockundo;
@@ -1933,10 +2110,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
             for (size_t j = 0; j < tx.vin.size(); j++) {
-                if (!fAddressIndex) break;
+                if (!pdeltas) break;
                 const Coin& coin = view.AccessCoin(tx.vin[j].prevout);
-                pblockaddressindex->Write (CAddressKey(coin.out.scriptPubKey, tx.vin[j].prevout), CAddressValue(coin.out.nValue, 
-                            fTxIndex ? coin.nHeight : 0, coin.IsCoinBase(), pindex->nHeight, tx.GetHash(), j));
+                pdeltas->emplace_back(CAddressKey(coin.out.scriptPubKey, tx.vin[j].prevout),
+                                      CAddressValue(coin.out.nValue, fTxIndex ? coin.nHeight : 0, coin.IsCoinBase(), pindex->nHeight, tx.GetHash(), j));
             }
         }
 
@@ -1961,11 +2138,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         }
 
         for (unsigned int k = 0; k < tx.vout.size(); k++) {
-            if (!fAddressIndex) break;
+            if (!pdeltas) break;
             const CTxOut &out = tx.vout[k];
             if (out.scriptPubKey.IsUnspendable()) continue;
-            pblockaddressindex->Write (CAddressKey(out.scriptPubKey, COutPoint(tx.GetHash(), k)), 
-                        CAddressValue(out.nValue, pindex->nHeight, tx.IsCoinBase()));
+            pdeltas->emplace_back(CAddressKey(out.scriptPubKey, COutPoint(tx.GetHash(), k)), CAddressValue(out.nValue, pindex->nHeight, tx.IsCoinBase()));
         }
 
         CTxUndo undoDummy;
@@ -1975,6 +2151,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
+    g_metric_connect_txs.Observe(nTime3 - nTime2);
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
     CAmount blockReward = nFees + GetBlockSubsidy(pindex->nHeight, chainparams.GetConsensus());
@@ -1987,11 +2164,15 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     if (!control.Wait())
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
+    g_metric_connect_verify.Observe(nTime4 - nTime2);
+    g_metric_connect_inputs.Inc(nInputs);
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
 
     if (fJustCheck)
         return true;
 
+    LogPubKeyCacheStats();
+
     if (!WriteUndoDataForBlock(blockundo, state, pindex, chainparams))
         return false;
 
@@ -2000,14 +2181,15 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         setDirtyBlockIndex.insert(pindex);
     }
 
-    if (!WriteTxIndexDataForBlock(block, state, pindex))
-        return false;
+    if (pstats && !ComputeBlockStats(block, blockundo, *pstats))
+        return error("ConnectBlock(): block and undo data inconsistent");
 
     assert(pindex->phashBlock);
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
     int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
+    g_metric_connect_index.Observe(nTime5 - nTime4);
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5 - nTime4), nTimeIndex * MICRO, nTimeIndex * MILLI / nBlocksTotal);
 
     int64_t nTime6 = GetTimeMicros(); nTimeCallbacks += nTime6 - nTime5;
@@ -2107,20 +2289,10 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 }
             }
         }
-        if (!fPruneMode && !fReindex && (chainActive.Height() > 100000)) {
-            const CBlockIndex* pi = chainActive.Tip();
-            if (pi) pi = pi->GetAncestor(chainActive.Height() - 100000);
-            int newfn = 0;
-            if (pi) newfn = pi->nFile;
-            if (newfn == nLastBlockFile) newfn--;
-            for (int fileNumber = 0; fileNumber < newfn; fileNumber++) {
-                if (vinfoBlockFile[fileNumber].nUndoSize == 0) continue;
-                PruneOneUndoFile(fileNumber);
-                setFilesToUndoPrune.insert(fileNumber);
-            }
-            if (!setFilesToUndoPrune.empty()) {
-                fFlushForUndoPrune = true;
-            }
+        // Undo data past -undoretain is dropped between blocks, not while connecting them
+        if (!fPruneMode && nUndoRetain > 0 && mode == FlushStateMode::PERIODIC && !fReindex && chainActive.Height() > nUndoRetain) {
+            FindUndoFilesToPrune(setFilesToUndoPrune, chainActive.Height() - nUndoRetain);
+            fFlushForUndoPrune = !setFilesToUndoPrune.empty();
         }
         int64_t nNow = GetTimeMicros();
         // Avoid writing/flushing immediately after startup.
@@ -2131,7 +2303,10 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             nLastFlush = nNow;
         }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage();
+        // Entries still being written by the background flush and coins
+        // prefetched for coming blocks count as well
+        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() + pcoinsdbview->PendingMemoryUsage();
+        if (pcoinsprefetch) cacheSize += pcoinsprefetch->DynamicMemoryUsage();
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FlushStateMode::PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
@@ -2142,10 +2317,13 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
         bool fPeriodicWrite = mode == FlushStateMode::PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FlushStateMode::PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
+        // The index caches are full. They are written after the block index, which has their best blocks.
+        bool fIndexLarge = mode != FlushStateMode::NONE && ((fTxIndex && pblocktxindex->IsCacheLarge()) || (fAddressIndex && pblockaddressindex->IsCacheLarge()) ||
+                                                               (fBlockStatsIndex && pblockstatsindex->IsCacheLarge()) || pblocktree->IsCacheLarge());
         // Combine all conditions that result in a full cache flush.
-        fDoFullFlush = (mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune || fFlushForUndoPrune;
-        // Write blocks and block index to disk.
-        if (fDoFullFlush || fPeriodicWrite) {
+        fDoFullFlush = (mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        // Write blocks and block index to disk. Deleting undo files only needs the block index written first.
+        if (fDoFullFlush || fPeriodicWrite || fIndexLarge || fFlushForUndoPrune) {
             // Depend on nMinDiskSpace to ensure we can write block index
             if (!CheckDiskSpace(0, true))
                 return state.Error("out of disk space");
@@ -2165,9 +2343,6 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                     vBlocks.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
-                if (!pblocktree->FlushAuxPow()) {
-                    return AbortNode(state, "Failed write aux pow info to database");
-                }
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Failed write block index to database");
                 }
@@ -2177,6 +2352,9 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 if (fAddressIndex && !pblockaddressindex->Flush()) {
                     return AbortNode(state, "Failed write addresses index to database");
                 }
+                if (fBlockStatsIndex && !pblockstatsindex->Flush()) {
+                    return AbortNode(state, "Failed write block stats index to database");
+                }
                 CleanAddressInfo ();
             }
             // Finally remove any pruned files
@@ -2196,7 +2374,13 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
             // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            // Clean entries stay cached; the cache is trimmed to make room for
+            // new ones only. With -asyncflush the write completes in the
+            // background, except when pruning or when asked to flush everything.
+            if (!pcoinsTip->Sync())
+                return AbortNode(state, "Failed to write to coin database");
+            pcoinsTip->Trim(nCoinCacheUsage * COINS_CACHE_RETAIN_PERCENT / 100);
+            if ((mode == FlushStateMode::ALWAYS || fFlushForPrune) && !pcoinsdbview->WaitForWrites())
                 return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
             full_flush_completed = true;
@@ -2246,11 +2430,22 @@ static void AppendWarning(std::string& res, const std::string& warn)
     res += warn;
 }
 
+// Chain state as of the last tip change, so that /metrics does not need cs_main
+static CMetricGauge g_metric_tip_height("chain_height", "Height of the active chain tip");
+static CMetricGauge g_metric_tip_time("chain_tip_time_seconds", "Block time of the active chain tip");
+static CMetricGauge g_metric_coins_cache_bytes("coins_cache_bytes", "Memory used by the UTXO cache");
+static CMetricGauge g_metric_coins_cache_entries("coins_cache_entries", "Entries in the UTXO cache");
+
 /** Check warning conditions and do some notifications on new chain tip set. */
 void static UpdateTip(const CBlockIndex *pindexNew, const CChainParams& chainParams) {
     // New best block
     mempool.AddTransactionsUpdated(1);
 
+    g_metric_tip_height.Set(pindexNew->nHeight);
+    g_metric_tip_time.Set(pindexNew->GetBlockTime());
+    g_metric_coins_cache_bytes.Set(pcoinsTip->DynamicMemoryUsage());
+    g_metric_coins_cache_entries.Set(pcoinsTip->GetCacheSize());
+
     {
         WaitableLock lock(g_best_block_mutex);
         g_best_block = pindexNew->GetBlockHash();
@@ -2266,6 +2461,31 @@ void static UpdateTip(const CBlockIndex *pindexNew, const CChainParams& chainPar
 
 }
 
+static CMetricHistogram g_metric_disconnect("disconnectblock_duration_seconds", "Time spent disconnecting a block from the chain state");
+
+/**
+ * Apply the address index changes of a block connected or disconnected by the
+ * tip, and move the best block of the indexes to pindex. The transaction
+ * index entries and block stats of connected blocks are written by
+ * ConnectTip(), so that blocks connected elsewhere, as by VerifyDB, leave the
+ * indexes alone. The indexes are only written at block boundaries, see
+ * FlushStateToDisk().
+ */
+static void UpdateIndexes(const CBlockIndex* pindex, const CAddressDeltas* pdeltas)
+{
+    if (!fAddressIndex && !fTxIndex && !fBlockStatsIndex) return;
+    const CBlockLocator locator = chainActive.GetLocator(pindex);
+    if (fAddressIndex) {
+        for (const auto& delta : *pdeltas)
+            pblockaddressindex->Write(delta.first, delta.second);
+        pblockaddressindex->SetBestBlock(locator);
+    }
+    if (fTxIndex)
+        pblocktxindex->SetBestBlock(locator);
+    if (fBlockStatsIndex)
+        pblockstatsindex->SetBestBlock(locator);
+}
+
 /** Disconnect chainActive's tip.
   * After calling, the mempool will be in an inconsistent state, with
   * transactions from disconnected blocks being added to disconnectpool.  You
@@ -2287,14 +2507,21 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
         return AbortNode(state, "Failed to read block");
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
+    const bool fNotifyDeltas = fNotifyAddressDeltas;
+    std::shared_ptr<CAddressDeltas> pdeltas;
+    if (fNotifyDeltas || fAddressIndex) pdeltas = std::make_shared<CAddressDeltas>();
     {
         CCoinsViewCache view(pcoinsTip.get());
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
+        if (DisconnectBlock(block, pindexDelete, view, pdeltas.get()) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         bool flushed = view.Flush();
         assert(flushed);
     }
+    if (fBlockStatsIndex)
+        pblockstatsindex->Write(pindexDelete->nHeight, CBlockStats());
+    UpdateIndexes(pindexDelete->pprev, pdeltas.get());
+    g_metric_disconnect.Observe(GetTimeMicros() - nStart);
     LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * MILLI);
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
@@ -2316,6 +2543,7 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     chainActive.SetTip(pindexDelete->pprev);
 
     UpdateTip(pindexDelete->pprev, chainparams);
+    if (fNotifyDeltas) GetMainSignals().BlockAddressDeltas(pindexDelete, false, std::move(pdeltas));
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
     GetMainSignals().BlockDisconnected(pblock);
@@ -2323,15 +2551,28 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
 
+static const char CONNECTTIP_METRIC[] = "connecttip_duration_seconds";
+static const char CONNECTTIP_METRIC_HELP[] = "Time spent in each stage of ConnectTip";
+static CMetricHistogram g_metric_tip_load(CONNECTTIP_METRIC, CONNECTTIP_METRIC_HELP, "stage=\"load\"");
+static CMetricHistogram g_metric_tip_prefetch(CONNECTTIP_METRIC, CONNECTTIP_METRIC_HELP, "stage=\"prefetch\"");
+static CMetricHistogram g_metric_tip_connect(CONNECTTIP_METRIC, CONNECTTIP_METRIC_HELP, "stage=\"connect\"");
+static CMetricHistogram g_metric_tip_flush(CONNECTTIP_METRIC, CONNECTTIP_METRIC_HELP, "stage=\"flush\"");
+static CMetricHistogram g_metric_tip_chainstate(CONNECTTIP_METRIC, CONNECTTIP_METRIC_HELP, "stage=\"chainstate\"");
+static CMetricHistogram g_metric_tip_postprocess(CONNECTTIP_METRIC, CONNECTTIP_METRIC_HELP, "stage=\"postprocess\"");
+static CMetricHistogram g_metric_tip_total(CONNECTTIP_METRIC, CONNECTTIP_METRIC_HELP, "stage=\"total\"");
+
 struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
     std::shared_ptr<const CBlock> pblock;
     std::shared_ptr<std::vector<CTransactionRef>> conflictedTxs;
+    //! Address deltas for BlockAddressDeltas, if anyone listens
+    std::shared_ptr<const CAddressDeltas> deltas;
     PerBlockConnectTrace() : conflictedTxs(std::make_shared<std::vector<CTransactionRef>>()) {}
 };
 /**
@@ -2364,12 +2605,13 @@ public:
         pool.NotifyEntryRemoved.disconnect(boost::bind(&ConnectTrace::NotifyEntryRemoved, this, _1, _2));
     }
 
-    void BlockConnected(CBlockIndex* pindex, std::shared_ptr<const CBlock> pblock) {
+    void BlockConnected(CBlockIndex* pindex, std::shared_ptr<const CBlock> pblock, std::shared_ptr<const CAddressDeltas> deltas) {
         assert(!blocksConnected.back().pindex);
         assert(pindex);
         assert(pblock);
         blocksConnected.back().pindex = pindex;
         blocksConnected.back().pblock = std::move(pblock);
+        blocksConnected.back().deltas = std::move(deltas);
         blocksConnected.emplace_back();
     }
 
@@ -2393,6 +2635,29 @@ public:
     }
 };
 
+/**
+ * Queue reads of the inputs of the block at nHeight that are neither created
+ * by the block itself nor in pcoinsTip. With fWait, return once they are read.
+ */
+static void PrefetchBlockInputs(const CBlock& block, int nHeight, bool fWait)
+{
+    AssertLockHeld(cs_main);
+    if (!pcoinsprefetch) return;
+    std::unordered_set<uint256, SaltedTxidHasher> created;
+    for (const auto& tx : block.vtx) {
+        created.insert(tx->GetHash());
+    }
+    std::vector<COutPoint> outpoints;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (created.count(txin.prevout.hash) || pcoinsTip->HaveCoinInCache(txin.prevout)) continue;
+            outpoints.push_back(txin.prevout);
+        }
+    }
+    pcoinsprefetch->Prefetch(std::move(outpoints), nHeight, fWait);
+}
+
 /**
  * Connect a new block to chainActive. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
@@ -2416,28 +2681,48 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     const CBlock& blockConnecting = *pthisBlock;
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
+    g_metric_tip_load.Observe(nTime2 - nTime1);
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    // Read the inputs the cache is missing in parallel, not one at a time in ConnectBlock
+    PrefetchBlockInputs(blockConnecting, pindexNew->nHeight, true);
+    int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+    g_metric_tip_prefetch.Observe(nTimePrefetched - nTime2);
+    LogPrint(BCLog::BENCH, "  - Prefetch inputs: %.2fms [%.2fs]\n", (nTimePrefetched - nTime2) * MILLI, nTimePrefetch * MICRO);
+    const bool fNotifyDeltas = fNotifyAddressDeltas;
+    std::shared_ptr<CAddressDeltas> pdeltas;
+    if (fNotifyDeltas || fAddressIndex) pdeltas = std::make_shared<CAddressDeltas>();
+    CBlockStats stats;
     {
         CCoinsViewCache view(pcoinsTip.get());
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, pdeltas.get(), fBlockStatsIndex ? &stats : nullptr);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
                 InvalidBlockFound(pindexNew, state);
+            // The coins left over were read for this block or another at its height
+            if (pcoinsprefetch) pcoinsprefetch->Evict(pindexNew->nHeight);
             return error("ConnectTip(): ConnectBlock %s failed", pindexNew->GetBlockHash().ToString());
         }
-        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
-        LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
+        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTimePrefetched;
+        g_metric_tip_connect.Observe(nTime3 - nTimePrefetched);
+        LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTimePrefetched) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
         bool flushed = view.Flush();
         assert(flushed);
     }
+    if (!WriteTxIndexDataForBlock(blockConnecting, state, pindexNew))
+        return false;
+    if (fBlockStatsIndex && !pblockstatsindex->Write(pindexNew->nHeight, stats))
+        return AbortNode(state, "Failed to write block stats");
+    UpdateIndexes(pindexNew, pdeltas.get());
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
+    g_metric_tip_flush.Observe(nTime4 - nTime3);
     LogPrint(BCLog::BENCH, "  - Flush: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
         return false;
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    g_metric_tip_chainstate.Observe(nTime5 - nTime4);
     LogPrint(BCLog::BENCH, "  - Writing chainstate: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime5 - nTime4) * MILLI, nTimeChainState * MICRO, nTimeChainState * MILLI / nBlocksTotal);
     // Remove conflicting transactions from the mempool.;
     mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
@@ -2445,12 +2730,17 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     // Update chainActive & related variables.
     chainActive.SetTip(pindexNew);
     UpdateTip(pindexNew, chainparams);
+    // Coins read for blocks up to the tip that were not used are of no use any more
+    if (pcoinsprefetch) pcoinsprefetch->Evict(pindexNew->nHeight);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
+    g_metric_tip_postprocess.Observe(nTime6 - nTime5);
+    g_metric_tip_total.Observe(nTime6 - nTime1);
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
 
-    connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
+    if (!fNotifyDeltas) pdeltas.reset();
+    connectTrace.BlockConnected(pindexNew, std::move(pthisBlock), std::move(pdeltas));
     return true;
 }
 
@@ -2528,6 +2818,20 @@ void CChainState::PruneBlockIndexCandidates() {
  * Try to make some progress towards making pindexMostWork the active block.
  * pblock is either nullptr or a pointer to a CBlock corresponding to pindexMostWork.
  */
+/**
+ * Whether the blocks of the active chain above pindexFork can be disconnected,
+ * i.e. still have their undo data. Undo data deleted by -undoretain or by
+ * pruning limits how deep a reorganization can go.
+ */
+static bool HaveUndoDataAbove(const CBlockIndex* pindexFork) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    for (const CBlockIndex* pindex = chainActive.Tip(); pindex && pindex != pindexFork; pindex = pindex->pprev) {
+        if (!(pindex->nStatus & BLOCK_HAVE_UNDO)) return false;
+    }
+    return true;
+}
+
 bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace)
 {
     AssertLockHeld(cs_main);
@@ -2535,6 +2839,11 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
     const CBlockIndex *pindexOldTip = chainActive.Tip();
     const CBlockIndex *pindexFork = chainActive.FindFork(pindexMostWork);
 
+    // Do not start a reorganization that cannot be completed
+    if (!HaveUndoDataAbove(pindexFork)) {
+        return state.Error(strprintf("undo data needed to reorganize to height %d is no longer available", pindexFork ? pindexFork->nHeight : -1));
+    }
+
     // Disconnect active blocks which are no longer in the best chain.
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool;
@@ -2660,15 +2969,14 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
     do {
         boost::this_thread::interruption_point();
 
-        if (GetMainSignals().CallbacksPending() > 10) {
-            // Block until the validation queue drains. This should largely
-            // never happen in normal operation, however may happen during
-            // reindex, causing memory blowup if we run too far ahead.
-            // Note that if a validationinterface callback ends up calling
-            // ActivateBestChain this may lead to a deadlock! We should
-            // probably have a DEBUG_LOCKORDER test for this in the future.
-            SyncWithValidationInterfaceQueue();
-        }
+        // Block until subscribers we wait for have drained their queues
+        // enough. This should largely never happen in normal operation,
+        // however may happen during reindex, causing memory blowup if we
+        // run too far ahead.
+        // Note that if a validationinterface callback ends up calling
+        // ActivateBestChain this may lead to a deadlock! We should
+        // probably have a DEBUG_LOCKORDER test for this in the future.
+        GetMainSignals().LimitBacklog();
 
         {
             LOCK(cs_main);
@@ -2702,6 +3010,7 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
 
                 for (const PerBlockConnectTrace& trace : connectTrace.GetBlocksConnected()) {
                     assert(trace.pblock && trace.pindex);
+                    if (trace.deltas) GetMainSignals().BlockAddressDeltas(trace.pindex, true, trace.deltas);
                     GetMainSignals().BlockConnected(trace.pblock, trace.pindex, trace.conflictedTxs);
                 }
             } while (!chainActive.Tip() || (starting_tip && CBlockIndexWorkComparator()(chainActive.Tip(), starting_tip)));
@@ -2778,6 +3087,10 @@ bool CChainState::InvalidateBlock(CValidationState& state, const CChainParams& c
     bool pindex_was_in_chain = false;
     CBlockIndex *invalid_walk_tip = chainActive.Tip();
 
+    if (chainActive.Contains(pindex) && !HaveUndoDataAbove(pindex->pprev)) {
+        return state.Error(strprintf("undo data needed to reorganize to height %d is no longer available", pindex->nHeight - 1));
+    }
+
     DisconnectedBlockTransactions disconnectpool;
     while (chainActive.Contains(pindex)) {
         pindex_was_in_chain = true;
@@ -2880,7 +3193,8 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
     if (pi) return pi;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
+    pindexNew->SetBlockHeader(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -2914,6 +3228,7 @@ void CChainState::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pi
     pindexNew->nStatus |= BLOCK_HAVE_DATA;
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
     setDirtyBlockIndex.insert(pindexNew);
+    AddBlockToFileList(pindexNew);
 
     if (pindexNew->pprev == nullptr || pindexNew->pprev->nChainTx) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
@@ -2952,8 +3267,16 @@ static bool FindBlockPos(CDiskBlockPos &pos, unsigned int nAddSize, unsigned int
         vinfoBlockFile.resize(nFile + 1);
     }
 
+    // Tests use small files to have several of them with a short chain
+    unsigned int nMaxFileSize = MAX_BLOCKFILE_SIZE;
+    unsigned int nChunkSize = BLOCKFILE_CHUNK_SIZE;
+    if (gArgs.GetBoolArg("-fastprune", false)) {
+        nMaxFileSize = std::max(FASTPRUNE_BLOCKFILE_SIZE, nAddSize + 1);
+        nChunkSize = FASTPRUNE_BLOCKFILE_SIZE;
+    }
+
     if (!fKnown) {
-        while (vinfoBlockFile[nFile].nSize + nAddSize >= MAX_BLOCKFILE_SIZE) {
+        while (vinfoBlockFile[nFile].nSize + nAddSize >= nMaxFileSize) {
             nFile++;
             if (vinfoBlockFile.size() <= nFile) {
                 vinfoBlockFile.resize(nFile + 1);
@@ -2978,18 +3301,14 @@ static bool FindBlockPos(CDiskBlockPos &pos, unsigned int nAddSize, unsigned int
         vinfoBlockFile[nFile].nSize += nAddSize;
 
     if (!fKnown) {
-        unsigned int nOldChunks = (pos.nPos + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
-        unsigned int nNewChunks = (vinfoBlockFile[nFile].nSize + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
+        unsigned int nOldChunks = (pos.nPos + nChunkSize - 1) / nChunkSize;
+        unsigned int nNewChunks = (vinfoBlockFile[nFile].nSize + nChunkSize - 1) / nChunkSize;
         if (nNewChunks > nOldChunks) {
             if (fPruneMode)
                 fCheckForPruning = true;
-            if (CheckDiskSpace(nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos, true)) {
-                FILE *file = OpenBlockFile(pos);
-                if (file) {
-                    LogPrintf("Pre-allocating up to position 0x%x in blk%05u.dat\n", nNewChunks * BLOCKFILE_CHUNK_SIZE, pos.nFile);
-                    AllocateFileRange(file, pos.nPos, nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos);
-                    fclose(file);
-                }
+            if (CheckDiskSpace(nNewChunks * nChunkSize - pos.nPos, true)) {
+                LogPrintf("Pre-allocating up to position 0x%x in blk%05u.dat\n", nNewChunks * nChunkSize, pos.nFile);
+                blockFileWriter.Allocate(pos, nNewChunks * nChunkSize - pos.nPos);
             }
             else
                 return error("out of disk space");
@@ -3017,12 +3336,8 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
         if (fPruneMode)
             fCheckForPruning = true;
         if (CheckDiskSpace(nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos, true)) {
-            FILE *file = OpenUndoFile(pos);
-            if (file) {
-                LogPrintf("Pre-allocating up to position 0x%x in rev%05u.dat\n", nNewChunks * UNDOFILE_CHUNK_SIZE, pos.nFile);
-                AllocateFileRange(file, pos.nPos, nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos);
-                fclose(file);
-            }
+            LogPrintf("Pre-allocating up to position 0x%x in rev%05u.dat\n", nNewChunks * UNDOFILE_CHUNK_SIZE, pos.nFile);
+            undoFileWriter.Allocate(pos, nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos);
         }
         else
             return state.Error("out of disk space");
@@ -3399,6 +3714,12 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
                 *ppindex = pindex;
             }
         }
+        // Merkle roots of new headers are only kept in memory until their
+        // index entries are written, which a headers-only sync never does
+        if (pblocktree->IsCacheLarge()) {
+            CValidationState stateDummy;
+            FlushStateToDisk(chainparams, stateDummy, FlushStateMode::IF_NEEDED);
+        }
     }
     NotifyHeaderTip();
     return true;
@@ -3523,6 +3844,10 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
             GetMainSignals().BlockChecked(*pblock, state);
             return error("%s: AcceptBlock FAILED (%s)", __func__, FormatStateMessage(state));
         }
+        // Blocks about to be connected get their inputs read while earlier ones are validated
+        if (pindex && pindex->nHeight > chainActive.Height() && pindex->nHeight <= chainActive.Height() + PREFETCH_LOOKAHEAD) {
+            PrefetchBlockInputs(*pblock, pindex->nHeight, false);
+        }
     }
 
     NotifyHeaderTip();
@@ -3578,10 +3903,11 @@ uint64_t CalculateCurrentUsage()
 /* Prune a block file (modify associated database entries)*/
 void PruneOneBlockFile(const int fileNumber)
 {
+    AssertLockHeld(cs_main);
     LOCK(cs_LastBlockFile);
 
-    for (const auto& entry : mapBlockIndex) {
-        CBlockIndex* pindex = entry.second;
+    if ((size_t)fileNumber >= vBlocksInFile.size()) return;
+    for (CBlockIndex* pindex : vBlocksInFile[fileNumber]) {
         if (pindex->nFile == fileNumber) {
             pindex->nStatus &= ~BLOCK_HAVE_DATA;
             pindex->nStatus &= ~BLOCK_HAVE_UNDO;
@@ -3605,24 +3931,27 @@ void PruneOneBlockFile(const int fileNumber)
         }
     }
 
+    std::vector<CBlockIndex*>().swap(vBlocksInFile[fileNumber]);
     vinfoBlockFile[fileNumber].SetNull();
     setDirtyFileInfo.insert(fileNumber);
 }
 
-/* Prune a block file (modify associated database entries)*/
+/* Prune the undo file of a block file, keeping the blocks (modify associated database entries)*/
 void PruneOneUndoFile(const int fileNumber)
 {
+    AssertLockHeld(cs_main);
     LOCK(cs_LastBlockFile);
 
-    for (const auto& entry : mapBlockIndex) {
-        CBlockIndex* pindex = entry.second;
-        if (pindex->nFile == fileNumber) {
-            pindex->nStatus &= ~BLOCK_HAVE_UNDO;
-            pindex->nUndoPos = 0;
-            setDirtyBlockIndex.insert(pindex);
+    if ((size_t)fileNumber < vBlocksInFile.size()) {
+        for (CBlockIndex* pindex : vBlocksInFile[fileNumber]) {
+            if (pindex->nFile == fileNumber && (pindex->nStatus & BLOCK_HAVE_UNDO)) {
+                pindex->nStatus &= ~BLOCK_HAVE_UNDO;
+                pindex->nUndoPos = 0;
+                setDirtyBlockIndex.insert(pindex);
+            }
         }
     }
-    
+
     vinfoBlockFile[fileNumber].nUndoSize = 0;
     setDirtyFileInfo.insert(fileNumber);
 }
@@ -3631,6 +3960,13 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        {
+            LOCK(cs_LastBlockFile);
+            blockFileWriter.Close(*it);
+            undoFileWriter.Close(*it);
+        }
+        blockFileCache.Close(GetBlockPosFilename(pos, "blk"));
+        blockFileCache.Close(GetBlockPosFilename(pos, "rev"));
         fs::remove(GetBlockPosFilename(pos, "blk"));
         fs::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -3641,11 +3977,31 @@ void UnlinkPrunedUndoFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        {
+            LOCK(cs_LastBlockFile);
+            undoFileWriter.Close(*it);
+        }
+        blockFileCache.Close(GetBlockPosFilename(pos, "rev"));
         fs::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted rev (%05u)\n", __func__, *it);
     }
 }
 
+/* Calculate the rev files to delete when not pruning: those with no block above nMaxHeight */
+static void FindUndoFilesToPrune(std::set<int>& setFilesToPrune, int nMaxHeight)
+{
+    LOCK2(cs_main, cs_LastBlockFile);
+    for (int fileNumber = 0; fileNumber < nLastBlockFile; fileNumber++) {
+        if (vinfoBlockFile[fileNumber].nUndoSize == 0 || vinfoBlockFile[fileNumber].nHeightLast >= (unsigned)nMaxHeight)
+            continue;
+        PruneOneUndoFile(fileNumber);
+        setFilesToPrune.insert(fileNumber);
+    }
+    if (!setFilesToPrune.empty()) {
+        LogPrintf("Prune (undo): keeping undo data above height %d, removed %d rev files\n", nMaxHeight, setFilesToPrune.size());
+    }
+}
+
 /* Calculate the block/rev files to delete based on height specified by user with RPC command pruneblockchain */
 static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPruneHeight)
 {
@@ -3787,11 +4143,6 @@ FILE* OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly) {
     return OpenDiskFile(pos, "blk", fReadOnly);
 }
 
-/** Open an undo file (rev?????.dat) */
-static FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly) {
-    return OpenDiskFile(pos, "rev", fReadOnly);
-}
-
 fs::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix)
 {
     return GetBlocksDir() / strprintf("%s%05u.dat", prefix, pos.nFile);
@@ -3809,7 +4160,7 @@ CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
     if (pi) return pi;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
     BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -3897,6 +4248,7 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
         CBlockIndex* pindex = item.second;
         if (pindex->nStatus & BLOCK_HAVE_DATA) {
             setBlkDataFiles.insert(pindex->nFile);
+            AddBlockToFileList(pindex);
         }
     }
     for (std::set<int>::iterator it = setBlkDataFiles.begin(); it != setBlkDataFiles.end(); it++)
@@ -3922,6 +4274,8 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
     LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled"); 
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled"); 
+    pblocktree->ReadFlag("blockstatsindex", fBlockStatsIndex);
+    LogPrintf("%s: block stats index %s\n", __func__, fBlockStatsIndex ? "enabled" : "disabled");
 
     return true;
 }
@@ -4153,6 +4507,121 @@ bool ReplayBlocks(const CChainParams& params, CCoinsView* view) {
     return g_chainstate.ReplayBlocks(params, view);
 }
 
+static bool ReplayTxIndexBlock(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex, bool fConnect)
+{
+    // Entries of disconnected transactions are left in place, as DisconnectTip does
+    CValidationState state;
+    return !fConnect || WriteTxIndexDataForBlock(block, state, pindex);
+}
+
+/** The address index changes ConnectBlock and DisconnectBlock make, with the spent coins taken from the undo data */
+static bool ReplayAddressIndexBlock(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex, bool fConnect)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) return false;
+    for (size_t n = 0; n < block.vtx.size(); n++) {
+        const size_t i = fConnect ? n : block.vtx.size() - 1 - n;
+        const CTransaction& tx = *block.vtx[i];
+        if (i > 0 && blockundo.vtxundo[i - 1].vprevout.size() != tx.vin.size()) return false;
+        if (fConnect) {
+            for (size_t j = 0; i > 0 && j < tx.vin.size(); j++) {
+                const Coin& coin = blockundo.vtxundo[i - 1].vprevout[j];
+                pblockaddressindex->Write(CAddressKey(coin.out.scriptPubKey, tx.vin[j].prevout),
+                                          CAddressValue(coin.out.nValue, fTxIndex ? coin.nHeight : 0, coin.IsCoinBase(), pindex->nHeight, tx.GetHash(), j));
+            }
+        }
+        for (size_t k = 0; k < tx.vout.size(); k++) {
+            if (tx.vout[k].scriptPubKey.IsUnspendable()) continue;
+            CAddressKey key(tx.vout[k].scriptPubKey, COutPoint(tx.GetHash(), k));
+            pblockaddressindex->Write(key, fConnect ? CAddressValue(tx.vout[k].nValue, pindex->nHeight, tx.IsCoinBase()) : CAddressValue());
+        }
+        if (!fConnect) {
+            for (size_t j = tx.vin.size(); i > 0 && j-- > 0;) {
+                const Coin& coin = blockundo.vtxundo[i - 1].vprevout[j];
+                pblockaddressindex->Write(CAddressKey(coin.out.scriptPubKey, tx.vin[j].prevout), CAddressValue(coin.out.nValue, coin.nHeight, coin.IsCoinBase()));
+            }
+        }
+    }
+    return true;
+}
+
+static bool ReplayBlockStatsBlock(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex, bool fConnect)
+{
+    if (!fConnect) return pblockstatsindex->Write(pindex->nHeight, CBlockStats());
+    CBlockStats stats;
+    return ComputeBlockStats(block, blockundo, stats) && pblockstatsindex->Write(pindex->nHeight, stats);
+}
+
+/**
+ * Bring an index from the block it was last written at to chainActive's tip:
+ * disconnect the blocks on its branch down to the fork, then connect the
+ * blocks of the active chain.
+ */
+template <typename IndexDB>
+static bool ReplayIndex(IndexDB& index, const char* name, const CChainParams& params, bool fNeedUndo,
+                        bool (*replay)(const CBlock&, const CBlockUndo&, const CBlockIndex*, bool))
+{
+    AssertLockHeld(cs_main);
+    CBlockLocator locator;
+    if (!index.ReadBestBlock(locator)) {
+        // Written by an older version, which kept it in step with the chain state
+        LogPrintf("%s: %s has no best block, assuming it is at the chain tip\n", __func__, name);
+        index.SetBestBlock(chainActive.GetLocator());
+        return index.Flush();
+    }
+    const CBlockIndex* pindexOld = locator.IsNull() ? nullptr : LookupBlockIndex(locator.vHave[0]);
+    if (!pindexOld) {
+        return error("%s: best block of the %s is not in the block index", __func__, name);
+    }
+    const CBlockIndex* pindexFork = chainActive.FindFork(pindexOld);
+    if (pindexOld == chainActive.Tip()) return true;
+    if (!pindexFork) {
+        return error("%s: best block of the %s is not on the chain", __func__, name);
+    }
+
+    LogPrintf("Replaying blocks into the %s from %s (%i) to %s (%i)\n", name,
+        pindexOld->GetBlockHash().ToString(), pindexOld->nHeight, chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height());
+    CBlock block;
+    CBlockUndo blockundo;
+    for (const CBlockIndex* pindex = pindexOld; pindex != pindexFork; pindex = pindex->pprev) {
+        if (!ReadBlockFromDisk(block, pindex, params.GetConsensus()) || (fNeedUndo && !UndoReadFromDisk(blockundo, pindex))) {
+            return error("%s: cannot read block or undo data to roll the %s back at %d, hash=%s", __func__, name, pindex->nHeight, pindex->GetBlockHash().ToString());
+        }
+        if (!replay(block, blockundo, pindex, false)) {
+            return error("%s: rolling the %s back failed at %d, hash=%s", __func__, name, pindex->nHeight, pindex->GetBlockHash().ToString());
+        }
+        if (index.IsCacheLarge()) {
+            index.SetBestBlock(chainActive.GetLocator(pindex->pprev));
+            if (!index.Flush()) return false;
+        }
+    }
+    for (const CBlockIndex* pindex = chainActive.Next(pindexFork); pindex; pindex = chainActive.Next(pindex)) {
+        if (!ReadBlockFromDisk(block, pindex, params.GetConsensus()) || (fNeedUndo && !UndoReadFromDisk(blockundo, pindex))) {
+            return error("%s: cannot read block or undo data to roll the %s forward at %d, hash=%s", __func__, name, pindex->nHeight, pindex->GetBlockHash().ToString());
+        }
+        if (!replay(block, blockundo, pindex, true)) {
+            return error("%s: rolling the %s forward failed at %d, hash=%s", __func__, name, pindex->nHeight, pindex->GetBlockHash().ToString());
+        }
+        if (index.IsCacheLarge()) {
+            index.SetBestBlock(chainActive.GetLocator(pindex));
+            if (!index.Flush()) return false;
+        }
+    }
+    index.SetBestBlock(chainActive.GetLocator());
+    return index.Flush();
+}
+
+bool ReplayIndexes(const CChainParams& params)
+{
+    LOCK(cs_main);
+    if (fTxIndex && !ReplayIndex(*pblocktxindex, "transaction index", params, false, ReplayTxIndexBlock))
+        return false;
+    if (fAddressIndex && !ReplayIndex(*pblockaddressindex, "address index", params, true, ReplayAddressIndexBlock))
+        return false;
+    if (fBlockStatsIndex && !ReplayIndex(*pblockstatsindex, "block stats index", params, true, ReplayBlockStatsBlock))
+        return false;
+    return true;
+}
+
 bool RewindBlockIndex(const CChainParams& params) {
     return true;
 }
@@ -4174,19 +4643,36 @@ void UnloadBlockIndex()
     mempool.clear();
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
+    vBlocksInFile.clear();
+    {
+        LOCK(cs_LastBlockFile);
+        blockFileWriter.Close();
+        undoFileWriter.Close();
+    }
+    blockFileCache.Clear();
     nLastBlockFile = 0;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
 
-    for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
     fHavePruned = false;
 
     g_chainstate.UnloadBlockIndex();
 }
 
+BlockIndexMemoryStats GetBlockIndexMemoryStats()
+{
+    AssertLockHeld(cs_main);
+    BlockIndexMemoryStats stats;
+    stats.nEntries = mapBlockIndex.size();
+    stats.nActiveEntries = chainActive.Height() + 1;
+    stats.nEntryBytes = blockIndexArena.DynamicMemoryUsage();
+    stats.nMapBytes = memusage::DynamicUsage(mapBlockIndex);
+    if (pblocktree) stats.nPendingMerkleRoots = pblocktree->GetCachedMerkleRoots();
+    return stats;
+}
+
 bool LoadBlockIndex(const CChainParams& chainparams)
 {
     // Load block index from databases
@@ -4210,6 +4696,8 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         pblocktree->WriteFlag("txindex", fTxIndex);
         fAddressIndex = gArgs.GetBoolArg("-addressindex", false);
         pblocktree->WriteFlag("addressindex", fAddressIndex);
+        fBlockStatsIndex = gArgs.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX);
+        pblocktree->WriteFlag("blockstatsindex", fBlockStatsIndex);
     }
     return true;
 }
@@ -4526,9 +5014,7 @@ public:
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
     }
 } instance_of_cmaincleanup;
@@ -38,11 +38,14 @@ class CBlockIndex;
 class CBlockTreeDB;
 class CTxIndexDB;
 class CAddressIndexDB;
+class CBlockStatsIndexDB;
 class CChainParams;
 class CCoinsViewDB;
+class CCoinsViewPrefetch;
 class CInv;
 class CConnman;
 class CScriptCheck;
+class CSignatureBatch;
 class CBlockPolicyEstimator;
 class CTxMemPool;
 class CValidationState;
@@ -82,6 +85,10 @@ static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
+/** File descriptors of the blk and rev files being written, kept open between blocks */
+static const int BLOCK_FILE_WRITER_DESCRIPTORS = 2;
+/** The maximum size and pre-allocation chunk size of blk?????.dat files with -fastprune */
+static const unsigned int FASTPRUNE_BLOCKFILE_SIZE = 0x10000; // 64 KiB
 
 /** Maximum number of script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
@@ -122,6 +129,8 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 /** Default for -permitbaremultisig */
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+/** Default for -blockfilemmap */
+static const bool DEFAULT_BLOCKFILE_MMAP = false;
 static const bool DEFAULT_TXINDEX = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
@@ -164,10 +173,15 @@ extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
 extern bool fAddressIndex;
+extern bool fBlockStatsIndex;
+/** Collect address deltas of connected and disconnected blocks for BlockAddressDeltas listeners */
+extern std::atomic_bool fNotifyAddressDeltas;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Whether finalized blk files are memory-mapped and blocks deserialized in place */
+extern bool fMapBlockFiles;
 extern size_t nCoinCacheUsage;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
@@ -196,8 +210,12 @@ extern bool fHavePruned;
 extern bool fPruneMode;
 /** Number of MiB of block files that we're trying to stay below. */
 extern uint64_t nPruneTarget;
+/** Number of blocks whose undo data is kept when not pruning, 0 keeps all. */
+extern int64_t nUndoRetain;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
 static const unsigned int MIN_BLOCKS_TO_KEEP = 1440;
+/** Default for -undoretain */
+static const int64_t DEFAULT_UNDO_RETAIN = 100000;
 /** Minimum blocks required to signal NODE_NETWORK_LIMITED */
 static const unsigned int NODE_NETWORK_LIMITED_MIN_BLOCKS = 1440;
 
@@ -260,6 +278,18 @@ bool LoadBlockIndex(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs
 bool LoadChainTip(const CChainParams& chainparams);
 /** Unload database information */
 void UnloadBlockIndex();
+
+/** Memory held by the block index, for getmemoryinfo */
+struct BlockIndexMemoryStats {
+    size_t nEntries = 0;
+    //! Entries of the active chain, the rest are on side branches or headers only
+    size_t nActiveEntries = 0;
+    size_t nEntryBytes = 0;
+    size_t nMapBytes = 0;
+    //! Merkle roots kept in memory until their entries are written
+    size_t nPendingMerkleRoots = 0;
+};
+BlockIndexMemoryStats GetBlockIndexMemoryStats() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -291,6 +321,9 @@ void PruneOneBlockFile(const int fileNumber);
  */
 void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 
+/** Log a fatal error, tell the user and shut the node down. Returns false. */
+bool AbortNode(const std::string& strMessage, const std::string& userMessage = "");
+
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
 /** Prune block files and flush state to disk. */
@@ -361,6 +394,13 @@ public:
 
     bool operator()();
 
+    /**
+     * Run the script with the signatures that are not in the cache added to
+     * batch instead of verified, see BatchingTransactionSignatureChecker.
+     * Returns false if the script fails even with those taken as valid.
+     */
+    bool RunBatched(CSignatureBatch& batch, std::vector<uint256>& vCacheEntries);
+
     void swap(CScriptCheck &check) {
         std::swap(ptxTo, check.ptxTo);
         std::swap(m_tx_out, check.m_tx_out);
@@ -374,6 +414,14 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Run a group of script checks taken from the script check queue, verifying
+ * their signatures as one batch. Checks whose batched signatures do not all
+ * verify are run again the usual way, so the result is the same as running
+ * each check on its own.
+ */
+bool RunChecks(std::vector<CScriptCheck>& vChecks);
+
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
@@ -416,6 +464,9 @@ public:
 /** Replay blocks that aren't fully applied to the database. */
 bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
 
+/** Roll the transaction and address indexes from their own best blocks to the chain tip. */
+bool ReplayIndexes(const CChainParams& params);
+
 inline CBlockIndex* LookupBlockIndex(const uint256& hash)
 {
     AssertLockHeld(cs_main);
@@ -444,11 +495,14 @@ extern std::unique_ptr<CCoinsViewDB> pcoinsdbview;
 
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern std::unique_ptr<CCoinsViewCache> pcoinsTip;
+/** Reads coins for pcoinsTip ahead of their use (protected by cs_main) */
+extern std::unique_ptr<CCoinsViewPrefetch> pcoinsprefetch;
 
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern std::unique_ptr<CBlockTreeDB> pblocktree;
 extern std::unique_ptr<CTxIndexDB> pblocktxindex;
 extern std::unique_ptr<CAddressIndexDB> pblockaddressindex;
+extern std::unique_ptr<CBlockStatsIndexDB> pblockstatsindex;
 
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
@@ -12,29 +12,190 @@
 #include <util.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <list>
 #include <atomic>
 #include <future>
 
-#include <boost/signals2/signal.hpp>
+#include <boost/bind.hpp>
+
+/**
+ * The ordered callback queue of one subscriber. Like
+ * SingleThreadedSchedulerClient it runs at most one callback at a time on
+ * the scheduler, but queues of different subscribers run concurrently when
+ * the scheduler has more than one thread. Scheduled work holds a reference
+ * to the queue so it can outlive unregistration.
+ */
+class ValidationSubscriber : public std::enable_shared_from_this<ValidationSubscriber>
+{
+public:
+    //! Called with the subscriber, or nullptr once it has been unregistered
+    typedef std::function<void (CValidationInterface*)> Callback;
+
+    CValidationInterface* const m_callbacks;
+    const std::string m_name;
+    const ValidationQueuePolicy m_policy;
+
+    ValidationSubscriber(CScheduler* pscheduler, CValidationInterface* callbacks, const std::string& name, ValidationQueuePolicy policy) :
+        m_callbacks(callbacks), m_name(name), m_policy(policy), m_pscheduler(pscheduler) {}
+
+    void Add(Callback func)
+    {
+        {
+            LOCK(m_cs);
+            m_pending.emplace_back(std::move(func));
+            m_max_pending = std::max(m_max_pending, m_pending.size());
+        }
+        MaybeScheduleProcessQueue();
+    }
+
+    /** Wait until everything queued so far has run */
+    void Sync()
+    {
+        std::promise<void> promise;
+        Add([&promise](CValidationInterface*) {
+            promise.set_value();
+        });
+        promise.get_future().wait();
+    }
+
+    void Deactivate()
+    {
+        LOCK(m_cs);
+        m_active = false;
+    }
+
+    // Processes all remaining queue members on the calling thread, blocking until queue is empty
+    // Must be called after the CScheduler has no remaining processing threads!
+    void EmptyQueue()
+    {
+        assert(!m_pscheduler->AreThreadsServicingQueue());
+        bool should_continue = true;
+        while (should_continue) {
+            ProcessQueue();
+            LOCK(m_cs);
+            should_continue = !m_pending.empty();
+        }
+    }
+
+    size_t CallbacksPending()
+    {
+        LOCK(m_cs);
+        return m_pending.size();
+    }
+
+    ValidationInterfaceStats GetStats()
+    {
+        LOCK(m_cs);
+        return ValidationInterfaceStats{m_name.empty() ? "other" : m_name, m_policy, m_pending.size(), m_max_pending, m_processed, m_total_run_us, m_max_run_us};
+    }
+
+private:
+    CScheduler* const m_pscheduler;
+
+    CCriticalSection m_cs;
+    std::list<Callback> m_pending GUARDED_BY(m_cs);
+    bool m_running GUARDED_BY(m_cs) = false;
+    bool m_active GUARDED_BY(m_cs) = true;
+    size_t m_max_pending GUARDED_BY(m_cs) = 0;
+    uint64_t m_processed GUARDED_BY(m_cs) = 0;
+    int64_t m_total_run_us GUARDED_BY(m_cs) = 0;
+    int64_t m_max_run_us GUARDED_BY(m_cs) = 0;
+
+    void MaybeScheduleProcessQueue()
+    {
+        {
+            LOCK(m_cs);
+            if (m_running) return;
+            if (m_pending.empty()) return;
+        }
+        m_pscheduler->schedule(std::bind(&ValidationSubscriber::ProcessQueue, shared_from_this()));
+    }
+
+    void ProcessQueue()
+    {
+        Callback callback;
+        CValidationInterface* pcallbacks;
+        {
+            LOCK(m_cs);
+            if (m_running) return;
+            if (m_pending.empty()) return;
+            m_running = true;
+
+            callback = std::move(m_pending.front());
+            m_pending.pop_front();
+            pcallbacks = m_active ? m_callbacks : nullptr;
+        }
+
+        // RAII the accounting, the clearing of m_running and calling
+        // MaybeScheduleProcessQueue so that they happen even if callback() throws.
+        struct RAIICallbacksRunning {
+            ValidationSubscriber* instance;
+            const int64_t nStart;
+            explicit RAIICallbacksRunning(ValidationSubscriber* _instance) : instance(_instance), nStart(GetTimeMicros()) {}
+            ~RAIICallbacksRunning() {
+                const int64_t nTime = GetTimeMicros() - nStart;
+                {
+                    LOCK(instance->m_cs);
+                    instance->m_running = false;
+                    instance->m_processed++;
+                    instance->m_total_run_us += nTime;
+                    instance->m_max_run_us = std::max(instance->m_max_run_us, nTime);
+                }
+                instance->MaybeScheduleProcessQueue();
+            }
+        } raiicallbacksrunning(this);
+
+        callback(pcallbacks);
+    }
+};
 
 struct MainSignalsInstance {
-    boost::signals2::signal<void (const CBlockIndex *, const CBlockIndex *, bool fInitialDownload)> UpdatedBlockTip;
-    boost::signals2::signal<void (const CTransactionRef &)> TransactionAddedToMempool;
-    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex, const std::vector<CTransactionRef>&)> BlockConnected;
-    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &)> BlockDisconnected;
-    boost::signals2::signal<void (const CTransactionRef &)> TransactionRemovedFromMempool;
-    boost::signals2::signal<void (const CBlockLocator &)> ChainStateFlushed;
-    boost::signals2::signal<void (int64_t nBestBlockTime, CConnman* connman)> Broadcast;
-    boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
-    boost::signals2::signal<void (const CBlockIndex *, const std::shared_ptr<const CBlock>&)> NewPoWValidBlock;
-
-    // We are not allowed to assume the scheduler only runs in one thread,
-    // but must ensure all callbacks happen in-order, so we end up creating
-    // our own queue here :(
+    CScheduler* m_pscheduler;
+
+    CCriticalSection m_cs_subscribers;
+    //! Registered subscribers in registration order
+    std::vector<std::shared_ptr<ValidationSubscriber>> m_subscribers GUARDED_BY(m_cs_subscribers);
+
+    // Runs CallFunctionInValidationInterfaceQueue functions while nobody is subscribed
     SingleThreadedSchedulerClient m_schedulerClient;
 
-    explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+    explicit MainSignalsInstance(CScheduler *pscheduler) : m_pscheduler(pscheduler), m_schedulerClient(pscheduler) {}
+
+    std::vector<std::shared_ptr<ValidationSubscriber>> GetSubscribers()
+    {
+        LOCK(m_cs_subscribers);
+        return m_subscribers;
+    }
+
+    std::shared_ptr<ValidationSubscriber> FindSubscriber(CValidationInterface* pcallbacks)
+    {
+        LOCK(m_cs_subscribers);
+        for (const auto& sub : m_subscribers) {
+            if (sub->m_callbacks == pcallbacks) return sub;
+        }
+        return nullptr;
+    }
+
+    /** Queue func for every subscriber */
+    template <typename F>
+    void Enqueue(const F& func)
+    {
+        for (const auto& sub : GetSubscribers()) {
+            sub->Add([func](CValidationInterface* pcallbacks) {
+                if (pcallbacks) func(*pcallbacks);
+            });
+        }
+    }
+
+    /** Call func for every subscriber on the calling thread */
+    template <typename F>
+    void Call(const F& func)
+    {
+        for (const auto& sub : GetSubscribers()) {
+            func(*sub->m_callbacks);
+        }
+    }
 };
 
 static CMainSignals g_signals;
@@ -50,13 +211,32 @@ void CMainSignals::UnregisterBackgroundSignalScheduler() {
 
 void CMainSignals::FlushBackgroundCallbacks() {
     if (m_internals) {
+        for (const auto& sub : m_internals->GetSubscribers()) {
+            sub->EmptyQueue();
+        }
         m_internals->m_schedulerClient.EmptyQueue();
     }
 }
 
 size_t CMainSignals::CallbacksPending() {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    size_t nPending = m_internals->m_schedulerClient.CallbacksPending();
+    for (const auto& sub : m_internals->GetSubscribers()) {
+        if (sub->m_policy == ValidationQueuePolicy::WAIT) {
+            nPending = std::max(nPending, sub->CallbacksPending());
+        }
+    }
+    return nPending;
+}
+
+void CMainSignals::LimitBacklog() {
+    AssertLockNotHeld(cs_main);
+    if (!m_internals) return;
+    for (const auto& sub : m_internals->GetSubscribers()) {
+        if (sub->m_policy == ValidationQueuePolicy::WAIT && sub->CallbacksPending() > MAX_VALIDATION_BACKLOG) {
+            sub->Sync();
+        }
+    }
 }
 
 void CMainSignals::RegisterWithMempoolSignals(CTxMemPool& pool) {
@@ -72,47 +252,51 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
-void RegisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.m_internals->UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1, _2, _3));
-    g_signals.m_internals->TransactionAddedToMempool.connect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1));
-    g_signals.m_internals->BlockConnected.connect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1, _2, _3));
-    g_signals.m_internals->BlockDisconnected.connect(boost::bind(&CValidationInterface::BlockDisconnected, pwalletIn, _1));
-    g_signals.m_internals->TransactionRemovedFromMempool.connect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1));
-    g_signals.m_internals->ChainStateFlushed.connect(boost::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, _1));
-    g_signals.m_internals->Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1, _2));
-    g_signals.m_internals->BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
-    g_signals.m_internals->NewPoWValidBlock.connect(boost::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, _1, _2));
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& name, ValidationQueuePolicy policy) {
+    MainSignalsInstance& internals = *g_signals.m_internals;
+    LOCK(internals.m_cs_subscribers);
+    internals.m_subscribers.push_back(std::make_shared<ValidationSubscriber>(internals.m_pscheduler, pwalletIn, name, policy));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.m_internals->BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
-    g_signals.m_internals->Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1, _2));
-    g_signals.m_internals->ChainStateFlushed.disconnect(boost::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, _1));
-    g_signals.m_internals->TransactionAddedToMempool.disconnect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1));
-    g_signals.m_internals->BlockConnected.disconnect(boost::bind(&CValidationInterface::BlockConnected, pwalletIn, _1, _2, _3));
-    g_signals.m_internals->BlockDisconnected.disconnect(boost::bind(&CValidationInterface::BlockDisconnected, pwalletIn, _1));
-    g_signals.m_internals->TransactionRemovedFromMempool.disconnect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1));
-    g_signals.m_internals->UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1, _2, _3));
-    g_signals.m_internals->NewPoWValidBlock.disconnect(boost::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, _1, _2));
+    MainSignalsInstance& internals = *g_signals.m_internals;
+    LOCK(internals.m_cs_subscribers);
+    for (auto it = internals.m_subscribers.begin(); it != internals.m_subscribers.end(); ++it) {
+        if ((*it)->m_callbacks == pwalletIn) {
+            // Callbacks still queued for it are skipped
+            (*it)->Deactivate();
+            internals.m_subscribers.erase(it);
+            break;
+        }
+    }
 }
 
 void UnregisterAllValidationInterfaces() {
     if (!g_signals.m_internals) {
         return;
     }
-    g_signals.m_internals->BlockChecked.disconnect_all_slots();
-    g_signals.m_internals->Broadcast.disconnect_all_slots();
-    g_signals.m_internals->ChainStateFlushed.disconnect_all_slots();
-    g_signals.m_internals->TransactionAddedToMempool.disconnect_all_slots();
-    g_signals.m_internals->BlockConnected.disconnect_all_slots();
-    g_signals.m_internals->BlockDisconnected.disconnect_all_slots();
-    g_signals.m_internals->TransactionRemovedFromMempool.disconnect_all_slots();
-    g_signals.m_internals->UpdatedBlockTip.disconnect_all_slots();
-    g_signals.m_internals->NewPoWValidBlock.disconnect_all_slots();
+    MainSignalsInstance& internals = *g_signals.m_internals;
+    LOCK(internals.m_cs_subscribers);
+    for (const auto& sub : internals.m_subscribers) {
+        sub->Deactivate();
+    }
+    internals.m_subscribers.clear();
 }
 
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func) {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    std::vector<std::shared_ptr<ValidationSubscriber>> subscribers = g_signals.m_internals->GetSubscribers();
+    if (subscribers.empty()) {
+        g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+        return;
+    }
+    // Run func once every subscriber has caught up to this point
+    auto remaining = std::make_shared<std::atomic<size_t>>(subscribers.size());
+    auto pfunc = std::make_shared<std::function<void ()>>(std::move(func));
+    for (const auto& sub : subscribers) {
+        sub->Add([remaining, pfunc](CValidationInterface*) {
+            if (--*remaining == 0) (*pfunc)();
+        });
+    }
 }
 
 void SyncWithValidationInterfaceQueue() {
@@ -125,12 +309,27 @@ void SyncWithValidationInterfaceQueue() {
     promise.get_future().wait();
 }
 
-void CMainSignals::MempoolEntryRemoved(CTransactionRef ptx, MemPoolRemovalReason reason) {
-    if (reason != MemPoolRemovalReason::BLOCK && reason != MemPoolRemovalReason::CONFLICT) {
-        m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
-            m_internals->TransactionRemovedFromMempool(ptx);
-        });
+void SyncWithValidationInterfaceQueue(CValidationInterface* pcallbacks) {
+    AssertLockNotHeld(cs_main);
+    std::shared_ptr<ValidationSubscriber> sub = g_signals.m_internals->FindSubscriber(pcallbacks);
+    if (sub) sub->Sync();
+}
+
+std::vector<ValidationInterfaceStats> GetValidationInterfaceStats() {
+    std::vector<ValidationInterfaceStats> result;
+    if (!g_signals.m_internals) return result;
+    for (const auto& sub : g_signals.m_internals->GetSubscribers()) {
+        result.push_back(sub->GetStats());
     }
+    return result;
+}
+
+void CMainSignals::MempoolEntryRemoved(CTransactionRef ptx, MemPoolRemovalReason reason) {
+    const bool fRemoved = reason != MemPoolRemovalReason::BLOCK && reason != MemPoolRemovalReason::CONFLICT;
+    m_internals->Enqueue([ptx, reason, fRemoved](CValidationInterface& callbacks) {
+        if (fRemoved) callbacks.TransactionRemovedFromMempool(ptx);
+        callbacks.TransactionLeftMempool(ptx, reason);
+    });
 }
 
 void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) {
@@ -138,43 +337,55 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    m_internals->m_schedulerClient.AddToProcessQueue([pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
+    m_internals->Enqueue([pindexNew, pindexFork, fInitialDownload](CValidationInterface& callbacks) {
+        callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     });
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef &ptx) {
-    m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
-        m_internals->TransactionAddedToMempool(ptx);
+    m_internals->Enqueue([ptx](CValidationInterface& callbacks) {
+        callbacks.TransactionAddedToMempool(ptx);
     });
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex, const std::shared_ptr<const std::vector<CTransactionRef>>& pvtxConflicted) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, pindex, pvtxConflicted, this] {
-        m_internals->BlockConnected(pblock, pindex, *pvtxConflicted);
+    m_internals->Enqueue([pblock, pindex, pvtxConflicted](CValidationInterface& callbacks) {
+        callbacks.BlockConnected(pblock, pindex, *pvtxConflicted);
     });
 }
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock> &pblock) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, this] {
-        m_internals->BlockDisconnected(pblock);
+    m_internals->Enqueue([pblock](CValidationInterface& callbacks) {
+        callbacks.BlockDisconnected(pblock);
+    });
+}
+
+void CMainSignals::BlockAddressDeltas(const CBlockIndex *pindex, bool fConnected, const std::shared_ptr<const CAddressDeltas> &pdeltas) {
+    m_internals->Enqueue([pindex, fConnected, pdeltas](CValidationInterface& callbacks) {
+        callbacks.BlockAddressDeltas(pindex, fConnected, pdeltas);
     });
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    m_internals->m_schedulerClient.AddToProcessQueue([locator, this] {
-        m_internals->ChainStateFlushed(locator);
+    m_internals->Enqueue([locator](CValidationInterface& callbacks) {
+        callbacks.ChainStateFlushed(locator);
     });
 }
 
 void CMainSignals::Broadcast(int64_t nBestBlockTime, CConnman* connman) {
-    m_internals->Broadcast(nBestBlockTime, connman);
+    m_internals->Call([nBestBlockTime, connman](CValidationInterface& callbacks) {
+        callbacks.ResendWalletTransactions(nBestBlockTime, connman);
+    });
 }
 
 void CMainSignals::BlockChecked(const CBlock& block, const CValidationState& state) {
-    m_internals->BlockChecked(block, state);
+    m_internals->Call([&block, &state](CValidationInterface& callbacks) {
+        callbacks.BlockChecked(block, state);
+    });
 }
 
 void CMainSignals::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &block) {
-    m_internals->NewPoWValidBlock(pindex, block);
+    m_internals->Call([pindex, &block](CValidationInterface& callbacks) {
+        callbacks.NewPoWValidBlock(pindex, block);
+    });
 }
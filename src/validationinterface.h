@@ -10,11 +10,15 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
+class CAddressKey;
+class CAddressValue;
 class CBlock;
 class CBlockIndex;
 struct CBlockLocator;
-class CBlockIndex;
 class CConnman;
 class CReserveScript;
 class CValidationInterface;
@@ -24,10 +28,40 @@ class CScheduler;
 class CTxMemPool;
 enum class MemPoolRemovalReason;
 
+/** Address index records written while a block is connected or disconnected */
+typedef std::vector<std::pair<CAddressKey, CAddressValue>> CAddressDeltas;
+
+//! Default number of scheduler threads, which deliver callbacks to different subscribers concurrently
+static const int DEFAULT_SCHEDULER_THREADS = 2;
+//! Callbacks a subscriber may fall behind before block connection waits for it
+static const size_t MAX_VALIDATION_BACKLOG = 10;
+
+/** How a subscriber's backlog of queued callbacks affects validation */
+enum class ValidationQueuePolicy {
+    WAIT,    //!< Block connection pauses while the subscriber is more than MAX_VALIDATION_BACKLOG callbacks behind
+    NO_WAIT, //!< Never slows validation down. For subscribers whose callbacks are cheap or that bound their own work.
+};
+
+/** Callback queue statistics of one subscriber */
+struct ValidationInterfaceStats
+{
+    std::string name;
+    ValidationQueuePolicy policy;
+    size_t pending;
+    size_t max_pending;
+    uint64_t processed;
+    int64_t total_run_us;
+    int64_t max_run_us;
+};
+
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
+/**
+ * Register a wallet to receive updates from core. Each subscriber has its
+ * own callback queue, so a slow one only holds up itself and, if its policy
+ * is WAIT, block connection.
+ */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, const std::string& name = "", ValidationQueuePolicy policy = ValidationQueuePolicy::WAIT);
 /** Unregister a wallet from core */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
@@ -52,6 +86,10 @@ void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
  *     promise.get_future().wait();
  */
 void SyncWithValidationInterfaceQueue();
+/** Block until the callbacks generated so far for one subscriber have been processed */
+void SyncWithValidationInterfaceQueue(CValidationInterface* pcallbacks);
+/** Return callback queue statistics for every subscriber */
+std::vector<ValidationInterfaceStats> GetValidationInterfaceStats();
 
 /**
  * Implement this to subscribe to events generated in validation
@@ -66,7 +104,8 @@ void SyncWithValidationInterfaceQueue();
  * UpdatedBlockTip() callback may depend on an operation performed in
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
- * ValidationInterface() subscribers.
+ * ValidationInterface() subscribers, whose callbacks may run at the same
+ * time on different scheduler threads.
  */
 class CValidationInterface {
 protected:
@@ -102,6 +141,13 @@ protected:
      * Called on a background thread.
      */
     virtual void TransactionRemovedFromMempool(const CTransactionRef &ptx) {}
+    /**
+     * Notifies listeners of any transaction leaving mempool, including
+     * those removed because they were included in or conflict with a block.
+     *
+     * Called on a background thread.
+     */
+    virtual void TransactionLeftMempool(const CTransactionRef &ptx, MemPoolRemovalReason reason) {}
     /**
      * Notifies listeners of a block being connected.
      * Provides a vector of transactions evicted from the mempool as a result.
@@ -115,6 +161,15 @@ protected:
      * Called on a background thread.
      */
     virtual void BlockDisconnected(const std::shared_ptr<const CBlock> &block) {}
+    /**
+     * Notifies listeners of the address index records of a block being
+     * connected (fConnected) or disconnected, delivered right before the
+     * corresponding BlockConnected or BlockDisconnected, and so after those
+     * of the blocks before it. Only fires while fNotifyAddressDeltas is set.
+     *
+     * Called on a background thread.
+     */
+    virtual void BlockAddressDeltas(const CBlockIndex *pindex, bool fConnected, const std::shared_ptr<const CAddressDeltas> &deltas) {}
     /**
      * Notifies listeners of the new active block chain on-disk.
      *
@@ -145,9 +200,10 @@ protected:
      * Notifies listeners that a block which builds directly on our current tip
      * has been received and connected to the headers tree, though not validated yet */
     virtual void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) {};
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, const std::string&, ValidationQueuePolicy);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
+    friend class CMainSignals;
 };
 
 struct MainSignalsInstance;
@@ -155,10 +211,12 @@ class CMainSignals {
 private:
     std::unique_ptr<MainSignalsInstance> m_internals;
 
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, const std::string&, ValidationQueuePolicy);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+    friend void ::SyncWithValidationInterfaceQueue(CValidationInterface*);
+    friend std::vector<ValidationInterfaceStats> (::GetValidationInterfaceStats)();
 
     void MempoolEntryRemoved(CTransactionRef tx, MemPoolRemovalReason reason);
 
@@ -170,7 +228,10 @@ public:
     /** Call any remaining callbacks on the calling thread */
     void FlushBackgroundCallbacks();
 
+    /** Number of callbacks queued for the most backlogged subscriber with the WAIT policy */
     size_t CallbacksPending();
+    /** Block until no subscriber with the WAIT policy is more than MAX_VALIDATION_BACKLOG callbacks behind */
+    void LimitBacklog();
 
     /** Register with mempool to call TransactionRemovedFromMempool callbacks */
     void RegisterWithMempoolSignals(CTxMemPool& pool);
@@ -181,6 +242,7 @@ public:
     void TransactionAddedToMempool(const CTransactionRef &);
     void BlockConnected(const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex, const std::shared_ptr<const std::vector<CTransactionRef>> &);
     void BlockDisconnected(const std::shared_ptr<const CBlock> &);
+    void BlockAddressDeltas(const CBlockIndex *, bool fConnected, const std::shared_ptr<const CAddressDeltas> &);
     void ChainStateFlushed(const CBlockLocator &);
     void Broadcast(int64_t nBestBlockTime, CConnman* connman);
     void BlockChecked(const CBlock&, const CValidationState&);
@@ -4,6 +4,7 @@
 
 #include <wallet/wallet.h>
 
+#include <list>
 #include <memory>
 #include <set>
 #include <stdint.h>
@@ -206,7 +207,10 @@ static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64
     CBlockIndex* block = nullptr;
     if (blockTime > 0) {
         LOCK(cs_main);
-        auto inserted = mapBlockIndex.emplace(GetRandHash(), new CBlockIndex);
+        // The block index does not own its entries, keep them for the whole run
+        static std::list<CBlockIndex> entries;
+        entries.emplace_back();
+        auto inserted = mapBlockIndex.emplace(GetRandHash(), &entries.back());
         assert(inserted.second);
         const uint256& hash = inserted.first->first;
         block = inserted.first->second;
@@ -1344,10 +1344,10 @@ void CWallet::BlockUntilSyncedToCurrentChain() {
         }
     }
 
-    // ...otherwise put a callback in the validation interface queue and wait
+    // ...otherwise put a callback in our validation interface queue and wait
     // for the queue to drain enough to execute it (indicating we are caught up
     // at least with the time we entered this function).
-    SyncWithValidationInterfaceQueue();
+    SyncWithValidationInterfaceQueue(this);
 }
 
 
@@ -4383,7 +4383,7 @@ std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(const WalletLocation& loc
     uiInterface.LoadWallet(walletInstance);
 
     // Register with the validation interface. It's ok to do this after rescan since we're still holding cs_main.
-    RegisterValidationInterface(walletInstance.get());
+    RegisterValidationInterface(walletInstance.get(), "wallet");
 
     walletInstance->SetBroadcastTransactions(gArgs.GetBoolArg("-walletbroadcast", DEFAULT_WALLETBROADCAST));
 
@@ -3,15 +3,45 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <zmq/zmqabstractnotifier.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <rpc/server.h>
+#include <streams.h>
 #include <util.h>
+#include <validation.h>
 
+CZMQBlockNotification::CZMQBlockNotification(const CBlockIndex* pindexIn, std::shared_ptr<const CBlock> pblockIn) :
+    pindex(pindexIn), hash(pindexIn->GetBlockHash()), pblock(std::move(pblockIn))
+{
+}
+
+const CZMQPayload& CZMQBlockNotification::GetSerialized() const
+{
+    if (serialized) return serialized;
+
+    std::shared_ptr<std::vector<unsigned char>> data = std::make_shared<std::vector<unsigned char>>();
+    if (pblock) {
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), *data, 0, *pblock);
+    } else {
+        // Only happens if the tip was not announced through BlockConnected
+        CBlock block;
+        LOCK(cs_main);
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            zmqError("Can't read block from disk");
+            return serialized;
+        }
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), *data, 0, block);
+    }
+    serialized = std::move(data);
+    return serialized;
+}
 
 CZMQAbstractNotifier::~CZMQAbstractNotifier()
 {
     assert(!psocket);
 }
 
-bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/)
+bool CZMQAbstractNotifier::NotifyBlock(const CZMQBlockNotification &/*block*/)
 {
     return true;
 }
@@ -20,3 +50,13 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyTransactionRemoval(const CTransaction &/*transaction*/, MemPoolRemovalReason /*reason*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyAddressDeltas(const CBlockIndex * /*pindex*/, bool /*fConnected*/, const CAddressDeltas &/*deltas*/)
+{
+    return true;
+}
@@ -7,15 +7,50 @@
 
 #include <zmq/zmqconfig.h>
 
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class CAddressKey;
+class CAddressValue;
 class CBlockIndex;
 class CZMQAbstractNotifier;
+class CZMQPublisher;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
+enum class MemPoolRemovalReason;
+typedef std::vector<std::pair<CAddressKey, CAddressValue>> CAddressDeltas;
+
+/** Message body, shared by every notifier publishing it until the last send completes */
+typedef std::shared_ptr<const std::vector<unsigned char>> CZMQPayload;
+
+/**
+ * A new tip as handed to the notifiers. The block is the one passed to
+ * BlockConnected, and its network serialization is computed at most once
+ * no matter how many raw block notifiers are active.
+ */
+class CZMQBlockNotification
+{
+public:
+    CZMQBlockNotification(const CBlockIndex* pindex, std::shared_ptr<const CBlock> pblock);
+
+    const CBlockIndex* GetIndex() const { return pindex; }
+    const uint256& GetHash() const { return hash; }
+    const CZMQPayload& GetSerialized() const;
+
+private:
+    const CBlockIndex* pindex;
+    const uint256 hash;
+    const std::shared_ptr<const CBlock> pblock;
+    mutable CZMQPayload serialized;
+};
+
 class CZMQAbstractNotifier
 {
 public:
-    CZMQAbstractNotifier() : psocket(nullptr) { }
+    CZMQAbstractNotifier() : psocket(nullptr), publisher(nullptr), nPublished(0), nDropped(0), nFailed(0) { }
     virtual ~CZMQAbstractNotifier();
 
     template <typename T>
@@ -28,17 +63,29 @@ public:
     void SetType(const std::string &t) { type = t; }
     std::string GetAddress() const { return address; }
     void SetAddress(const std::string &a) { address = a; }
+    void SetPublisher(CZMQPublisher *p) { publisher = p; }
+
+    uint64_t GetPublished() const { return nPublished; }
+    uint64_t GetDropped() const { return nDropped; }
+    uint64_t GetFailed() const { return nFailed; }
 
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
-    virtual bool NotifyBlock(const CBlockIndex *pindex);
+    virtual bool NotifyBlock(const CZMQBlockNotification &block);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyTransactionRemoval(const CTransaction &transaction, MemPoolRemovalReason reason);
+    virtual bool NotifyAddressDeltas(const CBlockIndex *pindex, bool fConnected, const CAddressDeltas &deltas);
 
 protected:
     void *psocket;
+    CZMQPublisher *publisher;
     std::string type;
     std::string address;
+
+    std::atomic<uint64_t> nPublished; //!< messages handed to the socket
+    std::atomic<uint64_t> nDropped;   //!< messages dropped because the publish queue was full
+    std::atomic<uint64_t> nFailed;    //!< messages the socket refused
 };
 
 #endif // BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
@@ -4,6 +4,7 @@
 
 #include <zmq/zmqnotificationinterface.h>
 #include <zmq/zmqpublishnotifier.h>
+#include <zmq/zmqpublisher.h>
 
 #include <version.h>
 #include <validation.h>
@@ -15,7 +16,7 @@ void zmqError(const char *str)
     LogPrint(BCLog::ZMQ, "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr), pindexConnected(nullptr)
 {
 }
 
@@ -48,6 +49,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubmempoolremoval"] = CZMQAbstractNotifier::Create<CZMQPublishMempoolRemovalNotifier>;
+    factories["pubaddressdelta"] = CZMQAbstractNotifier::Create<CZMQPublishAddressDeltaNotifier>;
 
     for (const auto& entry : factories)
     {
@@ -67,6 +70,10 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     {
         notificationInterface = new CZMQNotificationInterface();
         notificationInterface->notifiers = notifiers;
+        notificationInterface->publisher.reset(new CZMQPublisher(std::max<int64_t>(1, gArgs.GetArg("-zmqpubqueue", DEFAULT_ZMQ_PUBLISH_QUEUE))));
+        for (CZMQAbstractNotifier* notifier : notifiers) {
+            notifier->SetPublisher(notificationInterface->publisher.get());
+        }
 
         if (!notificationInterface->Initialize())
         {
@@ -112,6 +119,14 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    // From here on the sockets are only used by the publisher thread
+    publisher->Start();
+
+    // Address deltas are only collected during block connection when asked for
+    for (const CZMQAbstractNotifier* notifier : notifiers) {
+        if (notifier->GetType() == "pubaddressdelta") fNotifyAddressDeltas = true;
+    }
+
     return true;
 }
 
@@ -121,6 +136,9 @@ void CZMQNotificationInterface::Shutdown()
     LogPrint(BCLog::ZMQ, "zmq: Shutdown notification interface\n");
     if (pcontext)
     {
+        fNotifyAddressDeltas = false;
+        // Flush what is queued before the sockets go away
+        publisher->Stop();
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -133,22 +151,39 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
+// Called when a notifier failed, from the validation callback thread
+std::list<CZMQAbstractNotifier*>::iterator CZMQNotificationInterface::RemoveNotifier(std::list<CZMQAbstractNotifier*>::iterator i)
+{
+    CZMQAbstractNotifier *notifier = *i;
+    LogPrint(BCLog::ZMQ, "zmq: Shutdown failed notifier %s at %s\n", notifier->GetType(), notifier->GetAddress());
+    // The publisher thread must be done with its socket before it is closed
+    publisher->Remove(notifier);
+    notifier->Shutdown();
+    return notifiers.erase(i);
+}
+
 void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
 {
+    // BlockConnected for the new tip was delivered just before this
+    std::shared_ptr<const CBlock> pblock = std::move(pblockConnected);
+    if (pindexConnected != pindexNew)
+        pblock.reset();
+    pindexConnected = nullptr;
+
     if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
         return;
 
+    const CZMQBlockNotification block(pindexNew, std::move(pblock));
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindexNew))
+        if (notifier->NotifyBlock(block))
         {
             i++;
         }
         else
         {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+            i = RemoveNotifier(i);
         }
     }
 }
@@ -168,26 +203,66 @@ void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef&
         }
         else
         {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+            i = RemoveNotifier(i);
         }
     }
 }
 
-void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted)
+void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted)
 {
     for (const CTransactionRef& ptx : pblock->vtx) {
         // Do a normal notify for each transaction added in the block
         TransactionAddedToMempool(ptx);
     }
+
+    // Keep the block for the tip notification instead of reading it back from disk
+    pblockConnected = pblock;
+    pindexConnected = pindex;
 }
 
 void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock)
 {
+    pblockConnected.reset();
+    pindexConnected = nullptr;
+
     for (const CTransactionRef& ptx : pblock->vtx) {
         // Do a normal notify for each transaction removed in block disconnection
         TransactionAddedToMempool(ptx);
     }
 }
 
+void CZMQNotificationInterface::TransactionLeftMempool(const CTransactionRef& ptx, MemPoolRemovalReason reason)
+{
+    const CTransaction& tx = *ptx;
+
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyTransactionRemoval(tx, reason))
+        {
+            i++;
+        }
+        else
+        {
+            i = RemoveNotifier(i);
+        }
+    }
+}
+
+void CZMQNotificationInterface::BlockAddressDeltas(const CBlockIndex *pindex, bool fConnected, const std::shared_ptr<const CAddressDeltas>& deltas)
+{
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyAddressDeltas(pindex, fConnected, *deltas))
+        {
+            i++;
+        }
+        else
+        {
+            i = RemoveNotifier(i);
+        }
+    }
+}
+
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
@@ -9,9 +9,11 @@
 #include <string>
 #include <map>
 #include <list>
+#include <memory>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
+class CZMQPublisher;
 
 class CZMQNotificationInterface final : public CValidationInterface
 {
@@ -19,6 +21,7 @@ public:
     virtual ~CZMQNotificationInterface();
 
     std::list<const CZMQAbstractNotifier*> GetActiveNotifiers() const;
+    const CZMQPublisher* GetPublisher() const { return publisher.get(); }
 
     static CZMQNotificationInterface* Create();
 
@@ -30,13 +33,22 @@ protected:
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) override;
+    void TransactionLeftMempool(const CTransactionRef& tx, MemPoolRemovalReason reason) override;
+    void BlockAddressDeltas(const CBlockIndex *pindex, bool fConnected, const std::shared_ptr<const CAddressDeltas>& deltas) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
 
 private:
     CZMQNotificationInterface();
 
+    std::list<CZMQAbstractNotifier*>::iterator RemoveNotifier(std::list<CZMQAbstractNotifier*>::iterator i);
+
     void *pcontext;
     std::list<CZMQAbstractNotifier*> notifiers;
+    std::unique_ptr<CZMQPublisher> publisher;
+
+    //! Last block passed to BlockConnected, published when it becomes the tip
+    std::shared_ptr<const CBlock> pblockConnected;
+    const CBlockIndex *pindexConnected;
 };
 
 extern CZMQNotificationInterface* g_zmq_notification_interface;
@@ -0,0 +1,93 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <zmq/zmqpublisher.h>
+#include <zmq/zmqpublishnotifier.h>
+
+#include <util.h>
+
+#include <algorithm>
+#include <functional>
+
+CZMQPublisher::CZMQPublisher(size_t nMaxQueueIn) :
+    nMaxQueue(nMaxQueueIn), nMaxQueueDepth(0), fRunning(false), fPublishing(false)
+{
+}
+
+CZMQPublisher::~CZMQPublisher()
+{
+    Stop();
+}
+
+void CZMQPublisher::Start()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    if (fRunning) return;
+    fRunning = true;
+    thread = std::thread(&TraceThread<std::function<void()> >, "zmqpub", std::function<void()>(std::bind(&CZMQPublisher::ThreadPublish, this)));
+}
+
+void CZMQPublisher::Stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        fRunning = false;
+    }
+    cond.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+bool CZMQPublisher::Push(CZMQAbstractPublishNotifier *notifier, const char *command, CZMQPayload payload, uint32_t nSequence)
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (!fRunning || queue.size() >= nMaxQueue) {
+            return false;
+        }
+        queue.push_back(Message{notifier, command, std::move(payload), nSequence});
+        nMaxQueueDepth = std::max(nMaxQueueDepth, queue.size());
+    }
+    cond.notify_one();
+    return true;
+}
+
+void CZMQPublisher::Remove(const CZMQAbstractNotifier *notifier)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    queue.erase(std::remove_if(queue.begin(), queue.end(), [notifier](const Message& msg) { return msg.notifier == notifier; }), queue.end());
+    // A batch taken off the queue before may still hold messages for it
+    condIdle.wait(lock, [this] { return !fPublishing; });
+}
+
+size_t CZMQPublisher::GetQueueDepth() const
+{
+    std::unique_lock<std::mutex> lock(cs);
+    return queue.size();
+}
+
+size_t CZMQPublisher::GetMaxQueueDepth() const
+{
+    std::unique_lock<std::mutex> lock(cs);
+    return nMaxQueueDepth;
+}
+
+void CZMQPublisher::ThreadPublish()
+{
+    std::deque<Message> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            fPublishing = false;
+            condIdle.notify_all();
+            cond.wait(lock, [this] { return !fRunning || !queue.empty(); });
+            if (queue.empty()) return; // stopped and drained
+            batch.swap(queue);
+            fPublishing = true;
+        }
+        for (const Message& msg : batch) {
+            msg.notifier->Publish(msg.command, msg.payload, msg.nSequence);
+        }
+        batch.clear();
+    }
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ZMQ_ZMQPUBLISHER_H
+#define BITCOIN_ZMQ_ZMQPUBLISHER_H
+
+#include <zmq/zmqabstractnotifier.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class CZMQAbstractPublishNotifier;
+
+//! Number of notifications that may wait for the publisher thread before new ones are dropped
+static const unsigned int DEFAULT_ZMQ_PUBLISH_QUEUE = 10000;
+
+/**
+ * Moves socket I/O off the validation callback thread. Notifiers queue
+ * messages here and a single thread, the only one touching the sockets
+ * once it runs, sends them in order. When the queue is full new messages
+ * are dropped and counted against their notifier instead of stalling
+ * validation. Sequence numbers are taken before queueing, so subscribers
+ * see a dropped message as a gap.
+ */
+class CZMQPublisher
+{
+public:
+    explicit CZMQPublisher(size_t nMaxQueue);
+    ~CZMQPublisher();
+
+    void Start();
+    /** Publish what is still queued, then join the thread */
+    void Stop();
+
+    /** Queue a message. Returns false if it was dropped. */
+    bool Push(CZMQAbstractPublishNotifier *notifier, const char *command, CZMQPayload payload, uint32_t nSequence);
+    /** Drop the messages queued for a notifier and wait until the thread
+        no longer uses it, so that its socket can be closed */
+    void Remove(const CZMQAbstractNotifier *notifier);
+
+    size_t GetQueueDepth() const;
+    size_t GetMaxQueueDepth() const;
+
+private:
+    struct Message
+    {
+        CZMQAbstractPublishNotifier *notifier;
+        const char *command;
+        CZMQPayload payload;
+        uint32_t nSequence;
+    };
+
+    void ThreadPublish();
+
+    mutable std::mutex cs;
+    std::condition_variable cond;
+    std::condition_variable condIdle;
+    std::deque<Message> queue;
+    const size_t nMaxQueue;
+    size_t nMaxQueueDepth;
+    bool fRunning;
+    //! Whether the thread is sending a batch taken off the queue
+    bool fPublishing;
+    std::thread thread;
+};
+
+#endif // BITCOIN_ZMQ_ZMQPUBLISHER_H
@@ -3,10 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chain.h>
-#include <chainparams.h>
+#include <coins.h>
 #include <streams.h>
+#include <txmempool.h>
+#include <version.h>
 #include <zmq/zmqpublishnotifier.h>
-#include <validation.h>
+#include <zmq/zmqpublisher.h>
 #include <util.h>
 #include <rpc/server.h>
 
@@ -16,50 +18,69 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_MEMPOOLREMOVAL = "mempoolremoval";
+static const char *MSG_ADDRESSDELTA   = "addressdelta";
 
-// Internal function to send multipart message
-static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
+// Internal function to send one part of a multipart message, copying the data
+static int zmq_send_part(void *sock, const void* data, size_t size, int flags)
 {
-    va_list args;
-    va_start(args, size);
+    zmq_msg_t msg;
 
-    while (1)
+    int rc = zmq_msg_init_size(&msg, size);
+    if (rc != 0)
     {
-        zmq_msg_t msg;
-
-        int rc = zmq_msg_init_size(&msg, size);
-        if (rc != 0)
-        {
-            zmqError("Unable to initialize ZMQ msg");
-            va_end(args);
-            return -1;
-        }
+        zmqError("Unable to initialize ZMQ msg");
+        return -1;
+    }
 
-        void *buf = zmq_msg_data(&msg);
-        memcpy(buf, data, size);
+    memcpy(zmq_msg_data(&msg), data, size);
 
-        data = va_arg(args, const void*);
+    rc = zmq_msg_send(&msg, sock, flags);
+    zmq_msg_close(&msg);
+    if (rc == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        return -1;
+    }
+    return 0;
+}
 
-        rc = zmq_msg_send(&msg, sock, data ? ZMQ_SNDMORE : 0);
-        if (rc == -1)
-        {
-            zmqError("Unable to send ZMQ msg");
-            zmq_msg_close(&msg);
-            va_end(args);
-            return -1;
-        }
+// Release the payload reference handed to zmq once it is done with the data
+static void zmq_free_payload(void* /*data*/, void* hint)
+{
+    delete static_cast<CZMQPayload*>(hint);
+}
 
-        zmq_msg_close(&msg);
+// Internal function to send one part of a multipart message without copying
+static int zmq_send_payload(void *sock, const CZMQPayload& payload, int flags)
+{
+    zmq_msg_t msg;
 
-        if (!data)
-            break;
+    CZMQPayload* ref = new CZMQPayload(payload);
+    int rc = zmq_msg_init_data(&msg, const_cast<unsigned char*>(payload->data()), payload->size(), zmq_free_payload, ref);
+    if (rc != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        delete ref;
+        return -1;
+    }
 
-        size = va_arg(args, size_t);
+    // On failure closing the message releases the reference
+    rc = zmq_msg_send(&msg, sock, flags);
+    zmq_msg_close(&msg);
+    if (rc == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        return -1;
     }
-    va_end(args);
     return 0;
 }
 
+static CZMQPayload HashPayload(const uint256& hash)
+{
+    return std::make_shared<const std::vector<unsigned char>>(std::reverse_iterator<const unsigned char*>(hash.end()), std::reverse_iterator<const unsigned char*>(hash.begin()));
+}
+
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 {
     assert(!psocket);
@@ -129,69 +150,113 @@ void CZMQAbstractPublishNotifier::Shutdown()
     psocket = nullptr;
 }
 
-bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, CZMQPayload payload)
+{
+    if (!payload || fSendFailed)
+        return false;
+
+    // A dropped or failed message keeps its number, which tells subscribers that they missed one
+    const uint32_t nSequenceMsg = nSequence++;
+    if (!publisher)
+        return Publish(command, payload, nSequenceMsg);
+
+    if (!publisher->Push(this, command, std::move(payload), nSequenceMsg))
+    {
+        if (nDropped++ == 0)
+            LogPrint(BCLog::ZMQ, "zmq: Publish queue full, dropping %s notifications\n", command);
+    }
+    return true;
+}
+
+bool CZMQAbstractPublishNotifier::Publish(const char *command, const CZMQPayload &payload, uint32_t nSequenceIn)
 {
     assert(psocket);
+    if (fSendFailed)
+        return false;
 
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), nullptr);
-    if (rc == -1)
+    WriteLE32(&msgseq[0], nSequenceIn);
+    if (zmq_send_part(psocket, command, strlen(command), ZMQ_SNDMORE) == -1 ||
+        zmq_send_payload(psocket, payload, ZMQ_SNDMORE) == -1 ||
+        zmq_send_part(psocket, msgseq, sizeof(msgseq), 0) == -1)
+    {
+        nFailed++;
+        fSendFailed = true;
         return false;
+    }
 
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    nPublished++;
 
     return true;
 }
 
-bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishHashBlockNotifier::NotifyBlock(const CZMQBlockNotification &block)
 {
-    uint256 hash = pindex->GetBlockHash();
-    LogPrint(BCLog::ZMQ, "zmq: Publish hashblock %s\n", hash.GetHex());
-    char data[32];
-    for (unsigned int i = 0; i < 32; i++)
-        data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHBLOCK, data, 32);
+    LogPrint(BCLog::ZMQ, "zmq: Publish hashblock %s\n", block.GetHash().GetHex());
+    return SendMessage(MSG_HASHBLOCK, HashPayload(block.GetHash()));
 }
 
 bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
 {
     uint256 hash = transaction.GetHash();
     LogPrint(BCLog::ZMQ, "zmq: Publish hashtx %s\n", hash.GetHex());
-    char data[32];
-    for (unsigned int i = 0; i < 32; i++)
-        data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHTX, data, 32);
+    return SendMessage(MSG_HASHTX, HashPayload(hash));
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlock(const CZMQBlockNotification &block)
 {
-    LogPrint(BCLog::ZMQ, "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
-
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
-    }
-
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    LogPrint(BCLog::ZMQ, "zmq: Publish rawblock %s\n", block.GetHash().GetHex());
+    return SendMessage(MSG_RAWBLOCK, block.GetSerialized());
 }
 
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
 {
     uint256 hash = transaction.GetHash();
     LogPrint(BCLog::ZMQ, "zmq: Publish rawtx %s\n", hash.GetHex());
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    ss << transaction;
-    return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    std::shared_ptr<std::vector<unsigned char>> data = std::make_shared<std::vector<unsigned char>>();
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), *data, 0, transaction);
+    return SendMessage(MSG_RAWTX, std::move(data));
+}
+
+bool CZMQPublishMempoolRemovalNotifier::NotifyTransactionRemoval(const CTransaction &transaction, MemPoolRemovalReason reason)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish mempoolremoval %s\n", hash.GetHex());
+    std::vector<unsigned char> data(std::reverse_iterator<const unsigned char*>(hash.end()), std::reverse_iterator<const unsigned char*>(hash.begin()));
+    data.push_back(static_cast<unsigned char>(reason));
+    return SendMessage(MSG_MEMPOOLREMOVAL, std::make_shared<const std::vector<unsigned char>>(std::move(data)));
+}
+
+template <typename Stream>
+static void WriteHashReversed(Stream& s, const uint256& hash)
+{
+    unsigned char data[32];
+    std::reverse_copy(hash.begin(), hash.end(), data);
+    s.write((const char*)data, sizeof(data));
+}
+
+bool CZMQPublishAddressDeltaNotifier::NotifyAddressDeltas(const CBlockIndex *pindex, bool fConnected, const CAddressDeltas &deltas)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish addressdelta %s (%u records)\n", pindex->GetBlockHash().GetHex(), deltas.size());
+
+    /* block hash, LE32 height, connected flag, then the records in index order */
+    std::shared_ptr<std::vector<unsigned char>> data = std::make_shared<std::vector<unsigned char>>();
+    CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION, *data, 0);
+    WriteHashReversed(writer, pindex->GetBlockHash());
+    writer << (uint32_t)pindex->nHeight << (uint8_t)fConnected;
+    WriteCompactSize(writer, deltas.size());
+    for (const auto& delta : deltas) {
+        const CAddressKey& key = delta.first;
+        const CAddressValue& value = delta.second;
+        uint8_t flags = (value.iscoinbase ? 1 : 0) | (value.spend_height != 0 ? 2 : 0);
+        writer << key.script.GetScript();
+        WriteHashReversed(writer, key.out.hash);
+        writer << key.out.n << value.value << value.height << flags;
+        if (value.spend_height != 0) {
+            WriteHashReversed(writer, value.spend_hash);
+            writer << value.spend_n;
+        }
+    }
+    return SendMessage(MSG_ADDRESSDELTA, std::move(data));
 }
@@ -12,17 +12,26 @@ class CBlockIndex;
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence; //!< upcounting per message sequence number
+    uint32_t nSequence{0U}; //!< upcounting per message sequence number, taken when a message is queued
+    std::atomic<bool> fSendFailed{false}; //!< set by the publisher thread when the socket refused a message
 
 public:
 
+    /* queue a message for the publisher thread, or publish it right away
+       if there is none. Returns false if the message could not be
+       published or an earlier one failed to send, after which the
+       notifier is shut down; a message dropped from a full queue is just
+       counted. */
+    bool SendMessage(const char *command, CZMQPayload payload);
+
     /* send zmq multipart message
        parts:
           * command
-          * data
+          * data (sent without copying, the payload is released by zmq)
           * message sequence number
+       nothing is sent after a failure
     */
-    bool SendMessage(const char *command, const void* data, size_t size);
+    bool Publish(const char *command, const CZMQPayload &payload, uint32_t nSequenceIn);
 
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
@@ -31,7 +40,7 @@ public:
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyBlock(const CZMQBlockNotification &block) override;
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -43,7 +52,7 @@ public:
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyBlock(const CZMQBlockNotification &block) override;
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -52,4 +61,16 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+class CZMQPublishMempoolRemovalNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransactionRemoval(const CTransaction &transaction, MemPoolRemovalReason reason) override;
+};
+
+class CZMQPublishAddressDeltaNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyAddressDeltas(const CBlockIndex *pindex, bool fConnected, const CAddressDeltas &deltas) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
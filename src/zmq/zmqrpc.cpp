@@ -7,6 +7,7 @@
 #include <rpc/server.h>
 #include <zmq/zmqabstractnotifier.h>
 #include <zmq/zmqnotificationinterface.h>
+#include <zmq/zmqpublisher.h>
 
 #include <univalue.h>
 
@@ -22,7 +23,12 @@ UniValue getzmqnotifications(const JSONRPCRequest& request)
             "[\n"
             "  {                        (json object)\n"
             "    \"type\": \"pubhashtx\",   (string) Type of notification\n"
-            "    \"address\": \"...\"       (string) Address of the publisher\n"
+            "    \"address\": \"...\",      (string) Address of the publisher\n"
+            "    \"published\": n,        (numeric) Number of messages sent\n"
+            "    \"dropped\": n,          (numeric) Number of messages dropped because the publish queue was full\n"
+            "    \"failed\": n,           (numeric) Number of messages the socket refused\n"
+            "    \"queue_depth\": n,      (numeric) Messages of all notifiers waiting to be published\n"
+            "    \"max_queue_depth\": n   (numeric) Highest queue depth seen\n"
             "  },\n"
             "  ...\n"
             "]\n"
@@ -34,10 +40,18 @@ UniValue getzmqnotifications(const JSONRPCRequest& request)
 
     UniValue result(UniValue::VARR);
     if (g_zmq_notification_interface != nullptr) {
+        const CZMQPublisher* publisher = g_zmq_notification_interface->GetPublisher();
+        const size_t queue_depth = publisher ? publisher->GetQueueDepth() : 0;
+        const size_t max_queue_depth = publisher ? publisher->GetMaxQueueDepth() : 0;
         for (const auto* n : g_zmq_notification_interface->GetActiveNotifiers()) {
             UniValue obj(UniValue::VOBJ);
             obj.pushKV("type", n->GetType());
             obj.pushKV("address", n->GetAddress());
+            obj.pushKV("published", n->GetPublished());
+            obj.pushKV("dropped", n->GetDropped());
+            obj.pushKV("failed", n->GetFailed());
+            obj.pushKV("queue_depth", (uint64_t)queue_depth);
+            obj.pushKV("max_queue_depth", (uint64_t)max_queue_depth);
             result.push_back(obj);
         }
     }
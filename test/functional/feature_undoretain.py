@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+# Copyright (c) 2023 Uladzimir (t.me/cryptadev)
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test -undoretain.
+
+-fastprune makes the block files small, so a short chain is spread over
+several of them. Check that
+- rev files with no block in the retention window are deleted, their blk
+  files are kept
+- reorgs within the window still work, before and after a restart
+- a reorg past the window is refused without disconnecting any block
+"""
+import os
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_raises_rpc_error
+
+RETAIN = 1440
+
+class UndoRetainTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-fastprune", "-undoretain=%d" % RETAIN]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def block_files(self, prefix):
+        blocksdir = os.path.join(self.nodes[0].datadir, "regtest", "blocks")
+        return sorted(f for f in os.listdir(blocksdir) if f.startswith(prefix) and f.endswith(".dat"))
+
+    def reorg_within_window(self):
+        node = self.nodes[0]
+        height = node.getblockcount()
+        blockhash = node.getblockhash(height - RETAIN + 10)
+        node.invalidateblock(blockhash)
+        assert_equal(node.getblockcount(), height - RETAIN + 9)
+        node.reconsiderblock(blockhash)
+        assert_equal(node.getblockcount(), height)
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        self.log.info("Retention below the minimum is rejected")
+        self.stop_node(0)
+        node.assert_start_raises_init_error(["-undoretain=100"], "Error: Undo retention configured below the minimum of %d blocks." % RETAIN)
+        self.start_node(0)
+
+        self.log.info("Mine a chain over several block files")
+        for _ in range(24):
+            node.generate(100)
+        height = node.getblockcount()
+        blk_files = self.block_files("blk")
+        rev_files = self.block_files("rev")
+        assert len(blk_files) > 4
+        self.log.info("%d blk files, %d rev files" % (len(blk_files), len(rev_files)))
+        assert "rev00000.dat" not in rev_files
+        assert 0 < len(rev_files) < len(blk_files)
+        # Only the oldest rev files are gone
+        assert_equal(rev_files, ["rev" + f[3:] for f in blk_files[-len(rev_files):]])
+        # Blocks below the window are still served
+        assert_equal(node.getblock(node.getblockhash(1))["height"], 1)
+
+        self.log.info("Reorg within the retention window")
+        self.reorg_within_window()
+
+        self.log.info("Reorg past the retention window is refused")
+        tip = node.getbestblockhash()
+        assert_raises_rpc_error(-20, "undo data needed to reorganize to height 99 is no longer available", node.invalidateblock, node.getblockhash(100))
+        assert_equal(node.getbestblockhash(), tip)
+        assert_equal(node.getchaintips(), [{"height": height, "hash": tip, "branchlen": 0, "status": "active"}])
+
+        self.log.info("Retained undo data is kept across a restart")
+        self.restart_node(0)
+        assert_equal(self.block_files("rev"), rev_files)
+        self.reorg_within_window()
+
+        self.log.info("Undo data leaving the window after the restart is deleted")
+        node.generate(600)
+        assert rev_files[0] not in self.block_files("rev")
+        self.reorg_within_window()
+
+if __name__ == '__main__':
+    UndoRetainTest().main()
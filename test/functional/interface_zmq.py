@@ -9,8 +9,10 @@ from test_framework.test_framework import BitcoinTestFramework
 from test_framework.messages import CTransaction
 from test_framework.util import (
     assert_equal,
+    assert_greater_than,
     bytes_to_hex_str,
     hash256,
+    wait_until,
 )
 from io import BytesIO
 
@@ -78,6 +80,8 @@ class ZMQTest (BitcoinTestFramework):
     def run_test(self):
         try:
             self._zmq_test()
+            self._zmq_address_delta_order_test()
+            self._zmq_queue_overflow_test()
         finally:
             # Destroy the ZMQ context.
             self.log.debug("Destroying ZMQ context")
@@ -122,5 +126,120 @@ class ZMQTest (BitcoinTestFramework):
         hex = self.rawtx.receive()
         assert_equal(payment_txid, bytes_to_hex_str(hash256(hex)))
 
+    def _zmq_address_delta_order_test(self):
+        import zmq
+
+        self.log.info("Connect several blocks in one step and check that each block's addressdelta comes right before its transactions")
+        address = "tcp://127.0.0.1:28334"
+        socket = self.zmq_context.socket(zmq.SUB)
+        socket.setsockopt(zmq.SUBSCRIBE, b"addressdelta")
+        socket.setsockopt(zmq.SUBSCRIBE, b"hashtx")
+        socket.connect(address)
+        self.restart_node(0, ["-zmqpubaddressdelta=%s" % address, "-zmqpubhashtx=%s" % address])
+        node = self.nodes[0]
+
+        # Wait for the subscription to reach the node
+        socket.set(zmq.RCVTIMEO, 1000)
+        for _ in range(30):
+            node.generate(1)
+            try:
+                socket.recv_multipart()
+                break
+            except zmq.error.Again:
+                pass
+        while True:
+            try:
+                topic, body, seq = socket.recv_multipart()
+            except zmq.error.Again:
+                break
+        socket.set(zmq.RCVTIMEO, 60000)
+
+        def receive():
+            topic, body, seq = socket.recv_multipart()
+            return topic, body
+
+        hashes = node.generate(3)
+        for _ in hashes:
+            receive()  # addressdelta
+            receive()  # coinbase hashtx
+
+        # Disconnecting three blocks and connecting them again in one
+        # ActivateBestChain step notifies block by block
+        node.invalidateblock(hashes[0])
+        for h in reversed(hashes):
+            topic, body = receive()
+            assert_equal(topic, b"addressdelta")
+            assert_equal(body[36], 0)
+            assert_equal(struct.unpack('<I', body[32:36])[0], node.getblockheader(h)["height"])
+            topic, body = receive()
+            assert_equal((topic, bytes_to_hex_str(body)), (b"hashtx", node.getblock(h)["tx"][0]))
+        node.reconsiderblock(hashes[0])
+        for h in hashes:
+            topic, body = receive()
+            assert_equal(topic, b"addressdelta")
+            assert_equal(body[36], 1)
+            assert_equal(struct.unpack('<I', body[32:36])[0], node.getblockheader(h)["height"])
+            topic, body = receive()
+            assert_equal((topic, bytes_to_hex_str(body)), (b"hashtx", node.getblock(h)["tx"][0]))
+        assert_equal(node.getbestblockhash(), hashes[-1])
+        socket.close()
+
+    def _zmq_queue_overflow_test(self):
+        import zmq
+
+        self.log.info("Overflow the publish queue and check that drops leave sequence gaps")
+        address = "tcp://127.0.0.1:28333"
+        socket = self.zmq_context.socket(zmq.SUB)
+        socket.set(zmq.RCVTIMEO, 1000)
+        socket.setsockopt(zmq.SUBSCRIBE, b"hashblock")
+        socket.connect(address)
+        # Every block queues a hashblock and a rawblock message at once, so a
+        # queue of one has to drop some of them
+        self.restart_node(0, ["-zmqpubhashblock=%s" % address, "-zmqpubrawblock=%s" % address, "-zmqpubqueue=1"])
+        node = self.nodes[0]
+
+        def settle():
+            # Receive until the publisher has been quiet for a second, then
+            # read the counters it left behind
+            node.syncwithvalidationinterfacequeue()
+            wait_until(lambda: all(n["queue_depth"] == 0 for n in node.getzmqnotifications()), timeout=30)
+            seqs = []
+            while True:
+                try:
+                    topic, body, seq = socket.recv_multipart()
+                except zmq.error.Again:
+                    break
+                assert_equal(topic, b"hashblock")
+                seqs.append(struct.unpack('<I', seq)[-1])
+            counts = [n for n in node.getzmqnotifications() if n["type"] == "pubhashblock"][0]
+            return counts, seqs
+
+        # Wait for the subscription to reach the node, since messages sent
+        # before that are lost without a trace
+        for _ in range(30):
+            node.generate(1)
+            start, seqs = settle()
+            if seqs:
+                break
+        assert seqs
+        start_seq = start["published"] + start["dropped"] + start["failed"]
+
+        for _ in range(10):
+            node.generate(20)
+            counts, seqs = settle()
+            if counts["dropped"] > start["dropped"]:
+                break
+        assert_greater_than(counts["dropped"], start["dropped"])
+
+        # Every queued message took a sequence number, delivered or not
+        assert_equal(len(seqs), counts["published"] - start["published"])
+        assert seqs == sorted(set(seqs))
+        assert_greater_than(seqs[0], start_seq - 1)
+        end_seq = counts["published"] + counts["dropped"] + counts["failed"]
+        assert_greater_than(end_seq, seqs[-1])
+        missed = (end_seq - start_seq) - len(seqs)
+        assert_equal(missed, (counts["dropped"] - start["dropped"]) + (counts["failed"] - start["failed"]))
+        socket.close()
+
 if __name__ == '__main__':
     ZMQTest().main()
@@ -28,9 +28,12 @@ class RPCZMQTest(BitcoinTestFramework):
         assert_equal(self.nodes[0].getzmqnotifications(), [])
 
         self.restart_node(0, extra_args=["-zmqpubhashtx=%s" % self.address])
-        assert_equal(self.nodes[0].getzmqnotifications(), [
-            {"type": "pubhashtx", "address": self.address},
+        notifications = self.nodes[0].getzmqnotifications()
+        assert_equal([(n["type"], n["address"]) for n in notifications], [
+            ("pubhashtx", self.address),
         ])
+        assert_equal(notifications[0]["dropped"], 0)
+        assert_equal(notifications[0]["failed"], 0)
 
 
 if __name__ == '__main__':